@@ -27,32 +27,99 @@ KAPI void _darray_field_set(void* array, u64 field, u64 value);
 
 KAPI void* _darray_resize(void* array);
 
+/**
+ * @brief Ensures the array can hold at least capacity elements without growing.
+ * @return The array, which may have moved.
+ */
+KAPI void* _darray_reserve(void* array, u64 capacity);
+
+/**
+ * @brief Releases the capacity beyond the current length.
+ * @return The array, which may have moved.
+ */
+KAPI void* _darray_shrink_to_fit(void* array);
+
 KAPI void* _darray_push(void* array, const void* value_ptr);
 KAPI void _darray_pop(void* array, void* dest);
 
+/**
+ * @brief Appends count copies of the element at value_ptr, growing at most once.
+ * @return The array, which may have moved.
+ */
+KAPI void* _darray_push_n(void* array, const void* value_ptr, u64 count);
+
+/**
+ * @brief Appends count consecutive elements starting at values, growing at most once.
+ * @return The array, which may have moved.
+ */
+KAPI void* _darray_append_array(void* array, const void* values, u64 count);
+
 KAPI void* _darray_pop_at(void* array, u64 index, void* dest);
 KAPI void* _darray_insert_at(void* array, u64 index, void* value_ptr);
 
 #define DARRAY_DEFAULT_CAPACITY 1
 #define DARRAY_RESIZE_FACTOR 2
 
+// The header fields live just before the elements, so they are read here rather than
+// through a call into the engine library.
+#define DARRAY_HEADER(array) ((u64*)(array) - DARRAY_FIELD_LENGTH)
+
+KINLINE u64 _darray_capacity(const void* array) {
+    return ((const u64*)array - DARRAY_FIELD_LENGTH)[DARRAY_CAPACITY];
+}
+
+KINLINE u64 _darray_length(const void* array) {
+    return ((const u64*)array - DARRAY_FIELD_LENGTH)[DARRAY_LENGTH];
+}
+
+KINLINE u64 _darray_stride(const void* array) {
+    return ((const u64*)array - DARRAY_FIELD_LENGTH)[DARRAY_STRIDE];
+}
+
+// Appends in place while there is capacity; only growing calls into the library.
+KINLINE void* _darray_push_inline(void* array, const void* value_ptr) {
+    u64* header = DARRAY_HEADER(array);
+    u64 length = header[DARRAY_LENGTH];
+    if (length >= header[DARRAY_CAPACITY]) {
+        return _darray_push(array, value_ptr);
+    }
+    __builtin_memcpy((u8*)array + length * header[DARRAY_STRIDE], value_ptr, header[DARRAY_STRIDE]);
+    header[DARRAY_LENGTH] = length + 1;
+    return array;
+}
+
 #define darray_create(type) \
     _darray_create(DARRAY_DEFAULT_CAPACITY, sizeof(type))
 
-#define darray_reserve(type, capacity) \
+#define darray_create_with_capacity(type, capacity) \
     _darray_create(capacity, sizeof(type))
 
 #define darray_destroy(array) _darray_destroy(array);
 
-#define darray_push(array, value)           \
-    {                                       \
-        typeof(value) temp = value;         \
-        array = _darray_push(array, &temp); \
+#define darray_reserve(array, capacity) \
+    array = _darray_reserve(array, capacity)
+
+#define darray_shrink_to_fit(array) \
+    array = _darray_shrink_to_fit(array)
+
+#define darray_push(array, value)                  \
+    {                                              \
+        typeof(value) temp = value;                \
+        array = _darray_push_inline(array, &temp); \
     }
 // NOTE: could use __auto_type for temp above, but intellisense
 // for VSCode flags it as an unknown type. typeof() seems to
 // work just fine, though. Both are GNU extensions.
 
+#define darray_push_n(array, value, count)           \
+    {                                                \
+        typeof(value) temp = value;                  \
+        array = _darray_push_n(array, &temp, count); \
+    }
+
+#define darray_append_array(array, values, count) \
+    array = _darray_append_array(array, values, count)
+
 #define darray_pop(array, value_ptr) \
     _darray_pop(array, value_ptr)
 
@@ -66,19 +133,19 @@ KAPI void* _darray_insert_at(void* array, u64 index, void* value_ptr);
     _darray_pop_at(array, index, value_ptr)
 
 #define darray_clear(array) \
-    _darray_field_set(array, DARRAY_LENGTH, 0)
+    (DARRAY_HEADER(array)[DARRAY_LENGTH] = 0)
 
 #define darray_capacity(array) \
-    _darray_field_get(array, DARRAY_CAPACITY)
+    _darray_capacity(array)
 
 #define darray_length(array) \
-    _darray_field_get(array, DARRAY_LENGTH)
+    _darray_length(array)
 
 #define darray_stride(array) \
-    _darray_field_get(array, DARRAY_STRIDE)
+    _darray_stride(array)
 
 #define darray_length_set(array, value) \
-    _darray_field_set(array, DARRAY_LENGTH, value)
+    (DARRAY_HEADER(array)[DARRAY_LENGTH] = (value))
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "../defines.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Hashes a block of bytes with wyhash, a fast non-cryptographic hash which
+ * consumes 16 to 48 bytes per step using 64x64->128 bit multiplies. Not suitable
+ * where an attacker controls the input and collisions matter.
+ *
+ * @param data The bytes to hash. May be 0 if length is 0.
+ * @param length The number of bytes.
+ * @param seed Selects an independent hash function. Pass 0 unless two different hashes of the same data are needed.
+ * @return The 64-bit hash.
+ */
+KAPI u64 hash_bytes(const void* data, u64 length, u64 seed);
+
+/**
+ * @brief Hashes a null-terminated string, not including the terminator. Case-sensitive.
+ */
+KAPI u64 hash_string(const char* str);
+
+/**
+ * @brief Mixes the bits of a 64-bit integer, for hashing integer keys.
+ */
+KAPI u64 hash_u64(u64 value);
+
+#ifdef __cplusplus
+}
+#endif
@@ -2,56 +2,107 @@
 
 #include "../defines.h"
 
+// The number of slots whose metadata is matched at once when probing.
+#define HASHTABLE_GROUP_WIDTH 16
+
+// The stored key of one slot.
+typedef struct HashTableKey {
+    u64 hash;
+    union {
+        // A copy of the name, owned by the table, for tables keyed by name.
+        char* name;
+        // The key itself, for tables keyed by id.
+        u64 id;
+    };
+} HashTableKey;
 
 /**
- * @brief Represents a simple HashTable. Members of this structure
+ * @brief Represents a HashTable. Members of this structure
  * should not be modified outside the functions associated with it.
- * 
- * For non-pointer types, table retains a copy of the value.For 
+ *
+ * For non-pointer types, table retains a copy of the value.For
  * pointer types, make sure to use the _ptr setter and getter. Table
  * does not take ownership of pointers or associated memory allocations,
  * and should be managed externally.
+ *
+ * Entries are keyed either by name (a copy of which is kept) or by a
+ * u64 id, but a single table should only use one kind of key. Colliding
+ * keys are resolved with open addressing: every slot has a byte of metadata
+ * holding 7 bits of its key's hash, and a whole group of slots is matched
+ * against that in one step before any keys are compared.
  */
-typedef struct HashTable{
+typedef struct HashTable {
     u64 elementSize;
-    u64 elementCount;
+    // The number of slots, always a power of two.
+    u32 capacity;
+    // The number of entries currently stored.
+    u32 count;
+    // The number of slots left unusable by removals until the next rehash.
+    u32 tombstones;
     b8 isPointerType;
+    // True if the table allocated its memory, and so can grow.
+    b8 ownsMemory;
+    // True if hashtable_fill has set a value to return for missing entries.
+    b8 hasDefault;
+    // True once an entry has been keyed by id rather than by name.
+    b8 isIdKeyed;
+    // Holds the keys, then the values and the default value, then the slot metadata.
     void* memory;
+    // capacity + HASHTABLE_GROUP_WIDTH bytes of slot metadata.
+    u8* control;
+    HashTableKey* keys;
+} HashTable;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Obtains the amount of memory required by a HashTable that is
+ * to hold up to element_count entries without growing.
+ *
+ * @param element_size The size of each element in bytes.
+ * @param element_count The number of entries the table must be able to hold.
+ * @return The required number of bytes.
+ */
+KAPI u64 hashtable_memory_requirement(u64 element_size, u32 element_count);
 
-}HashTable;
 /**
  * @brief Creates a HashTable and stores it in out_hashtable.
- * 
+ *
  * @param element_size The size of each element in bytes.
- * @param element_count The maximum number of elements. Cannot be resized.
- * @param memory A block of memory to be used. Should be equal in size to element_size * element_count;
+ * @param element_count The number of entries the table must be able to hold.
+ * @param memory A block of hashtable_memory_requirement(element_size, element_count) bytes to be used,
+ * in which case the table cannot be resized and allocates nothing but copies of names. It must be
+ * aligned to 8 bytes. Pass 0 to have the table allocate its own memory and grow as entries are added.
  * @param is_pointer_type Indicates if this HashTable will hold pointer types.
  * @param out_hashtable A pointer to a HashTable in which to hold relevant data.
  */
 KAPI void hashtable_create(u64 element_size, u32 element_count, void* memory, b8 is_pointer_type, HashTable* out_hashtable);
 
 /**
- * @brief Destroys the provided HashTable. Does not release memory for pointer types.
- * 
+ * @brief Destroys the provided HashTable, releasing its copies of keys. Does not release memory for pointer types.
+ *
  * @param table A pointer to the table to be destroyed.
  */
 KAPI void hashtable_destroy(HashTable* table);
 
 /**
- * @brief Stores a copy of the data in value in the provided HashTable. 
+ * @brief Stores a copy of the data in value in the provided HashTable.
  * Only use for tables which were *NOT* created with is_pointer_type = true.
- * 
+ *
  * @param table A pointer to the table to get from. Required.
  * @param name The name of the entry to set. Required.
  * @param value The value to be set. Required.
- * @return True, or false if a null pointer is passed.
+ * @return True, or false if a null pointer is passed or the table is full.
  */
 KAPI b8 hashtable_set(HashTable* table, const char* name, void* value);
 
 /**
  * @brief Stores a pointer as provided in value in the HashTable.
  * Only use for tables which were created with is_pointer_type = true.
- * 
+ *
  * @param table A pointer to the table to get from. Required.
  * @param name The name of the entry to set. Required.
  * @param value A pointer value to be set. Can pass 0 to 'unset' an entry.
@@ -62,18 +113,18 @@ KAPI b8 hashtable_set_ptr(HashTable* table, const char* name, void** value);
 /**
  * @brief Obtains a copy of data present in the HashTable.
  * Only use for tables which were *NOT* created with is_pointer_type = true.
- * 
+ *
  * @param table A pointer to the table to retrieved from. Required.
  * @param name The name of the entry to retrieved. Required.
  * @param value A pointer to store the retrieved value. Required.
- * @return True; or false if a null pointer is passed.
+ * @return True if found, or if the table has been filled with a default value which was retrieved instead; otherwise false.
  */
 KAPI b8 hashtable_get(HashTable* table, const char* name, void* out_value);
 
 /**
  * @brief Obtains a pointer to data present in the HashTable.
  * Only use for tables which were created with is_pointer_type = true.
- * 
+ *
  * @param table A pointer to the table to retrieved from. Required.
  * @param name The name of the entry to retrieved. Required.
  * @param value A pointer to store the retrieved value. Required.
@@ -82,12 +133,57 @@ KAPI b8 hashtable_get(HashTable* table, const char* name, void* out_value);
 KAPI b8 hashtable_get_ptr(HashTable* table, const char* name, void** out_value);
 
 /**
- * @brief Fills all entries in the HashTable with the given value.
+ * @brief Removes the entry with the given name, if there is one.
+ *
+ * @param table A pointer to the table. Required.
+ * @param name The name of the entry to remove. Required.
+ * @return True if an entry was removed; otherwise false.
+ */
+KAPI b8 hashtable_remove(HashTable* table, const char* name);
+
+/**
+ * @brief Versions of hashtable_set, hashtable_get and hashtable_remove which take the
+ * hash of the name, as computed by hash_string, instead of computing it. Callers that
+ * look the same name up several times can hash it once and pass that along.
+ */
+KAPI b8 hashtable_set_hashed(HashTable* table, const char* name, u64 hash, void* value);
+KAPI b8 hashtable_get_hashed(HashTable* table, const char* name, u64 hash, void* out_value);
+KAPI b8 hashtable_remove_hashed(HashTable* table, const char* name, u64 hash);
+
+/**
+ * @brief Stores a copy of the data in value under an integer key.
+ * Only use for tables which were *NOT* created with is_pointer_type = true.
+ *
+ * @return True, or false if a null pointer is passed or the table is full.
+ */
+KAPI b8 hashtable_set_id(HashTable* table, u64 id, void* value);
+
+/**
+ * @brief Obtains a copy of the data stored under an integer key.
+ * Only use for tables which were *NOT* created with is_pointer_type = true.
+ *
+ * @return True if found, or if the table has been filled with a default value which was retrieved instead; otherwise false.
+ */
+KAPI b8 hashtable_get_id(HashTable* table, u64 id, void* out_value);
+
+/**
+ * @brief Removes the entry stored under an integer key, if there is one.
+ *
+ * @return True if an entry was removed; otherwise false.
+ */
+KAPI b8 hashtable_remove_id(HashTable* table, u64 id);
+
+/**
+ * @brief Sets the value that hashtable_get returns for names that are not present.
  * Useful when non-existent names should return some default value.
  * Should not be used with pointer table types.
- * 
+ *
  * @param table A pointer to the table filled. Required.
  * @param value The value to be filled with. Required.
  * @return True if successful; otherwise false.
  */
 KAPI b8 hashtable_fill(HashTable* table, void* value);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,341 @@
+#pragma once
+
+/* Engine-native C++ containers. They allocate through kallocate, so their memory shows up
+   under a memory tag in the stats instead of being hidden in the C++ runtime heap.
+
+   kspan<T>                 A non-owning view of contiguous elements.
+   kvector<T, N, Tag>       A growable array that keeps up to N elements inline before
+                            allocating. N defaults to 0 and Tag to MEMORY_TAG_RENDERER.
+   kfixed_vector<T, N>      An array of at most N elements, stored inline. Never allocates.
+
+   A kvector whose bytes are all zero is a valid empty vector, so one may live inside a
+   structure obtained from kallocate without being constructed. Containers are move-only;
+   copies are made explicitly with assign(). */
+
+#ifndef __cplusplus
+#error "containers/kvector.h may only be included from C++."
+#endif
+
+#include "../defines.h"
+#include "../kohi_asserts.h"
+#include "../memory/kmemory.h"
+
+#include <new>
+#include <type_traits>
+
+template <typename T>
+struct kspan {
+    T* elements;
+    u64 count;
+
+    constexpr kspan() : elements(nullptr), count(0) {}
+    constexpr kspan(T* elements, u64 count) : elements(elements), count(count) {}
+    template <u64 N>
+    constexpr kspan(T (&array)[N]) : elements(array), count(N) {}
+    // A span of T may be viewed as a span of const T.
+    template <typename U, typename = typename std::enable_if<std::is_same<const U, T>::value>::type>
+    constexpr kspan(kspan<U> other) : elements(other.elements), count(other.count) {}
+
+    T* data() const { return elements; }
+    u64 size() const { return count; }
+    b8 empty() const { return count == 0; }
+    T* begin() const { return elements; }
+    T* end() const { return elements + count; }
+    T& operator[](u64 index) const {
+        KASSERT_DEBUG(index < count);
+        return elements[index];
+    }
+};
+
+namespace kcontainers_internal {
+// Inline element storage. Specialised for zero elements, which C++ does not allow as an array.
+template <typename T, u64 N>
+struct InlineStorage {
+    alignas(T) u8 bytes[N * sizeof(T)];
+    T* get() { return reinterpret_cast<T*>(bytes); }
+    const T* get() const { return reinterpret_cast<const T*>(bytes); }
+};
+template <typename T>
+struct InlineStorage<T, 0> {
+    T* get() { return nullptr; }
+    const T* get() const { return nullptr; }
+};
+
+template <typename T>
+void destroy_range(T* elements, u64 count) {
+    if (!std::is_trivially_destructible<T>::value) {
+        for (u64 i = 0; i < count; ++i) {
+            elements[i].~T();
+        }
+    }
+}
+
+// Moves count elements into uninitialized memory at dest, leaving the sources destroyed.
+template <typename T>
+void relocate(T* dest, T* source, u64 count) {
+    if (std::is_trivially_copyable<T>::value) {
+        if (count) {
+            kcopy_memory(static_cast<void*>(dest), static_cast<const void*>(source), count * sizeof(T));
+        }
+    } else {
+        for (u64 i = 0; i < count; ++i) {
+            new (dest + i) T(static_cast<T&&>(source[i]));
+            source[i].~T();
+        }
+    }
+}
+}  // namespace kcontainers_internal
+
+template <typename T, u64 InlineCount = 0, MemoryTag Tag = MEMORY_TAG_RENDERER>
+class kvector {
+    // kallocate only guarantees 16 byte alignment.
+    static_assert(alignof(T) <= 16, "kvector elements may not need more than 16 byte alignment.");
+
+   public:
+    kvector() : heap(nullptr), count(0), heapCapacity(0) {}
+
+    /** @brief Creates a vector of count value-initialized elements, like std::vector(count). */
+    explicit kvector(u64 count) : kvector() { resize(count); }
+
+    kvector(kvector&& other) : kvector() { take(other); }
+
+    kvector& operator=(kvector&& other) {
+        if (this != &other) {
+            reset();
+            take(other);
+        }
+        return *this;
+    }
+
+    kvector(const kvector&) = delete;
+    kvector& operator=(const kvector&) = delete;
+
+    ~kvector() { reset(); }
+
+    T* data() { return heap ? heap : storage.get(); }
+    const T* data() const { return heap ? heap : storage.get(); }
+    u64 size() const { return count; }
+    u64 capacity() const { return heap ? heapCapacity : InlineCount; }
+    b8 empty() const { return count == 0; }
+    b8 is_inline() const { return heap == nullptr; }
+
+    T* begin() { return data(); }
+    T* end() { return data() + count; }
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + count; }
+
+    T& operator[](u64 index) {
+        KASSERT_DEBUG(index < count);
+        return data()[index];
+    }
+    const T& operator[](u64 index) const {
+        KASSERT_DEBUG(index < count);
+        return data()[index];
+    }
+    T& front() { return (*this)[0]; }
+    T& back() { return (*this)[count - 1]; }
+
+    operator kspan<T>() { return kspan<T>(data(), count); }
+    operator kspan<const T>() const { return kspan<const T>(data(), count); }
+
+    /** @brief Ensures room for at least newCapacity elements without further allocation. */
+    void reserve(u64 newCapacity) {
+        if (newCapacity > capacity()) {
+            set_capacity(newCapacity);
+        }
+    }
+
+    /** @brief Grows or shrinks to newCount elements. New elements are value-initialized. */
+    void resize(u64 newCount) {
+        if (newCount < count) {
+            kcontainers_internal::destroy_range(data() + newCount, count - newCount);
+        } else if (newCount > count) {
+            reserve(newCount);
+            T* elements = data();
+            for (u64 i = count; i < newCount; ++i) {
+                new (elements + i) T();
+            }
+        }
+        count = newCount;
+    }
+
+    void push_back(const T& value) { emplace_back(value); }
+    void push_back(T&& value) { emplace_back(static_cast<T&&>(value)); }
+
+    template <typename... Args>
+    T& emplace_back(Args&&... args) {
+        if (count == capacity()) {
+            grow(count + 1);
+        }
+        T* element = new (data() + count) T(static_cast<Args&&>(args)...);
+        count++;
+        return *element;
+    }
+
+    void pop_back() {
+        KASSERT_DEBUG(count > 0);
+        count--;
+        kcontainers_internal::destroy_range(data() + count, 1);
+    }
+
+    /** @brief Replaces the contents with copies of the given elements. */
+    void assign(kspan<const T> values) {
+        clear();
+        reserve(values.size());
+        T* elements = data();
+        for (u64 i = 0; i < values.size(); ++i) {
+            new (elements + i) T(values[i]);
+        }
+        count = values.size();
+    }
+
+    /** @brief Destroys the elements, keeping the storage for reuse. */
+    void clear() {
+        kcontainers_internal::destroy_range(data(), count);
+        count = 0;
+    }
+
+    /** @brief Destroys the elements and releases any allocated storage. */
+    void reset() {
+        clear();
+        if (heap) {
+            kfree(heap, heapCapacity * sizeof(T), Tag);
+            heap = nullptr;
+            heapCapacity = 0;
+        }
+    }
+
+   private:
+    void grow(u64 required) {
+        u64 newCapacity = capacity() * 2;
+        if (newCapacity < 4) {
+            newCapacity = 4;
+        }
+        set_capacity(newCapacity < required ? required : newCapacity);
+    }
+
+    void set_capacity(u64 newCapacity) {
+        if (heap && std::is_trivially_copyable<T>::value) {
+            // Trivial elements can be resized in place by the allocator.
+            T* elements = static_cast<T*>(kreallocate(heap, heapCapacity * sizeof(T), newCapacity * sizeof(T), Tag));
+            KASSERT_MSG(elements, "kvector failed to grow.");
+            heap = elements;
+        } else {
+            T* elements = static_cast<T*>(kallocate(newCapacity * sizeof(T), Tag));
+            KASSERT_MSG(elements, "kvector failed to grow.");
+            kcontainers_internal::relocate(elements, data(), count);
+            if (heap) {
+                kfree(heap, heapCapacity * sizeof(T), Tag);
+            }
+            heap = elements;
+        }
+        heapCapacity = newCapacity;
+    }
+
+    // Moves the contents of other into this empty vector, leaving other empty.
+    void take(kvector& other) {
+        if (other.heap) {
+            heap = other.heap;
+            heapCapacity = other.heapCapacity;
+            other.heap = nullptr;
+            other.heapCapacity = 0;
+        } else {
+            kcontainers_internal::relocate(storage.get(), other.storage.get(), other.count);
+        }
+        count = other.count;
+        other.count = 0;
+    }
+
+    // Null while the elements are inline.
+    T* heap;
+    u64 count;
+    u64 heapCapacity;
+    kcontainers_internal::InlineStorage<T, InlineCount> storage;
+};
+
+template <typename T, u64 N>
+class kfixed_vector {
+    static_assert(N > 0, "kfixed_vector must hold at least one element.");
+
+   public:
+    kfixed_vector() : count(0) {}
+    kfixed_vector(kfixed_vector&& other) : count(0) {
+        kcontainers_internal::relocate(storage.get(), other.storage.get(), other.count);
+        count = other.count;
+        other.count = 0;
+    }
+    kfixed_vector& operator=(kfixed_vector&& other) {
+        if (this != &other) {
+            clear();
+            kcontainers_internal::relocate(storage.get(), other.storage.get(), other.count);
+            count = other.count;
+            other.count = 0;
+        }
+        return *this;
+    }
+    kfixed_vector(const kfixed_vector&) = delete;
+    kfixed_vector& operator=(const kfixed_vector&) = delete;
+    ~kfixed_vector() { clear(); }
+
+    T* data() { return storage.get(); }
+    const T* data() const { return storage.get(); }
+    u64 size() const { return count; }
+    static constexpr u64 capacity() { return N; }
+    b8 empty() const { return count == 0; }
+    b8 full() const { return count == N; }
+
+    T* begin() { return data(); }
+    T* end() { return data() + count; }
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + count; }
+
+    T& operator[](u64 index) {
+        KASSERT_DEBUG(index < count);
+        return data()[index];
+    }
+    const T& operator[](u64 index) const {
+        KASSERT_DEBUG(index < count);
+        return data()[index];
+    }
+
+    operator kspan<T>() { return kspan<T>(data(), count); }
+    operator kspan<const T>() const { return kspan<const T>(data(), count); }
+
+    /** @brief Grows or shrinks to newCount elements, which may not exceed N. */
+    void resize(u64 newCount) {
+        KASSERT_MSG(newCount <= N, "kfixed_vector capacity exceeded.");
+        if (newCount < count) {
+            kcontainers_internal::destroy_range(data() + newCount, count - newCount);
+        }
+        for (u64 i = count; i < newCount; ++i) {
+            new (data() + i) T();
+        }
+        count = newCount;
+    }
+
+    void push_back(const T& value) { emplace_back(value); }
+    void push_back(T&& value) { emplace_back(static_cast<T&&>(value)); }
+
+    template <typename... Args>
+    T& emplace_back(Args&&... args) {
+        KASSERT_MSG(count < N, "kfixed_vector capacity exceeded.");
+        T* element = new (data() + count) T(static_cast<Args&&>(args)...);
+        count++;
+        return *element;
+    }
+
+    void pop_back() {
+        KASSERT_DEBUG(count > 0);
+        count--;
+        kcontainers_internal::destroy_range(data() + count, 1);
+    }
+
+    void clear() {
+        kcontainers_internal::destroy_range(data(), count);
+        count = 0;
+    }
+
+   private:
+    u64 count;
+    kcontainers_internal::InlineStorage<T, N> storage;
+};
@@ -0,0 +1,158 @@
+#pragma once
+
+#include "../defines.h"
+
+/* Bounded lock-free ring queues of equally sized elements, copied in and out by value.
+   Capacities are rounded up to a power of two. Neither queue ever blocks; push fails
+   when the queue is full and pop fails when it is empty, leaving the caller to decide
+   whether to retry, yield or do something else. Members of these structures should not
+   be modified outside the functions associated with them. */
+
+/**
+ * @brief A queue for exactly one producer thread and one consumer thread, such as the
+ * hand-off to a logging or render thread. Each side only writes its own position and
+ * keeps a cached copy of the other's, so the shared cache lines are only touched when
+ * the queue looks full or empty.
+ */
+typedef struct SpscQueue {
+    // Set on creation, then only read.
+    u64 elementSize;
+    u64 capacity;
+    u64 mask;
+    void* elements;
+    b8 ownsMemory;
+    u8 sharedPad[KCACHE_LINE_SIZE];
+
+    // Written by the producer.
+    u64 tail;
+    u64 cachedHead;
+    u8 producerPad[KCACHE_LINE_SIZE];
+
+    // Written by the consumer.
+    u64 head;
+    u64 cachedTail;
+    u8 consumerPad[KCACHE_LINE_SIZE];
+} SpscQueue;
+
+/**
+ * @brief A queue for any number of producer and consumer threads, such as job submission
+ * or resource load completions. This is Dmitry Vyukov's bounded MPMC queue: each cell
+ * carries a sequence number that says whether it is ready to be written or read, so a
+ * push or pop costs one compare-and-swap when uncontended.
+ */
+typedef struct MpmcQueue {
+    // Set on creation, then only read.
+    u64 elementSize;
+    u64 capacity;
+    u64 mask;
+    // The size of a cell: its sequence number followed by the element, rounded up to 8 bytes.
+    u64 cellStride;
+    void* cells;
+    b8 ownsMemory;
+    u8 sharedPad[KCACHE_LINE_SIZE];
+
+    // Claimed by producers.
+    u64 enqueuePos;
+    u8 producerPad[KCACHE_LINE_SIZE];
+
+    // Claimed by consumers.
+    u64 dequeuePos;
+    u8 consumerPad[KCACHE_LINE_SIZE];
+} MpmcQueue;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Obtains the amount of memory required by a single-producer single-consumer queue.
+ *
+ * @param elementSize The size of each element in bytes.
+ * @param capacity The maximum number of elements. Rounded up to a power of two.
+ * @return The required number of bytes.
+ */
+KAPI u64 spsc_queue_memory_requirement(u64 elementSize, u64 capacity);
+
+/**
+ * @brief Creates a single-producer single-consumer queue and stores it in outQueue.
+ *
+ * @param elementSize The size of each element in bytes.
+ * @param capacity The maximum number of elements. Rounded up to a power of two.
+ * @param memory A block of spsc_queue_memory_requirement bytes to be used. Pass 0 to have the queue allocate its own.
+ * @param outQueue A pointer to a SpscQueue in which to hold relevant data.
+ * @return True if successful; otherwise false.
+ */
+KAPI b8 spsc_queue_create(u64 elementSize, u64 capacity, void* memory, SpscQueue* outQueue);
+
+/**
+ * @brief Destroys the provided queue, releasing its memory if it allocated its own.
+ */
+KAPI void spsc_queue_destroy(SpscQueue* queue);
+
+/**
+ * @brief Copies an element onto the back of the queue. Producer thread only.
+ *
+ * @return True if the element was added; false if the queue is full.
+ */
+KAPI b8 spsc_queue_push(SpscQueue* queue, const void* value);
+
+/**
+ * @brief Copies the front element into outValue and removes it. Consumer thread only.
+ *
+ * @return True if an element was removed; false if the queue is empty.
+ */
+KAPI b8 spsc_queue_pop(SpscQueue* queue, void* outValue);
+
+/**
+ * @brief Obtains the number of elements in the queue. Only a snapshot when the other side is active.
+ */
+KAPI u64 spsc_queue_count(SpscQueue* queue);
+
+/**
+ * @brief Obtains the amount of memory required by a multi-producer multi-consumer queue.
+ *
+ * @param elementSize The size of each element in bytes.
+ * @param capacity The maximum number of elements. Rounded up to a power of two, and at least 2.
+ * @return The required number of bytes.
+ */
+KAPI u64 mpmc_queue_memory_requirement(u64 elementSize, u64 capacity);
+
+/**
+ * @brief Creates a multi-producer multi-consumer queue and stores it in outQueue.
+ *
+ * @param elementSize The size of each element in bytes.
+ * @param capacity The maximum number of elements. Rounded up to a power of two, and at least 2.
+ * @param memory A block of mpmc_queue_memory_requirement bytes to be used. Pass 0 to have the queue allocate its own.
+ * @param outQueue A pointer to a MpmcQueue in which to hold relevant data.
+ * @return True if successful; otherwise false.
+ */
+KAPI b8 mpmc_queue_create(u64 elementSize, u64 capacity, void* memory, MpmcQueue* outQueue);
+
+/**
+ * @brief Destroys the provided queue, releasing its memory if it allocated its own.
+ */
+KAPI void mpmc_queue_destroy(MpmcQueue* queue);
+
+/**
+ * @brief Copies an element onto the back of the queue. Safe to call from any thread.
+ *
+ * @return True if the element was added; false if the queue is full.
+ */
+KAPI b8 mpmc_queue_push(MpmcQueue* queue, const void* value);
+
+/**
+ * @brief Copies the front element into outValue and removes it. Safe to call from any thread.
+ *
+ * @return True if an element was removed; false if the queue is empty.
+ */
+KAPI b8 mpmc_queue_pop(MpmcQueue* queue, void* outValue);
+
+/**
+ * @brief Obtains the number of elements in the queue. Only a snapshot while other threads are active.
+ */
+KAPI u64 mpmc_queue_count(MpmcQueue* queue);
+
+#ifdef __cplusplus
+}
+#endif
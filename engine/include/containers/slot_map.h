@@ -0,0 +1,110 @@
+#pragma once
+
+#include "../defines.h"
+
+// Handles pack the slot index into the low bits and the slot generation into the high bits,
+// so that they fit in the u32 id fields used by the resource systems.
+#define SLOT_MAP_INDEX_BITS 20
+#define SLOT_MAP_INDEX_MASK ((1u << SLOT_MAP_INDEX_BITS) - 1)
+#define SLOT_MAP_GENERATION_MASK (0xFFFFFFFFu >> SLOT_MAP_INDEX_BITS)
+// One index is left over so that no handle can ever equal INVALID_ID.
+#define SLOT_MAP_MAX_CAPACITY SLOT_MAP_INDEX_MASK
+
+#define SLOT_MAP_HANDLE_INDEX(handle) ((handle) & SLOT_MAP_INDEX_MASK)
+#define SLOT_MAP_HANDLE_GENERATION(handle) ((handle) >> SLOT_MAP_INDEX_BITS)
+
+/**
+ * @brief A fixed-capacity container of equally sized elements addressed by handles.
+ * Insert, remove and lookup are O(1), and live elements can be iterated without
+ * visiting empty slots. Elements never move, so pointers to them remain valid until
+ * they are removed. Each slot carries a generation which is bumped on removal, so a
+ * handle to a removed element is detected as stale rather than aliasing whatever
+ * reuses its slot. Members of this structure should not be modified outside the
+ * functions associated with it.
+ */
+typedef struct SlotMap {
+    u64 elementSize;
+    u32 capacity;
+    // The number of live elements.
+    u32 count;
+    // The first free slot, or INVALID_ID if full.
+    u32 freeHead;
+    b8 ownsMemory;
+    void* elements;
+    // The generation of each slot, used in the handle of the element it holds.
+    u32* generations;
+    // For free slots, the next free slot. For live slots, the position in live.
+    u32* links;
+    // The slot indices of the live elements, packed for iteration.
+    u32* live;
+} SlotMap;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Obtains the amount of memory required by a slot map of the given size.
+ *
+ * @param elementSize The size of each element in bytes.
+ * @param capacity The maximum number of elements.
+ * @return The required number of bytes.
+ */
+KAPI u64 slot_map_memory_requirement(u64 elementSize, u32 capacity);
+
+/**
+ * @brief Creates a slot map and stores it in outMap.
+ *
+ * @param elementSize The size of each element in bytes.
+ * @param capacity The maximum number of elements, up to SLOT_MAP_MAX_CAPACITY. Cannot be resized.
+ * @param memory A block of slot_map_memory_requirement bytes to be used. Pass 0 to have the map allocate its own.
+ * @param outMap A pointer to a SlotMap in which to hold relevant data.
+ * @return True if successful; otherwise false.
+ */
+KAPI b8 slot_map_create(u64 elementSize, u32 capacity, void* memory, SlotMap* outMap);
+
+/**
+ * @brief Destroys the provided slot map, releasing its memory if it allocated its own.
+ */
+KAPI void slot_map_destroy(SlotMap* map);
+
+/**
+ * @brief Takes a free slot and returns its element, zeroed.
+ *
+ * @param map A pointer to the map. Required.
+ * @param outHandle A pointer to hold the handle of the new element. Required.
+ * @return A pointer to the new element, or 0 if the map is full.
+ */
+KAPI void* slot_map_insert(SlotMap* map, u32* outHandle);
+
+/**
+ * @brief Frees the slot of the element with the given handle. The handle and any
+ * other copies of it become stale.
+ *
+ * @return True if removed; false if the handle was invalid or stale.
+ */
+KAPI b8 slot_map_remove(SlotMap* map, u32 handle);
+
+/**
+ * @brief Obtains the element with the given handle.
+ *
+ * @return A pointer to the element, or 0 if the handle is invalid or stale.
+ */
+KAPI void* slot_map_get(SlotMap* map, u32 handle);
+
+/**
+ * @brief Obtains a live element by its position, for iteration. Positions run from 0 to
+ * map->count - 1. Removing an element moves the last one into its position, so iterate
+ * backwards when removing while iterating.
+ *
+ * @param map A pointer to the map. Required.
+ * @param position The position of the element, less than map->count.
+ * @param outHandle A pointer to hold the handle of the element. Optional.
+ * @return A pointer to the element, or 0 if position is out of range.
+ */
+KAPI void* slot_map_at(SlotMap* map, u32 position, u32* outHandle);
+
+#ifdef __cplusplus
+}
+#endif
@@ -12,6 +12,12 @@ typedef struct ApplicationConfig{
     i16 startWidth;
     i16 startHeight;
     char* name;
+    // Job system worker threads. 0 starts one per processor besides the main thread.
+    u32 jobWorkerCount;
+    // Log channel levels, such as "*=info,renderer=warn". 0 writes everything. See logger_configure_levels.
+    const char* logLevels;
+    // Frames to profile from startup, written to kohi_trace.json. 0 profiles nothing until F9 is pressed.
+    u32 profileStartupFrames;
 
 }ApplicationConfig;
 
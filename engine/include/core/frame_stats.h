@@ -0,0 +1,102 @@
+#pragma once
+
+#include "../defines.h"
+
+/* Frame time statistics. The time spent in each part of a frame is added up as the frame
+   runs, and the totals are kept for a rolling window of recent frames, from which the
+   minimum, mean, percentiles and maximum are worked out on request. Frames that take longer
+   than the hitch threshold are counted. Every few frames a summary is logged and, if a path
+   is configured, written as a row of a CSV file, which is started afresh at initialization.
+   Used from the main thread only. */
+
+typedef enum FrameStatSection {
+    // The whole frame, from the end of the previous one.
+    FRAME_STAT_FRAME,
+    // The game's update.
+    FRAME_STAT_UPDATE,
+    // The game's render and the renderer recording the frame.
+    FRAME_STAT_RENDER,
+    // The renderer waiting for the GPU and the next image, then submitting and presenting the frame.
+    FRAME_STAT_PRESENT,
+    FRAME_STAT_COUNT
+} FrameStatSection;
+
+typedef struct FrameStatsConfig {
+    // The frames the statistics are worked out over. 0 uses 1024.
+    u32 windowSize;
+    // Frames longer than this many milliseconds count as hitches. 0 uses 33.3.
+    f32 hitchThresholdMs;
+    // A summary is reported every this many frames. 0 only reports on request.
+    u32 reportInterval;
+    // The CSV file summaries are written to, or 0 to only log them.
+    const char* csvPath;
+} FrameStatsConfig;
+
+// Statistics of one section over the window, in milliseconds.
+typedef struct FrameStatSummary {
+    f32 min;
+    f32 mean;
+    f32 p50;
+    f32 p95;
+    f32 p99;
+    f32 max;
+} FrameStatSummary;
+
+typedef struct FrameStats {
+    // Frames in the window, which is fewer than its size until it first fills.
+    u32 sampleCount;
+    // Hitches in the window.
+    u32 hitchCount;
+    // Frames since initialization.
+    u64 totalFrames;
+    // Hitches since initialization.
+    u64 totalHitches;
+    FrameStatSummary sections[FRAME_STAT_COUNT];
+} FrameStats;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Initializes frame statistics. Call twice; once to obtain the memory requirement
+ * (passing state = 0) and a second time passing an allocated block of that size.
+ *
+ * @param memoryRequirement A pointer to hold the memory requirement.
+ * @param state The block of memory for the state, or 0 to just obtain the requirement.
+ * @param config The configuration. If the CSV file cannot be opened, statistics are only logged.
+ * @return True on success; otherwise false.
+ */
+b8 frame_stats_initialize(u64* memoryRequirement, void* state, FrameStatsConfig config);
+
+/** @brief Reports the window if there have been frames since the last report, then closes the CSV file. */
+void frame_stats_shutdown(void* state);
+
+/** @brief Adds time to a section of the current frame. */
+KAPI void frame_stats_record(FrameStatSection section, f64 seconds);
+
+/**
+ * @brief Ends the current frame, adding it to the window, and reports if the interval is up.
+ *
+ * @param frameSeconds The length of the whole frame.
+ */
+KAPI void frame_stats_end_frame(f64 frameSeconds);
+
+/**
+ * @brief Works out the statistics of the frames in the window.
+ *
+ * @param outStats Holds the statistics. Zeroed if the window is empty.
+ * @return True if there were frames to work them out from; otherwise false.
+ */
+KAPI b8 frame_stats_get(FrameStats* outStats);
+
+/** @brief Logs the statistics of the window, and writes them to the CSV file if there is one. */
+KAPI void frame_stats_report();
+
+/** @brief Empties the window, such as after a loading screen. The totals are kept. */
+KAPI void frame_stats_reset();
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "../defines.h"
+
+/* A work-stealing job system. The main thread and one worker thread per remaining
+   processor each own a Chase-Lev deque per priority: a thread pushes and pops jobs at
+   the bottom of its own deques, while idle threads steal from the top of the others'.
+   Jobs submitted from threads outside the system go through a shared queue per priority,
+   as do jobs that only the workers may run.
+
+   Fork-join is expressed with counters: every job submitted with a counter increments it
+   and decrements it when finished, and job_system_wait() runs other jobs on the calling
+   thread until the counter reaches zero. A job may also name a counter it depends on; it
+   is not started until that counter is zero.
+
+   Jobs must not block on anything but job_system_wait(), or they hold a thread the others
+   may be counting on. Before the system is initialized, and after it is shut down, jobs
+   run immediately on the submitting thread. */
+
+// The entry point of a job.
+typedef void (*PFN_job_entry)(void* param);
+
+typedef enum JobPriority {
+    // Work the current frame is waiting on.
+    JOB_PRIORITY_HIGH,
+    JOB_PRIORITY_NORMAL,
+    // Background work, such as resource loading.
+    JOB_PRIORITY_LOW,
+    JOB_PRIORITY_COUNT
+} JobPriority;
+
+/* Tracks a group of jobs. A zeroed counter has nothing pending. A counter may be reused
+   once it has reached zero, and must outlive the jobs submitted with it. */
+typedef struct JobCounter {
+    u32 pending;
+} JobCounter;
+
+typedef struct JobInfo {
+    PFN_job_entry entry;
+    void* param;
+    JobPriority priority;
+    // Incremented on submission and decremented when the job finishes. Optional.
+    JobCounter* counter;
+    // The job does not start until this counter is zero. Optional. Idle workers are woken when
+    // a job finishes a counter; one counted down by other means is only noticed by threads
+    // looking for work, such as one in job_system_wait().
+    JobCounter* dependency;
+    // Runs only on worker threads, never on the main thread while it waits for other jobs,
+    // so long background work such as resource loading cannot stall a frame. Ignored if no
+    // worker thread started, or if the queue is full and the job runs inline.
+    b8 workerOnly;
+} JobInfo;
+
+typedef struct JobSystemConfig {
+    // The worker threads to start besides the main thread. 0 starts one per remaining
+    // processor, and at least one.
+    u32 workerCount;
+    // The most jobs each thread can hold per priority before submission runs them inline.
+    // Rounded up to a power of two.
+    u32 maxQueuedJobs;
+} JobSystemConfig;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Initializes the job system and starts its worker threads. Call twice; once to
+ * obtain the memory requirement (passing state = 0) and a second time passing an allocated
+ * block of that size. The thread making the second call becomes the system's main thread.
+ *
+ * @param memoryRequirement A pointer to hold the memory requirement.
+ * @param state The block of memory for the state, or 0 to just obtain the requirement.
+ * @param config The configuration for the system.
+ * @return True on success; otherwise false.
+ */
+b8 job_system_initialize(u64* memoryRequirement, void* state, JobSystemConfig config);
+
+/** @brief Runs any remaining jobs, then stops and joins the worker threads. */
+void job_system_shutdown(void* state);
+
+/** @brief Queues a job. Returns immediately, unless the queue is full and it runs inline. */
+KAPI void job_system_submit(JobInfo job);
+
+/**
+ * @brief Queues count copies of a job, the i-th of which receives
+ * (u8*)job.param + i * paramStride as its parameter.
+ */
+KAPI void job_system_submit_many(JobInfo job, u32 count, u64 paramStride);
+
+/**
+ * @brief Runs queued jobs on the calling thread until the counter reaches zero.
+ * Callable from jobs as well as from other threads.
+ */
+KAPI void job_system_wait(JobCounter* counter);
+
+/** @brief Indicates whether every job submitted with the counter has finished. */
+KAPI b8 job_system_is_done(JobCounter* counter);
+
+/**
+ * @brief Runs one queued job on the calling thread, if there is one that can start.
+ *
+ * @return True if a job was run; otherwise false.
+ */
+KAPI b8 job_system_run_pending();
+
+/** @brief Obtains the number of threads running jobs, including the main thread. 1 when not initialized. */
+KAPI u32 job_system_thread_count();
+
+/** @brief Obtains the calling thread's index: 0 for the main thread, then the workers. INVALID_ID for other threads. */
+KAPI u32 job_system_thread_index();
+
+#ifdef __cplusplus
+}
+#endif
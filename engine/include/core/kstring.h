@@ -27,7 +27,33 @@ KAPI i32 string_format(char* dest, const char* format, ...);
  */
 KAPI i32 string_format_v(char* dest, const char* format, void* va_list);
 
+/**
+ * @brief Performs string formatting into a buffer of a known size, cutting the result short
+ * if it does not fit. Unlike string_format, no intermediate buffer is used.
+ * @param dest The destination for the formatted string. Always null-terminated.
+ * @param size The size of dest in bytes. Must be at least 1.
+ * @param format The format string to use for the operation
+ * @param ... The format arguments.
+ * @returns The length of the string written to dest.
+ */
+KAPI i32 string_nformat(char* dest, u64 size, const char* format, ...);
+
+/**
+ * @brief Performs variadic string formatting into a buffer of a known size. See string_nformat.
+ */
+KAPI i32 string_nformat_v(char* dest, u64 size, const char* format, void* va_list);
+
+/**
+ * @brief Duplicates the provided string. The copy is allocated from the memory system's
+ * small object pools and must be released with string_free.
+ */
 KAPI char* string_duplicate(const char* str);
+
+/**
+ * @brief Frees a string obtained from string_duplicate.
+ */
+KAPI void string_free(char* str);
+
 // Case-sensitive string comparison. True if the same, otherwise false.
 KAPI b8 strings_equal(const char* str0, const char* str1);
 
@@ -3,15 +3,20 @@
 #include "../defines.h"
 #include "../platform/platform.h"
 
+/* Debug and trace messages are compiled into release builds too, where channel levels skip
+   them at runtime. Build with LOG_STRIP_VERBOSE=1 to compile them away entirely. */
+#ifndef LOG_STRIP_VERBOSE
+#define LOG_STRIP_VERBOSE 0
+#endif
+
 #define LOG_WARN_ENABLED 1
 #define LOG_INFO_ENABLED 1
-#define LOG_DEBUG_ENABLED 1
-#define LOG_TRACE_ENABLED 1
-
-// Disable debug and trace logging for release builds.
-#if KRELEASE == 1
+#if LOG_STRIP_VERBOSE == 1
 #define LOG_DEBUG_ENABLED 0
 #define LOG_TRACE_ENABLED 0
+#else
+#define LOG_DEBUG_ENABLED 1
+#define LOG_TRACE_ENABLED 1
 #endif
 
 typedef enum LogLevel {
@@ -23,6 +28,101 @@ typedef enum LogLevel {
     LOG_LEVEL_TRACE = 5
 }LogLevel;
 
+/* Messages are formatted on the calling thread, then queued for a background writer thread
+   that writes them to the console and the log file in batches, so logging costs the caller
+   no system call. When the queue is full, messages of this level or less severe are dropped
+   and counted, while more severe ones wait for the writer to make room. KFATAL waits until
+   everything logged before it has been written. Before the logging system is initialized
+   and after it is shut down, messages are written directly by the calling thread. */
+#define LOG_DROPPABLE_LEVEL LOG_LEVEL_INFO
+
+/* Every message belongs to a channel, which has a level of its own that can be changed at
+   runtime. Messages less severe than their channel's level are skipped by the logging macros
+   with a single branch, before their arguments are evaluated. Errors and fatal messages are
+   never skipped. A source file picks its channel by defining KLOG_CHANNEL before its first
+   include; otherwise its messages go to LOG_CHANNEL_CORE. */
+typedef enum LogChannel {
+    LOG_CHANNEL_CORE,
+    LOG_CHANNEL_PLATFORM,
+    LOG_CHANNEL_MEMORY,
+    LOG_CHANNEL_RENDERER,
+    LOG_CHANNEL_SYSTEMS,
+    LOG_CHANNEL_RESOURCES,
+    LOG_CHANNEL_GAME,
+    LOG_CHANNEL_COUNT
+} LogChannel;
+
+#ifndef KLOG_CHANNEL
+#define KLOG_CHANNEL LOG_CHANNEL_CORE
+#endif
+
+/* The macros ending in _LIMITED write at most LOG_RATE_LIMIT_COUNT messages from one call site
+   in each LOG_RATE_LIMIT_WINDOW_MS, for messages that come in bursts, such as one per resource
+   during a bulk unload. How many were skipped is logged with the first message of a later window. */
+#define LOG_RATE_LIMIT_COUNT 5
+#define LOG_RATE_LIMIT_WINDOW_MS 1000
+
+// The state of one rate limited call site. A zeroed LogRateLimit is ready to use.
+typedef struct LogRateLimit {
+    // When the current window started, in microseconds of absolute time. 0 before the first message.
+    u64 windowStart;
+    // Messages in the current window, including skipped ones.
+    u32 count;
+    // Messages skipped and not yet reported.
+    u32 skipped;
+} LogRateLimit;
+
+typedef struct LoggingConfig {
+    // The most messages that can wait for the writer. Rounded up to a power of two.
+    u32 queueCapacity;
+    // The file messages are also written to, or 0 for the console only.
+    const char* logFilePath;
+    // Channel levels as accepted by logger_configure_levels, or 0 to leave them as they are.
+    const char* channelLevels;
+} LoggingConfig;
+
+/* With deferred formatting, KINFO, KDEBUG and KTRACE do not format their message. They
+   capture the format string pointer and the raw argument values, copying any strings, and
+   the writer thread formats the message later. This keeps the cost of a message that is
+   logged but rarely read to a few stores, which is what lets those levels stay on in release
+   builds unless LOG_STRIP_VERBOSE is set.
+   Only string literal formats are deferred; others are formatted at once, as are messages
+   whose strings do not fit in a queue record. */
+#ifndef LOG_DEFERRED_FORMATTING
+#define LOG_DEFERRED_FORMATTING 1
+#endif
+
+// The most arguments a deferred message may have.
+#define LOG_MAX_DEFERRED_ARGS 16
+
+typedef enum LogArgType {
+    LOG_ARG_SIGNED,
+    LOG_ARG_UNSIGNED,
+    LOG_ARG_FLOAT,
+    LOG_ARG_STRING,
+    LOG_ARG_POINTER
+} LogArgType;
+
+// An argument captured for a deferred message. When formatted, it is read according to the
+// conversion specification it meets, as printf would read it.
+typedef struct LogArg {
+    u8 type;
+    union {
+        i64 i;
+        u64 u;
+        f64 f;
+        const char* s;
+        const void* p;
+    } value;
+} LogArg;
+
+typedef struct LoggerStats {
+    // Messages the writer has written since the system was initialized.
+    u64 written;
+    // Messages dropped because the queue was full.
+    u64 dropped;
+} LoggerStats;
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -34,13 +134,230 @@ extern "C"
  * 
  * @param memoryRequirement A pointer to hold the required memory size of internal state.
  * @param state 0 if just requesting memory requirement, otherwise allocated block of memory.
+ * @param config The configuration for the system.
  * @return b8 True on success; otherwise false.
  */
-b8 initialize_logging(u64* memoryRequirement, void* state);
+b8 initialize_logging(u64* memoryRequirement, void* state, LoggingConfig config);
+
+/** @brief Writes every queued message, then stops the writer thread. */
 void shutdown_logging(u64* memoryRequirement, void* state);
 
 KAPI void log_output(LogLevel level, const char* message, ...);
 
+/**
+ * @brief Logs a message whose formatting is left to the writer thread. Called by the
+ * logging macros; see LOG_DEFERRED_FORMATTING.
+ *
+ * @param level The level of the message.
+ * @param format A printf-style format string. Must remain valid for the life of the program.
+ * @param argCount The number of arguments. Messages with more than LOG_MAX_DEFERRED_ARGS are formatted at once.
+ * @param args The arguments, of which strings are copied before returning.
+ */
+KAPI void log_output_deferred(LogLevel level, const char* format, u32 argCount, const LogArg* args);
+
+/**
+ * @brief Formats a message from captured arguments the way the writer thread does.
+ *
+ * @param dest The destination for the message. Always null-terminated.
+ * @param size The size of dest in bytes. Must be at least 1.
+ * @param format A printf-style format string.
+ * @param argCount The number of arguments.
+ * @param args The arguments.
+ * @return The length of the message written to dest.
+ */
+KAPI i32 log_format_args(char* dest, u64 size, const char* format, u32 argCount, const LogArg* args);
+
+/**
+ * @brief Sets the least severe level of message written for a channel. Takes effect on every
+ * thread at once. Levels more severe than LOG_LEVEL_ERROR are raised to it.
+ *
+ * @param channel The channel, or LOG_CHANNEL_COUNT for all of them.
+ * @param level The level.
+ */
+KAPI void logger_set_channel_level(LogChannel channel, LogLevel level);
+
+KAPI LogLevel logger_get_channel_level(LogChannel channel);
+
+/**
+ * @brief Sets channel levels from a comma-separated list of channel=level pairs, such as
+ * "*=info,renderer=warn,resources=trace", applied in order. Channels are named as in LogChannel,
+ * and "*" stands for all of them. Levels are error, warn, info, debug and trace.
+ *
+ * @param levels The list of pairs.
+ * @return True if every pair was applied; otherwise false, having applied the valid ones.
+ */
+KAPI b8 logger_configure_levels(const char* levels);
+
+/**
+ * @brief Counts a message from a rate limited call site. Used by the _LIMITED logging macros.
+ *
+ * @param limit The call site's state.
+ * @param level The level of the message, used to report skipped messages.
+ * @param format The message's format string, used to report skipped messages.
+ * @return True if the message should be written; otherwise false.
+ */
+KAPI b8 log_rate_limit_allow(LogRateLimit* limit, LogLevel level, const char* format);
+
+// The level of each channel. Written through logger_set_channel_level.
+KAPI extern u8 logChannelLevels[LOG_CHANNEL_COUNT];
+
+/** @brief Blocks until every message logged before the call has been written. */
+KAPI void logger_flush();
+
+/** @brief Obtains the writer's counters. Zeroed while the system is not initialized. */
+KAPI void logger_get_stats(LoggerStats* outStats);
+
+KINLINE LogArg log_arg_signed(i64 value) {
+    LogArg arg;
+    arg.type = LOG_ARG_SIGNED;
+    arg.value.i = value;
+    return arg;
+}
+
+KINLINE LogArg log_arg_unsigned(u64 value) {
+    LogArg arg;
+    arg.type = LOG_ARG_UNSIGNED;
+    arg.value.u = value;
+    return arg;
+}
+
+KINLINE LogArg log_arg_float(f64 value) {
+    LogArg arg;
+    arg.type = LOG_ARG_FLOAT;
+    arg.value.f = value;
+    return arg;
+}
+
+KINLINE LogArg log_arg_string(const char* value) {
+    LogArg arg;
+    arg.type = LOG_ARG_STRING;
+    arg.value.s = value;
+    return arg;
+}
+
+KINLINE LogArg log_arg_pointer(const void* value) {
+    LogArg arg;
+    arg.type = LOG_ARG_POINTER;
+    arg.value.p = value;
+    return arg;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#if LOG_DEFERRED_FORMATTING == 1 && (defined(__GNUC__) || defined(__clang__))
+#ifdef __cplusplus
+// C++ has no _Generic, so the arguments are captured by overloading.
+inline LogArg log_arg(bool value) { return log_arg_unsigned(value); }
+inline LogArg log_arg(char value) { return log_arg_signed(value); }
+inline LogArg log_arg(signed char value) { return log_arg_signed(value); }
+inline LogArg log_arg(unsigned char value) { return log_arg_unsigned(value); }
+inline LogArg log_arg(short value) { return log_arg_signed(value); }
+inline LogArg log_arg(unsigned short value) { return log_arg_unsigned(value); }
+inline LogArg log_arg(int value) { return log_arg_signed(value); }
+inline LogArg log_arg(unsigned int value) { return log_arg_unsigned(value); }
+inline LogArg log_arg(long value) { return log_arg_signed(value); }
+inline LogArg log_arg(unsigned long value) { return log_arg_unsigned(value); }
+inline LogArg log_arg(long long value) { return log_arg_signed(value); }
+inline LogArg log_arg(unsigned long long value) { return log_arg_unsigned(value); }
+inline LogArg log_arg(double value) { return log_arg_float(value); }
+inline LogArg log_arg(long double value) { return log_arg_float((f64)value); }
+inline LogArg log_arg(const char* value) { return log_arg_string(value); }
+inline LogArg log_arg(const void* value) { return log_arg_pointer(value); }
+
+template <typename... Args>
+inline void log_output_captured(LogLevel level, const char* format, Args... args) {
+    // Led by an unused element, since C++ has no empty arrays.
+    const LogArg captured[] = {LogArg(), log_arg(args)...};
+    log_output_deferred(level, format, sizeof...(Args), captured + 1);
+}
+
+#define KLOG_DEFERRED(level, message, ...) \
+    (__builtin_constant_p(message) ? log_output_captured(level, message, ##__VA_ARGS__) : log_output(level, message, ##__VA_ARGS__))
+#else
+#define KLOG_ARG(value) _Generic((value), \
+    _Bool: log_arg_unsigned,              \
+    char: log_arg_signed,                 \
+    signed char: log_arg_signed,          \
+    unsigned char: log_arg_unsigned,      \
+    short: log_arg_signed,                \
+    unsigned short: log_arg_unsigned,     \
+    int: log_arg_signed,                  \
+    unsigned int: log_arg_unsigned,       \
+    long: log_arg_signed,                 \
+    unsigned long: log_arg_unsigned,      \
+    long long: log_arg_signed,            \
+    unsigned long long: log_arg_unsigned, \
+    float: log_arg_float,                 \
+    double: log_arg_float,                \
+    long double: log_arg_float,           \
+    char*: log_arg_string,                \
+    const char*: log_arg_string,          \
+    default: log_arg_pointer)(value)
+
+// Counts up to LOG_MAX_DEFERRED_ARGS arguments, including none.
+#define KLOG_ARG_COUNT(...) KLOG_ARG_COUNT_(_, ##__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+#define KLOG_ARG_COUNT_(_0, _1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, N, ...) N
+#define KLOG_CONCAT(a, b) KLOG_CONCAT_(a, b)
+#define KLOG_CONCAT_(a, b) a##b
+
+// Expands to ", KLOG_ARG(a), KLOG_ARG(b), ..." for each argument.
+#define KLOG_ARGS(...) KLOG_CONCAT(KLOG_ARGS_, KLOG_ARG_COUNT(__VA_ARGS__))(__VA_ARGS__)
+#define KLOG_ARGS_0()
+#define KLOG_ARGS_1(a) , KLOG_ARG(a)
+#define KLOG_ARGS_2(a, ...) , KLOG_ARG(a) KLOG_ARGS_1(__VA_ARGS__)
+#define KLOG_ARGS_3(a, ...) , KLOG_ARG(a) KLOG_ARGS_2(__VA_ARGS__)
+#define KLOG_ARGS_4(a, ...) , KLOG_ARG(a) KLOG_ARGS_3(__VA_ARGS__)
+#define KLOG_ARGS_5(a, ...) , KLOG_ARG(a) KLOG_ARGS_4(__VA_ARGS__)
+#define KLOG_ARGS_6(a, ...) , KLOG_ARG(a) KLOG_ARGS_5(__VA_ARGS__)
+#define KLOG_ARGS_7(a, ...) , KLOG_ARG(a) KLOG_ARGS_6(__VA_ARGS__)
+#define KLOG_ARGS_8(a, ...) , KLOG_ARG(a) KLOG_ARGS_7(__VA_ARGS__)
+#define KLOG_ARGS_9(a, ...) , KLOG_ARG(a) KLOG_ARGS_8(__VA_ARGS__)
+#define KLOG_ARGS_10(a, ...) , KLOG_ARG(a) KLOG_ARGS_9(__VA_ARGS__)
+#define KLOG_ARGS_11(a, ...) , KLOG_ARG(a) KLOG_ARGS_10(__VA_ARGS__)
+#define KLOG_ARGS_12(a, ...) , KLOG_ARG(a) KLOG_ARGS_11(__VA_ARGS__)
+#define KLOG_ARGS_13(a, ...) , KLOG_ARG(a) KLOG_ARGS_12(__VA_ARGS__)
+#define KLOG_ARGS_14(a, ...) , KLOG_ARG(a) KLOG_ARGS_13(__VA_ARGS__)
+#define KLOG_ARGS_15(a, ...) , KLOG_ARG(a) KLOG_ARGS_14(__VA_ARGS__)
+#define KLOG_ARGS_16(a, ...) , KLOG_ARG(a) KLOG_ARGS_15(__VA_ARGS__)
+
+// The captured arguments are led by an unused element, since C has no empty arrays.
+#define KLOG_DEFERRED(level, message, ...)                                                                    \
+    (__builtin_constant_p(message)                                                                           \
+         ? log_output_deferred(level, message, KLOG_ARG_COUNT(__VA_ARGS__),                                  \
+                               (const LogArg[]){{0} KLOG_ARGS(__VA_ARGS__)} + 1)                             \
+         : log_output(level, message, ##__VA_ARGS__))
+#endif
+#else
+#define KLOG_DEFERRED(level, message, ...) log_output(level, message, ##__VA_ARGS__)
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// True if messages of the given level on this file's channel are written.
+#define KLOG_ENABLED(level) ((level) <= __atomic_load_n(&logChannelLevels[KLOG_CHANNEL], __ATOMIC_RELAXED))
+
+// Writes a message if its channel's level allows it.
+#define KLOG_FILTERED(output, level, message, ...) \
+    do {                                           \
+        if (KLOG_ENABLED(level)) {                 \
+            output(level, message, ##__VA_ARGS__); \
+        }                                          \
+    } while (0)
+
+// As KLOG_FILTERED, also holding the call site to LOG_RATE_LIMIT_COUNT messages per window.
+#define KLOG_LIMITED(output, level, message, ...)                                             \
+    do {                                                                                      \
+        static LogRateLimit klogRateLimit;                                                    \
+        if (KLOG_ENABLED(level) && log_rate_limit_allow(&klogRateLimit, level, message)) {    \
+            output(level, message, ##__VA_ARGS__);                                            \
+        }                                                                                     \
+    } while (0)
+
 // Logs a fatal-level message.
 #define KFATAL(message, ...) log_output(LOG_LEVEL_FATAL, message, ##__VA_ARGS__);
 
@@ -51,34 +368,42 @@ KAPI void log_output(LogLevel level, const char* message, ...);
 
 #if LOG_WARN_ENABLED == 1
 // Logs a warning-level message.
-#define KWARN(message, ...) log_output(LOG_LEVEL_WARN, message, ##__VA_ARGS__);
+#define KWARN(message, ...) KLOG_FILTERED(log_output, LOG_LEVEL_WARN, message, ##__VA_ARGS__);
+#define KWARN_LIMITED(message, ...) KLOG_LIMITED(log_output, LOG_LEVEL_WARN, message, ##__VA_ARGS__);
 #else
 // Does nothing when LOG_WARN_ENABLED != 1
 #define KWARN(message, ...)
+#define KWARN_LIMITED(message, ...)
 #endif
 
 #if LOG_INFO_ENABLED == 1
 // Logs a info-level message.
-#define KINFO(message, ...) log_output(LOG_LEVEL_INFO, message, ##__VA_ARGS__);
+#define KINFO(message, ...) KLOG_FILTERED(KLOG_DEFERRED, LOG_LEVEL_INFO, message, ##__VA_ARGS__);
+#define KINFO_LIMITED(message, ...) KLOG_LIMITED(KLOG_DEFERRED, LOG_LEVEL_INFO, message, ##__VA_ARGS__);
 #else
 // Does nothing when LOG_INFO_ENABLED != 1
 #define KINFO(message, ...)
+#define KINFO_LIMITED(message, ...)
 #endif
 
 #if LOG_DEBUG_ENABLED == 1
 // Logs a debug-level message.
-#define KDEBUG(message, ...) log_output(LOG_LEVEL_DEBUG, message, ##__VA_ARGS__);
+#define KDEBUG(message, ...) KLOG_FILTERED(KLOG_DEFERRED, LOG_LEVEL_DEBUG, message, ##__VA_ARGS__);
+#define KDEBUG_LIMITED(message, ...) KLOG_LIMITED(KLOG_DEFERRED, LOG_LEVEL_DEBUG, message, ##__VA_ARGS__);
 #else
 // Does nothing when LOG_DEBUG_ENABLED != 1
 #define KDEBUG(message, ...)
+#define KDEBUG_LIMITED(message, ...)
 #endif
 
 #if LOG_TRACE_ENABLED == 1
 // Logs a trace-level message.
-#define KTRACE(message, ...) log_output(LOG_LEVEL_TRACE, message, ##__VA_ARGS__);
+#define KTRACE(message, ...) KLOG_FILTERED(KLOG_DEFERRED, LOG_LEVEL_TRACE, message, ##__VA_ARGS__);
+#define KTRACE_LIMITED(message, ...) KLOG_LIMITED(KLOG_DEFERRED, LOG_LEVEL_TRACE, message, ##__VA_ARGS__);
 #else
 // Does nothing when LOG_TRACE_ENABLED != 1
 #define KTRACE(message, ...)
+#define KTRACE_LIMITED(message, ...)
 #endif 
 
 #ifdef __cplusplus
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "../defines.h"
+
+/* Runs a loop over the job system's threads.
+
+   The range is cut into chunks of whole grains, about PARALLEL_FOR_CHUNKS_PER_THREAD per
+   thread so that stealing can even out uneven chunks, and never more than
+   PARALLEL_FOR_MAX_CHUNKS. The calling thread runs the first chunk and helps with the rest
+   until all are done. Ranges of at most one grain, and every range while the job system is
+   not running, are run serially as a single call.
+
+   Chunk boundaries always fall on multiples of grain from begin. Which thread runs an index
+   varies, so the output matches the serial loop as long as each index only writes its own
+   results, or combines them in a way that does not depend on order. */
+
+// The grain used when 0 is passed.
+#define PARALLEL_FOR_DEFAULT_GRAIN 1024
+#define PARALLEL_FOR_CHUNKS_PER_THREAD 4
+#define PARALLEL_FOR_MAX_CHUNKS 256
+
+// Processes the indices [begin, end).
+typedef void (*PFN_parallel_for)(u64 begin, u64 end, void* user);
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Calls fn over the range [begin, end) in chunks spread across the job system's
+ * threads, returning once every chunk has finished.
+ *
+ * @param begin The first index.
+ * @param end One past the last index.
+ * @param grain The fewest indices worth handing to another thread. Pick it so that a grain
+ * takes a few microseconds or more. 0 uses PARALLEL_FOR_DEFAULT_GRAIN.
+ * @param fn The function to call for each chunk. Required.
+ * @param user Passed to fn.
+ */
+KAPI void parallel_for(u64 begin, u64 end, u64 grain, PFN_parallel_for fn, void* user);
+
+#ifdef __cplusplus
+}
+#endif
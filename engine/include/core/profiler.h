@@ -0,0 +1,123 @@
+#pragma once
+
+#include "../defines.h"
+
+/* An instrumentation profiler. Code marks out zones with KPROFILE_SCOPE, which last until
+   the end of the enclosing block and may nest, and the application marks the start of each
+   frame. Nothing is recorded until a capture is started; during one, each thread appends
+   its zones to a buffer of its own without locking, and when the capture ends the zones of
+   every thread are written out in the Chrome trace format, which chrome://tracing and
+   https://ui.perfetto.dev open.
+
+   With KPROFILE_ENABLED set to 0 the macros compile to nothing. Outside a capture a zone
+   costs a function call and a load. */
+#ifndef KPROFILE_ENABLED
+#if KRELEASE == 1
+#define KPROFILE_ENABLED 0
+#else
+#define KPROFILE_ENABLED 1
+#endif
+#endif
+
+typedef struct ProfilerConfig {
+    // The most zones each thread records in one capture. Later ones are counted and dropped.
+    u32 eventsPerThread;
+    // The most threads that can record zones.
+    u32 maxThreads;
+    // Where a capture is written when it ends.
+    const char* tracePath;
+    // Starts a capture of this many frames at initialization, so startup is included. 0 does not.
+    u32 startupCaptureFrames;
+} ProfilerConfig;
+
+// An open zone. Filled in by profiler_zone_begin, closed by profiler_zone_end.
+typedef struct ProfileZone {
+    const char* name;
+    // In nanoseconds, or 0 if the zone is not being recorded.
+    u64 start;
+} ProfileZone;
+
+typedef struct ProfilerStats {
+    b8 capturing;
+    // Threads that have recorded a zone since initialization.
+    u32 threadCount;
+    // Zones and frame markers recorded in the current or last capture.
+    u64 eventCount;
+    // Zones that did not fit in their thread's buffer in the current or last capture.
+    u64 droppedCount;
+} ProfilerStats;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Initializes the profiler. Call twice; once to obtain the memory requirement (passing
+ * state = 0) and a second time passing an allocated block of that size.
+ *
+ * @param memoryRequirement A pointer to hold the memory requirement.
+ * @param state The block of memory for the state, or 0 to just obtain the requirement.
+ * @param config The configuration for the profiler.
+ * @return True on success; otherwise false.
+ */
+b8 profiler_initialize(u64* memoryRequirement, void* state, ProfilerConfig config);
+
+/** @brief Ends any capture in progress, writing it out, and frees the thread buffers. */
+void profiler_shutdown(void* state);
+
+/**
+ * @brief Starts recording zones on every thread.
+ *
+ * @param frameCount The capture ends by itself once this many whole frames have been marked. 0 waits for profiler_end_capture.
+ * @return True if started; false if a capture is already in progress or the profiler is not initialized.
+ */
+KAPI b8 profiler_begin_capture(u32 frameCount);
+
+/**
+ * @brief Stops recording and writes the capture to the configured trace path.
+ *
+ * @return True if the trace was written; otherwise false.
+ */
+KAPI b8 profiler_end_capture();
+
+/**
+ * @brief Writes the zones of the current or last capture in the Chrome trace format. Must be
+ * called from the thread that starts and ends captures.
+ *
+ * @param path The file to write.
+ * @return True on success; otherwise false.
+ */
+KAPI b8 profiler_export_chrome_trace(const char* path);
+
+/** @brief Marks the start of a frame, and ends a capture that has run for its frames. Call from the main thread. */
+KAPI void profiler_frame_mark();
+
+/** @brief Names the calling thread in traces. Takes effect if called before the thread first records a zone. */
+KAPI void profiler_set_thread_name(const char* name);
+
+KAPI ProfileZone profiler_zone_begin(const char* name);
+
+KAPI void profiler_zone_end(ProfileZone* zone);
+
+KAPI void profiler_get_stats(ProfilerStats* outStats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#if KPROFILE_ENABLED == 1
+#define KPROFILE_CONCAT_(a, b) a##b
+#define KPROFILE_CONCAT(a, b) KPROFILE_CONCAT_(a, b)
+
+// Records a zone with the given name, which must be a string literal, from here to the end of the enclosing block.
+#define KPROFILE_SCOPE(name) \
+    ProfileZone KPROFILE_CONCAT(profileZone, __LINE__) __attribute__((cleanup(profiler_zone_end))) = profiler_zone_begin(name)
+
+// Marks the start of a frame.
+#define KPROFILE_FRAME_MARK() profiler_frame_mark()
+#else
+// Does nothing when KPROFILE_ENABLED != 1
+#define KPROFILE_SCOPE(name)
+#define KPROFILE_FRAME_MARK()
+#endif
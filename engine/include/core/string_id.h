@@ -0,0 +1,49 @@
+#pragma once
+
+#include "../defines.h"
+
+// 64-bit FNV-1a over the ASCII-lowercase form of a string. Simple enough to be
+// evaluated by the C++ compiler, so KSID("...") and string_id("...") agree exactly.
+#define STRING_ID_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define STRING_ID_PRIME 0x100000001b3ULL
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Obtains the id of a null-terminated string at runtime. Case-insensitive for
+ * ASCII, matching the way resource names are compared. The result is identical to
+ * KSID for the same string, so ids may be stored by C code and matched by C++ code.
+ *
+ * @param str The string to hash. Required.
+ * @return The 64-bit id of the string.
+ */
+KAPI u64 string_id(const char* str);
+
+#ifdef __cplusplus
+}
+
+/**
+ * @brief Compile-time counterpart of string_id. Written as a single recursive
+ * expression so it is a valid constexpr function under C++11.
+ */
+constexpr u64 string_id_constexpr(const char* str, u64 hash = STRING_ID_OFFSET_BASIS) {
+    return *str == 0 ? hash
+                     : string_id_constexpr(str + 1, (hash ^ (u8)((*str >= 'A' && *str <= 'Z') ? *str + ('a' - 'A') : *str)) * STRING_ID_PRIME);
+}
+
+// Forces evaluation at compile time, so no hashing is left for runtime.
+template <u64 id>
+struct StringIdConstant {
+    static constexpr u64 value = id;
+};
+
+/** @brief The id of a string literal, computed at compile time. Equal to string_id(str). */
+#define KSID(str) (StringIdConstant<string_id_constexpr(str)>::value)
+
+static_assert(KSID("") == STRING_ID_OFFSET_BASIS, "KSID of the empty string must be the offset basis.");
+static_assert(KSID("a") == 0xaf63dc4c8601ec8cULL, "KSID must be 64-bit FNV-1a.");
+static_assert(KSID("Builtin.MaterialShader") == KSID("builtin.materialshader"), "KSID must ignore case.");
+#endif
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "../defines.h"
+
+// The longest string that can be interned, not including the terminator.
+#define STRING_INTERN_MAX_LENGTH 1023
+
+// The id of the empty string. Zeroed structures therefore hold empty names.
+#define STRING_ID_EMPTY 0
+
+typedef struct StringInternConfig {
+    // The most distinct strings that can be interned.
+    u32 maxStringCount;
+    // The address space to reserve for the characters. Only what is used is committed.
+    u64 maxStringBytes;
+} StringInternConfig;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Initializes the string intern table. Call twice; once to obtain the memory
+ * requirement (passing state = 0) and a second time passing an allocated block of that size.
+ *
+ * Interned strings are compared without regard to case, so "Cobblestone" and
+ * "cobblestone" share an id, which keeps the spelling it was first interned with.
+ * Strings are never removed, and their characters never move.
+ *
+ * @param memoryRequirement A pointer to hold the memory requirement.
+ * @param state The block of memory for the state, or 0 to just obtain the requirement.
+ * @param config The configuration for the table.
+ * @return True on success; otherwise false.
+ */
+b8 string_intern_initialize(u64* memoryRequirement, void* state, StringInternConfig config);
+
+void string_intern_shutdown(void* state);
+
+/**
+ * @brief Obtains the id of a string, adding it to the table if it is not there yet.
+ *
+ * @param str The string to intern. Required.
+ * @return The id of the string, or INVALID_ID if the table is full or the string is too long.
+ */
+KAPI u32 string_intern(const char* str);
+
+/**
+ * @brief Obtains the id of a string without adding it.
+ *
+ * @return The id of the string, or INVALID_ID if it has not been interned.
+ */
+KAPI u32 string_intern_find(const char* str);
+
+/**
+ * @brief Obtains the string with the given id. The pointer remains valid until shutdown.
+ *
+ * @return The string, or an empty string if the id is invalid.
+ */
+KAPI const char* string_intern_get(u32 id);
+
+#ifdef __cplusplus
+}
+#endif
@@ -103,6 +103,10 @@ STATIC_ASSERT(sizeof(f64) == 8, "Expected f64 to be 8 bytes.");
 #endif
 #endif
 
+// The size of a cache line on the targeted CPUs. Data written by different threads is
+// kept at least this far apart, so that the threads do not contend for the same line.
+#define KCACHE_LINE_SIZE 64
+
 #define KCLAMP(value,min,max) (value <= min) ? min : (value >= max)? max : value
 
 // Inlining
@@ -112,4 +116,13 @@ STATIC_ASSERT(sizeof(f64) == 8, "Expected f64 to be 8 bytes.");
 #else
 #define KINLINE static inline
 #define KNOINLINE
+#endif
+
+// Variables with one instance per thread. For keys created at runtime, see platform/thread.h.
+#if defined(__cplusplus)
+#define KTHREAD_LOCAL thread_local
+#elif defined(_MSC_VER)
+#define KTHREAD_LOCAL __declspec(thread)
+#else
+#define KTHREAD_LOCAL _Thread_local
 #endif 
\ No newline at end of file
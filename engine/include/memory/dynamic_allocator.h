@@ -0,0 +1,90 @@
+#pragma once
+
+#include "../defines.h"
+
+// Number of segregated free lists. One per power of two block size.
+#define DYNAMIC_ALLOCATOR_BIN_COUNT 64
+
+/**
+ * @brief A general-purpose allocator that manages a single contiguous block of memory.
+ * Free blocks are kept in segregated free lists (one per power of two size class) and
+ * use boundary tags so that neighbouring free blocks are coalesced in constant time on free.
+ * Members of this structure should not be modified outside the functions associated with it.
+ */
+typedef struct DynamicAllocator {
+    u64 totalSize;
+    u64 allocated;
+    u64 allocationCount;
+    void* memory;
+    b8 ownsMemory;
+    // A bit is set for each bin that holds at least one free block.
+    u64 binMask;
+    // Heads of the segregated free lists.
+    struct DynamicAllocatorBlock* bins[DYNAMIC_ALLOCATOR_BIN_COUNT];
+} DynamicAllocator;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Creates a new dynamic allocator.
+ *
+ * @param totalSize The total size in bytes the allocator should manage.
+ * @param memory A block of memory of totalSize bytes to be used. Pass 0 to have the allocator allocate its own.
+ * @param allocator A pointer to hold the allocator.
+ * @return True on success; otherwise false.
+ */
+KAPI b8 dynamic_allocator_create(u64 totalSize, void* memory, DynamicAllocator* allocator);
+
+/**
+ * @brief Destroys the provided allocator, releasing its memory if it was allocated by the allocator.
+ *
+ * @param allocator A pointer to the allocator to be destroyed.
+ */
+KAPI void dynamic_allocator_destroy(DynamicAllocator* allocator);
+
+/**
+ * @brief Allocates a block of memory of the given size from the allocator.
+ * Returned blocks are 16-byte aligned.
+ *
+ * @param allocator A pointer to the allocator to allocate from.
+ * @param size The size in bytes to be allocated.
+ * @return The allocated block of memory, or 0 if there is no free block large enough.
+ */
+KAPI void* dynamic_allocator_allocate(DynamicAllocator* allocator, u64 size);
+
+/**
+ * @brief Returns the given block to the allocator, merging it with any free neighbours.
+ *
+ * @param allocator A pointer to the allocator the block was allocated from.
+ * @param block The block to be freed.
+ * @return True on success; false if the block does not belong to this allocator.
+ */
+KAPI b8 dynamic_allocator_free(DynamicAllocator* allocator, void* block);
+
+/**
+ * @brief Indicates if the given block lies within the memory managed by the allocator.
+ */
+KAPI b8 dynamic_allocator_owns(DynamicAllocator* allocator, const void* block);
+
+/**
+ * @brief Obtains the usable size of a block previously allocated from the allocator.
+ */
+KAPI u64 dynamic_allocator_block_size(DynamicAllocator* allocator, const void* block);
+
+/**
+ * @brief Obtains the total amount of free space left in the allocator, including block overhead.
+ */
+KAPI u64 dynamic_allocator_free_space(DynamicAllocator* allocator);
+
+/**
+ * @brief Obtains the size of the largest contiguous free block. Comparing this against
+ * dynamic_allocator_free_space gives a measure of fragmentation.
+ */
+KAPI u64 dynamic_allocator_largest_free_block(DynamicAllocator* allocator);
+
+#ifdef __cplusplus
+}
+#endif
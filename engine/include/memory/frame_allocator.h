@@ -0,0 +1,62 @@
+#pragma once
+
+#include "../defines.h"
+
+// The most frames that can be buffered by the frame allocator.
+#define FRAME_ALLOCATOR_MAX_FRAMES 3
+
+typedef struct FrameAllocatorConfig {
+    // The size in bytes of each frame's arena.
+    u64 frameSize;
+    // The number of arenas to rotate through. Must be greater than the number of frames
+    // the renderer keeps in flight, so that memory handed to the GPU is not reused until
+    // its fence has signalled. At most FRAME_ALLOCATOR_MAX_FRAMES.
+    u8 frameCount;
+} FrameAllocatorConfig;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// The frame allocator belongs to the main thread. Its functions take no locks, so they must
+// not be called from job system workers or any other thread. Jobs that need per-frame memory
+// should be handed a block the main thread allocated before it dispatched them.
+
+/**
+ * @brief Initializes the frame allocator. Call twice, once to obtain the memory requirement
+ * (passing state = 0) and a second time passing the allocated state.
+ *
+ * @param memoryRequirement A pointer to hold the memory requirement of the system state.
+ * @param state The state block, or 0 when only querying the memory requirement.
+ * @param config The configuration of the frame allocator.
+ * @return True on success; otherwise false.
+ */
+KAPI b8 frame_allocator_initialize(u64* memoryRequirement, void* state, FrameAllocatorConfig config);
+
+KAPI void frame_allocator_shutdown(void* state);
+
+/**
+ * @brief Moves on to the next frame's arena and resets it. Called by the application at the
+ * top of each frame, before the game is updated.
+ */
+KAPI void frame_allocator_begin_frame();
+
+/**
+ * @brief Allocates memory that lives until this arena comes around again, frameCount frames
+ * from now. There is no free; everything is released at once when the arena is reset.
+ * Returned memory is zeroed and 16-byte aligned. Main thread only.
+ *
+ * @param size The size in bytes to allocate.
+ * @return A pointer to the memory, or 0 if the arena for this frame is exhausted.
+ */
+KAPI void* frame_allocate(u64 size);
+
+/**
+ * @brief Obtains the number of bytes allocated from the current frame's arena so far.
+ */
+KAPI u64 frame_allocator_used();
+
+#ifdef __cplusplus
+}
+#endif
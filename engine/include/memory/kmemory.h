@@ -7,6 +7,8 @@ typedef enum MemoryTag {
     MEMORY_TAG_UNKNOWN,
     MEMORY_TAG_ARRAY,
     MEMORY_TAG_LINEAR_ALLOCATOR,
+    MEMORY_TAG_DYNAMIC_ALLOCATOR,
+    MEMORY_TAG_POOL_ALLOCATOR,
     MEMORY_TAG_DARRAY,
     MEMORY_TAG_DICT,
     MEMORY_TAG_RING_QUEUE,
@@ -22,31 +24,176 @@ typedef enum MemoryTag {
     MEMORY_TAG_ENTITY,
     MEMORY_TAG_ENTITY_NODE,
     MEMORY_TAG_SCENE,
+    MEMORY_TAG_PROFILER,
 
     MEMORY_TAG_MAX_TAGS
 } MemoryTag;
 
+typedef struct MemorySystemConfig {
+    // Total size in bytes of the heap reserved up front for engine allocations.
+    // Requests that do not fit are passed on to the OS.
+    u64 totalAllocSize;
+} MemorySystemConfig;
+
+/* Allocation tracking. When enabled, every allocation made through the kallocate family
+   records its call site, size, tag and frame so that high-water marks, per-frame allocation
+   rates and outstanding allocations can be reported. Opt in by building with
+   KMEMORY_TRACKING=1; it is always off in release builds and then compiles away entirely. */
+#ifndef KMEMORY_TRACKING
+#define KMEMORY_TRACKING 0
+#endif
+#if KRELEASE == 1
+#undef KMEMORY_TRACKING
+#define KMEMORY_TRACKING 0
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
 #endif
-KAPI void memory_system_initialize(u64* memoryRequirements, void* state);
+KAPI void memory_system_initialize(u64* memoryRequirements, void* state, MemorySystemConfig config);
 KAPI void memory_system_shutdown(void* state);
 
 KAPI void* kallocate(u64 size, MemoryTag tag);
 
 KAPI void kfree(void* block, u64 size, MemoryTag tag);
 
+/**
+ * @brief Resizes a block obtained from kallocate, preserving its contents up to the smaller
+ * of the two sizes. Any bytes beyond oldSize are zeroed. The block is grown in place when
+ * the space it already occupies allows, and is otherwise moved.
+ *
+ * @param block The block to resize, or 0 to allocate a new one.
+ * @param oldSize The size the block was allocated with.
+ * @param newSize The size required.
+ * @param tag The tag the block was allocated with.
+ * @return The resized block, which may differ from block, or 0 on failure, in which case block is left intact.
+ */
+KAPI void* kreallocate(void* block, u64 oldSize, u64 newSize, MemoryTag tag);
+
+/**
+ * @brief Allocates a zeroed block whose address is a multiple of alignment, for data that
+ * needs SIMD loads, its own cache line or matching a GPU copy alignment.
+ * Blocks must be released with kfree_aligned using the same size and alignment.
+ *
+ * @param size The size in bytes to be allocated.
+ * @param alignment The required alignment. Must be a power of two.
+ * @param tag The tag to account the allocation under.
+ * @return The allocated block, or 0 on failure.
+ */
+KAPI void* kallocate_aligned(u64 size, u16 alignment, MemoryTag tag);
+
+/**
+ * @brief Releases a block obtained from kallocate_aligned.
+ */
+KAPI void kfree_aligned(void* block, u64 size, u16 alignment, MemoryTag tag);
+
+/**
+ * @brief Allocates a small object from the memory system's size-class pools. Intended for
+ * small fixed-size objects that are created and destroyed in bulk. Requests larger than the
+ * biggest size class are passed on to kallocate. The returned memory is zeroed.
+ * Safe to call from any thread.
+ * Blocks must be released with kfree_pooled using the same size.
+ */
+KAPI void* kallocate_pooled(u64 size, MemoryTag tag);
+
+/**
+ * @brief Releases a block obtained from kallocate_pooled.
+ */
+KAPI void kfree_pooled(void* block, u64 size, MemoryTag tag);
+
+/**
+ * @brief Returns every block cached by the calling thread to the shared pools. Pooled blocks
+ * freed on a thread are kept in a small per-thread cache for reuse without locking; worker
+ * threads should call this before they exit so those blocks are not stranded.
+ */
+KAPI void memory_thread_cache_flush();
+
 KAPI void* kzero_memory(void* block, u64 size);
 
 KAPI void* kcopy_memory(void* dest, const void* source, u64 size);
 
 KAPI void* kset_memory(void* dest, i32 value, u64 size);
 
+/**
+ * @brief Reports memory use by tag, along with the heap, pools, aligned allocations and
+ * virtual arenas. The report may contain '%', so log it with "%s" rather than as a format.
+ * @return A string which must be released with string_free.
+ */
 KAPI char* get_memory_usage_str();
 
 KAPI u64 get_memory_alloc_count(); 
 
+/**
+ * @brief Obtains the bytes currently allocated under the tag. Pooled blocks count under their
+ * own tag; MEMORY_TAG_POOL_ALLOCATOR counts the part of the pool pages not handed out.
+ */
+KAPI u64 get_memory_tag_usage(MemoryTag tag);
+
+/** @brief Obtains the bytes currently allocated, which is the sum over every tag. */
+KAPI u64 get_memory_total_usage();
+
+/**
+ * @brief Records a change in the address space reserved and committed by virtual arenas, so
+ * that it shows up in the memory stats. May be called before the memory system is initialized.
+ */
+KAPI void memory_system_track_virtual(i64 reservedDelta, i64 committedDelta);
+
+#if KMEMORY_TRACKING
+KAPI void* kallocate_tracked(u64 size, MemoryTag tag, const char* file, u32 line);
+KAPI void kfree_tracked(void* block, u64 size, MemoryTag tag);
+KAPI void* kreallocate_tracked(void* block, u64 oldSize, u64 newSize, MemoryTag tag, const char* file, u32 line);
+KAPI void* kallocate_aligned_tracked(u64 size, u16 alignment, MemoryTag tag, const char* file, u32 line);
+KAPI void kfree_aligned_tracked(void* block, u64 size, u16 alignment, MemoryTag tag);
+KAPI void* kallocate_pooled_tracked(u64 size, MemoryTag tag, const char* file, u32 line);
+KAPI void kfree_pooled_tracked(void* block, u64 size, MemoryTag tag);
+
+/**
+ * @brief Marks the start of a new frame. Allocations are stamped with the frame they were made
+ * in, and the allocation and free counts of the previous frame are kept as its rates.
+ */
+KAPI void memory_tracking_begin_frame();
+
+/**
+ * @brief Logs every allocation that has not been freed yet, with the call site that made it.
+ * Called automatically by memory_system_shutdown to report leaks.
+ *
+ * @param currentFrameOnly Only report allocations made during the current frame.
+ */
+KAPI void memory_tracking_report(b8 currentFrameOnly);
+
+// The totals behind memory_tracking_report and the memory usage report.
+typedef struct MemoryTrackingSummary {
+    // Allocations that have not been freed yet, and their size in bytes.
+    u64 outstanding;
+    u64 outstandingBytes;
+    // The most bytes allocated under each tag at once.
+    u64 peakAllocations[MEMORY_TAG_MAX_TAGS];
+} MemoryTrackingSummary;
+
+/** @brief Obtains the number and size of outstanding allocations and the peak of each tag. */
+KAPI void memory_tracking_get_summary(MemoryTrackingSummary* outSummary);
+
+/**
+ * @brief Looks up the call site that made an allocation which has not been freed yet.
+ *
+ * @return True if the block is a live allocation; otherwise false.
+ */
+KAPI b8 memory_tracking_find(const void* block, const char** outFile, u32* outLine);
+
+// Route every allocation through the tracked versions so that the call site is recorded.
+#define kallocate(size, tag) kallocate_tracked((size), (tag), __FILE__, __LINE__)
+#define kfree(block, size, tag) kfree_tracked((block), (size), (tag))
+#define kreallocate(block, oldSize, newSize, tag) kreallocate_tracked((block), (oldSize), (newSize), (tag), __FILE__, __LINE__)
+#define kallocate_aligned(size, alignment, tag) kallocate_aligned_tracked((size), (alignment), (tag), __FILE__, __LINE__)
+#define kfree_aligned(block, size, alignment, tag) kfree_aligned_tracked((block), (size), (alignment), (tag))
+#define kallocate_pooled(size, tag) kallocate_pooled_tracked((size), (tag), __FILE__, __LINE__)
+#define kfree_pooled(block, size, tag) kfree_pooled_tracked((block), (size), (tag))
+#else
+#define memory_tracking_begin_frame()
+#define memory_tracking_report(currentFrameOnly)
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -2,6 +2,9 @@
 
 #include "../defines.h"
 
+// Alignment of blocks returned by linear_allocator_allocate.
+#define LINEAR_ALLOCATOR_DEFAULT_ALIGNMENT 8
+
 typedef struct LinearAllocator{
     u64 totalSize;
     u64 allocated;
@@ -14,4 +17,16 @@ KAPI void linear_allocator_create(u64 totalSize, void* memory, LinearAllocator*
 KAPI void linear_allocator_destroy(LinearAllocator* allocator);
 
 KAPI void* linear_allocator_allocate(LinearAllocator* allocator, u64 size);
-KAPI void linear_allocator_free_all(LinearAllocator* allocator);
\ No newline at end of file
+
+/**
+ * @brief Allocates a block whose address is a multiple of alignment, skipping over any
+ * padding needed to get there. The padding counts towards the allocated size.
+ *
+ * @param allocator A pointer to the allocator to allocate from.
+ * @param size The size in bytes to be allocated.
+ * @param alignment The required alignment. Must be a power of two.
+ * @return The allocated block, or 0 if there is not enough space left.
+ */
+KAPI void* linear_allocator_allocate_aligned(LinearAllocator* allocator, u64 size, u64 alignment);
+
+KAPI void linear_allocator_free_all(LinearAllocator* allocator);
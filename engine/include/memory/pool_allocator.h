@@ -0,0 +1,65 @@
+#pragma once
+
+#include "../defines.h"
+
+/**
+ * @brief A fixed-size object allocator. Memory is obtained in pages that are each
+ * split into elementsPerPage equally sized elements, and free elements are kept in an
+ * intrusive singly linked list, so allocation and free are both a couple of pointer swaps.
+ * Pages are retained until the pool is destroyed. Members of this structure should not
+ * be modified outside the functions associated with it.
+ */
+typedef struct PoolAllocator {
+    u64 elementSize;
+    u64 elementsPerPage;
+    u64 allocatedCount;
+    u64 pageCount;
+    // Intrusive list threaded through the free elements.
+    void* freeList;
+    // List of the pages backing this pool. The first bytes of each page point to the next one.
+    void* pages;
+} PoolAllocator;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Creates a new pool allocator. No memory is allocated until the first allocation.
+ *
+ * @param elementSize The size in bytes of each element. Rounded up to a multiple of 8.
+ * @param elementsPerPage The number of elements held by each page.
+ * @param pool A pointer to hold the pool.
+ * @return True on success; otherwise false.
+ */
+KAPI b8 pool_allocator_create(u64 elementSize, u64 elementsPerPage, PoolAllocator* pool);
+
+/**
+ * @brief Destroys the provided pool, releasing all of its pages. Any elements still
+ * allocated from the pool become invalid.
+ *
+ * @param pool A pointer to the pool to be destroyed.
+ */
+KAPI void pool_allocator_destroy(PoolAllocator* pool);
+
+/**
+ * @brief Allocates a single element from the pool, adding a new page if required.
+ * The returned memory is not zeroed.
+ *
+ * @param pool A pointer to the pool to allocate from.
+ * @return A pointer to the element, or 0 on failure.
+ */
+KAPI void* pool_allocator_allocate(PoolAllocator* pool);
+
+/**
+ * @brief Returns an element to the pool it was allocated from.
+ *
+ * @param pool A pointer to the pool the element was allocated from.
+ * @param block The element to be freed.
+ */
+KAPI void pool_allocator_free(PoolAllocator* pool, void* block);
+
+#ifdef __cplusplus
+}
+#endif
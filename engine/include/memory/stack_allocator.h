@@ -0,0 +1,86 @@
+#pragma once
+
+#include "../defines.h"
+#include "linear_allocator.h"
+
+// Alignment of blocks returned by stack_allocator_allocate.
+#define STACK_ALLOCATOR_DEFAULT_ALIGNMENT 16
+
+/**
+ * @brief A linear allocator that can also be unwound part of the way. Take a marker before
+ * some temporary allocations and free back to it afterwards to release everything allocated
+ * since, in last-in first-out order. Intended for scratch memory used while parsing or decoding.
+ * Members of this structure should not be modified outside the functions associated with it.
+ */
+typedef struct StackAllocator {
+    LinearAllocator linear;
+    // The most memory that has been in use at once, for sizing the allocator.
+    u64 peak;
+} StackAllocator;
+
+/**
+ * @brief Frees everything allocated after it was taken when it goes out of scope.
+ * Create one with STACK_ALLOCATOR_SCOPE.
+ */
+typedef struct StackAllocatorScope {
+    StackAllocator* allocator;
+    u64 marker;
+} StackAllocatorScope;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Creates a new stack allocator.
+ *
+ * @param totalSize The total size in bytes the allocator should manage.
+ * @param memory A block of memory of totalSize bytes to be used. Pass 0 to have the allocator allocate its own.
+ * @param allocator A pointer to hold the allocator.
+ */
+KAPI void stack_allocator_create(u64 totalSize, void* memory, StackAllocator* allocator);
+
+KAPI void stack_allocator_destroy(StackAllocator* allocator);
+
+/**
+ * @brief Allocates a block of memory, aligned to STACK_ALLOCATOR_DEFAULT_ALIGNMENT.
+ * The memory is not zeroed.
+ *
+ * @return The allocated block, or 0 if there is not enough space left.
+ */
+KAPI void* stack_allocator_allocate(StackAllocator* allocator, u64 size);
+
+KAPI void* stack_allocator_allocate_aligned(StackAllocator* allocator, u64 size, u64 alignment);
+
+/**
+ * @brief Obtains a marker for the current top of the stack.
+ */
+KAPI u64 stack_allocator_get_marker(StackAllocator* allocator);
+
+/**
+ * @brief Frees every allocation made since the given marker was taken. Markers must be freed
+ * to in the reverse order they were taken.
+ */
+KAPI void stack_allocator_free_to_marker(StackAllocator* allocator, u64 marker);
+
+/**
+ * @brief Indicates if the given block lies within the memory of the allocator.
+ */
+KAPI b8 stack_allocator_owns(StackAllocator* allocator, const void* block);
+
+KAPI StackAllocatorScope stack_allocator_scope_begin(StackAllocator* allocator);
+KAPI void stack_allocator_scope_end(StackAllocatorScope* scope);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @brief Declares a scope named name that frees allocator back to its current marker when the
+ * enclosing block is left, including through an early return.
+ */
+#if defined(__GNUC__) || defined(__clang__)
+#define STACK_ALLOCATOR_SCOPE(name, allocator) \
+    StackAllocatorScope name __attribute__((cleanup(stack_allocator_scope_end))) = stack_allocator_scope_begin(allocator)
+#endif
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "../defines.h"
+
+/**
+ * @brief A linear allocator over a large reserved range of virtual address space. Pages are
+ * only committed as allocations reach them, so the arena can be sized generously without
+ * costing physical memory up front, and since the range never moves, pointers into it stay
+ * valid as it grows. Members of this structure should not be modified outside the functions
+ * associated with it.
+ */
+typedef struct VirtualArena {
+    u64 reservedSize;
+    u64 committedSize;
+    u64 allocated;
+    // Highest allocated has reached since the pages were last committed. Memory below it may be dirty.
+    u64 peakAllocated;
+    // Memory is committed in multiples of this size.
+    u64 commitGranularity;
+    void* memory;
+} VirtualArena;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Creates a new virtual arena, reserving but not committing its address space.
+ *
+ * @param reserveSize The most the arena can grow to, in bytes. Rounded up to the commit granularity.
+ * @param hugePages Ask for the range to be backed by huge pages where the platform supports it.
+ * @param arena A pointer to hold the arena.
+ * @return True on success; otherwise false.
+ */
+KAPI b8 virtual_arena_create(u64 reserveSize, b8 hugePages, VirtualArena* arena);
+
+/**
+ * @brief Destroys the arena, releasing its whole address range.
+ */
+KAPI void virtual_arena_destroy(VirtualArena* arena);
+
+/**
+ * @brief Allocates a block of memory, committing more pages if required.
+ * Blocks are 16-byte aligned and zeroed.
+ *
+ * @return The allocated block, or 0 if the reservation is exhausted or pages could not be committed.
+ */
+KAPI void* virtual_arena_allocate(VirtualArena* arena, u64 size);
+
+KAPI void* virtual_arena_allocate_aligned(VirtualArena* arena, u64 size, u64 alignment);
+
+/**
+ * @brief Frees every allocation in the arena. Committed pages are kept for reuse unless
+ * decommit is set, in which case they are handed back to the OS.
+ */
+KAPI void virtual_arena_free_all(VirtualArena* arena, b8 decommit);
+
+#ifdef __cplusplus
+}
+#endif
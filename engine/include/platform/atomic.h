@@ -0,0 +1,58 @@
+#pragma once
+
+#include "../defines.h"
+
+/* Atomic operations on naturally aligned 32 bit, 64 bit and pointer values.
+
+   Loads acquire and stores release, which is enough to publish data from one thread to
+   another. Read-modify-write operations are sequentially consistent. Code that needs
+   weaker or mixed orderings, such as the lock-free queues, uses the compiler builtins
+   directly. */
+
+#if !defined(__GNUC__) && !defined(__clang__)
+#error "platform/atomic.h requires the GCC or Clang __atomic builtins."
+#endif
+
+KINLINE u32 katomic_load_u32(const u32* value) { return __atomic_load_n(value, __ATOMIC_ACQUIRE); }
+KINLINE u64 katomic_load_u64(const u64* value) { return __atomic_load_n(value, __ATOMIC_ACQUIRE); }
+KINLINE void* katomic_load_ptr(void* const* value) { return __atomic_load_n(value, __ATOMIC_ACQUIRE); }
+
+KINLINE void katomic_store_u32(u32* value, u32 desired) { __atomic_store_n(value, desired, __ATOMIC_RELEASE); }
+KINLINE void katomic_store_u64(u64* value, u64 desired) { __atomic_store_n(value, desired, __ATOMIC_RELEASE); }
+KINLINE void katomic_store_ptr(void** value, void* desired) { __atomic_store_n(value, desired, __ATOMIC_RELEASE); }
+
+// Return the value from before the operation.
+KINLINE u32 katomic_fetch_add_u32(u32* value, u32 amount) { return __atomic_fetch_add(value, amount, __ATOMIC_SEQ_CST); }
+KINLINE u64 katomic_fetch_add_u64(u64* value, u64 amount) { return __atomic_fetch_add(value, amount, __ATOMIC_SEQ_CST); }
+KINLINE u32 katomic_fetch_sub_u32(u32* value, u32 amount) { return __atomic_fetch_sub(value, amount, __ATOMIC_SEQ_CST); }
+KINLINE u64 katomic_fetch_sub_u64(u64* value, u64 amount) { return __atomic_fetch_sub(value, amount, __ATOMIC_SEQ_CST); }
+KINLINE u32 katomic_fetch_or_u32(u32* value, u32 bits) { return __atomic_fetch_or(value, bits, __ATOMIC_SEQ_CST); }
+KINLINE u32 katomic_fetch_and_u32(u32* value, u32 bits) { return __atomic_fetch_and(value, bits, __ATOMIC_SEQ_CST); }
+
+KINLINE u32 katomic_exchange_u32(u32* value, u32 desired) { return __atomic_exchange_n(value, desired, __ATOMIC_SEQ_CST); }
+KINLINE u64 katomic_exchange_u64(u64* value, u64 desired) { return __atomic_exchange_n(value, desired, __ATOMIC_SEQ_CST); }
+KINLINE void* katomic_exchange_ptr(void** value, void* desired) { return __atomic_exchange_n(value, desired, __ATOMIC_SEQ_CST); }
+
+/* Replace the value with desired if it equals *expected. On failure, *expected receives
+   the current value, ready for the next attempt of a retry loop. */
+KINLINE b8 katomic_compare_exchange_u32(u32* value, u32* expected, u32 desired) {
+    return __atomic_compare_exchange_n(value, expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+KINLINE b8 katomic_compare_exchange_u64(u64* value, u64* expected, u64 desired) {
+    return __atomic_compare_exchange_n(value, expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+KINLINE b8 katomic_compare_exchange_ptr(void** value, void** expected, void* desired) {
+    return __atomic_compare_exchange_n(value, expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+// A full memory barrier.
+KINLINE void katomic_fence() { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+
+// Tells the CPU the thread is spinning, freeing resources for its hyperthread sibling. Use in busy-wait loops.
+KINLINE void kcpu_pause() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
@@ -27,6 +27,13 @@ typedef enum FileModes{
  */
 KAPI b8 filesystem_exists(const char* path);
 
+/**
+ * Deletes the file at the given path. The file should not be open.
+ * @param path The path of the file to be deleted.
+ * @returns True if deleted; otherwise false.
+ */
+KAPI b8 filesystem_delete(const char* path);
+
 /** 
  * Attempt to open file located at path.
  * @param path The path of the file to be opened.
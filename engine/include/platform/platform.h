@@ -23,17 +23,43 @@ void platform_system_shutdown(void* platformState);
 
 b8 platform_pump_messages(void* platformState);
 
+// Alignment used by platform_allocate when aligned is true. One cache line.
+#define PLATFORM_DEFAULT_ALIGNMENT 64
+
 void* platform_allocate(u64 size, b8 aligned);
+// Allocates a block aligned to the given power of two. Release it with platform_free passing aligned = true.
+void* platform_allocate_aligned(u64 size, u64 alignment);
 void platform_free(void* block, b8 aligned);
+// Resizes a block from platform_allocate with aligned = false, moving it if needed. Returns 0 on failure, leaving the block intact.
+void* platform_reallocate(void* block, u64 size);
+
+// Virtual memory. Reserving only claims address space; nothing is backed by physical
+// memory until it has been committed.
+u64 platform_memory_page_size();
+// Reserves size bytes of address space. When hugePages is set, the range is marked as a
+// candidate for transparent huge pages. Returns 0 on failure.
+void* platform_memory_reserve(u64 size, b8 hugePages);
+// Makes a page aligned range of reserved memory readable and writable.
+b8 platform_memory_commit(void* address, u64 size);
+// Releases the physical memory behind a committed range, leaving it reserved.
+void platform_memory_decommit(void* address, u64 size);
+// Releases a whole reserved range.
+void platform_memory_release(void* address, u64 size);
+
 void* platform_zero_memory(void* block, u64 size);
 void* platform_copy_memory(void* dest, const void* source, u64 size);
 void* platform_set_memory(void* dest, i32 value, u64 size);
 
 void platform_console_write(const char* message, u8 colour);
 void platform_console_write_error(const char* message, u8 colour);
+// Pushes out anything the console writes above have buffered.
+void platform_console_flush();
 
 f64 platform_get_absolute_time();
 
+// Nanoseconds from a monotonic clock that is not slewed by time adjustment, for timing short spans.
+u64 platform_get_timestamp();
+
 // Sleep on the thread for the provided ms. This blocks the main thread.
 // Should only be used for giving time back to the OS for unused update power.
 // Therefore it is not exported.
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "../defines.h"
+
+/* Threads and the primitives used to coordinate them. Atomic operations are in
+   platform/atomic.h.
+
+   The mutex, condition variable and semaphore below need no creation or destruction
+   beyond zeroing them, and hold no operating system resources, so they can live in any
+   structure. Waiting threads sleep in the kernel rather than spin. */
+
+// The entry point of a thread. The return value is the thread's exit code.
+typedef u32 (*PFN_thread_start)(void* params);
+
+typedef struct KThread {
+    // The platform's handle to the thread.
+    u64 handle;
+} KThread;
+
+// A counting semaphore. A zeroed KSemaphore has a count of zero.
+typedef struct KSemaphore {
+    u32 count;
+    u32 waiters;
+} KSemaphore;
+
+// A non-recursive mutex. A zeroed KMutex is unlocked.
+typedef struct KMutex {
+    // 0 when unlocked, 1 when locked, 2 when locked and another thread may be waiting.
+    u32 state;
+} KMutex;
+
+// A condition variable, used with a KMutex. A zeroed KConditionVariable is ready to use.
+typedef struct KConditionVariable {
+    // Bumped by every signal, so a waiter can tell it missed nothing.
+    u32 sequence;
+} KConditionVariable;
+
+// A key to a pointer that has a separate value on each thread, for use where KTHREAD_LOCAL cannot be.
+typedef struct KThreadLocalKey {
+    u32 key;
+} KThreadLocalKey;
+
+typedef struct PlatformCpuInfo {
+    // Logical processors available to the process, counting each hyperthread.
+    u32 processorCount;
+    // Distinct physical cores among them.
+    u32 coreCount;
+    // Distinct sockets among them.
+    u32 packageCount;
+    // Cache sizes in bytes, or 0 where unknown. L2 and L3 may be shared between cores.
+    u32 cacheLineSize;
+    u32 l1DataCacheSize;
+    u32 l2CacheSize;
+    u32 l3CacheSize;
+} PlatformCpuInfo;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+ * @brief Starts a new thread running start(params).
+ *
+ * @param start The function the thread runs. Required.
+ * @param params Passed to start.
+ * @param outThread Holds the new thread. Required.
+ * @return True on success; otherwise false.
+ */
+KAPI b8 platform_thread_create(PFN_thread_start start, void* params, KThread* outThread);
+
+/**
+ * @brief Blocks until the thread has finished, then releases it.
+ *
+ * @return The value the thread's start function returned, or 0 if there was no thread.
+ */
+KAPI u32 platform_thread_join(KThread* thread);
+
+/** @brief Names the thread for debuggers and profilers. Linux keeps the first 15 characters. */
+KAPI void platform_thread_set_name(KThread* thread, const char* name);
+
+/** @brief Names the calling thread. */
+KAPI void platform_thread_set_current_name(const char* name);
+
+/** @brief Obtains the operating system's id for the calling thread. */
+KAPI u64 platform_thread_current_id();
+
+/**
+ * @brief Restricts the thread to run only on the given logical processor.
+ *
+ * @return True on success; false if the platform refused or the processor does not exist.
+ */
+KAPI b8 platform_thread_set_affinity(KThread* thread, u32 processorIndex);
+
+/** @brief Gives the rest of the calling thread's time slice to another thread. */
+KAPI void platform_thread_yield();
+
+/** @brief Obtains the number of logical processors available to the process. Always at least 1. */
+KAPI u32 platform_get_processor_count();
+
+/**
+ * @brief Obtains the processor topology and cache sizes.
+ *
+ * @param outInfo Holds the information. Fields the platform cannot report are filled with
+ * safe defaults: one core per processor, one package and KCACHE_LINE_SIZE.
+ */
+KAPI void platform_get_cpu_info(PlatformCpuInfo* outInfo);
+
+/**
+ * @brief Obtains the physical core a logical processor belongs to, so work can be spread
+ * over cores before their hyperthreads.
+ *
+ * @return An index below PlatformCpuInfo.coreCount, or INVALID_ID if unknown.
+ */
+KAPI u32 platform_get_processor_core(u32 processorIndex);
+
+/**
+ * @brief Lists one logical processor of each physical core available to the process, in
+ * processor order, for pinning threads so that no two share a core or its hyperthreads.
+ * Processors whose core is unknown are listed as cores of their own.
+ *
+ * @param outProcessors Holds the processor indices.
+ * @param maxCount The most indices outProcessors holds.
+ * @return The number of indices written.
+ */
+KAPI u32 platform_get_core_processors(u32* outProcessors, u32 maxCount);
+
+KAPI void platform_mutex_lock(KMutex* mutex);
+
+/** @brief Locks the mutex if it is free. Returns true if the lock was taken. */
+KAPI b8 platform_mutex_try_lock(KMutex* mutex);
+
+KAPI void platform_mutex_unlock(KMutex* mutex);
+
+/**
+ * @brief Unlocks the mutex, sleeps until the condition variable is signalled, then locks
+ * the mutex again. Wakeups may be spurious, so callers recheck their condition in a loop.
+ *
+ * @param condition The condition variable to wait on.
+ * @param mutex A mutex locked by the calling thread.
+ */
+KAPI void platform_condition_wait(KConditionVariable* condition, KMutex* mutex);
+
+/** @brief As platform_condition_wait, giving up after timeoutMs. Returns false if the time ran out. */
+KAPI b8 platform_condition_wait_timeout(KConditionVariable* condition, KMutex* mutex, u64 timeoutMs);
+
+/** @brief Wakes one thread waiting on the condition variable, if there is one. */
+KAPI void platform_condition_signal(KConditionVariable* condition);
+
+/** @brief Wakes every thread waiting on the condition variable. */
+KAPI void platform_condition_broadcast(KConditionVariable* condition);
+
+/** @brief Sets the count of a semaphore. Must not be called while threads are waiting on it. */
+KAPI void platform_semaphore_create(u32 initialCount, KSemaphore* outSemaphore);
+
+/** @brief Adds count to the semaphore, waking up to that many waiting threads. */
+KAPI void platform_semaphore_signal(KSemaphore* semaphore, u32 count);
+
+/** @brief Sleeps until the count is above zero, then decrements it. */
+KAPI void platform_semaphore_wait(KSemaphore* semaphore);
+
+/** @brief As platform_semaphore_wait, giving up after timeoutMs. Returns false if the time ran out. */
+KAPI b8 platform_semaphore_wait_timeout(KSemaphore* semaphore, u64 timeoutMs);
+
+/**
+ * @brief Creates a thread-local key. Every thread's value starts as 0.
+ *
+ * @return True on success; false if the platform has run out of keys.
+ */
+KAPI b8 platform_thread_local_create(KThreadLocalKey* outKey);
+
+/** @brief Deletes the key. The values themselves are not freed. */
+KAPI void platform_thread_local_destroy(KThreadLocalKey* key);
+
+KAPI void* platform_thread_local_get(KThreadLocalKey* key);
+
+KAPI void platform_thread_local_set(KThreadLocalKey* key, void* value);
+
+#ifdef __cplusplus
+}
+#endif
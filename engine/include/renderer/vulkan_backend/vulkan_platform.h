@@ -6,7 +6,7 @@
 extern "C"
 {
 #endif
-void platform_get_required_extension_names(std::vector<const char*>* extensions); 
+void platform_get_required_extension_names(kvector<const char*>* extensions); 
 b8 platform_create_vulkan_surface(PlatformState* platformState,VulkanContext* context);
 #ifdef __cplusplus
 }
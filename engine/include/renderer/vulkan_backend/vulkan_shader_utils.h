@@ -2,4 +2,7 @@
 
 #include "vulkan_types.inl"
 
-b8 create_shader_module(VulkanContext* context, const char* name,const char* stageTypeString, VkShaderStageFlagBits shaderStageFlag, u32 stageIndex, VulkanShaderStage* shaderStages,int deviceIndex);
\ No newline at end of file
+/**
+ * @brief Creates a shader module from a compiled SPIR-V file, e.g. "shaders/Builtin.MaterialShader.vert.spv".
+ */
+b8 create_shader_module(VulkanContext* context, const char* filename, VkShaderStageFlagBits shaderStageFlag, u32 stageIndex, VulkanShaderStage* shaderStages,int deviceIndex);
\ No newline at end of file
@@ -6,8 +6,16 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
-#include <vector>
 #include "../renderer_types.inl"
+#include "../../containers/slot_map.h"
+#include "../../containers/kvector.h"
+
+// Almost every machine has one or two GPUs, so per-device arrays keep that many inline.
+#define VULKAN_INLINE_DEVICE_COUNT 2
+
+// An array with an entry per logical device.
+template <typename T>
+using VulkanPerDevice = kvector<T, VULKAN_INLINE_DEVICE_COUNT>;
 
 
 
@@ -44,19 +52,19 @@ typedef struct VulkanDevice{
     VulkanSwapChainSupportInfo swapchainSupport;
 
 
-    std::vector<VkPhysicalDevice> physicalDevices;
-    std::vector<VkDevice> logicalDevices;
-    std::vector<const char*> deviceNames;
-    std::vector<u32> graphicsQueueIndex;
-    std::vector<u32> presentQueueIndex;
-    std::vector<u32> transferQueueIndex;
-    std::vector<VkQueue> graphicsQueues;
-    std::vector<VkQueue> transferQueues;
-    std::vector<VkQueue> presentQueues;
-    std::vector<VkCommandPool> graphicsCommandPools;
-    std::vector<VkPhysicalDeviceProperties> properties;
-    std::vector<VkPhysicalDeviceFeatures> features;
-    std::vector<VkPhysicalDeviceMemoryProperties> memory;
+    VulkanPerDevice<VkPhysicalDevice> physicalDevices;
+    VulkanPerDevice<VkDevice> logicalDevices;
+    VulkanPerDevice<const char*> deviceNames;
+    VulkanPerDevice<u32> graphicsQueueIndex;
+    VulkanPerDevice<u32> presentQueueIndex;
+    VulkanPerDevice<u32> transferQueueIndex;
+    VulkanPerDevice<VkQueue> graphicsQueues;
+    VulkanPerDevice<VkQueue> transferQueues;
+    VulkanPerDevice<VkQueue> presentQueues;
+    VulkanPerDevice<VkCommandPool> graphicsCommandPools;
+    VulkanPerDevice<VkPhysicalDeviceProperties> properties;
+    VulkanPerDevice<VkPhysicalDeviceFeatures> features;
+    VulkanPerDevice<VkPhysicalDeviceMemoryProperties> memory;
 
   
     VkFormat depthFormat;
@@ -94,7 +102,7 @@ typedef struct VulkanRenderpass{
 
 
 typedef struct VulkanFramebuffer{
-  std::vector<VkImageView> attachments;
+  kvector<VkImageView, 2> attachments;
   VulkanRenderpass* renderpass;
   u32 attachmentCount;
   VkFramebuffer handle;
@@ -106,10 +114,10 @@ typedef struct VulkanSwapchain{
   u8 maxFramesInFlight;
   VkSwapchainKHR handle;
   u32 imageCount;
-  std::vector<VkImage> images;
-  std::vector<VkImageView> views;
+  kvector<VkImage> images;
+  kvector<VkImageView> views;
   VulkanImage depthAttachment;
-  std::vector<VulkanFramebuffer> framebuffers;
+  kvector<VulkanFramebuffer> framebuffers;
 
 }VulkanSwapchain;
 
@@ -202,14 +210,14 @@ typedef struct VulkanTextureData{
 } VulkanTextureData;
 
 typedef struct VulkanTexture{
-  char name[TEXTURE_NAME_MAX_LENGTH];
+  u32 nameId;
   u32 id;
   u32 width;
   u32 height;
   u8 channelCount;
   b8 hasTransparency;
   u32 generation;
-  std::vector<VulkanTextureData*> textureData;
+  VulkanPerDevice<VulkanTextureData*> textureData;
 }VulkanTexture;
 
 
@@ -237,30 +245,31 @@ typedef struct VulkanContext {
     f64 frameDeltaTime;
 
 
-    std::vector<u64> framebufferWidth;
-    std::vector<u64> framebufferHeight;
-    std::vector<int> currentDeviceIndex;
-    std::vector<int> lastDeviceIndex;
-    std::vector<u64> framebufferSizeGeneration;
-    std::vector<u64> framebufferSizeLastGeneration;
-    std::vector<VulkanSwapchain> swapchains;
-    std::vector<VulkanRenderpass> mainRenderPasses;
-    std::vector<std::vector<VulkanCommandBuffer>> graphicsCommandBuffers;
-    std::vector<std::vector<VkSemaphore>> imageAvalableSemaphores;
-    std::vector<std::vector<VkSemaphore>> queueCompleteSemaphores;
-    std::vector<std::vector<VulkanFence>> inFlightFences;
-    std::vector<std::vector<VulkanFence*>> imagesInFlight;
-    std::vector<u32> imageIndex;
-    std::vector<u32> currentFrame;
-    std::vector<b8> recreatingSwapchain;
-    std::vector<VulkanMaterialShader> materialShaders;
-    std::vector<VulkanBuffer> vertexBuffers;
-    std::vector<VulkanBuffer> indexBuffers;
-    std::vector<u32> geometryVertexOffset;
-    std::vector<u32> geometryIndexOffset;
+    VulkanPerDevice<u64> framebufferWidth;
+    VulkanPerDevice<u64> framebufferHeight;
+    VulkanPerDevice<int> currentDeviceIndex;
+    VulkanPerDevice<int> lastDeviceIndex;
+    VulkanPerDevice<u64> framebufferSizeGeneration;
+    VulkanPerDevice<u64> framebufferSizeLastGeneration;
+    VulkanPerDevice<VulkanSwapchain> swapchains;
+    VulkanPerDevice<VulkanRenderpass> mainRenderPasses;
+    VulkanPerDevice<kvector<VulkanCommandBuffer>> graphicsCommandBuffers;
+    VulkanPerDevice<kvector<VkSemaphore>> imageAvalableSemaphores;
+    VulkanPerDevice<kvector<VkSemaphore>> queueCompleteSemaphores;
+    VulkanPerDevice<kvector<VulkanFence>> inFlightFences;
+    VulkanPerDevice<kvector<VulkanFence*>> imagesInFlight;
+    VulkanPerDevice<u32> imageIndex;
+    VulkanPerDevice<u32> currentFrame;
+    VulkanPerDevice<b8> recreatingSwapchain;
+    VulkanPerDevice<VulkanMaterialShader> materialShaders;
+    VulkanPerDevice<VulkanBuffer> vertexBuffers;
+    VulkanPerDevice<VulkanBuffer> indexBuffers;
+    VulkanPerDevice<u32> geometryVertexOffset;
+    VulkanPerDevice<u32> geometryIndexOffset;
 
     //TODO: Make dynamic (possibly vector it for multi-GPU)
-    VulkanGeometryData geometries[VULKAN_MAX_GEOMETRY_COUNT];
+    // VulkanGeometryData for each uploaded geometry, addressed by Geometry::internalId.
+    SlotMap geometries;
 
 
     VkResult swapchainResult;
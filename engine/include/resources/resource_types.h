@@ -28,7 +28,8 @@ typedef struct ImageResourceData{
 
 #define TEXTURE_NAME_MAX_LENGTH 512
 typedef struct Texture {
-    char name[TEXTURE_NAME_MAX_LENGTH];
+    // The interned name. See string_intern_get.
+    u32 nameId;
     u32 id;
     u32 width;
     u32 height;
@@ -49,8 +50,12 @@ typedef struct TextureMap {
 } TextureMap;
 
 #define MATERIAL_NAME_MAX_LENGTH 256
+// The shader used by materials that do not name one.
+#define BUILTIN_SHADER_NAME_MATERIAL "Builtin.MaterialShader"
 typedef struct MaterialConfig {
     char name[MATERIAL_NAME_MAX_LENGTH];
+    // The id of the shader's name. See string_id.
+    u64 shaderId;
     b8 autoRelease;
     vec4 diffuseColour;
     char diffuseMapName[TEXTURE_NAME_MAX_LENGTH];
@@ -59,7 +64,10 @@ typedef struct Material {
     u32 id;
     u32 generation;
     u32 internalId;
-    char name[MATERIAL_NAME_MAX_LENGTH];
+    // The interned name. See string_intern_get.
+    u32 nameId;
+    // The id of the name of the shader that draws it. The renderer matches it against KSID.
+    u64 shaderId;
     vec4 diffuseColour;
     TextureMap diffuseMap;
 } Material;
@@ -67,7 +75,8 @@ typedef struct Material {
 #define GEOMETRY_NAME_MAX_LENGTH 256
 
 typedef struct Geometry {
-    char name[GEOMETRY_NAME_MAX_LENGTH];
+    // The interned name. See string_intern_get.
+    u32 nameId;
     u32 id;
     u32 internalId;
     u32 generation;
@@ -24,6 +24,19 @@ void material_system_shutdown(void* state);
 
 Material* material_system_acquire(const char* name);
 Material* material_system_acquire_from_config(MaterialConfig config);
+
+/**
+ * @brief Acquires a material, loading its configuration on a worker thread. The material
+ * returned is usable immediately and looks like the default material until the configuration
+ * is delivered by resource_system_process_completed_loads; its values are then filled in, its
+ * diffuse map acquired with texture_system_acquire_async and its generation bumped.
+ *
+ * @param name The name of the material.
+ * @param autoRelease Whether the material is destroyed with its last reference. Like the
+ * autoRelease of a configuration, only the first acquire sets it; the loaded file does not change it.
+ * @return The material, or 0 if it could not be registered.
+ */
+Material* material_system_acquire_async(const char* name, b8 autoRelease);
 void material_system_release(const char* name);
 Material* material_system_get_default();
 
@@ -6,10 +6,14 @@ extern "C"
 #endif
 
 #include "../resources/resource_types.h"
+#include "../memory/stack_allocator.h"
 typedef struct ResourceSystemConfig{
     u32 maxLoaderCount;
     // Relative base path for assets
     char* assetBasePath;
+    // Size in bytes of the scratch stack loaders use for temporary memory while loading.
+    // Each thread that loads resources gets its own.
+    u64 scratchSize;
 }ResourceSystemConfig;
 
 typedef struct ResourceLoader{
@@ -22,6 +26,16 @@ typedef struct ResourceLoader{
 
 }ResourceLoader;
 
+/**
+ * @brief Receives the result of resource_system_load_async, on the main thread.
+ *
+ * @param resource The loaded resource, or 0 if the load failed. The callee takes ownership
+ * and passes a copy to resource_system_unload when done with it. The name is only valid
+ * during the call.
+ * @param user The pointer passed to resource_system_load_async.
+ */
+typedef void (*PFN_resource_loaded)(Resource* resource, void* user);
+
 b8 resource_system_initialize(u64* memory_requirement, void* state, ResourceSystemConfig config);
 void resource_system_shutdown(void* state);
 
@@ -30,10 +44,40 @@ KAPI b8 resource_system_register_loader(ResourceLoader loader);
 KAPI b8 resource_system_load(const char* name, ResourceType type, Resource* resource);
 KAPI b8 resource_system_load_custom(const char* name, const char* custom_type, Resource* resource);
 
+/**
+ * @brief Loads a resource on a job system worker, so file reads and decoding stay off the
+ * calling thread. The callback is invoked by the next resource_system_process_completed_loads
+ * after the load finishes, never from within this function.
+ *
+ * @param name The name of the resource. Copied, so it need not outlive the call.
+ * @param type The type of the resource. Must not be RESOURCE_TYPE_CUSTOM.
+ * @param callback Receives the result. Required.
+ * @param user Passed to the callback.
+ * @return True if the load was started; false if no loader exists for the type.
+ */
+KAPI b8 resource_system_load_async(const char* name, ResourceType type, PFN_resource_loaded callback, void* user);
+
+/**
+ * @brief Invokes the callbacks of every asynchronous load that has finished since the last
+ * call. This is the point where loaded resources reach the main thread; call it once per
+ * frame from the main thread.
+ */
+KAPI void resource_system_process_completed_loads();
+
 KAPI void resource_system_unload(Resource* resource);
 
 KAPI const char* resource_system_base_path();
 
+/**
+ * @brief Obtains the scratch stack loaders use for memory that is only needed during a load,
+ * such as parse buffers and decode temporaries. Take a marker (or use STACK_ALLOCATOR_SCOPE)
+ * before allocating and free back to it before the load returns.
+ *
+ * Each job system thread has its own stack, so loads on different threads do not interfere.
+ * Returns 0 on threads outside the job system while it is running.
+ */
+KAPI StackAllocator* resource_system_scratch_allocator();
+
 #ifdef __cplusplus
 }
 #endif
@@ -16,6 +16,17 @@ b8 texture_system_initialize(u64* memoryRequirement, void* state, TextureSystemC
 void texture_system_shutdown(void* state);
 
 Texture* texture_system_acquire(const char* name, b8 autoRelease);
+
+/**
+ * @brief Acquires a texture like texture_system_acquire, but loads it on a worker thread.
+ * Until the load completes the texture's generation is INVALID_ID, so the renderer draws the
+ * default texture in its place; the image is uploaded and the generation set when
+ * resource_system_process_completed_loads delivers it. If the load fails the texture keeps
+ * drawing as the default.
+ *
+ * @return The texture, which is valid immediately, or 0 if it could not be registered.
+ */
+Texture* texture_system_acquire_async(const char* name, b8 autoRelease);
 void texture_system_release(const char* name);
 
 
@@ -2,11 +2,14 @@
 #include "memory/kmemory.h"
 #include "core/logger.h"
 
+#include <string.h>
+
+#define DARRAY_HEADER_SIZE (DARRAY_FIELD_LENGTH * sizeof(u64))
+
 void* _darray_create(u64 length, u64 stride) {
-    u64 header_size = DARRAY_FIELD_LENGTH * sizeof(u64);
     u64 array_size = length * stride;
-    u64* new_array = kallocate(header_size + array_size, MEMORY_TAG_DARRAY);
-    kset_memory(new_array, 0, header_size + array_size);
+    // kallocate hands back zeroed memory.
+    u64* new_array = kallocate(DARRAY_HEADER_SIZE + array_size, MEMORY_TAG_DARRAY);
     new_array[DARRAY_CAPACITY] = length;
     new_array[DARRAY_LENGTH] = 0;
     new_array[DARRAY_STRIDE] = stride;
@@ -14,105 +17,150 @@ void* _darray_create(u64 length, u64 stride) {
 }
 
 void _darray_destroy(void* array) {
-    u64* header = (u64*)array - DARRAY_FIELD_LENGTH;
-    u64 header_size = DARRAY_FIELD_LENGTH * sizeof(u64);
-    u64 total_size = header_size + header[DARRAY_CAPACITY] * header[DARRAY_STRIDE];
+    u64* header = DARRAY_HEADER(array);
+    u64 total_size = DARRAY_HEADER_SIZE + header[DARRAY_CAPACITY] * header[DARRAY_STRIDE];
     kfree(header, total_size, MEMORY_TAG_DARRAY);
 }
 
 u64 _darray_field_get(void* array, u64 field) {
-    u64* header = (u64*)array - DARRAY_FIELD_LENGTH;
-    return header[field];
+    return DARRAY_HEADER(array)[field];
 }
 
 void _darray_field_set(void* array, u64 field, u64 value) {
-    u64* header = (u64*)array - DARRAY_FIELD_LENGTH;
-    header[field] = value;
+    DARRAY_HEADER(array)[field] = value;
+}
+
+// Changes the capacity, moving the array only when the allocation cannot be resized in place.
+static void* set_capacity(void* array, u64 capacity) {
+    u64* header = DARRAY_HEADER(array);
+    u64 stride = header[DARRAY_STRIDE];
+    u64* resized = kreallocate(
+        header,
+        DARRAY_HEADER_SIZE + header[DARRAY_CAPACITY] * stride,
+        DARRAY_HEADER_SIZE + capacity * stride,
+        MEMORY_TAG_DARRAY);
+    if (!resized) {
+        KFATAL("darray - unable to change capacity to %llu elements.", capacity);
+        return array;
+    }
+    resized[DARRAY_CAPACITY] = capacity;
+    return (void*)(resized + DARRAY_FIELD_LENGTH);
+}
+
+// Grows geometrically, so that a run of pushes costs amortized constant time.
+static void* grow(void* array, u64 required) {
+    u64 capacity = _darray_capacity(array) * DARRAY_RESIZE_FACTOR;
+    if (capacity < DARRAY_DEFAULT_CAPACITY) {
+        capacity = DARRAY_DEFAULT_CAPACITY;
+    }
+    if (capacity < required) {
+        capacity = required;
+    }
+    return set_capacity(array, capacity);
 }
 
 void* _darray_resize(void* array) {
-    u64 length = darray_length(array);
-    u64 stride = darray_stride(array);
-    void* temp = _darray_create(
-        (DARRAY_RESIZE_FACTOR * darray_capacity(array)),
-        stride);
-    kcopy_memory(temp, array, length * stride);
-
-    _darray_field_set(temp, DARRAY_LENGTH, length);
-    _darray_destroy(array);
-    return temp;
+    return grow(array, 0);
+}
+
+void* _darray_reserve(void* array, u64 capacity) {
+    if (capacity <= _darray_capacity(array)) {
+        return array;
+    }
+    return set_capacity(array, capacity);
+}
+
+void* _darray_shrink_to_fit(void* array) {
+    u64 length = _darray_length(array);
+    if (length == _darray_capacity(array)) {
+        return array;
+    }
+    return set_capacity(array, length);
 }
 
 void* _darray_push(void* array, const void* value_ptr) {
-    u64 length = darray_length(array);
-    u64 stride = darray_stride(array);
-    if (length >= darray_capacity(array)) {
-        array = _darray_resize(array);
+    u64 length = _darray_length(array);
+    u64 stride = _darray_stride(array);
+    if (length >= _darray_capacity(array)) {
+        array = grow(array, length + 1);
     }
 
-    u64 addr = (u64)array;
-    addr += (length * stride);
-    kcopy_memory((void*)addr, value_ptr, stride);
-    _darray_field_set(array, DARRAY_LENGTH, length + 1);
+    memcpy((u8*)array + length * stride, value_ptr, stride);
+    DARRAY_HEADER(array)[DARRAY_LENGTH] = length + 1;
+    return array;
+}
+
+void* _darray_push_n(void* array, const void* value_ptr, u64 count) {
+    u64 length = _darray_length(array);
+    u64 stride = _darray_stride(array);
+    if (length + count > _darray_capacity(array)) {
+        array = grow(array, length + count);
+    }
+
+    u8* dest = (u8*)array + length * stride;
+    for (u64 i = 0; i < count; ++i) {
+        memcpy(dest + i * stride, value_ptr, stride);
+    }
+    DARRAY_HEADER(array)[DARRAY_LENGTH] = length + count;
+    return array;
+}
+
+void* _darray_append_array(void* array, const void* values, u64 count) {
+    u64 length = _darray_length(array);
+    u64 stride = _darray_stride(array);
+    if (length + count > _darray_capacity(array)) {
+        array = grow(array, length + count);
+    }
+
+    memcpy((u8*)array + length * stride, values, count * stride);
+    DARRAY_HEADER(array)[DARRAY_LENGTH] = length + count;
     return array;
 }
 
 void _darray_pop(void* array, void* dest) {
-    u64 length = darray_length(array);
-    u64 stride = darray_stride(array);
-    u64 addr = (u64)array;
-    addr += ((length - 1) * stride);
-    kcopy_memory(dest, (void*)addr, stride);
-    _darray_field_set(array, DARRAY_LENGTH, length - 1);
+    u64 length = _darray_length(array);
+    u64 stride = _darray_stride(array);
+    memcpy(dest, (u8*)array + (length - 1) * stride, stride);
+    DARRAY_HEADER(array)[DARRAY_LENGTH] = length - 1;
 }
 
 void* _darray_pop_at(void* array, u64 index, void* dest) {
-    u64 length = darray_length(array);
-    u64 stride = darray_stride(array);
+    u64 length = _darray_length(array);
+    u64 stride = _darray_stride(array);
     if (index >= length) {
-        KERROR("Index outside the bounds of this array! Length: %i, index: %index", length, index);
+        KERROR("Index outside the bounds of this array! Length: %llu, index: %llu", length, index);
         return array;
     }
 
-    u64 addr = (u64)array;
-    kcopy_memory(dest, (void*)(addr + (index * stride)), stride);
+    u8* element = (u8*)array + index * stride;
+    memcpy(dest, element, stride);
 
-    // If not on the last element, snip out the entry and copy the rest inward.
-    if (index != length - 1) {
-        kcopy_memory(
-            (void*)(addr + (index * stride)),
-            (void*)(addr + ((index + 1) * stride)),
-            stride * (length - index));
-    }
+    // Snip out the entry and move the rest inward. The ranges overlap.
+    memmove(element, element + stride, (length - index - 1) * stride);
 
-    _darray_field_set(array, DARRAY_LENGTH, length - 1);
+    DARRAY_HEADER(array)[DARRAY_LENGTH] = length - 1;
     return array;
 }
 
 void* _darray_insert_at(void* array, u64 index, void* value_ptr) {
-    u64 length = darray_length(array);
-    u64 stride = darray_stride(array);
-    if (index >= length) {
-        KERROR("Index outside the bounds of this array! Length: %i, index: %index", length, index);
+    u64 length = _darray_length(array);
+    u64 stride = _darray_stride(array);
+    // Inserting at the length appends.
+    if (index > length) {
+        KERROR("Index outside the bounds of this array! Length: %llu, index: %llu", length, index);
         return array;
     }
-    if (length >= darray_capacity(array)) {
-        array = _darray_resize(array);
+    if (length >= _darray_capacity(array)) {
+        array = grow(array, length + 1);
     }
 
-    u64 addr = (u64)array;
-
-    // If not on the last element, copy the rest outward.
-    if (index != length - 1) {
-        kcopy_memory(
-            (void*)(addr + ((index + 1) * stride)),
-            (void*)(addr + (index * stride)),
-            stride * (length - index));
-    }
+    // Move the rest outward to make room. The ranges overlap.
+    u8* element = (u8*)array + index * stride;
+    memmove(element + stride, element, (length - index) * stride);
 
     // Set the value at the index
-    kcopy_memory((void*)(addr + (index * stride)), value_ptr, stride);
+    memcpy(element, value_ptr, stride);
 
-    _darray_field_set(array, DARRAY_LENGTH, length + 1);
+    DARRAY_HEADER(array)[DARRAY_LENGTH] = length + 1;
     return array;
-} 
\ No newline at end of file
+}
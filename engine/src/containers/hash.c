@@ -0,0 +1,85 @@
+#include "containers/hash.h"
+
+#include <string.h>
+
+// wyhash final version 4 (public domain, by Wang Yi), with its default secret.
+static const u64 secret[4] = {0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL};
+
+static inline void multiply(u64* a, u64* b) {
+    __uint128_t r = (__uint128_t)*a * *b;
+    *a = (u64)r;
+    *b = (u64)(r >> 64);
+}
+
+static inline u64 mix(u64 a, u64 b) {
+    multiply(&a, &b);
+    return a ^ b;
+}
+
+// Unaligned little-endian reads. memcpy compiles to a single load.
+static inline u64 read8(const u8* p) {
+    u64 v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+static inline u64 read4(const u8* p) {
+    u32 v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+// Reads 1 to 3 bytes.
+static inline u64 read3(const u8* p, u64 k) {
+    return ((u64)p[0] << 16) | ((u64)p[k >> 1] << 8) | p[k - 1];
+}
+
+u64 hash_bytes(const void* data, u64 length, u64 seed) {
+    const u8* p = (const u8*)data;
+    u64 a, b;
+    seed ^= mix(seed ^ secret[0], secret[1]);
+    if (length <= 16) {
+        if (length >= 4) {
+            a = (read4(p) << 32) | read4(p + ((length >> 3) << 2));
+            b = (read4(p + length - 4) << 32) | read4(p + length - 4 - ((length >> 3) << 2));
+        } else if (length > 0) {
+            a = read3(p, length);
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        u64 i = length;
+        if (i >= 48) {
+            // Three independent lanes, so the multiplies can overlap.
+            u64 see1 = seed, see2 = seed;
+            do {
+                seed = mix(read8(p) ^ secret[1], read8(p + 8) ^ seed);
+                see1 = mix(read8(p + 16) ^ secret[2], read8(p + 24) ^ see1);
+                see2 = mix(read8(p + 32) ^ secret[3], read8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i >= 48);
+            seed ^= see1 ^ see2;
+        }
+        while (i > 16) {
+            seed = mix(read8(p) ^ secret[1], read8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+        a = read8(p + i - 16);
+        b = read8(p + i - 8);
+    }
+    a ^= secret[1];
+    b ^= seed;
+    multiply(&a, &b);
+    return mix(a ^ secret[0] ^ length, b ^ secret[1]);
+}
+
+u64 hash_string(const char* str) {
+    return hash_bytes(str, strlen(str), 0);
+}
+
+u64 hash_u64(u64 value) {
+    return mix(value ^ secret[0], secret[1]);
+}
@@ -2,50 +2,340 @@
 
 #include "memory/kmemory.h"
 #include "core/logger.h"
+#include "core/kstring.h"
+#include "containers/hash.h"
 
-u64 hash_name(const char* name, u32 elementCount) {
-    // A multipler to use when generating a hash. Prime to hopefully avoid collisions.
-    static const u64 multiplier = 97;
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
-    unsigned const char* us;
-    u64 hash = 0;
+// Slot metadata. Full slots hold the low 7 bits of their key's hash, so always have the top bit clear.
+#define CONTROL_EMPTY 0x80
+#define CONTROL_DELETED 0xFE
 
-    for (us = (unsigned const char*)name; *us; us++) {
-        hash = hash * multiplier + *us;
+#define HASHTABLE_MIN_CAPACITY HASHTABLE_GROUP_WIDTH
+
+// Returns a bitmask with bit i set if byte i of the group equals value.
+static u32 group_match(const u8* group, u8 value) {
+#if defined(__SSE2__)
+    __m128i control = _mm_loadu_si128((const __m128i*)group);
+    return (u32)_mm_movemask_epi8(_mm_cmpeq_epi8(control, _mm_set1_epi8((char)value)));
+#else
+    u32 mask = 0;
+    for (u32 i = 0; i < HASHTABLE_GROUP_WIDTH; ++i) {
+        mask |= (u32)(group[i] == value) << i;
+    }
+    return mask;
+#endif
+}
+
+// Returns a bitmask with bit i set if slot i of the group is empty or deleted.
+static u32 group_match_free(const u8* group) {
+#if defined(__SSE2__)
+    return (u32)_mm_movemask_epi8(_mm_loadu_si128((const __m128i*)group));
+#else
+    u32 mask = 0;
+    for (u32 i = 0; i < HASHTABLE_GROUP_WIDTH; ++i) {
+        mask |= (u32)(group[i] >> 7) << i;
+    }
+    return mask;
+#endif
+}
+
+// Keep at most 7/8 of the slots in use, so that every probe reaches an empty slot quickly.
+static u32 max_load(u32 capacity) {
+    return capacity - capacity / 8;
+}
+
+static u32 capacity_for(u32 elementCount) {
+    u32 capacity = HASHTABLE_MIN_CAPACITY;
+    while (max_load(capacity) < elementCount) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+static u64 memory_requirement(u64 elementSize, u32 capacity) {
+    // Keys first, then values, then slot metadata. Keys are 16 bytes, so both keys and values
+    // keep the alignment of the block whatever the element size. The extra value holds the default.
+    return sizeof(HashTableKey) * capacity + elementSize * (capacity + 1) + capacity + HASHTABLE_GROUP_WIDTH;
+}
+
+static void* value_at(HashTable* table, u64 index) {
+    return (u8*)(table->keys + table->capacity) + table->elementSize * index;
+}
+
+static void set_layout(HashTable* table, void* memory, u32 capacity) {
+    table->memory = memory;
+    table->capacity = capacity;
+    table->keys = memory;
+    table->control = (u8*)value_at(table, capacity + 1);
+}
+
+static void set_control(HashTable* table, u32 index, u8 value) {
+    table->control[index] = value;
+    // The first group is mirrored after the last slot, so a group can be loaded from any slot without wrapping.
+    if (index < HASHTABLE_GROUP_WIDTH) {
+        table->control[table->capacity + index] = value;
+    }
+}
+
+// Returns the slot holding the key, or INVALID_ID if it is not present.
+static u32 find_index(HashTable* table, u64 hash, const char* name, u64 id) {
+    u32 mask = table->capacity - 1;
+    u32 position = (u32)(hash >> 7) & mask;
+    u32 stride = 0;
+    u8 tag = hash & 0x7F;
+    while (true) {
+        const u8* group = table->control + position;
+        u32 matches = group_match(group, tag);
+        while (matches) {
+            u32 index = (position + __builtin_ctz(matches)) & mask;
+            HashTableKey* key = &table->keys[index];
+            if (key->hash == hash && (name ? strings_equal(key->name, name) : key->id == id)) {
+                return index;
+            }
+            matches &= matches - 1;
+        }
+        if (group_match(group, CONTROL_EMPTY)) {
+            return INVALID_ID;
+        }
+        // Triangular probing visits every group once the capacity is a power of two.
+        stride += HASHTABLE_GROUP_WIDTH;
+        position = (position + stride) & mask;
+    }
+}
+
+// Returns the first empty or deleted slot along the probe sequence of the hash.
+static u32 find_free_index(HashTable* table, u64 hash) {
+    u32 mask = table->capacity - 1;
+    u32 position = (u32)(hash >> 7) & mask;
+    u32 stride = 0;
+    while (true) {
+        u32 free = group_match_free(table->control + position);
+        if (free) {
+            return (position + __builtin_ctz(free)) & mask;
+        }
+        stride += HASHTABLE_GROUP_WIDTH;
+        position = (position + stride) & mask;
+    }
+}
+
+// Returns which group along the probe sequence of the hash holds the slot.
+static u32 probe_group(HashTable* table, u64 hash, u32 index) {
+    return ((index - (u32)(hash >> 7)) & (table->capacity - 1)) / HASHTABLE_GROUP_WIDTH;
+}
+
+static void swap_slots(HashTable* table, u32 a, u32 b) {
+    HashTableKey key = table->keys[a];
+    table->keys[a] = table->keys[b];
+    table->keys[b] = key;
+    u8* valueA = value_at(table, a);
+    u8* valueB = value_at(table, b);
+    for (u64 i = 0; i < table->elementSize; ++i) {
+        u8 byte = valueA[i];
+        valueA[i] = valueB[i];
+        valueB[i] = byte;
+    }
+}
+
+/* Clears out tombstones without other memory, so tables in fixed memory never allocate.
+   Tombstones are emptied and every entry is marked deleted, meaning not yet placed. Each
+   entry is then moved to the first free slot along its probe sequence, swapping places with
+   an entry not yet placed if that is where it lands. An entry already in the first group
+   with room stays put. */
+static void rehash_in_place(HashTable* table) {
+    for (u32 i = 0; i < table->capacity; ++i) {
+        set_control(table, i, table->control[i] & CONTROL_EMPTY ? CONTROL_EMPTY : CONTROL_DELETED);
+    }
+    for (u32 i = 0; i < table->capacity; ++i) {
+        if (table->control[i] != CONTROL_DELETED) {
+            continue;
+        }
+        u64 hash = table->keys[i].hash;
+        u32 target = find_free_index(table, hash);
+        if (probe_group(table, hash, target) == probe_group(table, hash, i)) {
+            set_control(table, i, hash & 0x7F);
+            continue;
+        }
+        b8 targetEmpty = table->control[target] == CONTROL_EMPTY;
+        swap_slots(table, i, target);
+        set_control(table, target, hash & 0x7F);
+        if (targetEmpty) {
+            set_control(table, i, CONTROL_EMPTY);
+        } else {
+            // Place the entry swapped in next.
+            --i;
+        }
+    }
+    table->tombstones = 0;
+}
+
+// Moves every entry into a fresh layout of the given capacity, which also clears out tombstones.
+static void rehash(HashTable* table, u32 capacity) {
+    if (capacity == table->capacity) {
+        rehash_in_place(table);
+        return;
+    }
+    u32 oldCapacity = table->capacity;
+    u64 oldSize = memory_requirement(table->elementSize, oldCapacity);
+    void* oldMemory = table->memory;
+    void* newMemory = kallocate(memory_requirement(table->elementSize, capacity), MEMORY_TAG_DICT);
+
+    HashTable old = *table;
+    set_layout(&old, oldMemory, oldCapacity);
+    set_layout(table, newMemory, capacity);
+    kset_memory(table->control, CONTROL_EMPTY, capacity + HASHTABLE_GROUP_WIDTH);
+    kcopy_memory(value_at(table, capacity), value_at(&old, oldCapacity), table->elementSize);
+
+    for (u32 i = 0; i < oldCapacity; ++i) {
+        if (old.control[i] & CONTROL_EMPTY) {
+            continue;
+        }
+        u32 index = find_free_index(table, old.keys[i].hash);
+        set_control(table, index, old.control[i]);
+        table->keys[index] = old.keys[i];
+        kcopy_memory(value_at(table, index), value_at(&old, i), table->elementSize);
+    }
+    table->tombstones = 0;
+
+    kfree(oldMemory, oldSize, MEMORY_TAG_DICT);
+}
+
+// Makes sure one more slot can be taken without going over the maximum load.
+static b8 reserve_slot(HashTable* table) {
+    u32 limit = max_load(table->capacity);
+    if (table->count + table->tombstones < limit) {
+        return true;
+    }
+    if (table->ownsMemory) {
+        // Grow if mostly full of entries, otherwise clearing out tombstones is enough.
+        rehash(table, table->count >= limit / 2 ? table->capacity * 2 : table->capacity);
+        return true;
+    }
+    if (table->tombstones) {
+        rehash(table, table->capacity);
+    }
+    return table->count < limit;
+}
+
+static b8 insert(HashTable* table, u64 hash, const char* name, u64 id, void* value) {
+    u32 index = find_index(table, hash, name, id);
+    if (index == INVALID_ID) {
+        if (!reserve_slot(table)) {
+            KERROR("hashtable - table is full (%u entries). Create it with a larger element_count.", table->count);
+            return false;
+        }
+        index = find_free_index(table, hash);
+        if (table->control[index] == CONTROL_DELETED) {
+            table->tombstones--;
+        }
+        set_control(table, index, hash & 0x7F);
+        table->keys[index].hash = hash;
+        if (name) {
+            table->keys[index].name = string_duplicate(name);
+        } else {
+            table->keys[index].id = id;
+        }
+        table->count++;
+    }
+    kcopy_memory(value_at(table, index), value, table->elementSize);
+    return true;
+}
+
+static b8 remove_index(HashTable* table, u32 index) {
+    if (index == INVALID_ID) {
+        return false;
+    }
+    if (!table->isIdKeyed) {
+        string_free(table->keys[index].name);
+    }
+    table->keys[index].name = 0;
+
+    // A probe only stops at an empty slot, so the slot can only be emptied if no probe
+    // could ever have found its group full and moved past it. Otherwise leave a tombstone.
+    u32 mask = table->capacity - 1;
+    u32 emptyBefore = group_match(table->control + ((index - HASHTABLE_GROUP_WIDTH) & mask), CONTROL_EMPTY);
+    u32 emptyAfter = group_match(table->control + index, CONTROL_EMPTY);
+    b8 wasNeverFull = emptyBefore && emptyAfter &&
+                      (u32)__builtin_ctz(emptyAfter) + (u32)(__builtin_clz(emptyBefore) - (32 - HASHTABLE_GROUP_WIDTH)) < HASHTABLE_GROUP_WIDTH;
+    if (wasNeverFull) {
+        set_control(table, index, CONTROL_EMPTY);
+    } else {
+        set_control(table, index, CONTROL_DELETED);
+        table->tombstones++;
     }
+    table->count--;
+    return true;
+}
 
-    // Mod it against the size of the table.
-    hash %= elementCount;
+// Entries keyed by name and by id cannot be mixed, as names are owned copies.
+static b8 check_key_kind(HashTable* table, b8 idKey) {
+    if (table->count == 0 && table->tombstones == 0) {
+        table->isIdKeyed = idKey;
+    }
+    if (table->isIdKeyed != idKey) {
+        KERROR("hashtable - entries of one table must be keyed either all by name or all by id.");
+        return false;
+    }
+    return true;
+}
 
-    return hash;
+u64 hashtable_memory_requirement(u64 elementSize, u32 elementCount) {
+    return memory_requirement(elementSize, capacity_for(elementCount));
 }
 
 void hashtable_create(u64 elementSize, u32 elementCount, void* memory, b8 isPointerType, HashTable* out_hashtable) {
-    if (!memory || !out_hashtable) {
-        KERROR("hashtable_create failed! Pointer to memory and out_hashtable are required.");
+    if (!out_hashtable) {
+        KERROR("hashtable_create failed! Pointer to out_hashtable is required.");
         return;
     }
     if (!elementCount || !elementSize) {
         KERROR("elementSize and elementCount must be a positive non-zero value.");
         return;
     }
+    if (isPointerType && elementSize < sizeof(void*)) {
+        KERROR("hashtable_create - elementSize must be able to hold a pointer for pointer types.");
+        return;
+    }
 
-    // TODO: Might want to require an allocator and allocate this memory instead.
-    out_hashtable->memory = memory;
-    out_hashtable->elementCount = elementCount;
+    kzero_memory(out_hashtable, sizeof(HashTable));
+    u32 capacity = capacity_for(elementCount);
+    u64 requirement = memory_requirement(elementSize, capacity);
+    out_hashtable->ownsMemory = memory == 0;
+    if (!memory) {
+        memory = kallocate(requirement, MEMORY_TAG_DICT);
+    }
     out_hashtable->elementSize = elementSize;
     out_hashtable->isPointerType = isPointerType;
-    kzero_memory(out_hashtable->memory, elementSize * elementCount);
+    set_layout(out_hashtable, memory, capacity);
+    kzero_memory(memory, requirement);
+    kset_memory(out_hashtable->control, CONTROL_EMPTY, capacity + HASHTABLE_GROUP_WIDTH);
 }
 
 void hashtable_destroy(HashTable* table) {
     if (table) {
-        // TODO: If using allocator above, free memory here.
+        if (table->memory) {
+            if (!table->isIdKeyed) {
+                for (u32 i = 0; i < table->capacity; ++i) {
+                    if (!(table->control[i] & CONTROL_EMPTY)) {
+                        string_free(table->keys[i].name);
+                    }
+                }
+            }
+            if (table->ownsMemory) {
+                kfree(table->memory, memory_requirement(table->elementSize, table->capacity), MEMORY_TAG_DICT);
+            }
+        }
         kzero_memory(table, sizeof(HashTable));
     }
 }
 
 b8 hashtable_set(HashTable* table, const char* name, void* value) {
+    return hashtable_set_hashed(table, name, name ? hash_string(name) : 0, value);
+}
+
+b8 hashtable_set_hashed(HashTable* table, const char* name, u64 hash, void* value) {
     if (!table || !name || !value) {
         KERROR("hashtable_set requires table, name and value to exist.");
         return false;
@@ -54,10 +344,11 @@ b8 hashtable_set(HashTable* table, const char* name, void* value) {
         KERROR("hashtable_set should not be used with tables that have pointer types. Use hashtable_set_ptr instead.");
         return false;
     }
+    if (!check_key_kind(table, false)) {
+        return false;
+    }
 
-    u64 hash = hash_name(name, table->elementCount);
-    kcopy_memory(table->memory + (table->elementSize * hash), value, table->elementSize);
-    return true;
+    return insert(table, hash, name, 0, value);
 }
 
 b8 hashtable_set_ptr(HashTable* table, const char* name, void** value) {
@@ -69,13 +360,24 @@ b8 hashtable_set_ptr(HashTable* table, const char* name, void** value) {
         KERROR("hashtable_set_ptr should not be used with tables that do not have pointer types. Use hashtable_set instead.");
         return false;
     }
+    if (!check_key_kind(table, false)) {
+        return false;
+    }
 
-    u64 hash = hash_name(name, table->elementCount);
-    ((void**)table->memory)[hash] = value ? *value : 0;
-    return true;
+    u64 hash = hash_string(name);
+    if (!value || !*value) {
+        // Unsetting an entry removes it.
+        remove_index(table, find_index(table, hash, name, 0));
+        return true;
+    }
+    return insert(table, hash, name, 0, value);
 }
 
 b8 hashtable_get(HashTable* table, const char* name, void* out_value) {
+    return hashtable_get_hashed(table, name, name ? hash_string(name) : 0, out_value);
+}
+
+b8 hashtable_get_hashed(HashTable* table, const char* name, u64 hash, void* out_value) {
     if (!table || !name || !out_value) {
         KWARN("hashtable_get requires table, name and out_value to exist.");
         return false;
@@ -84,8 +386,14 @@ b8 hashtable_get(HashTable* table, const char* name, void* out_value) {
         KERROR("hashtable_get should not be used with tables that have pointer types. Use hashtable_set_ptr instead.");
         return false;
     }
-    u64 hash = hash_name(name, table->elementCount);
-    kcopy_memory(out_value, table->memory + (table->elementSize * hash), table->elementSize);
+    u32 index = table->isIdKeyed ? INVALID_ID : find_index(table, hash, name, 0);
+    if (index == INVALID_ID) {
+        if (!table->hasDefault) {
+            return false;
+        }
+        index = table->capacity;
+    }
+    kcopy_memory(out_value, value_at(table, index), table->elementSize);
     return true;
 }
 
@@ -99,11 +407,65 @@ b8 hashtable_get_ptr(HashTable* table, const char* name, void** out_value) {
         return false;
     }
 
-    u64 hash = hash_name(name, table->elementCount);
-    *out_value = ((void**)table->memory)[hash];
+    u32 index = table->isIdKeyed ? INVALID_ID : find_index(table, hash_string(name), name, 0);
+    *out_value = index == INVALID_ID ? 0 : *(void**)value_at(table, index);
     return *out_value != 0;
 }
 
+b8 hashtable_remove(HashTable* table, const char* name) {
+    return hashtable_remove_hashed(table, name, name ? hash_string(name) : 0);
+}
+
+b8 hashtable_remove_hashed(HashTable* table, const char* name, u64 hash) {
+    if (!table || !name || table->isIdKeyed) {
+        return false;
+    }
+    return remove_index(table, find_index(table, hash, name, 0));
+}
+
+b8 hashtable_set_id(HashTable* table, u64 id, void* value) {
+    if (!table || !value) {
+        KERROR("hashtable_set_id requires table and value to exist.");
+        return false;
+    }
+    if (table->isPointerType) {
+        KERROR("hashtable_set_id should not be used with tables that have pointer types.");
+        return false;
+    }
+    if (!check_key_kind(table, true)) {
+        return false;
+    }
+
+    return insert(table, hash_u64(id), 0, id, value);
+}
+
+b8 hashtable_get_id(HashTable* table, u64 id, void* out_value) {
+    if (!table || !out_value) {
+        KWARN("hashtable_get_id requires table and out_value to exist.");
+        return false;
+    }
+    if (table->isPointerType) {
+        KERROR("hashtable_get_id should not be used with tables that have pointer types.");
+        return false;
+    }
+    u32 index = table->isIdKeyed ? find_index(table, hash_u64(id), 0, id) : INVALID_ID;
+    if (index == INVALID_ID) {
+        if (!table->hasDefault) {
+            return false;
+        }
+        index = table->capacity;
+    }
+    kcopy_memory(out_value, value_at(table, index), table->elementSize);
+    return true;
+}
+
+b8 hashtable_remove_id(HashTable* table, u64 id) {
+    if (!table || !table->isIdKeyed) {
+        return false;
+    }
+    return remove_index(table, find_index(table, hash_u64(id), 0, id));
+}
+
 b8 hashtable_fill(HashTable* table, void* value) {
     if (!table || !value) {
         KWARN("hashtable_fill requires table and value to exist.");
@@ -114,9 +476,7 @@ b8 hashtable_fill(HashTable* table, void* value) {
         return false;
     }
 
-    for (u32 i = 0; i < table->elementCount; ++i) {
-        kcopy_memory(table->memory + (table->elementSize * i), value, table->elementSize);
-    }
-
+    kcopy_memory(value_at(table, table->capacity), value, table->elementSize);
+    table->hasDefault = true;
     return true;
-}
\ No newline at end of file
+}
@@ -0,0 +1,189 @@
+#include "containers/ring_queue.h"
+
+#include "core/logger.h"
+#include "memory/kmemory.h"
+
+#include <string.h>
+
+static u64 round_up_to_power_of_two(u64 value) {
+    u64 result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+u64 spsc_queue_memory_requirement(u64 elementSize, u64 capacity) {
+    return elementSize * round_up_to_power_of_two(capacity);
+}
+
+b8 spsc_queue_create(u64 elementSize, u64 capacity, void* memory, SpscQueue* outQueue) {
+    if (elementSize == 0 || capacity == 0 || !outQueue) {
+        KERROR("spsc_queue_create requires a nonzero element size and capacity, and a valid pointer to hold the queue.");
+        return false;
+    }
+    kzero_memory(outQueue, sizeof(SpscQueue));
+    outQueue->elementSize = elementSize;
+    outQueue->capacity = round_up_to_power_of_two(capacity);
+    outQueue->mask = outQueue->capacity - 1;
+    if (memory) {
+        outQueue->elements = memory;
+    } else {
+        outQueue->elements = kallocate_aligned(spsc_queue_memory_requirement(elementSize, capacity), KCACHE_LINE_SIZE, MEMORY_TAG_RING_QUEUE);
+        outQueue->ownsMemory = true;
+    }
+    return true;
+}
+
+void spsc_queue_destroy(SpscQueue* queue) {
+    if (queue) {
+        if (queue->ownsMemory && queue->elements) {
+            kfree_aligned(queue->elements, queue->elementSize * queue->capacity, KCACHE_LINE_SIZE, MEMORY_TAG_RING_QUEUE);
+        }
+        kzero_memory(queue, sizeof(SpscQueue));
+    }
+}
+
+b8 spsc_queue_push(SpscQueue* queue, const void* value) {
+    // Only this thread writes the tail.
+    u64 tail = queue->tail;
+    if (tail - queue->cachedHead == queue->capacity) {
+        // Looks full; refresh the consumer's position.
+        queue->cachedHead = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+        if (tail - queue->cachedHead == queue->capacity) {
+            return false;
+        }
+    }
+    memcpy((u8*)queue->elements + (tail & queue->mask) * queue->elementSize, value, queue->elementSize);
+    // Publishes the element to the consumer.
+    __atomic_store_n(&queue->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+b8 spsc_queue_pop(SpscQueue* queue, void* outValue) {
+    // Only this thread writes the head.
+    u64 head = queue->head;
+    if (head == queue->cachedTail) {
+        // Looks empty; refresh the producer's position.
+        queue->cachedTail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+        if (head == queue->cachedTail) {
+            return false;
+        }
+    }
+    memcpy(outValue, (u8*)queue->elements + (head & queue->mask) * queue->elementSize, queue->elementSize);
+    // Hands the slot back to the producer.
+    __atomic_store_n(&queue->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+u64 spsc_queue_count(SpscQueue* queue) {
+    u64 head = __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE);
+    u64 tail = __atomic_load_n(&queue->tail, __ATOMIC_ACQUIRE);
+    return tail - head;
+}
+
+// Each cell starts with its sequence number. A cell at position p is free to be written when
+// its sequence is p, and holds an element ready to be read when its sequence is p + 1.
+#define CELL_AT(queue, pos) ((u8*)(queue)->cells + ((pos) & (queue)->mask) * (queue)->cellStride)
+#define CELL_SEQUENCE(cell) ((u64*)(cell))
+#define CELL_DATA(cell) ((cell) + sizeof(u64))
+
+static u64 mpmc_capacity(u64 capacity) {
+    return round_up_to_power_of_two(capacity < 2 ? 2 : capacity);
+}
+
+static u64 mpmc_cell_stride(u64 elementSize) {
+    return (sizeof(u64) + elementSize + 7) & ~(u64)7;
+}
+
+u64 mpmc_queue_memory_requirement(u64 elementSize, u64 capacity) {
+    return mpmc_cell_stride(elementSize) * mpmc_capacity(capacity);
+}
+
+b8 mpmc_queue_create(u64 elementSize, u64 capacity, void* memory, MpmcQueue* outQueue) {
+    if (elementSize == 0 || capacity == 0 || !outQueue) {
+        KERROR("mpmc_queue_create requires a nonzero element size and capacity, and a valid pointer to hold the queue.");
+        return false;
+    }
+    kzero_memory(outQueue, sizeof(MpmcQueue));
+    outQueue->elementSize = elementSize;
+    outQueue->capacity = mpmc_capacity(capacity);
+    outQueue->mask = outQueue->capacity - 1;
+    outQueue->cellStride = mpmc_cell_stride(elementSize);
+    if (memory) {
+        outQueue->cells = memory;
+    } else {
+        outQueue->cells = kallocate_aligned(mpmc_queue_memory_requirement(elementSize, capacity), KCACHE_LINE_SIZE, MEMORY_TAG_RING_QUEUE);
+        outQueue->ownsMemory = true;
+    }
+    for (u64 i = 0; i < outQueue->capacity; ++i) {
+        *CELL_SEQUENCE(CELL_AT(outQueue, i)) = i;
+    }
+    return true;
+}
+
+void mpmc_queue_destroy(MpmcQueue* queue) {
+    if (queue) {
+        if (queue->ownsMemory && queue->cells) {
+            kfree_aligned(queue->cells, queue->cellStride * queue->capacity, KCACHE_LINE_SIZE, MEMORY_TAG_RING_QUEUE);
+        }
+        kzero_memory(queue, sizeof(MpmcQueue));
+    }
+}
+
+b8 mpmc_queue_push(MpmcQueue* queue, const void* value) {
+    u8* cell;
+    u64 pos = __atomic_load_n(&queue->enqueuePos, __ATOMIC_RELAXED);
+    while (true) {
+        cell = CELL_AT(queue, pos);
+        u64 sequence = __atomic_load_n(CELL_SEQUENCE(cell), __ATOMIC_ACQUIRE);
+        i64 difference = (i64)(sequence - pos);
+        if (difference == 0) {
+            // The cell is free; try to claim the position. On failure pos is reloaded.
+            if (__atomic_compare_exchange_n(&queue->enqueuePos, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (difference < 0) {
+            // The cell still holds an element from a lap ago.
+            return false;
+        } else {
+            // Another producer claimed this position first.
+            pos = __atomic_load_n(&queue->enqueuePos, __ATOMIC_RELAXED);
+        }
+    }
+    memcpy(CELL_DATA(cell), value, queue->elementSize);
+    __atomic_store_n(CELL_SEQUENCE(cell), pos + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+b8 mpmc_queue_pop(MpmcQueue* queue, void* outValue) {
+    u8* cell;
+    u64 pos = __atomic_load_n(&queue->dequeuePos, __ATOMIC_RELAXED);
+    while (true) {
+        cell = CELL_AT(queue, pos);
+        u64 sequence = __atomic_load_n(CELL_SEQUENCE(cell), __ATOMIC_ACQUIRE);
+        i64 difference = (i64)(sequence - (pos + 1));
+        if (difference == 0) {
+            // The cell holds an element; try to claim the position. On failure pos is reloaded.
+            if (__atomic_compare_exchange_n(&queue->dequeuePos, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (difference < 0) {
+            // The cell has not been written yet.
+            return false;
+        } else {
+            // Another consumer claimed this position first.
+            pos = __atomic_load_n(&queue->dequeuePos, __ATOMIC_RELAXED);
+        }
+    }
+    memcpy(outValue, CELL_DATA(cell), queue->elementSize);
+    // Frees the cell for the producer one lap ahead.
+    __atomic_store_n(CELL_SEQUENCE(cell), pos + queue->capacity, __ATOMIC_RELEASE);
+    return true;
+}
+
+u64 mpmc_queue_count(MpmcQueue* queue) {
+    u64 dequeuePos = __atomic_load_n(&queue->dequeuePos, __ATOMIC_ACQUIRE);
+    u64 enqueuePos = __atomic_load_n(&queue->enqueuePos, __ATOMIC_ACQUIRE);
+    return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0;
+}
@@ -0,0 +1,142 @@
+#include "containers/slot_map.h"
+
+#include "memory/kmemory.h"
+#include "core/logger.h"
+#include "core/parallel_for.h"
+
+// The fewest free list links worth writing on another thread.
+#define SLOT_MAP_LINKS_PER_GRAIN (16 * 1024)
+
+static u32 make_handle(SlotMap* map, u32 index) {
+    return (map->generations[index] << SLOT_MAP_INDEX_BITS) | index;
+}
+
+// Returns the slot index of a handle, or INVALID_ID if it does not refer to a live element.
+static u32 resolve_handle(SlotMap* map, u32 handle) {
+    u32 index = SLOT_MAP_HANDLE_INDEX(handle);
+    if (index >= map->capacity || map->links[index] >= map->count || map->live[map->links[index]] != index) {
+        return INVALID_ID;
+    }
+    if (map->generations[index] != SLOT_MAP_HANDLE_GENERATION(handle)) {
+        return INVALID_ID;
+    }
+    return index;
+}
+
+static void chain_free_slots(u64 begin, u64 end, void* user) {
+    u32* links = user;
+    for (u64 i = begin; i < end; ++i) {
+        links[i] = (u32)i + 1;
+    }
+}
+
+u64 slot_map_memory_requirement(u64 elementSize, u32 capacity) {
+    // Elements come first so that they keep the alignment of the block.
+    return (elementSize + sizeof(u32) * 3) * capacity;
+}
+
+b8 slot_map_create(u64 elementSize, u32 capacity, void* memory, SlotMap* outMap) {
+    if (!outMap) {
+        KERROR("slot_map_create requires a pointer to a SlotMap.");
+        return false;
+    }
+    if (!elementSize || !capacity || capacity > SLOT_MAP_MAX_CAPACITY) {
+        KERROR("slot_map_create - elementSize must be non-zero and capacity must be between 1 and %u.", SLOT_MAP_MAX_CAPACITY);
+        return false;
+    }
+
+    u64 requirement = slot_map_memory_requirement(elementSize, capacity);
+    outMap->ownsMemory = memory == 0;
+    if (!memory) {
+        memory = kallocate(requirement, MEMORY_TAG_ARRAY);
+    }
+
+    outMap->elementSize = elementSize;
+    outMap->capacity = capacity;
+    outMap->count = 0;
+    outMap->elements = memory;
+    outMap->generations = (u32*)((u8*)memory + elementSize * capacity);
+    outMap->links = outMap->generations + capacity;
+    outMap->live = outMap->links + capacity;
+    kzero_memory(memory, requirement);
+
+    // Chain every slot onto the free list in index order.
+    parallel_for(0, capacity, SLOT_MAP_LINKS_PER_GRAIN, chain_free_slots, outMap->links);
+    outMap->links[capacity - 1] = INVALID_ID;
+    outMap->freeHead = 0;
+    return true;
+}
+
+void slot_map_destroy(SlotMap* map) {
+    if (map) {
+        if (map->ownsMemory && map->elements) {
+            kfree(map->elements, slot_map_memory_requirement(map->elementSize, map->capacity), MEMORY_TAG_ARRAY);
+        }
+        kzero_memory(map, sizeof(SlotMap));
+    }
+}
+
+void* slot_map_insert(SlotMap* map, u32* outHandle) {
+    if (!map || !outHandle) {
+        KERROR("slot_map_insert requires map and outHandle to exist.");
+        return 0;
+    }
+    u32 index = map->freeHead;
+    if (index == INVALID_ID) {
+        return 0;
+    }
+    map->freeHead = map->links[index];
+
+    map->links[index] = map->count;
+    map->live[map->count] = index;
+    map->count++;
+
+    void* element = (u8*)map->elements + map->elementSize * index;
+    kzero_memory(element, map->elementSize);
+    *outHandle = make_handle(map, index);
+    return element;
+}
+
+b8 slot_map_remove(SlotMap* map, u32 handle) {
+    if (!map) {
+        return false;
+    }
+    u32 index = resolve_handle(map, handle);
+    if (index == INVALID_ID) {
+        return false;
+    }
+
+    // Keep the live list packed by moving the last entry into the hole.
+    u32 position = map->links[index];
+    u32 last = map->live[map->count - 1];
+    map->live[position] = last;
+    map->links[last] = position;
+    map->count--;
+
+    map->generations[index] = (map->generations[index] + 1) & SLOT_MAP_GENERATION_MASK;
+    map->links[index] = map->freeHead;
+    map->freeHead = index;
+    return true;
+}
+
+void* slot_map_get(SlotMap* map, u32 handle) {
+    if (!map) {
+        return 0;
+    }
+    u32 index = resolve_handle(map, handle);
+    if (index == INVALID_ID) {
+        return 0;
+    }
+    return (u8*)map->elements + map->elementSize * index;
+}
+
+void* slot_map_at(SlotMap* map, u32 position, u32* outHandle) {
+    if (!map || position >= map->count) {
+        return 0;
+    }
+    u32 index = map->live[position];
+    if (outHandle) {
+        *outHandle = make_handle(map, index);
+    }
+    return (u8*)map->elements + map->elementSize * index;
+}
@@ -4,8 +4,13 @@
 #include "game_types.h"
 #include "memory/kmemory.h"
 #include "core/clock.h"
-#include "memory/linear_allocator.h"
+#include "memory/frame_allocator.h"
+#include "memory/virtual_arena.h"
 #include "core/kstring.h"
+#include "core/string_intern.h"
+#include "core/job_system.h"
+#include "core/profiler.h"
+#include "core/frame_stats.h"
 
 // Renderer
 #include "renderer/renderer_frontend.h"
@@ -29,7 +34,7 @@ typedef struct ApplicationState{
     i16 height;
     KohiClock clock;
     f64 lastTime;
-    LinearAllocator systemsAllocator;
+    VirtualArena systemsAllocator;
 
      u64 eventSystemMemoryReqs;
     void* eventSystemState;
@@ -43,6 +48,9 @@ typedef struct ApplicationState{
     u64 memorySystemMemoryReqs;
     void* memorySystemState;
 
+    u64 frameAllocatorMemoryReqs;
+    void* frameAllocatorState;
+
     u64 platformSystemMemoryReqs;
     void* platformSystemState;
 
@@ -57,8 +65,16 @@ typedef struct ApplicationState{
 
     u64 geometrySystemMemoryReqs;
     void* geometrySystemState;
+    u64 jobSystemMemoryReqs;
+    void* jobSystemState;
+    u64 stringInternMemoryReqs;
+    void* stringInternState;
     u64 resourceSystemMemoryReqs;
     void* resourceSystemState;
+    u64 profilerMemoryReqs;
+    void* profilerState;
+    u64 frameStatsMemoryReqs;
+    void* frameStatsState;
 
     //TODO: Temp
     Geometry* testGeometry;
@@ -89,7 +105,8 @@ b8 event_on_debug_event(u16 code, void* sender, void* listener_inst, EventContex
     
     // Acquire the new texture.
     if(applicationState->testGeometry){
-        applicationState->testGeometry->material->diffuseMap.texture = texture_system_acquire(names[choice], true);
+        // Loaded in the background; the default texture shows until it is ready.
+        applicationState->testGeometry->material->diffuseMap.texture = texture_system_acquire_async(names[choice], true);
         if (!applicationState->testGeometry->material->diffuseMap.texture) {
             KWARN("event_on_debug_event no texture! using default");
             applicationState->testGeometry->material->diffuseMap.texture = texture_system_get_default_texture();
@@ -113,8 +130,13 @@ b8 application_create(Game* gameInstance){
     applicationState->gameInstance = gameInstance;
     applicationState->isRunning = false;
     applicationState->isSuspended = false;
-    u64 systemsAllocatorTotalSize = 64 * 1024 * 1024; // 64 MiB
-    linear_allocator_create(systemsAllocatorTotalSize,0,&applicationState->systemsAllocator);
+    // System states are carved out of a reserved range that only takes up memory as it is used,
+    // so it can be sized well beyond what the current systems need.
+    u64 systemsAllocatorReserveSize = 1024 * 1024 * 1024; // 1 GiB
+    if(!virtual_arena_create(systemsAllocatorReserveSize,false,&applicationState->systemsAllocator)){
+        KFATAL("Failed to reserve memory for the engine systems");
+        return false;
+    }
     
 
     
@@ -123,32 +145,74 @@ b8 application_create(Game* gameInstance){
     // Initialize subsystems
 
     // Memory
-    memory_system_initialize(&applicationState->memorySystemMemoryReqs,0);
+    MemorySystemConfig memory_sys_config;
+    memory_sys_config.totalAllocSize = 512 * 1024 * 1024; // 512 MiB
+    memory_system_initialize(&applicationState->memorySystemMemoryReqs,0,memory_sys_config);
     KDEBUG("MEMORY SYSTEM REQS %i",applicationState->memorySystemMemoryReqs);
-    applicationState->memorySystemState = linear_allocator_allocate(&applicationState->systemsAllocator,applicationState->memorySystemMemoryReqs);
-    memory_system_initialize(&applicationState->memorySystemMemoryReqs,applicationState->memorySystemState);
+    applicationState->memorySystemState = virtual_arena_allocate(&applicationState->systemsAllocator,applicationState->memorySystemMemoryReqs);
+    memory_system_initialize(&applicationState->memorySystemMemoryReqs,applicationState->memorySystemState,memory_sys_config);
+
+    // Frame allocator
+    FrameAllocatorConfig frame_allocator_config;
+    frame_allocator_config.frameSize = 8 * 1024 * 1024; // 8 MiB
+    // One more than the frames the renderer keeps in flight, so frame data handed to the GPU outlives its fence.
+    frame_allocator_config.frameCount = 3;
+    frame_allocator_initialize(&applicationState->frameAllocatorMemoryReqs, 0, frame_allocator_config);
+    applicationState->frameAllocatorState = virtual_arena_allocate(&applicationState->systemsAllocator, applicationState->frameAllocatorMemoryReqs);
+    if (!frame_allocator_initialize(&applicationState->frameAllocatorMemoryReqs, applicationState->frameAllocatorState, frame_allocator_config)) {
+        KFATAL("Failed to initialize frame allocator. Application cannot continue.");
+        return false;
+    }
 
     // Logging
-    initialize_logging(&applicationState->loggingSystemMemoryReqs,0);
-    applicationState->loggingSystemState = linear_allocator_allocate(&applicationState->systemsAllocator,applicationState->loggingSystemMemoryReqs);
-    if(!initialize_logging(&applicationState->loggingSystemMemoryReqs,applicationState->loggingSystemState)){
+    LoggingConfig logging_config;
+    logging_config.queueCapacity = 4096;
+    logging_config.logFilePath = "kohi.log";
+    logging_config.channelLevels = gameInstance->applicationConfig.logLevels;
+    initialize_logging(&applicationState->loggingSystemMemoryReqs,0,logging_config);
+    applicationState->loggingSystemState = virtual_arena_allocate(&applicationState->systemsAllocator,applicationState->loggingSystemMemoryReqs);
+    if(!initialize_logging(&applicationState->loggingSystemMemoryReqs,applicationState->loggingSystemState,logging_config)){
         KERROR("Logging system failed to initialize");
         return false;
     }
 
+    // Profiler
+    ProfilerConfig profiler_config;
+    profiler_config.eventsPerThread = 64 * 1024;
+    profiler_config.maxThreads = 64;
+    profiler_config.tracePath = "kohi_trace.json";
+    profiler_config.startupCaptureFrames = gameInstance->applicationConfig.profileStartupFrames;
+    profiler_set_thread_name("Main thread");
+    profiler_initialize(&applicationState->profilerMemoryReqs, 0, profiler_config);
+    applicationState->profilerState = virtual_arena_allocate(&applicationState->systemsAllocator, applicationState->profilerMemoryReqs);
+    profiler_initialize(&applicationState->profilerMemoryReqs, applicationState->profilerState, profiler_config);
+    KPROFILE_SCOPE("application_create");
+
+    // Frame statistics
+    FrameStatsConfig frame_stats_config;
+    frame_stats_config.windowSize = 1024;
+    frame_stats_config.hitchThresholdMs = 1000.0f / 30;
+    frame_stats_config.reportInterval = 600;
+    frame_stats_config.csvPath = "frame_stats.csv";
+    frame_stats_initialize(&applicationState->frameStatsMemoryReqs, 0, frame_stats_config);
+    applicationState->frameStatsState = virtual_arena_allocate(&applicationState->systemsAllocator, applicationState->frameStatsMemoryReqs);
+    if (!frame_stats_initialize(&applicationState->frameStatsMemoryReqs, applicationState->frameStatsState, frame_stats_config)) {
+        KWARN("Frame statistics failed to initialize; carrying on without them.");
+    }
+
      // Events
     event_system_initialize(&applicationState->eventSystemMemoryReqs,0);
-    applicationState->eventSystemState = linear_allocator_allocate(&applicationState->systemsAllocator,applicationState->eventSystemMemoryReqs);
+    applicationState->eventSystemState = virtual_arena_allocate(&applicationState->systemsAllocator,applicationState->eventSystemMemoryReqs);
     event_system_initialize(&applicationState->eventSystemMemoryReqs,applicationState->eventSystemState);
 
     // Inputs
     input_system_initialize(&applicationState->inputSystemMemoryReqs,0);
-    applicationState->inputSystemState = linear_allocator_allocate(&applicationState->systemsAllocator,applicationState->inputSystemMemoryReqs);
+    applicationState->inputSystemState = virtual_arena_allocate(&applicationState->systemsAllocator,applicationState->inputSystemMemoryReqs);
     input_system_initialize(&applicationState->inputSystemMemoryReqs,applicationState->inputSystemState);
 
     
     platform_system_startup(&applicationState->platformSystemMemoryReqs,0,0,0,0,0,0);
-    applicationState->platformSystemState = linear_allocator_allocate(&applicationState->systemsAllocator,applicationState->platformSystemMemoryReqs);
+    applicationState->platformSystemState = virtual_arena_allocate(&applicationState->systemsAllocator,applicationState->platformSystemMemoryReqs);
     platform_system_startup(&applicationState->platformSystemMemoryReqs,
     applicationState->platformSystemState,
     gameInstance->applicationConfig.name,
@@ -157,20 +221,43 @@ b8 application_create(Game* gameInstance){
     gameInstance->applicationConfig.startWidth,
     gameInstance->applicationConfig.startHeight);
 
+    // Job system
+    JobSystemConfig job_sys_config;
+    job_sys_config.workerCount = gameInstance->applicationConfig.jobWorkerCount;
+    job_sys_config.maxQueuedJobs = 1024;
+    job_system_initialize(&applicationState->jobSystemMemoryReqs, 0, job_sys_config);
+    applicationState->jobSystemState = virtual_arena_allocate(&applicationState->systemsAllocator, applicationState->jobSystemMemoryReqs);
+    if (!job_system_initialize(&applicationState->jobSystemMemoryReqs, applicationState->jobSystemState, job_sys_config)) {
+        KFATAL("Failed to initialize job system. Application cannot continue.");
+        return false;
+    }
+
+    // String interning
+    StringInternConfig string_intern_config;
+    string_intern_config.maxStringCount = 128 * 1024;
+    string_intern_config.maxStringBytes = 64 * 1024 * 1024; // 64 MiB
+    string_intern_initialize(&applicationState->stringInternMemoryReqs, 0, string_intern_config);
+    applicationState->stringInternState = virtual_arena_allocate(&applicationState->systemsAllocator, applicationState->stringInternMemoryReqs);
+    if (!string_intern_initialize(&applicationState->stringInternMemoryReqs, applicationState->stringInternState, string_intern_config)) {
+        KFATAL("Failed to initialize string interning. Application cannot continue.");
+        return false;
+    }
+
     // Resource System
     ResourceSystemConfig resource_sys_config;
     resource_sys_config.assetBasePath = "../assets";
     resource_sys_config.maxLoaderCount = 32;
+    resource_sys_config.scratchSize = 32 * 1024 * 1024; // 32 MiB
     resource_system_initialize(&applicationState->resourceSystemMemoryReqs,0,resource_sys_config);
-    applicationState->resourceSystemState = linear_allocator_allocate(&applicationState->systemsAllocator,applicationState->resourceSystemMemoryReqs);
-    if(!resource_system_initialize(&applicationState->resourceSystemMemoryReqs,&applicationState->resourceSystemState,resource_sys_config)){
+    applicationState->resourceSystemState = virtual_arena_allocate(&applicationState->systemsAllocator,applicationState->resourceSystemMemoryReqs);
+    if(!resource_system_initialize(&applicationState->resourceSystemMemoryReqs,applicationState->resourceSystemState,resource_sys_config)){
         KFATAL("Failed to initialize renderer");
         return false;
     }
 
     //Renderer System
     renderer_system_initialize(&applicationState->rendererSystemMemoryReqs,0,0,0);
-    applicationState->rendererSystemState = linear_allocator_allocate(&applicationState->systemsAllocator,applicationState->rendererSystemMemoryReqs);
+    applicationState->rendererSystemState = virtual_arena_allocate(&applicationState->systemsAllocator,applicationState->rendererSystemMemoryReqs);
     
     if(!renderer_system_initialize(&applicationState->rendererSystemMemoryReqs,applicationState->rendererSystemState,applicationState->platformSystemState,gameInstance->applicationConfig.name)){
         KFATAL("Failed to initialize renderer");
@@ -181,7 +268,7 @@ b8 application_create(Game* gameInstance){
     TextureSystemConfig texture_sys_config;
     texture_sys_config.maxTextureCount = 65536;
     texture_system_initialize(&applicationState->textureSystemMemoryReqs, 0, texture_sys_config);
-    applicationState->textureSystemState = linear_allocator_allocate(&applicationState->systemsAllocator, applicationState->textureSystemMemoryReqs);
+    applicationState->textureSystemState = virtual_arena_allocate(&applicationState->systemsAllocator, applicationState->textureSystemMemoryReqs);
     if (!texture_system_initialize(&applicationState->textureSystemMemoryReqs, applicationState->textureSystemState, texture_sys_config)) {
         KFATAL("Failed to initialize texture system. Application cannot continue.");
         return false;
@@ -191,7 +278,7 @@ b8 application_create(Game* gameInstance){
     MaterialSystemConfig material_sys_config;
     material_sys_config.maxMaterialCount = 4096;
     material_system_initialize(&applicationState->materialSystemMemoryReqs, 0, material_sys_config);
-    applicationState->materialSystemState = linear_allocator_allocate(&applicationState->systemsAllocator, applicationState->materialSystemMemoryReqs);
+    applicationState->materialSystemState = virtual_arena_allocate(&applicationState->systemsAllocator, applicationState->materialSystemMemoryReqs);
     if (!material_system_initialize(&applicationState->materialSystemMemoryReqs, applicationState->materialSystemState, material_sys_config)) {
         KFATAL("Failed to initialize material system. Application cannot continue.");
         return false;
@@ -201,7 +288,7 @@ b8 application_create(Game* gameInstance){
     GeometrySystemConfig geometry_sys_config;
     geometry_sys_config.maxGeometryCount = 4096;
     geometry_system_initialize(&applicationState->geometrySystemMemoryReqs, 0, geometry_sys_config);
-    applicationState->geometrySystemState = linear_allocator_allocate(&applicationState->systemsAllocator, applicationState->geometrySystemMemoryReqs);
+    applicationState->geometrySystemState = virtual_arena_allocate(&applicationState->systemsAllocator, applicationState->geometrySystemMemoryReqs);
     if (!geometry_system_initialize(&applicationState->geometrySystemMemoryReqs, applicationState->geometrySystemState, geometry_sys_config)) {
         KFATAL("Failed to initialize Geometry system. Application cannot continue.");
         return false;
@@ -251,10 +338,15 @@ b8 application_run(){
     f64 runTime = 0;
     u8 frameCount = 0;
     f64 targetFrameTimeSeconds = 1.0f / 60;
+    // When the last frame ended, or 0 if there was no frame just before this one.
+    f64 lastFrameEndTime = 0;
     
-    KINFO(get_memory_usage_str());
+    char* usage = get_memory_usage_str();
+    KINFO("%s", usage);
+    string_free(usage);
     while (applicationState->isRunning)
     {
+        KPROFILE_FRAME_MARK();
         if(!platform_pump_messages(&applicationState->platformSystemState)){
             applicationState->isRunning = false;
         }
@@ -264,26 +356,48 @@ b8 application_run(){
             f64 deltaTime = currentTime - applicationState->lastTime;
             f64 frameStartTime = platform_get_absolute_time();
 
-            if(!applicationState->gameInstance->update(applicationState->gameInstance,(f32)deltaTime)){
-                KFATAL("Failed to update game state Shutting down");
-                applicationState->isRunning = false;
-                break;
+            // Anything allocated with frame_allocate during the previous frameCount frames is released here.
+            frame_allocator_begin_frame();
+            memory_tracking_begin_frame();
+
+            // Resources loaded in the background since the last frame are handed over here.
+            resource_system_process_completed_loads();
+
+            {
+                KPROFILE_SCOPE("Game update");
+                f64 updateStartTime = platform_get_absolute_time();
+                if(!applicationState->gameInstance->update(applicationState->gameInstance,(f32)deltaTime)){
+                    KFATAL("Failed to update game state Shutting down");
+                    applicationState->isRunning = false;
+                    break;
+                }
+                frame_stats_record(FRAME_STAT_UPDATE, platform_get_absolute_time() - updateStartTime);
             }
 
-            if(!applicationState->gameInstance->render(applicationState->gameInstance,(f32)deltaTime)){
-                KFATAL("Failed to Render game Shutting down");
-                applicationState->isRunning = false;
-                break;
+            {
+                KPROFILE_SCOPE("Game render");
+                f64 renderStartTime = platform_get_absolute_time();
+                if(!applicationState->gameInstance->render(applicationState->gameInstance,(f32)deltaTime)){
+                    KFATAL("Failed to Render game Shutting down");
+                    applicationState->isRunning = false;
+                    break;
+                }
+                frame_stats_record(FRAME_STAT_RENDER, platform_get_absolute_time() - renderStartTime);
             }
             // TODO: Refactor Packet creation
             RenderPacket packet;
             packet.deltaTime = deltaTime;
             // TODO: Temp
-            GeometryRenderData testRender;
-            testRender.geometry = applicationState->testGeometry;
-            testRender.model = mat4_identity();
             packet.geometryCount = 1;
-            packet.geometries = &testRender;
+            packet.geometries = frame_allocate(sizeof(GeometryRenderData) * packet.geometryCount);
+            if (packet.geometries) {
+                packet.geometries[0].geometry = applicationState->testGeometry;
+                packet.geometries[0].model = mat4_identity();
+            } else {
+                // The frame is still drawn, just without geometry, so the window keeps responding.
+                KWARN_LIMITED("The frame allocator is exhausted; this frame's geometry is skipped. Increase its frameSize.");
+                packet.geometryCount = 0;
+            }
 
             // TODO: End Temp
 
@@ -304,7 +418,15 @@ b8 application_run(){
             }
             input_update(deltaTime);
 
+            // The whole frame, including the message pump before it. The first frame after a
+            // suspension is timed from its own start.
+            f64 now = platform_get_absolute_time();
+            frame_stats_end_frame(now - (lastFrameEndTime ? lastFrameEndTime : frameStartTime));
+            lastFrameEndTime = now;
+
             applicationState->lastTime = currentTime;
+        } else {
+            lastFrameEndTime = 0;
         }
 
         
@@ -319,12 +441,22 @@ b8 application_run(){
     
     input_system_shutdown(applicationState->inputSystemState);
 
+    // Jobs may use any of the systems below, so they are finished first.
+    job_system_shutdown(applicationState->jobSystemState);
+    // Writes out a capture still in progress.
+    profiler_shutdown(applicationState->profilerState);
+    frame_stats_shutdown(applicationState->frameStatsState);
+
     geometry_system_shutdown(applicationState->geometrySystemState);
     material_system_shutdown(applicationState->materialSystemState);
     texture_system_shutdown(applicationState->textureSystemState);
     renderer_shutdown();
     resource_system_shutdown(applicationState->resourceSystemState);
+    string_intern_shutdown(applicationState->stringInternState);
     platform_system_shutdown(&applicationState->platformSystemState);
+    // Writes out anything still queued.
+    shutdown_logging(&applicationState->loggingSystemMemoryReqs, applicationState->loggingSystemState);
+    frame_allocator_shutdown(applicationState->frameAllocatorState);
     memory_system_shutdown(applicationState->memorySystemState);
     
     
@@ -364,6 +496,9 @@ b8 application_on_key(u16 code, void* sender, void* listener_inst, EventContext
 
             // Block anything else from processing this.
             return true;
+        } else if (key_code == KEY_F9) {
+            // Captures the next few seconds for chrome://tracing or Perfetto.
+            profiler_begin_capture(300);
         } else if (key_code == KEY_A) {
             // Example on checking for a key
             KDEBUG("Explicit - A key pressed!");
@@ -0,0 +1,209 @@
+#include "core/frame_stats.h"
+
+#include "core/logger.h"
+#include "core/kstring.h"
+#include "memory/kmemory.h"
+#include "platform/filesystem.h"
+#include "platform/platform.h"
+
+#define FRAME_STATS_DEFAULT_WINDOW_SIZE 1024
+#define FRAME_STATS_DEFAULT_HITCH_THRESHOLD_MS 33.3f
+
+typedef struct FrameStatsState {
+    FrameStatsConfig config;
+    // The current frame's sections so far, in seconds.
+    f64 current[FRAME_STAT_COUNT];
+    // A ring of windowSize samples per section, in milliseconds.
+    f32* samples;
+    // Room to sort one section's samples.
+    f32* sorted;
+    // Where the next frame goes in the ring.
+    u32 next;
+    u32 sampleCount;
+    u64 totalFrames;
+    u64 totalHitches;
+    u32 framesSinceReport;
+    f64 startTime;
+    FileHandle csvFile;
+} FrameStatsState;
+
+static FrameStatsState* statePtr;
+
+static const char* sectionNames[FRAME_STAT_COUNT] = {"frame", "update", "render", "present"};
+
+b8 frame_stats_initialize(u64* memoryRequirement, void* state, FrameStatsConfig config) {
+    if (config.windowSize == 0) {
+        config.windowSize = FRAME_STATS_DEFAULT_WINDOW_SIZE;
+    }
+    if (config.hitchThresholdMs <= 0) {
+        config.hitchThresholdMs = FRAME_STATS_DEFAULT_HITCH_THRESHOLD_MS;
+    }
+    u64 samplesSize = sizeof(f32) * config.windowSize * FRAME_STAT_COUNT;
+    *memoryRequirement = sizeof(FrameStatsState) + samplesSize + sizeof(f32) * config.windowSize;
+    if (state == 0) {
+        return true;
+    }
+    kzero_memory(state, *memoryRequirement);
+    FrameStatsState* s = state;
+    s->config = config;
+    s->samples = (f32*)((u8*)state + sizeof(FrameStatsState));
+    s->sorted = (f32*)((u8*)s->samples + samplesSize);
+    s->startTime = platform_get_absolute_time();
+
+    // Without the CSV file, statistics are still collected and logged.
+    if (config.csvPath && !filesystem_open(config.csvPath, FILE_MODE_WRITE, false, &s->csvFile)) {
+        KERROR("frame_stats_initialize - Unable to open '%s' for writing. Frame statistics will only be logged.", config.csvPath);
+    }
+    if (s->csvFile.isValid) {
+        char header[512];
+        i32 length = string_nformat(header, sizeof(header), "time_s,frames,hitches");
+        for (u32 i = 0; i < FRAME_STAT_COUNT; ++i) {
+            const char* name = sectionNames[i];
+            length += string_nformat(header + length, sizeof(header) - length, ",%s_min_ms,%s_mean_ms,%s_p50_ms,%s_p95_ms,%s_p99_ms,%s_max_ms",
+                                     name, name, name, name, name, name);
+        }
+        filesystem_write_line(&s->csvFile, header);
+    }
+    statePtr = s;
+    return true;
+}
+
+void frame_stats_shutdown(void* state) {
+    if (!statePtr) {
+        return;
+    }
+    if (statePtr->framesSinceReport) {
+        frame_stats_report();
+    }
+    if (statePtr->csvFile.isValid) {
+        filesystem_close(&statePtr->csvFile);
+    }
+    statePtr = 0;
+}
+
+void frame_stats_record(FrameStatSection section, f64 seconds) {
+    if (statePtr && section < FRAME_STAT_COUNT) {
+        statePtr->current[section] += seconds;
+    }
+}
+
+void frame_stats_end_frame(f64 frameSeconds) {
+    FrameStatsState* state = statePtr;
+    if (!state) {
+        return;
+    }
+    state->current[FRAME_STAT_FRAME] = frameSeconds;
+    for (u32 i = 0; i < FRAME_STAT_COUNT; ++i) {
+        state->samples[i * state->config.windowSize + state->next] = (f32)(state->current[i] * 1000.0);
+        state->current[i] = 0;
+    }
+    if (frameSeconds * 1000.0 > state->config.hitchThresholdMs) {
+        state->totalHitches++;
+    }
+    state->next = (state->next + 1) % state->config.windowSize;
+    if (state->sampleCount < state->config.windowSize) {
+        state->sampleCount++;
+    }
+    state->totalFrames++;
+    state->framesSinceReport++;
+
+    if (state->config.reportInterval && state->framesSinceReport >= state->config.reportInterval) {
+        frame_stats_report();
+    }
+}
+
+// Sorts ascending. A shell sort, as the window is small and this runs rarely.
+static void sort_samples(f32* values, u32 count) {
+    for (u32 gap = count / 2; gap > 0; gap /= 2) {
+        for (u32 i = gap; i < count; ++i) {
+            f32 value = values[i];
+            u32 j = i;
+            for (; j >= gap && values[j - gap] > value; j -= gap) {
+                values[j] = values[j - gap];
+            }
+            values[j] = value;
+        }
+    }
+}
+
+// The nearest-rank percentile of sorted values.
+static f32 percentile(const f32* sorted, u32 count, u32 percent) {
+    u32 rank = (u32)(((u64)percent * count + 99) / 100);
+    return sorted[rank > 0 ? rank - 1 : 0];
+}
+
+b8 frame_stats_get(FrameStats* outStats) {
+    kzero_memory(outStats, sizeof(FrameStats));
+    FrameStatsState* state = statePtr;
+    if (!state) {
+        return false;
+    }
+    outStats->totalFrames = state->totalFrames;
+    outStats->totalHitches = state->totalHitches;
+    u32 count = state->sampleCount;
+    outStats->sampleCount = count;
+    if (count == 0) {
+        return false;
+    }
+
+    // The ring is only partly filled, from its start, until it first wraps.
+    for (u32 section = 0; section < FRAME_STAT_COUNT; ++section) {
+        const f32* samples = state->samples + section * state->config.windowSize;
+        f64 total = 0;
+        for (u32 i = 0; i < count; ++i) {
+            state->sorted[i] = samples[i];
+            total += samples[i];
+            if (section == FRAME_STAT_FRAME && samples[i] > state->config.hitchThresholdMs) {
+                outStats->hitchCount++;
+            }
+        }
+        sort_samples(state->sorted, count);
+        FrameStatSummary* summary = &outStats->sections[section];
+        summary->min = state->sorted[0];
+        summary->mean = (f32)(total / count);
+        summary->p50 = percentile(state->sorted, count, 50);
+        summary->p95 = percentile(state->sorted, count, 95);
+        summary->p99 = percentile(state->sorted, count, 99);
+        summary->max = state->sorted[count - 1];
+    }
+    return true;
+}
+
+void frame_stats_report() {
+    FrameStatsState* state = statePtr;
+    FrameStats stats;
+    if (!state || !frame_stats_get(&stats)) {
+        return;
+    }
+    state->framesSinceReport = 0;
+
+    const FrameStatSummary* frame = &stats.sections[FRAME_STAT_FRAME];
+    KINFO("Frame times over %u frames: min %.2fms, mean %.2fms, p50 %.2fms, p95 %.2fms, p99 %.2fms, max %.2fms, %u hitches.",
+          stats.sampleCount, frame->min, frame->mean, frame->p50, frame->p95, frame->p99, frame->max, stats.hitchCount);
+    KINFO("p99 update %.2fms, render %.2fms, present %.2fms.",
+          stats.sections[FRAME_STAT_UPDATE].p99, stats.sections[FRAME_STAT_RENDER].p99, stats.sections[FRAME_STAT_PRESENT].p99);
+
+    if (state->csvFile.isValid) {
+        char row[512];
+        i32 length = string_nformat(row, sizeof(row), "%.3f,%u,%u", platform_get_absolute_time() - state->startTime, stats.sampleCount, stats.hitchCount);
+        for (u32 i = 0; i < FRAME_STAT_COUNT; ++i) {
+            const FrameStatSummary* s = &stats.sections[i];
+            length += string_nformat(row + length, sizeof(row) - length, ",%.3f,%.3f,%.3f,%.3f,%.3f,%.3f",
+                                     s->min, s->mean, s->p50, s->p95, s->p99, s->max);
+        }
+        filesystem_write_line(&state->csvFile, row);
+    }
+}
+
+void frame_stats_reset() {
+    FrameStatsState* state = statePtr;
+    if (!state) {
+        return;
+    }
+    for (u32 i = 0; i < FRAME_STAT_COUNT; ++i) {
+        state->current[i] = 0;
+    }
+    state->next = 0;
+    state->sampleCount = 0;
+    state->framesSinceReport = 0;
+}
@@ -0,0 +1,476 @@
+#include "core/job_system.h"
+
+#include "core/logger.h"
+#include "core/kstring.h"
+#include "containers/ring_queue.h"
+#include "memory/kmemory.h"
+#include "platform/atomic.h"
+#include "platform/thread.h"
+#include "core/profiler.h"
+
+// How many times an idle worker looks for work before yielding its time slice.
+#define JOB_SPIN_COUNT 64
+
+// Above this many threads, workers are never pinned to processors.
+#define JOB_MAX_PINNED_THREADS 256
+
+typedef struct Job {
+    PFN_job_entry entry;
+    void* param;
+    JobCounter* counter;
+    JobCounter* dependency;
+    b8 workerOnly;
+} Job;
+
+/* A Chase-Lev work-stealing deque with a fixed capacity (Le, Pop, Cohen and Zappa Nardelli,
+   "Correct and Efficient Work-Stealing for Weak Memory Models", 2013). The owner pushes and
+   takes at the bottom; thieves take from the top. Jobs are copied into and out of the
+   slots with atomic accesses, so a thief that loses the race for a slot only discards
+   its copy. A slot is never rewritten while a thief could still claim it, because a push
+   never runs more than the capacity ahead of the top. */
+typedef struct JobDeque {
+    i64 top;
+    u8 topPad[KCACHE_LINE_SIZE];
+    i64 bottom;
+    u8 bottomPad[KCACHE_LINE_SIZE];
+    Job* jobs;
+} JobDeque;
+
+typedef struct JobThread {
+    KThread thread;
+    u32 index;
+    JobDeque deques[JOB_PRIORITY_COUNT];
+} JobThread;
+
+typedef struct JobSystemState {
+    JobSystemConfig config;
+    u64 dequeCapacity;
+    u64 dequeMask;
+    // Index 0 is the main thread, which has no KThread of its own.
+    u32 threadCount;
+    JobThread* threads;
+    // Jobs submitted by threads outside the system.
+    MpmcQueue injected[JOB_PRIORITY_COUNT];
+    // Jobs only worker threads may run, from any thread.
+    MpmcQueue workerOnly[JOB_PRIORITY_COUNT];
+    // Jobs found before their dependency finished. Only retried when nothing else is ready,
+    // so a waiting job never holds up the work it waits on.
+    MpmcQueue deferred;
+    u8 sharedPad[KCACHE_LINE_SIZE];
+
+    // Jobs sitting in any deque or queue, including the deferred ones.
+    u32 queuedJobs;
+    // Jobs sitting in the deferred queue.
+    u32 deferredJobs;
+    // Bumped whenever a job finishes a counter, which may unblock deferred jobs.
+    u32 finishedCounters;
+    // Workers asleep on wakeSemaphore, or about to be.
+    u32 sleepingWorkers;
+    b8 running;
+    KSemaphore wakeSemaphore;
+} JobSystemState;
+
+static JobSystemState* statePtr = 0;
+
+static KTHREAD_LOCAL u32 threadIndex = INVALID_ID;
+
+static u64 round_up_to_power_of_two(u64 value) {
+    u64 result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+static inline void store_job(Job* slot, const Job* job) {
+    __atomic_store_n(&slot->entry, job->entry, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->param, job->param, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->counter, job->counter, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->dependency, job->dependency, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->workerOnly, job->workerOnly, __ATOMIC_RELAXED);
+}
+
+static inline void load_job(Job* slot, Job* outJob) {
+    outJob->entry = __atomic_load_n(&slot->entry, __ATOMIC_RELAXED);
+    outJob->param = __atomic_load_n(&slot->param, __ATOMIC_RELAXED);
+    outJob->counter = __atomic_load_n(&slot->counter, __ATOMIC_RELAXED);
+    outJob->dependency = __atomic_load_n(&slot->dependency, __ATOMIC_RELAXED);
+    outJob->workerOnly = __atomic_load_n(&slot->workerOnly, __ATOMIC_RELAXED);
+}
+
+// Owner only.
+static b8 deque_push(JobDeque* deque, const Job* job) {
+    i64 bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED);
+    i64 top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    if (bottom - top >= (i64)statePtr->dequeCapacity) {
+        return false;
+    }
+    store_job(&deque->jobs[bottom & statePtr->dequeMask], job);
+    // Publishes the slot to thieves that observe the new bottom.
+    __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+// Owner only. Takes the most recently pushed job.
+static b8 deque_take(JobDeque* deque, Job* outJob) {
+    i64 bottom = __atomic_load_n(&deque->bottom, __ATOMIC_RELAXED) - 1;
+    __atomic_store_n(&deque->bottom, bottom, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    i64 top = __atomic_load_n(&deque->top, __ATOMIC_RELAXED);
+    if (top > bottom) {
+        // Empty.
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    load_job(&deque->jobs[bottom & statePtr->dequeMask], outJob);
+    if (top == bottom) {
+        // The last job. Race any thieves for it.
+        b8 won = __atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+        __atomic_store_n(&deque->bottom, bottom + 1, __ATOMIC_RELAXED);
+        return won;
+    }
+    return true;
+}
+
+// Any thread. Takes the least recently pushed job.
+static b8 deque_steal(JobDeque* deque, Job* outJob) {
+    i64 top = __atomic_load_n(&deque->top, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    i64 bottom = __atomic_load_n(&deque->bottom, __ATOMIC_ACQUIRE);
+    if (top >= bottom) {
+        return false;
+    }
+    load_job(&deque->jobs[top & statePtr->dequeMask], outJob);
+    // Losing means another thread took the job; the caller just looks elsewhere.
+    return __atomic_compare_exchange_n(&deque->top, &top, top + 1, false, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+static void wake_worker() {
+    if (__atomic_load_n(&statePtr->sleepingWorkers, __ATOMIC_SEQ_CST) > 0) {
+        platform_semaphore_signal(&statePtr->wakeSemaphore, 1);
+    }
+}
+
+static void run_job(const Job* job) {
+    {
+        KPROFILE_SCOPE("Job");
+        job->entry(job->param);
+    }
+    if (job->counter && __atomic_sub_fetch(&job->counter->pending, 1, __ATOMIC_SEQ_CST) == 0 && statePtr) {
+        // Deferred jobs waiting on the counter can start now, so wake a worker to retry them.
+        __atomic_add_fetch(&statePtr->finishedCounters, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&statePtr->deferredJobs, __ATOMIC_SEQ_CST) > 0) {
+            wake_worker();
+        }
+    }
+}
+
+// Whether the calling thread may run jobs submitted as worker only. Anything but the main
+// thread may, and the main thread too if no worker thread started.
+static inline b8 can_run_worker_only() {
+    return threadIndex != 0 || statePtr->threadCount == 1;
+}
+
+// Queues a job whose counter has already been incremented. Runs it inline if there is no room.
+static void enqueue(const Job* job, JobPriority priority) {
+    __atomic_add_fetch(&statePtr->queuedJobs, 1, __ATOMIC_SEQ_CST);
+    b8 queued;
+    if (job->workerOnly) {
+        queued = mpmc_queue_push(&statePtr->workerOnly[priority], job);
+    } else if (threadIndex < statePtr->threadCount) {
+        queued = deque_push(&statePtr->threads[threadIndex].deques[priority], job);
+    } else {
+        queued = mpmc_queue_push(&statePtr->injected[priority], job);
+    }
+    if (queued) {
+        wake_worker();
+        return;
+    }
+    __atomic_sub_fetch(&statePtr->queuedJobs, 1, __ATOMIC_SEQ_CST);
+    if (job->dependency) {
+        job_system_wait(job->dependency);
+    }
+    run_job(job);
+}
+
+// Finds the highest priority job available to the calling thread.
+static b8 find_job(Job* outJob) {
+    u32 self = threadIndex;
+    u32 count = statePtr->threadCount;
+    for (u32 priority = 0; priority < JOB_PRIORITY_COUNT; ++priority) {
+        b8 found = false;
+        if (self < count) {
+            found = deque_take(&statePtr->threads[self].deques[priority], outJob);
+        }
+        if (!found) {
+            found = mpmc_queue_pop(&statePtr->injected[priority], outJob);
+        }
+        if (!found && can_run_worker_only()) {
+            found = mpmc_queue_pop(&statePtr->workerOnly[priority], outJob);
+        }
+        // Steal, starting with the next thread along so thieves spread over the victims.
+        for (u32 i = 1; !found && i <= count; ++i) {
+            u32 victim = (self < count ? self + i : i) % count;
+            if (victim != self) {
+                found = deque_steal(&statePtr->threads[victim].deques[priority], outJob);
+            }
+        }
+        if (found) {
+            __atomic_sub_fetch(&statePtr->queuedJobs, 1, __ATOMIC_SEQ_CST);
+            return true;
+        }
+    }
+    return false;
+}
+
+static b8 is_blocked(const Job* job) {
+    return job->dependency && __atomic_load_n(&job->dependency->pending, __ATOMIC_ACQUIRE) > 0;
+}
+
+// Sets aside a job that cannot start yet. If there is no room, waits for it and runs it instead.
+static void defer(const Job* job) {
+    __atomic_add_fetch(&statePtr->deferredJobs, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&statePtr->queuedJobs, 1, __ATOMIC_SEQ_CST);
+    if (mpmc_queue_push(&statePtr->deferred, job)) {
+        return;
+    }
+    __atomic_sub_fetch(&statePtr->queuedJobs, 1, __ATOMIC_SEQ_CST);
+    __atomic_sub_fetch(&statePtr->deferredJobs, 1, __ATOMIC_SEQ_CST);
+    job_system_wait(job->dependency);
+    run_job(job);
+}
+
+// Gives every deferred job one more try. Returns true if a job ran.
+static b8 retry_deferred() {
+    u32 count = __atomic_load_n(&statePtr->deferredJobs, __ATOMIC_SEQ_CST);
+    for (u32 i = 0; i < count; ++i) {
+        if (job_system_run_pending()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static u32 worker_main(void* params) {
+    JobThread* self = params;
+    threadIndex = self->index;
+    char name[32];
+    string_format(name, "Job worker %u", self->index);
+    profiler_set_thread_name(name);
+
+    u32 idleCount = 0;
+    while (__atomic_load_n(&statePtr->running, __ATOMIC_ACQUIRE)) {
+        if (job_system_run_pending()) {
+            idleCount = 0;
+            continue;
+        }
+        if (++idleCount < JOB_SPIN_COUNT) {
+            kcpu_pause();
+            continue;
+        }
+        // At most deferred jobs are left. Any whose dependency finished before this point
+        // are found by the retry, and any that finish later bump finishedCounters.
+        u32 finishedCounters = __atomic_load_n(&statePtr->finishedCounters, __ATOMIC_SEQ_CST);
+        if (retry_deferred()) {
+            idleCount = 0;
+            continue;
+        }
+        // Announce the sleep before checking for work one last time; a submitter increments
+        // queuedJobs, and a finished counter bumps finishedCounters, before checking
+        // sleepingWorkers, so one of each pair sees the other.
+        __atomic_add_fetch(&statePtr->sleepingWorkers, 1, __ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&statePtr->queuedJobs, __ATOMIC_SEQ_CST) <= __atomic_load_n(&statePtr->deferredJobs, __ATOMIC_SEQ_CST) &&
+            __atomic_load_n(&statePtr->finishedCounters, __ATOMIC_SEQ_CST) == finishedCounters &&
+            __atomic_load_n(&statePtr->running, __ATOMIC_SEQ_CST)) {
+            platform_semaphore_wait(&statePtr->wakeSemaphore);
+        }
+        __atomic_sub_fetch(&statePtr->sleepingWorkers, 1, __ATOMIC_SEQ_CST);
+        idleCount = 0;
+    }
+
+    // Jobs free pooled blocks into this thread's cache, which would be stranded once it exits.
+    memory_thread_cache_flush();
+    threadIndex = INVALID_ID;
+    return 0;
+}
+
+b8 job_system_initialize(u64* memoryRequirement, void* state, JobSystemConfig config) {
+    if (config.maxQueuedJobs == 0) {
+        KFATAL("job_system_initialize - config.maxQueuedJobs must be > 0.");
+        return false;
+    }
+    u32 processorCount = platform_get_processor_count();
+    u32 workerCount = config.workerCount;
+    if (workerCount == 0) {
+        // Always at least one, so background jobs progress while the main thread is busy.
+        workerCount = processorCount > 1 ? processorCount - 1 : 1;
+    }
+    u32 threadCount = workerCount + 1;
+    u64 dequeCapacity = round_up_to_power_of_two(config.maxQueuedJobs);
+
+    // Block of memory will contain state structure, then the threads, then the deque slots, then the shared queues.
+    u64 structRequirement = sizeof(JobSystemState);
+    u64 threadsRequirement = sizeof(JobThread) * threadCount;
+    u64 dequesRequirement = sizeof(Job) * dequeCapacity * JOB_PRIORITY_COUNT * threadCount;
+    u64 queueRequirement = mpmc_queue_memory_requirement(sizeof(Job), dequeCapacity);
+    u64 deferredRequirement = mpmc_queue_memory_requirement(sizeof(Job), dequeCapacity * threadCount);
+    *memoryRequirement = structRequirement + threadsRequirement + dequesRequirement + queueRequirement * JOB_PRIORITY_COUNT * 2 + deferredRequirement;
+
+    if (!state) {
+        return true;
+    }
+    KPROFILE_SCOPE("job_system_initialize");
+
+    statePtr = state;
+    kzero_memory(statePtr, *memoryRequirement);
+    statePtr->config = config;
+    statePtr->dequeCapacity = dequeCapacity;
+    statePtr->dequeMask = dequeCapacity - 1;
+    statePtr->threadCount = threadCount;
+    statePtr->threads = (JobThread*)((u8*)state + structRequirement);
+    Job* slots = (Job*)((u8*)statePtr->threads + threadsRequirement);
+    u8* queueMemory = (u8*)slots + dequesRequirement;
+    for (u32 i = 0; i < threadCount; ++i) {
+        statePtr->threads[i].index = i;
+        for (u32 priority = 0; priority < JOB_PRIORITY_COUNT; ++priority) {
+            statePtr->threads[i].deques[priority].jobs = slots;
+            slots += dequeCapacity;
+        }
+    }
+    for (u32 priority = 0; priority < JOB_PRIORITY_COUNT; ++priority) {
+        mpmc_queue_create(sizeof(Job), dequeCapacity, queueMemory, &statePtr->injected[priority]);
+        queueMemory += queueRequirement;
+        mpmc_queue_create(sizeof(Job), dequeCapacity, queueMemory, &statePtr->workerOnly[priority]);
+        queueMemory += queueRequirement;
+    }
+    mpmc_queue_create(sizeof(Job), dequeCapacity * threadCount, queueMemory, &statePtr->deferred);
+    platform_semaphore_create(0, &statePtr->wakeSemaphore);
+    statePtr->running = true;
+    threadIndex = 0;
+
+    // Workers are pinned only when every thread can have a physical core to itself. The main
+    // thread is left free, and the first core to it. Threads sharing a core or its
+    // hyperthreads do worse pinned than when the scheduler can move them apart.
+    u32 coreProcessors[JOB_MAX_PINNED_THREADS];
+    b8 pinWorkers = threadCount <= JOB_MAX_PINNED_THREADS &&
+                    platform_get_core_processors(coreProcessors, threadCount) == threadCount;
+
+    for (u32 i = 1; i < threadCount; ++i) {
+        JobThread* worker = &statePtr->threads[i];
+        if (!platform_thread_create(worker_main, worker, &worker->thread)) {
+            KFATAL("job_system_initialize - failed to start worker thread %u.", i);
+            // Run everything on the threads that did start.
+            statePtr->threadCount = i;
+            break;
+        }
+        char name[32];
+        string_format(name, "kohi-job-%u", i);
+        platform_thread_set_name(&worker->thread, name);
+        if (pinWorkers && !platform_thread_set_affinity(&worker->thread, coreProcessors[i])) {
+            KWARN("job_system_initialize - could not pin worker thread %u to processor %u.", i, coreProcessors[i]);
+        }
+    }
+
+    KINFO("Job system started %u worker threads on %u processors%s.", statePtr->threadCount - 1, processorCount, pinWorkers ? ", one core each" : "");
+    return true;
+}
+
+void job_system_shutdown(void* state) {
+    if (statePtr) {
+        // Finish what was queued, so no counter is left waiting.
+        while (__atomic_load_n(&statePtr->queuedJobs, __ATOMIC_SEQ_CST) > 0) {
+            if (!job_system_run_pending()) {
+                platform_thread_yield();
+            }
+        }
+        __atomic_store_n(&statePtr->running, false, __ATOMIC_SEQ_CST);
+        platform_semaphore_signal(&statePtr->wakeSemaphore, statePtr->threadCount);
+        for (u32 i = 1; i < statePtr->threadCount; ++i) {
+            platform_thread_join(&statePtr->threads[i].thread);
+        }
+        for (u32 priority = 0; priority < JOB_PRIORITY_COUNT; ++priority) {
+            mpmc_queue_destroy(&statePtr->injected[priority]);
+            mpmc_queue_destroy(&statePtr->workerOnly[priority]);
+        }
+        mpmc_queue_destroy(&statePtr->deferred);
+        threadIndex = INVALID_ID;
+        statePtr = 0;
+    }
+}
+
+void job_system_submit(JobInfo job) {
+    job_system_submit_many(job, 1, 0);
+}
+
+void job_system_submit_many(JobInfo job, u32 count, u64 paramStride) {
+    if (!job.entry || job.priority >= JOB_PRIORITY_COUNT) {
+        KERROR("job_system_submit requires an entry point and a valid priority.");
+        return;
+    }
+    if (job.counter) {
+        // Counted up front, so the counter cannot reach zero while jobs are still being submitted.
+        __atomic_add_fetch(&job.counter->pending, count, __ATOMIC_RELAXED);
+    }
+    Job queued = {job.entry, job.param, job.counter, job.dependency, job.workerOnly};
+    for (u32 i = 0; i < count; ++i) {
+        queued.param = (u8*)job.param + i * paramStride;
+        if (statePtr) {
+            enqueue(&queued, job.priority);
+        } else {
+            run_job(&queued);
+        }
+    }
+}
+
+void job_system_wait(JobCounter* counter) {
+    u32 idleCount = 0;
+    while (__atomic_load_n(&counter->pending, __ATOMIC_ACQUIRE) > 0) {
+        if (statePtr && job_system_run_pending()) {
+            idleCount = 0;
+        } else if (++idleCount < JOB_SPIN_COUNT) {
+            kcpu_pause();
+        } else {
+            // The remaining jobs are running elsewhere.
+            platform_thread_yield();
+        }
+    }
+}
+
+b8 job_system_is_done(JobCounter* counter) {
+    return __atomic_load_n(&counter->pending, __ATOMIC_ACQUIRE) == 0;
+}
+
+b8 job_system_run_pending() {
+    if (!statePtr) {
+        return false;
+    }
+    Job job;
+    // Every blocked job found is moved to the deferred queue, so this ends.
+    while (find_job(&job)) {
+        if (!is_blocked(&job)) {
+            run_job(&job);
+            return true;
+        }
+        defer(&job);
+    }
+    // Only deferred jobs are left, if any. Retry the one that has waited longest.
+    if (!mpmc_queue_pop(&statePtr->deferred, &job)) {
+        return false;
+    }
+    __atomic_sub_fetch(&statePtr->queuedJobs, 1, __ATOMIC_SEQ_CST);
+    __atomic_sub_fetch(&statePtr->deferredJobs, 1, __ATOMIC_SEQ_CST);
+    if (is_blocked(&job) || (job.workerOnly && !can_run_worker_only())) {
+        defer(&job);
+        return false;
+    }
+    run_job(&job);
+    return true;
+}
+
+u32 job_system_thread_count() {
+    return statePtr ? statePtr->threadCount : 1;
+}
+
+u32 job_system_thread_index() {
+    return threadIndex;
+}
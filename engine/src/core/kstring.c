@@ -40,12 +40,39 @@ i32 string_format_v(char* dest, const char* format, void* va_listp) {
     return -1;
 }
 
+i32 string_nformat(char* dest, u64 size, const char* format, ...) {
+    __builtin_va_list arg_ptr;
+    va_start(arg_ptr, format);
+    i32 written = string_nformat_v(dest, size, format, arg_ptr);
+    va_end(arg_ptr);
+    return written;
+}
+
+i32 string_nformat_v(char* dest, u64 size, const char* format, void* va_listp) {
+    if (!dest || size == 0) {
+        return -1;
+    }
+    i32 written = vsnprintf(dest, size, format, va_listp);
+    if (written < 0) {
+        dest[0] = 0;
+        return -1;
+    }
+    // vsnprintf reports the length it wanted, not what fit.
+    return (u64)written < size ? written : (i32)(size - 1);
+}
+
 char* string_duplicate(const char* str) {
     u64 length = string_length(str);
-    char* copy = kallocate(length + 1, MEMORY_TAG_STRING);
+    char* copy = kallocate_pooled(length + 1, MEMORY_TAG_STRING);
     kcopy_memory(copy, str, length + 1);
     return copy;
 }
+
+void string_free(char* str) {
+    if (str) {
+        kfree_pooled(str, string_length(str) + 1, MEMORY_TAG_STRING);
+    }
+}
 // Case-sensitive string comparison. True if the same, otherwise false.
 b8 strings_equal(const char* str0, const char* str1) {
     return strcmp(str0, str1) == 0;
@@ -3,92 +3,718 @@
 #include <stdarg.h>
 #include "core/kstring.h"
 #include "memory/kmemory.h"
+#include "containers/ring_queue.h"
+#include "platform/atomic.h"
 #include "platform/filesystem.h"
-#include <string.h>
+#include "platform/thread.h"
+
+#define LOG_DEFAULT_QUEUE_CAPACITY 4096
+// The longest message a queued record holds, including the terminator. Longer ones are
+// spilled into a block of their own, which the writer frees.
+#define LOG_RECORD_MESSAGE_LENGTH 496
+// Lines are gathered into this much memory, then written to the log file at once.
+#define LOG_BATCH_SIZE (64 * 1024)
+// Technically imposes a 32k character limit on a single log entry, but...
+// DON'T DO THAT!
+#define LOG_DIRECT_LINE_LENGTH 32000
+// Marks a captured string argument that was a null pointer.
+#define LOG_NULL_STRING ((u64)-1)
+
+typedef enum LogRecordType {
+    LOG_RECORD_MESSAGE,
+    // A format string and its captured arguments, for the writer to format.
+    LOG_RECORD_DEFERRED,
+    // Asks the writer to write out its batch, then mark the record's flush ticket as done.
+    LOG_RECORD_FLUSH,
+    // A message too long for the record, held in a block from platform_allocate.
+    LOG_RECORD_SPILLED
+} LogRecordType;
+
+// The arguments of a deferred message, laid out to fill a record.
+typedef struct LogDeferredArgs {
+    const char* format;
+    u8 argCount;
+    u8 types[LOG_MAX_DEFERRED_ARGS];
+    // For strings, the offset of the copy in strings, or LOG_NULL_STRING.
+    u64 values[LOG_MAX_DEFERRED_ARGS];
+    char strings[LOG_RECORD_MESSAGE_LENGTH - 32 - 8 * LOG_MAX_DEFERRED_ARGS];
+} LogDeferredArgs;
+
+// A queued message, 512 bytes in all.
+typedef struct LogRecord {
+    u8 type;
+    u8 level;
+    u16 length;
+    u32 reserved;
+    u64 flushTicket;
+    union {
+        char message[LOG_RECORD_MESSAGE_LENGTH];
+        LogDeferredArgs deferred;
+        char* spilled;
+    };
+} LogRecord;
+
+STATIC_ASSERT(sizeof(LogRecord) == 512, "Expected a log record to be 512 bytes.");
 
 typedef struct LoggerSystemState {
+    LoggingConfig config;
     FileHandle logFileHandle;
+    MpmcQueue queue;
+    KThread writer;
+    // Cleared to stop the writer. While set, messages go through the queue.
+    u32 running;
+    // Set while the writer sleeps on wake. Callers only signal it then, so most messages cost no system call.
+    u32 writerSleeping;
+    KSemaphore wake;
+
+    u64 written;
+    u64 dropped;
+    // Drops not yet mentioned in the log.
+    u64 unreportedDrops;
+
+    // Flush tickets are taken before the flush record is queued, and completed in queue order.
+    u64 nextFlushTicket;
+    u64 completedFlushTicket;
+    KMutex flushMutex;
+    KConditionVariable flushCompleted;
+
+    // Lines waiting to be written to the log file. Only touched by the writer.
+    u64 batchLength;
+    char batch[LOG_BATCH_SIZE];
+    // Where the writer puts together each line. Only touched by the writer.
+    char line[LOG_DIRECT_LINE_LENGTH];
 } LoggerSystemState;
 
 static LoggerSystemState* statePtr;
 
-void append_to_log_file(const char* message) {
-    if (statePtr && statePtr->logFileHandle.isValid) {
-        // Since the message already contains a '\n', just write the bytes directly.
-        u64 length = strlen(message);
-        u64 written = 0;
-        // if (!filesystem_write(&statePtr->logFileHandle, length, message, &written)) {
-        //     platform_console_write_error("ERROR writing to console.log.", LOG_LEVEL_ERROR);
-        // }
-    }
-}
+// Set on the writer thread, whose own messages must not wait on itself.
+static KTHREAD_LOCAL b8 isWriterThread = false;
+
+static const char* levelStrings[6] = {"[FATAL]: ", "[ERROR]: ", "[WARN]:  ", "[INFO]:  ", "[DEBUG]: ", "[TRACE]: "};
 
+// Names of the levels and channels accepted by logger_configure_levels.
+static const char* levelNames[6] = {"fatal", "error", "warn", "info", "debug", "trace"};
+static const char* channelNames[LOG_CHANNEL_COUNT] = {"core", "platform", "memory", "renderer", "systems", "resources", "game"};
 
-b8 initialize_logging(u64* memoryRequirement, void* state ){
-    *memoryRequirement = sizeof(LoggerSystemState);
+// Every channel writes everything until configured otherwise.
+u8 logChannelLevels[LOG_CHANNEL_COUNT] = {
+    LOG_LEVEL_TRACE, LOG_LEVEL_TRACE, LOG_LEVEL_TRACE, LOG_LEVEL_TRACE, LOG_LEVEL_TRACE, LOG_LEVEL_TRACE, LOG_LEVEL_TRACE};
+
+static u32 log_writer(void* params);
+static void write_direct(LogLevel level, char* line, i32 length);
+
+b8 initialize_logging(u64* memoryRequirement, void* state, LoggingConfig config){
+    if (config.queueCapacity == 0) {
+        config.queueCapacity = LOG_DEFAULT_QUEUE_CAPACITY;
+    }
+    u64 queueRequirement = mpmc_queue_memory_requirement(sizeof(LogRecord), config.queueCapacity);
+    *memoryRequirement = sizeof(LoggerSystemState) + queueRequirement;
     if(state == 0){
         return true;
     }
-    statePtr = state;
-    if(!filesystem_open("kohi.log",FILE_MODE_WRITE,false,&statePtr->logFileHandle)){
-        platform_console_write_error("Unable to open log file for writing",LOG_LEVEL_ERROR);
+    LoggerSystemState* s = state;
+    kzero_memory(s, sizeof(LoggerSystemState));
+    s->config = config;
+    if (config.logFilePath && !filesystem_open(config.logFilePath, FILE_MODE_WRITE, false, &s->logFileHandle)) {
+        platform_console_write_error("Unable to open log file for writing", LOG_LEVEL_ERROR);
         return false;
     }
 
-     // TODO: create log file.
-     return true;
+    if (config.channelLevels && !logger_configure_levels(config.channelLevels)) {
+        platform_console_write_error("Some log channel levels were not understood and have been ignored.\n", LOG_LEVEL_WARN);
+    }
 
+    mpmc_queue_create(sizeof(LogRecord), config.queueCapacity, (u8*)state + sizeof(LoggerSystemState), &s->queue);
+    statePtr = s;
 
+    katomic_store_u32(&s->running, true);
+    if (!platform_thread_create(log_writer, s, &s->writer)) {
+        // Carry on writing directly.
+        katomic_store_u32(&s->running, false);
+        platform_console_write_error("Unable to start the log writer thread, logging directly.\n", LOG_LEVEL_WARN);
+        return true;
+    }
+    platform_thread_set_name(&s->writer, "kohi-log");
+    return true;
 }
-void shutdown_logging(u64* memoryRequirement, void* state){
-    
 
-    // TODO: cleanup logging/write queued entries.
+void shutdown_logging(u64* memoryRequirement, void* state){
+    LoggerSystemState* s = statePtr;
+    if (!s) {
+        return;
+    }
 
+    // The writer drains the queue before it exits. Messages logged from here on are written directly.
+    if (katomic_exchange_u32(&s->running, false)) {
+        platform_semaphore_signal(&s->wake, 1);
+        platform_thread_join(&s->writer);
+    }
     statePtr = 0;
 
+    mpmc_queue_destroy(&s->queue);
+    if (s->logFileHandle.isValid) {
+        filesystem_close(&s->logFileHandle);
+    }
 }
 
-void log_output(LogLevel level, const char* message, ...){
-    // TODO: These string operations are all pretty slow. This needs to be
-    // moved to another thread eventually, along with the file writes, to
-    // avoid slowing things down while the engine is trying to run.
-     const char* level_strings[6] = {"[FATAL]: ", "[ERROR]: ", "[WARN]:  ", "[INFO]:  ", "[DEBUG]: ", "[TRACE]: "};
-     b8 is_error = level < LOG_LEVEL_WARN;
+// Wakes the writer if it is asleep.
+static void wake_writer(LoggerSystemState* state) {
+    // Pairs with the writer announcing it will sleep before its last look at the queue: either
+    // it sees the new record or this sees it sleeping.
+    katomic_fence();
+    if (katomic_load_u32(&state->writerSleeping) && katomic_exchange_u32(&state->writerSleeping, false)) {
+        platform_semaphore_signal(&state->wake, 1);
+    }
+}
 
+static b8 enqueue(LoggerSystemState* state, const LogRecord* record, b8 mayDrop) {
+    while (!mpmc_queue_push(&state->queue, record)) {
+        if (mayDrop) {
+            if (record->type == LOG_RECORD_SPILLED) {
+                platform_free(record->spilled, false);
+            }
+            katomic_fetch_add_u64(&state->dropped, 1);
+            katomic_fetch_add_u64(&state->unreportedDrops, 1);
+            return false;
+        }
+        // Back-pressure: give the writer a chance to make room.
+        wake_writer(state);
+        platform_thread_yield();
+    }
+    wake_writer(state);
+    return true;
+}
 
-    // Technically imposes a 32k character limit on a single log entry, but...
-    // DON'T DO THAT!
-    char out_message[32000];
-    kzero_memory(out_message, sizeof(out_message));
+/* Obtains a block for a message that filled its record, which may have been cut short. The
+   message is formatted again into it, up to the direct line length. Returns 0 if there is no
+   memory, leaving the shortened message in the record. */
+static char* spill_begin() {
+    return platform_allocate(LOG_DIRECT_LINE_LENGTH, false);
+}
+
+// Points the record at the spilled message, giving back the memory it did not use.
+static void spill_end(LogRecord* record, char* spilled, i32 length) {
+    if (length < 0) {
+        length = 0;
+    }
+    char* shrunk = platform_reallocate(spilled, length + 1);
+    record->type = LOG_RECORD_SPILLED;
+    record->spilled = shrunk ? shrunk : spilled;
+    record->length = length;
+}
 
-    // Format original message.
+void log_output(LogLevel level, const char* message, ...){
     // NOTE: Oddly enough, MS's headers override the GCC/Clang va_list type with a "typedef char* va_list" in some
     // cases, and as a result throws a strange error here. The workaround for now is to just use __builtin_va_list,
     // which is the type GCC/Clang's va_start expects.
     __builtin_va_list arg_ptr;
+    LoggerSystemState* state = statePtr;
+    if (!state || isWriterThread || !katomic_load_u32(&state->running)) {
+        char line[LOG_DIRECT_LINE_LENGTH];
+        i32 length = string_nformat(line, sizeof(line), "%s", levelStrings[level]);
+        va_start(arg_ptr, message);
+        // Leave room for the newline.
+        i32 messageLength = string_nformat_v(line + length, sizeof(line) - length - 1, message, arg_ptr);
+        va_end(arg_ptr);
+        write_direct(level, line, length + (messageLength > 0 ? messageLength : 0));
+        return;
+    }
+
+    LogRecord record;
+    record.type = LOG_RECORD_MESSAGE;
+    record.level = level;
+    record.reserved = 0;
+    record.flushTicket = 0;
     va_start(arg_ptr, message);
-    string_format_v(out_message, message, arg_ptr);
+    i32 length = string_nformat_v(record.message, sizeof(record.message), message, arg_ptr);
     va_end(arg_ptr);
+    record.length = length > 0 ? length : 0;
+    char* spilled = record.length == sizeof(record.message) - 1 ? spill_begin() : 0;
+    if (spilled) {
+        va_start(arg_ptr, message);
+        length = string_nformat_v(spilled, LOG_DIRECT_LINE_LENGTH, message, arg_ptr);
+        va_end(arg_ptr);
+        spill_end(&record, spilled, length);
+    }
 
-     // Prepend log level to message.
-    string_format(out_message, "%s%s\n", level_strings[level], out_message);
+    enqueue(state, &record, level >= LOG_DROPPABLE_LEVEL);
 
-    
-    // Platform-specific output.
-    if (is_error) {
-        platform_console_write_error(out_message, level);
+    if (level == LOG_LEVEL_FATAL) {
+        // Whatever follows a fatal error may never give the writer another chance.
+        logger_flush();
+    }
+}
+
+// Copies the arguments into the record. Fails if there are too many, or their strings do not fit.
+static b8 capture_args(LogRecord* record, const char* format, u32 argCount, const LogArg* args) {
+    if (argCount > LOG_MAX_DEFERRED_ARGS) {
+        return false;
+    }
+    LogDeferredArgs* deferred = &record->deferred;
+    deferred->format = format;
+    deferred->argCount = argCount;
+    u64 stringsUsed = 0;
+    for (u32 i = 0; i < argCount; ++i) {
+        deferred->types[i] = args[i].type;
+        if (args[i].type != LOG_ARG_STRING) {
+            deferred->values[i] = args[i].value.u;
+            continue;
+        }
+        // The string may be gone by the time the writer gets to it, so keep a copy.
+        if (!args[i].value.s) {
+            deferred->values[i] = LOG_NULL_STRING;
+            continue;
+        }
+        u64 size = string_length(args[i].value.s) + 1;
+        if (stringsUsed + size > sizeof(deferred->strings)) {
+            return false;
+        }
+        kcopy_memory(deferred->strings + stringsUsed, args[i].value.s, size);
+        deferred->values[i] = stringsUsed;
+        stringsUsed += size;
+    }
+    return true;
+}
+
+void log_output_deferred(LogLevel level, const char* format, u32 argCount, const LogArg* args){
+    LoggerSystemState* state = statePtr;
+    if (!state || isWriterThread || !katomic_load_u32(&state->running)) {
+        char line[LOG_DIRECT_LINE_LENGTH];
+        i32 length = string_nformat(line, sizeof(line), "%s", levelStrings[level]);
+        // Leave room for the newline.
+        length += log_format_args(line + length, sizeof(line) - length - 1, format, argCount, args);
+        write_direct(level, line, length);
+        return;
+    }
+
+    LogRecord record;
+    record.type = LOG_RECORD_DEFERRED;
+    record.level = level;
+    record.length = 0;
+    record.reserved = 0;
+    record.flushTicket = 0;
+    if (!capture_args(&record, format, argCount, args)) {
+        // Format it here instead.
+        record.type = LOG_RECORD_MESSAGE;
+        record.length = log_format_args(record.message, sizeof(record.message), format, argCount, args);
+        char* spilled = record.length == sizeof(record.message) - 1 ? spill_begin() : 0;
+        if (spilled) {
+            spill_end(&record, spilled, log_format_args(spilled, LOG_DIRECT_LINE_LENGTH, format, argCount, args));
+        }
+    }
+
+    enqueue(state, &record, level >= LOG_DROPPABLE_LEVEL);
+
+    if (level == LOG_LEVEL_FATAL) {
+        logger_flush();
+    }
+}
+
+// Reads an argument as an integer, whatever it was captured as.
+static i64 log_arg_integer(const LogArg* arg) {
+    return arg->type == LOG_ARG_FLOAT ? (i64)arg->value.f : arg->value.i;
+}
+
+// Formats one conversion with the given value, passing any '*' width and precision before it.
+#define LOG_FORMAT_CONVERSION(value)                                                                     \
+    (starCount == 0   ? string_nformat(out, room, spec, value)                                          \
+     : starCount == 1 ? string_nformat(out, room, spec, stars[0], value)                                \
+                      : string_nformat(out, room, spec, stars[0], stars[1], value))
+
+i32 log_format_args(char* dest, u64 size, const char* format, u32 argCount, const LogArg* args){
+    if (!dest || size == 0) {
+        return 0;
+    }
+    u64 length = 0;
+    u32 next = 0;
+    const char* p = format;
+    while (*p && length + 1 < size) {
+        if (*p != '%') {
+            dest[length++] = *p++;
+            continue;
+        }
+        const char* specStart = p++;
+        if (*p == '%') {
+            dest[length++] = '%';
+            p++;
+            continue;
+        }
+
+        // Walk the conversion specification: flags, width, precision, length modifier, conversion.
+        i32 stars[2];
+        u32 starCount = 0;
+        b8 missing = false;
+        while (*p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0') {
+            p++;
+        }
+        for (u32 part = 0; part < 2; ++part) {
+            if (part == 1) {
+                if (*p != '.') {
+                    break;
+                }
+                p++;
+            }
+            if (*p == '*') {
+                p++;
+                if (next < argCount) {
+                    stars[starCount++] = (i32)log_arg_integer(&args[next++]);
+                } else {
+                    missing = true;
+                }
+            } else {
+                while (*p >= '0' && *p <= '9') {
+                    p++;
+                }
+            }
+        }
+        u32 longs = 0;
+        b8 longDouble = false;
+        while (*p == 'h' || *p == 'l' || *p == 'L' || *p == 'q' || *p == 'j' || *p == 'z' || *p == 't') {
+            longs += *p != 'h' && *p != 'L';
+            longDouble |= *p == 'L';
+            p++;
+        }
+        char conversion = *p;
+        if (!conversion) {
+            break;
+        }
+        p++;
+
+        char spec[32];
+        u64 specLength = p - specStart;
+        const LogArg* arg = next < argCount ? &args[next] : 0;
+        if (missing || !arg || specLength >= sizeof(spec)) {
+            // Nothing to format it with, so leave the specification as it is.
+            for (const char* c = specStart; c < p && length + 1 < size; ++c) {
+                dest[length++] = *c;
+            }
+            continue;
+        }
+        kcopy_memory(spec, specStart, specLength);
+        spec[specLength] = 0;
+        next++;
+
+        char* out = dest + length;
+        u64 room = size - length;
+        i32 written = 0;
+        switch (conversion) {
+            case 'd':
+            case 'i': {
+                i64 value = log_arg_integer(arg);
+                written = longs == 0 ? LOG_FORMAT_CONVERSION((int)value)
+                        : longs == 1 ? LOG_FORMAT_CONVERSION((long)value)
+                                     : LOG_FORMAT_CONVERSION((long long)value);
+            } break;
+            case 'u':
+            case 'o':
+            case 'x':
+            case 'X': {
+                u64 value = (u64)log_arg_integer(arg);
+                written = longs == 0 ? LOG_FORMAT_CONVERSION((unsigned int)value)
+                        : longs == 1 ? LOG_FORMAT_CONVERSION((unsigned long)value)
+                                     : LOG_FORMAT_CONVERSION((unsigned long long)value);
+            } break;
+            case 'c':
+                written = LOG_FORMAT_CONVERSION((int)log_arg_integer(arg));
+                break;
+            case 'e':
+            case 'E':
+            case 'f':
+            case 'F':
+            case 'g':
+            case 'G':
+            case 'a':
+            case 'A': {
+                f64 value = arg->type == LOG_ARG_FLOAT ? arg->value.f : (f64)arg->value.i;
+                written = longDouble ? LOG_FORMAT_CONVERSION((long double)value) : LOG_FORMAT_CONVERSION(value);
+            } break;
+            case 's': {
+                const char* value = arg->type == LOG_ARG_STRING && arg->value.s ? arg->value.s : "(null)";
+                written = LOG_FORMAT_CONVERSION(value);
+            } break;
+            case 'p':
+                written = LOG_FORMAT_CONVERSION(arg->value.p);
+                break;
+            default:
+                // Includes %n, which is never honoured.
+                break;
+        }
+        if (written > 0) {
+            length += written;
+        }
+    }
+    dest[length] = 0;
+    return (i32)length;
+}
+
+void logger_flush(){
+    LoggerSystemState* state = statePtr;
+    if (!state || isWriterThread || !katomic_load_u32(&state->running)) {
+        return;
+    }
+
+    LogRecord record;
+    record.type = LOG_RECORD_FLUSH;
+    record.level = LOG_LEVEL_FATAL;
+    record.length = 0;
+    record.reserved = 0;
+    // Everything this thread logged is queued before the ticket is taken, so before the record
+    // of any flush that completes this ticket.
+    record.flushTicket = katomic_fetch_add_u64(&state->nextFlushTicket, 1) + 1;
+    enqueue(state, &record, false);
+
+    platform_mutex_lock(&state->flushMutex);
+    while (state->completedFlushTicket < record.flushTicket) {
+        platform_condition_wait(&state->flushCompleted, &state->flushMutex);
+    }
+    platform_mutex_unlock(&state->flushMutex);
+}
+
+void logger_set_channel_level(LogChannel channel, LogLevel level){
+    if (level < LOG_LEVEL_ERROR) {
+        level = LOG_LEVEL_ERROR;
+    }
+    if (level > LOG_LEVEL_TRACE) {
+        level = LOG_LEVEL_TRACE;
+    }
+    for (u32 i = 0; i < LOG_CHANNEL_COUNT; ++i) {
+        if (channel == LOG_CHANNEL_COUNT || channel == i) {
+            __atomic_store_n(&logChannelLevels[i], (u8)level, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+LogLevel logger_get_channel_level(LogChannel channel){
+    if (channel >= LOG_CHANNEL_COUNT) {
+        return LOG_LEVEL_TRACE;
+    }
+    return (LogLevel)__atomic_load_n(&logChannelLevels[channel], __ATOMIC_RELAXED);
+}
+
+// Finds the name among names, comparing only the first length characters of name. Returns INVALID_ID if absent.
+static u32 find_name(const char* name, u64 length, const char** names, u32 count) {
+    char copy[32];
+    if (length >= sizeof(copy)) {
+        return INVALID_ID;
+    }
+    string_ncopy(copy, name, length);
+    copy[length] = 0;
+    for (u32 i = 0; i < count; ++i) {
+        if (strings_equali(copy, names[i])) {
+            return i;
+        }
+    }
+    return INVALID_ID;
+}
+
+b8 logger_configure_levels(const char* levels){
+    if (!levels) {
+        return false;
+    }
+    b8 result = true;
+    const char* pair = levels;
+    while (*pair) {
+        // Measure out "channel=level", ignoring spaces around either.
+        const char* end = pair;
+        while (*end && *end != ',') {
+            end++;
+        }
+        const char* equals = pair;
+        while (equals < end && *equals != '=') {
+            equals++;
+        }
+        const char* channelStart = pair;
+        const char* channelEnd = equals;
+        const char* levelStart = equals < end ? equals + 1 : end;
+        const char* levelEnd = end;
+        while (channelStart < channelEnd && *channelStart == ' ') {
+            channelStart++;
+        }
+        while (channelEnd > channelStart && channelEnd[-1] == ' ') {
+            channelEnd--;
+        }
+        while (levelStart < levelEnd && *levelStart == ' ') {
+            levelStart++;
+        }
+        while (levelEnd > levelStart && levelEnd[-1] == ' ') {
+            levelEnd--;
+        }
+
+        if (channelEnd > channelStart || equals < end) {
+            u32 channel = channelEnd - channelStart == 1 && *channelStart == '*'
+                              ? LOG_CHANNEL_COUNT
+                              : find_name(channelStart, channelEnd - channelStart, channelNames, LOG_CHANNEL_COUNT);
+            u32 level = find_name(levelStart, levelEnd - levelStart, levelNames, 6);
+            if (equals == end || channel == INVALID_ID || level == INVALID_ID || level < LOG_LEVEL_ERROR) {
+                result = false;
+            } else {
+                logger_set_channel_level((LogChannel)channel, (LogLevel)level);
+            }
+        }
+        pair = *end ? end + 1 : end;
+    }
+    return result;
+}
+
+b8 log_rate_limit_allow(LogRateLimit* limit, LogLevel level, const char* format){
+    const u64 window = LOG_RATE_LIMIT_WINDOW_MS * 1000;
+    u64 now = (u64)(platform_get_absolute_time() * 1000000.0);
+    u64 start = katomic_load_u64(&limit->windowStart);
+    // The thread that moves the window on reports what the last one skipped.
+    if ((start == 0 || now - start >= window) && katomic_compare_exchange_u64(&limit->windowStart, &start, now)) {
+        katomic_store_u32(&limit->count, 0);
+        u32 skipped = katomic_exchange_u32(&limit->skipped, 0);
+        if (skipped) {
+            log_output(level, "Skipped %u more messages like \"%s\".", skipped, format);
+        }
+    }
+    if (katomic_fetch_add_u32(&limit->count, 1) < LOG_RATE_LIMIT_COUNT) {
+        return true;
+    }
+    katomic_fetch_add_u32(&limit->skipped, 1);
+    return false;
+}
+
+void logger_get_stats(LoggerStats* outStats){
+    LoggerSystemState* state = statePtr;
+    if (!outStats) {
+        return;
+    }
+    if (!state) {
+        kzero_memory(outStats, sizeof(LoggerStats));
+        return;
+    }
+    outStats->written = katomic_load_u64(&state->written);
+    outStats->dropped = katomic_load_u64(&state->dropped);
+}
+
+static void write_batch(LoggerSystemState* state) {
+    if (state->batchLength > 0 && state->logFileHandle.isValid) {
+        u64 written = 0;
+        if (!filesystem_write(&state->logFileHandle, state->batchLength, state->batch, &written)) {
+            platform_console_write_error("ERROR writing to the log file.\n", LOG_LEVEL_ERROR);
+        }
+    }
+    state->batchLength = 0;
+    platform_console_flush();
+}
+
+// Writes out the first length characters of state->line, which end with a newline.
+static void output_line(LoggerSystemState* state, LogLevel level, u64 length) {
+    if (level < LOG_LEVEL_WARN) {
+        platform_console_write_error(state->line, level);
     } else {
-        platform_console_write(out_message, level);
+        platform_console_write(state->line, level);
+    }
+
+    if (state->logFileHandle.isValid) {
+        if (state->batchLength + length > LOG_BATCH_SIZE) {
+            write_batch(state);
+        }
+        kcopy_memory(state->batch + state->batchLength, state->line, length);
+        state->batchLength += length;
+    }
+}
+
+static void write_line(LoggerSystemState* state, LogLevel level, const char* message, u32 length) {
+    // Leave room for the level and the newline.
+    if (length > sizeof(state->line) - 16) {
+        length = sizeof(state->line) - 16;
+    }
+    i32 lineLength = string_nformat(state->line, sizeof(state->line), "%s%.*s\n", levelStrings[level], (i32)length, message);
+    output_line(state, level, lineLength);
+}
+
+static void write_deferred(LoggerSystemState* state, const LogRecord* record) {
+    // Point the string arguments at their copies in the record.
+    const LogDeferredArgs* deferred = &record->deferred;
+    LogArg args[LOG_MAX_DEFERRED_ARGS];
+    for (u32 i = 0; i < deferred->argCount; ++i) {
+        args[i].type = deferred->types[i];
+        args[i].value.u = deferred->values[i];
+        if (args[i].type == LOG_ARG_STRING) {
+            args[i].value.s = deferred->values[i] == LOG_NULL_STRING ? 0 : deferred->strings + deferred->values[i];
+        }
     }
+    i32 length = string_nformat(state->line, sizeof(state->line), "%s", levelStrings[record->level]);
+    // Leave room for the newline.
+    length += log_format_args(state->line + length, sizeof(state->line) - length - 1, deferred->format, deferred->argCount, args);
+    state->line[length++] = '\n';
+    state->line[length] = 0;
+    output_line(state, record->level, length);
+}
+
+static u32 log_writer(void* params) {
+    LoggerSystemState* state = params;
+    isWriterThread = true;
+    LogRecord record;
+    for (;;) {
+        while (mpmc_queue_pop(&state->queue, &record)) {
+            if (record.type == LOG_RECORD_FLUSH) {
+                write_batch(state);
+                platform_mutex_lock(&state->flushMutex);
+                if (record.flushTicket > state->completedFlushTicket) {
+                    state->completedFlushTicket = record.flushTicket;
+                }
+                platform_condition_broadcast(&state->flushCompleted);
+                platform_mutex_unlock(&state->flushMutex);
+                continue;
+            }
+            if (record.type == LOG_RECORD_DEFERRED) {
+                write_deferred(state, &record);
+            } else if (record.type == LOG_RECORD_SPILLED) {
+                write_line(state, record.level, record.spilled, record.length);
+                platform_free(record.spilled, false);
+            } else {
+                write_line(state, record.level, record.message, record.length);
+            }
+            katomic_fetch_add_u64(&state->written, 1);
+        }
 
-    char log_message[32000];
-    kzero_memory(log_message, sizeof(log_message));
-    string_ncopy(log_message,out_message,32000);
-     // Queue a copy to be written to the log file.
-    append_to_log_file(log_message);
+        u64 drops = katomic_exchange_u64(&state->unreportedDrops, 0);
+        if (drops) {
+            char message[128];
+            i32 length = string_nformat(message, sizeof(message), "%llu log messages were dropped because the log queue was full.", drops);
+            write_line(state, LOG_LEVEL_WARN, message, length);
+        }
+        write_batch(state);
 
+        if (!katomic_load_u32(&state->running)) {
+            if (mpmc_queue_count(&state->queue) == 0) {
+                break;
+            }
+            continue;
+        }
+
+        // Announce the sleep before the last look at the queue, so a record queued meanwhile is not missed.
+        katomic_exchange_u32(&state->writerSleeping, true);
+        if (mpmc_queue_count(&state->queue) == 0 && katomic_load_u32(&state->running)) {
+            platform_semaphore_wait(&state->wake);
+        }
+        katomic_store_u32(&state->writerSleeping, false);
+    }
+    return 0;
 }
+
+// Writes a line holding the level prefix and message on the calling thread, adding the newline.
+static void write_direct(LogLevel level, char* line, i32 length) {
+    line[length++] = '\n';
+    line[length] = 0;
+
+    // Platform-specific output.
+    if (level < LOG_LEVEL_WARN) {
+        platform_console_write_error(line, level);
+    } else {
+        platform_console_write(line, level);
+    }
+
+    LoggerSystemState* state = statePtr;
+    if (state && state->logFileHandle.isValid) {
+        u64 written = 0;
+        filesystem_write(&state->logFileHandle, length, line, &written);
+    }
+}
+
 void report_assertion_failure(const char* expression, const char* message, const char* file, i32 line) {
     log_output(LOG_LEVEL_FATAL, "Assertion Failure: %s, message: '%s', in file: %s, line: %d\n", expression, message, file, line);
-} 
\ No newline at end of file
+}
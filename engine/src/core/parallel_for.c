@@ -0,0 +1,62 @@
+#include "core/parallel_for.h"
+
+#include "core/job_system.h"
+#include "core/logger.h"
+
+typedef struct ParallelForChunk {
+    u64 begin;
+    u64 end;
+    PFN_parallel_for fn;
+    void* user;
+} ParallelForChunk;
+
+static void run_chunk(void* param) {
+    ParallelForChunk* chunk = param;
+    chunk->fn(chunk->begin, chunk->end, chunk->user);
+}
+
+void parallel_for(u64 begin, u64 end, u64 grain, PFN_parallel_for fn, void* user) {
+    if (!fn) {
+        KERROR("parallel_for requires a function to run.");
+        return;
+    }
+    if (end <= begin) {
+        return;
+    }
+    if (grain == 0) {
+        grain = PARALLEL_FOR_DEFAULT_GRAIN;
+    }
+    u64 count = end - begin;
+    u32 threadCount = job_system_thread_count();
+    if (threadCount == 1 || count <= grain) {
+        fn(begin, end, user);
+        return;
+    }
+
+    u64 grainCount = (count + grain - 1) / grain;
+    u64 chunkCount = (u64)threadCount * PARALLEL_FOR_CHUNKS_PER_THREAD;
+    if (chunkCount > PARALLEL_FOR_MAX_CHUNKS) {
+        chunkCount = PARALLEL_FOR_MAX_CHUNKS;
+    }
+    if (chunkCount > grainCount) {
+        chunkCount = grainCount;
+    }
+    // Whole grains per chunk. Rounding up may leave fewer chunks than asked for.
+    u64 chunkSize = ((grainCount + chunkCount - 1) / chunkCount) * grain;
+    chunkCount = (count + chunkSize - 1) / chunkSize;
+
+    ParallelForChunk chunks[PARALLEL_FOR_MAX_CHUNKS];
+    for (u64 i = 0; i < chunkCount; ++i) {
+        chunks[i].begin = begin + i * chunkSize;
+        chunks[i].end = i + 1 == chunkCount ? end : chunks[i].begin + chunkSize;
+        chunks[i].fn = fn;
+        chunks[i].user = user;
+    }
+
+    // Work the frame is waiting on, so it goes ahead of background jobs.
+    JobCounter counter = {0};
+    JobInfo job = {run_chunk, &chunks[1], JOB_PRIORITY_HIGH, &counter, 0};
+    job_system_submit_many(job, (u32)(chunkCount - 1), sizeof(ParallelForChunk));
+    run_chunk(&chunks[0]);
+    job_system_wait(&counter);
+}
@@ -0,0 +1,364 @@
+#include "core/profiler.h"
+
+#include <stdarg.h>
+#include "core/logger.h"
+#include "core/kstring.h"
+#include "memory/kmemory.h"
+#include "platform/atomic.h"
+#include "platform/filesystem.h"
+#include "platform/platform.h"
+#include "platform/thread.h"
+
+#define PROFILER_DEFAULT_EVENTS_PER_THREAD (64 * 1024)
+#define PROFILER_DEFAULT_MAX_THREADS 64
+#define PROFILER_THREAD_NAME_LENGTH 32
+// Trace output is gathered in this much memory between writes.
+#define PROFILER_WRITE_BUFFER_SIZE (64 * 1024)
+
+typedef enum ProfileEventType {
+    PROFILE_EVENT_ZONE,
+    PROFILE_EVENT_FRAME
+} ProfileEventType;
+
+typedef struct ProfileEvent {
+    const char* name;
+    u64 start;
+    u64 end;
+    u32 type;
+    // Zones open around this one on its thread.
+    u32 depth;
+} ProfileEvent;
+
+/* A thread's events. Only the owning thread writes them, publishing each with a release
+   store of count, so the exporter can read the first count events without locking. */
+typedef struct ProfileThread {
+    // Set once the fields below the events are filled in.
+    u32 ready;
+    // The capture the events belong to. The owner clears its events when this falls behind.
+    u32 generation;
+    u32 count;
+    u64 threadId;
+    char name[PROFILER_THREAD_NAME_LENGTH];
+    ProfileEvent* events;
+} ProfileThread;
+
+typedef struct ProfilerState {
+    ProfilerConfig config;
+    // Distinguishes this initialization from earlier ones, whose thread registrations are stale.
+    u32 instance;
+    u32 capturing;
+    // Bumped by each capture.
+    u32 generation;
+    u64 captureStart;
+    u32 captureFrames;
+    u32 capturedFrames;
+    u64 dropped;
+    // Threads that have claimed an entry in threads. May exceed config.maxThreads.
+    u32 threadCount;
+    ProfileThread* threads;
+} ProfilerState;
+
+static ProfilerState* statePtr;
+static u32 lastInstance;
+
+static KTHREAD_LOCAL ProfileThread* localThread;
+static KTHREAD_LOCAL u32 localInstance;
+static KTHREAD_LOCAL u32 localDepth;
+static KTHREAD_LOCAL char localName[PROFILER_THREAD_NAME_LENGTH];
+
+// Threads with an entry in threads, which may be fewer than have asked for one.
+static u32 claimed_thread_count(ProfilerState* state) {
+    u32 count = katomic_load_u32(&state->threadCount);
+    return count < state->config.maxThreads ? count : state->config.maxThreads;
+}
+
+b8 profiler_initialize(u64* memoryRequirement, void* state, ProfilerConfig config) {
+    if (config.eventsPerThread == 0) {
+        config.eventsPerThread = PROFILER_DEFAULT_EVENTS_PER_THREAD;
+    }
+    if (config.maxThreads == 0) {
+        config.maxThreads = PROFILER_DEFAULT_MAX_THREADS;
+    }
+    *memoryRequirement = sizeof(ProfilerState) + sizeof(ProfileThread) * config.maxThreads;
+    if (state == 0) {
+        return true;
+    }
+    kzero_memory(state, *memoryRequirement);
+    ProfilerState* s = state;
+    s->config = config;
+    s->instance = ++lastInstance;
+    s->threads = (ProfileThread*)((u8*)state + sizeof(ProfilerState));
+    statePtr = s;
+
+    if (config.startupCaptureFrames) {
+        profiler_begin_capture(config.startupCaptureFrames);
+    }
+    return true;
+}
+
+void profiler_shutdown(void* state) {
+    if (!statePtr) {
+        return;
+    }
+    if (katomic_load_u32(&statePtr->capturing)) {
+        profiler_end_capture();
+    }
+    u32 threadCount = claimed_thread_count(statePtr);
+    for (u32 i = 0; i < threadCount; ++i) {
+        ProfileThread* thread = &statePtr->threads[i];
+        if (katomic_load_u32(&thread->ready)) {
+            kfree(thread->events, sizeof(ProfileEvent) * statePtr->config.eventsPerThread, MEMORY_TAG_PROFILER);
+        }
+    }
+    statePtr = 0;
+}
+
+// Obtains the calling thread's buffer, claiming one the first time. 0 if there are none left.
+static ProfileThread* current_thread(ProfilerState* state) {
+    if (localInstance == state->instance) {
+        return localThread;
+    }
+    localInstance = state->instance;
+    localThread = 0;
+
+    u32 index = katomic_fetch_add_u32(&state->threadCount, 1);
+    if (index >= state->config.maxThreads) {
+        KWARN_LIMITED("Profiler has no room for more than %u threads; zones on this one are not recorded.", state->config.maxThreads);
+        return 0;
+    }
+    ProfileThread* thread = &state->threads[index];
+    thread->events = kallocate(sizeof(ProfileEvent) * state->config.eventsPerThread, MEMORY_TAG_PROFILER);
+    thread->threadId = platform_thread_current_id();
+    if (localName[0]) {
+        string_ncopy(thread->name, localName, PROFILER_THREAD_NAME_LENGTH - 1);
+    } else {
+        string_format(thread->name, "Thread %u", index);
+    }
+    katomic_store_u32(&thread->ready, true);
+    localThread = thread;
+    return thread;
+}
+
+static void record(ProfilerState* state, const char* name, u64 start, u64 end, ProfileEventType type) {
+    ProfileThread* thread = current_thread(state);
+    if (!thread) {
+        return;
+    }
+    u32 generation = katomic_load_u32(&state->generation);
+    u32 count = thread->count;
+    if (thread->generation != generation) {
+        katomic_store_u32(&thread->count, 0);
+        katomic_store_u32(&thread->generation, generation);
+        count = 0;
+    }
+    if (count >= state->config.eventsPerThread) {
+        katomic_fetch_add_u64(&state->dropped, 1);
+        return;
+    }
+    ProfileEvent* event = &thread->events[count];
+    event->name = name;
+    event->start = start;
+    event->end = end;
+    event->type = type;
+    event->depth = localDepth;
+    katomic_store_u32(&thread->count, count + 1);
+}
+
+b8 profiler_begin_capture(u32 frameCount) {
+    ProfilerState* state = statePtr;
+    if (!state) {
+        return false;
+    }
+    if (katomic_load_u32(&state->capturing)) {
+        KWARN("profiler_begin_capture - A capture is already in progress.");
+        return false;
+    }
+    katomic_store_u64(&state->dropped, 0);
+    state->captureFrames = frameCount;
+    state->capturedFrames = 0;
+    state->captureStart = platform_get_timestamp();
+    katomic_fetch_add_u32(&state->generation, 1);
+    katomic_store_u32(&state->capturing, true);
+    KINFO("Profiler capture started.");
+    return true;
+}
+
+b8 profiler_end_capture() {
+    ProfilerState* state = statePtr;
+    if (!state || !katomic_exchange_u32(&state->capturing, false)) {
+        return false;
+    }
+    if (!state->config.tracePath) {
+        return true;
+    }
+    return profiler_export_chrome_trace(state->config.tracePath);
+}
+
+void profiler_frame_mark() {
+    ProfilerState* state = statePtr;
+    if (!state || !katomic_load_u32(&state->capturing)) {
+        return;
+    }
+    u64 now = platform_get_timestamp();
+    record(state, "Frame", now, now, PROFILE_EVENT_FRAME);
+    state->capturedFrames++;
+    if (state->captureFrames && state->capturedFrames > state->captureFrames) {
+        profiler_end_capture();
+    }
+}
+
+void profiler_set_thread_name(const char* name) {
+    string_ncopy(localName, name, PROFILER_THREAD_NAME_LENGTH - 1);
+    localName[PROFILER_THREAD_NAME_LENGTH - 1] = 0;
+}
+
+ProfileZone profiler_zone_begin(const char* name) {
+    ProfileZone zone;
+    zone.name = name;
+    zone.start = 0;
+    ProfilerState* state = statePtr;
+    if (state && __atomic_load_n(&state->capturing, __ATOMIC_RELAXED)) {
+        zone.start = platform_get_timestamp();
+        localDepth++;
+    }
+    return zone;
+}
+
+void profiler_zone_end(ProfileZone* zone) {
+    if (!zone->start) {
+        return;
+    }
+    u64 end = platform_get_timestamp();
+    localDepth--;
+    ProfilerState* state = statePtr;
+    if (state) {
+        record(state, zone->name, zone->start, end, PROFILE_EVENT_ZONE);
+    }
+}
+
+void profiler_get_stats(ProfilerStats* outStats) {
+    kzero_memory(outStats, sizeof(ProfilerStats));
+    ProfilerState* state = statePtr;
+    if (!state) {
+        return;
+    }
+    outStats->capturing = katomic_load_u32(&state->capturing) != 0;
+    outStats->threadCount = claimed_thread_count(state);
+    outStats->droppedCount = katomic_load_u64(&state->dropped);
+    u32 generation = katomic_load_u32(&state->generation);
+    for (u32 i = 0; i < outStats->threadCount; ++i) {
+        ProfileThread* thread = &state->threads[i];
+        if (katomic_load_u32(&thread->ready) && katomic_load_u32(&thread->generation) == generation) {
+            outStats->eventCount += katomic_load_u32(&thread->count);
+        }
+    }
+}
+
+typedef struct TraceWriter {
+    FileHandle file;
+    char* buffer;
+    u64 length;
+    b8 failed;
+} TraceWriter;
+
+static void trace_flush(TraceWriter* writer) {
+    u64 written = 0;
+    if (writer->length && !filesystem_write(&writer->file, writer->length, writer->buffer, &written)) {
+        writer->failed = true;
+    }
+    writer->length = 0;
+}
+
+// Appends a formatted string, writing out the buffer first if it might not fit.
+static void trace_write(TraceWriter* writer, const char* format, ...) {
+    // Nothing written here is anywhere near this long.
+    if (writer->length + 512 > PROFILER_WRITE_BUFFER_SIZE) {
+        trace_flush(writer);
+    }
+    __builtin_va_list args;
+    va_start(args, format);
+    i32 length = string_nformat_v(writer->buffer + writer->length, PROFILER_WRITE_BUFFER_SIZE - writer->length, format, args);
+    va_end(args);
+    if (length > 0) {
+        writer->length += length;
+    }
+}
+
+// Appends a name as a JSON string, escaping what JSON requires.
+static void trace_write_name(TraceWriter* writer, const char* name) {
+    char escaped[256];
+    u32 length = 0;
+    for (const char* c = name; *c && length < sizeof(escaped) - 2; ++c) {
+        if (*c == '"' || *c == '\\') {
+            escaped[length++] = '\\';
+        } else if ((u8)*c < 0x20) {
+            continue;
+        }
+        escaped[length++] = *c;
+    }
+    escaped[length] = 0;
+    trace_write(writer, "\"%s\"", escaped);
+}
+
+b8 profiler_export_chrome_trace(const char* path) {
+    ProfilerState* state = statePtr;
+    if (!state || !path) {
+        return false;
+    }
+    TraceWriter writer = {0};
+    if (!filesystem_open(path, FILE_MODE_WRITE, false, &writer.file)) {
+        KERROR("profiler_export_chrome_trace - Unable to open '%s' for writing.", path);
+        return false;
+    }
+    writer.buffer = kallocate(PROFILER_WRITE_BUFFER_SIZE, MEMORY_TAG_PROFILER);
+
+    trace_write(&writer, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    u64 eventCount = 0;
+    u32 generation = katomic_load_u32(&state->generation);
+    u32 threadCount = claimed_thread_count(state);
+    for (u32 i = 0; i < threadCount; ++i) {
+        ProfileThread* thread = &state->threads[i];
+        if (!katomic_load_u32(&thread->ready)) {
+            continue;
+        }
+        trace_write(&writer, "%s{\"ph\":\"M\",\"pid\":1,\"tid\":%llu,\"name\":\"thread_name\",\"args\":{\"name\":",
+                    eventCount ? ",\n" : "", thread->threadId);
+        trace_write_name(&writer, thread->name);
+        trace_write(&writer, "}}");
+        eventCount++;
+
+        if (katomic_load_u32(&thread->generation) != generation) {
+            continue;
+        }
+        u32 count = katomic_load_u32(&thread->count);
+        for (u32 e = 0; e < count; ++e) {
+            const ProfileEvent* event = &thread->events[e];
+            // Times are in microseconds from the start of the capture. Zones begun before it are clamped to it.
+            u64 start = event->start > state->captureStart ? event->start - state->captureStart : 0;
+            u64 end = event->end > state->captureStart ? event->end - state->captureStart : 0;
+            trace_write(&writer, ",\n{\"name\":");
+            trace_write_name(&writer, event->name);
+            if (event->type == PROFILE_EVENT_FRAME) {
+                trace_write(&writer, ",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":%llu,\"ts\":%llu.%03llu}",
+                            thread->threadId, start / 1000, start % 1000);
+            } else {
+                u64 duration = end - start;
+                trace_write(&writer, ",\"ph\":\"X\",\"pid\":1,\"tid\":%llu,\"ts\":%llu.%03llu,\"dur\":%llu.%03llu,\"args\":{\"depth\":%u}}",
+                            thread->threadId, start / 1000, start % 1000, duration / 1000, duration % 1000, event->depth);
+            }
+            eventCount++;
+        }
+    }
+    trace_write(&writer, "\n]}\n");
+    trace_flush(&writer);
+    b8 result = !writer.failed;
+
+    kfree(writer.buffer, PROFILER_WRITE_BUFFER_SIZE, MEMORY_TAG_PROFILER);
+    filesystem_close(&writer.file);
+    if (result) {
+        KINFO("Profiler wrote %llu events to '%s'.", eventCount, path);
+    } else {
+        KERROR("profiler_export_chrome_trace - Failed writing to '%s'.", path);
+    }
+    return result;
+}
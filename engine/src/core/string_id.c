@@ -0,0 +1,11 @@
+#include "core/string_id.h"
+
+u64 string_id(const char* str) {
+    u64 hash = STRING_ID_OFFSET_BASIS;
+    for (; *str; ++str) {
+        char c = *str;
+        hash ^= (u8)((c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c);
+        hash *= STRING_ID_PRIME;
+    }
+    return hash;
+}
@@ -0,0 +1,157 @@
+#include "core/string_intern.h"
+
+#include "core/logger.h"
+#include "core/kstring.h"
+#include "containers/hash.h"
+#include "memory/kmemory.h"
+#include "memory/virtual_arena.h"
+#include "core/profiler.h"
+
+typedef struct StringInternState {
+    StringInternConfig config;
+    // Holds the characters of every string.
+    VirtualArena characters;
+    u32 count;
+    // The string of each id.
+    const char** strings;
+    // The case-insensitive hash of each id.
+    u64* hashes;
+    // Open-addressing index from hash to id. Twice the string count, so probes stay short.
+    u32 indexCapacity;
+    u32* index;
+} StringInternState;
+
+static StringInternState* statePtr = 0;
+
+// Hashes the lowercase form of str, so that strings differing only in case collide exactly.
+static b8 hash_lowercase(const char* str, u64* outHash, u64* outLength) {
+    char lower[STRING_INTERN_MAX_LENGTH + 1];
+    u64 length = 0;
+    for (; str[length]; ++length) {
+        if (length == STRING_INTERN_MAX_LENGTH) {
+            KERROR("string_intern - '%.32s...' is longer than STRING_INTERN_MAX_LENGTH (%u).", str, STRING_INTERN_MAX_LENGTH);
+            return false;
+        }
+        char c = str[length];
+        lower[length] = (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+    }
+    *outHash = hash_bytes(lower, length, 0);
+    *outLength = length;
+    return true;
+}
+
+// Returns the index slot holding the string, or the empty slot where it belongs.
+static u32 find_slot(const char* str, u64 hash) {
+    u32 mask = statePtr->indexCapacity - 1;
+    u32 slot = (u32)hash & mask;
+    while (true) {
+        u32 id = statePtr->index[slot];
+        if (id == INVALID_ID || (statePtr->hashes[id] == hash && strings_equali(statePtr->strings[id], str))) {
+            return slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+b8 string_intern_initialize(u64* memoryRequirement, void* state, StringInternConfig config) {
+    if (config.maxStringCount == 0 || config.maxStringBytes == 0) {
+        KFATAL("string_intern_initialize - config.maxStringCount and config.maxStringBytes must be > 0.");
+        return false;
+    }
+    u32 indexCapacity = 1;
+    while (indexCapacity < config.maxStringCount * 2) {
+        indexCapacity <<= 1;
+    }
+
+    // Block of memory will contain state structure, then the strings, then the hashes, then the index.
+    u64 structRequirement = sizeof(StringInternState);
+    u64 stringsRequirement = sizeof(const char*) * config.maxStringCount;
+    u64 hashesRequirement = sizeof(u64) * config.maxStringCount;
+    u64 indexRequirement = sizeof(u32) * indexCapacity;
+    *memoryRequirement = structRequirement + stringsRequirement + hashesRequirement + indexRequirement;
+
+    if (!state) {
+        return true;
+    }
+    KPROFILE_SCOPE("string_intern_initialize");
+
+    statePtr = state;
+    kzero_memory(statePtr, structRequirement);
+    statePtr->config = config;
+    statePtr->strings = (const char**)((u8*)state + structRequirement);
+    statePtr->hashes = (u64*)((u8*)statePtr->strings + stringsRequirement);
+    statePtr->index = (u32*)((u8*)statePtr->hashes + hashesRequirement);
+    statePtr->indexCapacity = indexCapacity;
+    kset_memory(statePtr->index, 0xFF, indexRequirement);
+
+    if (!virtual_arena_create(config.maxStringBytes, false, &statePtr->characters)) {
+        KFATAL("string_intern_initialize - failed to reserve memory for the strings.");
+        statePtr = 0;
+        return false;
+    }
+
+    // The empty string always comes first.
+    if (string_intern("") != STRING_ID_EMPTY) {
+        KFATAL("string_intern_initialize - failed to intern the empty string.");
+        return false;
+    }
+    return true;
+}
+
+void string_intern_shutdown(void* state) {
+    if (statePtr) {
+        KDEBUG("String intern table held %u strings in %llu bytes.", statePtr->count, statePtr->characters.allocated);
+        virtual_arena_destroy(&statePtr->characters);
+        statePtr = 0;
+    }
+}
+
+u32 string_intern(const char* str) {
+    if (!statePtr || !str) {
+        KERROR("string_intern called before initialization or with a null string.");
+        return INVALID_ID;
+    }
+    u64 hash, length;
+    if (!hash_lowercase(str, &hash, &length)) {
+        return INVALID_ID;
+    }
+    u32 slot = find_slot(str, hash);
+    if (statePtr->index[slot] != INVALID_ID) {
+        return statePtr->index[slot];
+    }
+
+    if (statePtr->count == statePtr->config.maxStringCount) {
+        KERROR("string_intern - table is full (%u strings). Adjust configuration to allow more.", statePtr->count);
+        return INVALID_ID;
+    }
+    char* copy = virtual_arena_allocate_aligned(&statePtr->characters, length + 1, 1);
+    if (!copy) {
+        KERROR("string_intern - out of space for string characters. Adjust configuration to allow more.");
+        return INVALID_ID;
+    }
+    kcopy_memory(copy, str, length + 1);
+
+    u32 id = statePtr->count++;
+    statePtr->strings[id] = copy;
+    statePtr->hashes[id] = hash;
+    statePtr->index[slot] = id;
+    return id;
+}
+
+u32 string_intern_find(const char* str) {
+    if (!statePtr || !str) {
+        return INVALID_ID;
+    }
+    u64 hash, length;
+    if (!hash_lowercase(str, &hash, &length)) {
+        return INVALID_ID;
+    }
+    return statePtr->index[find_slot(str, hash)];
+}
+
+const char* string_intern_get(u32 id) {
+    if (!statePtr || id >= statePtr->count) {
+        return "";
+    }
+    return statePtr->strings[id];
+}
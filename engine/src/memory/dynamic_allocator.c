@@ -0,0 +1,253 @@
+#define KLOG_CHANNEL LOG_CHANNEL_MEMORY
+
+#include "memory/dynamic_allocator.h"
+#include "memory/kmemory.h"
+#include "core/logger.h"
+
+#include <stddef.h>
+
+/* Block layout
+    u64 prevSize = size of the previous physical block, 0 for the first block
+    u64 size = size of this block including the header, lowest bit set when free
+    -- payload starts here for used blocks --
+    DynamicAllocatorBlock* nextFree = only valid while the block is free
+    DynamicAllocatorBlock* prevFree = only valid while the block is free
+*/
+typedef struct DynamicAllocatorBlock {
+    u64 prevSize;
+    u64 size;
+    struct DynamicAllocatorBlock* nextFree;
+    struct DynamicAllocatorBlock* prevFree;
+} DynamicAllocatorBlock;
+
+#define BLOCK_ALIGNMENT 16
+#define BLOCK_FREE_FLAG 1ULL
+#define BLOCK_HEADER_SIZE offsetof(DynamicAllocatorBlock, nextFree)
+#define BLOCK_MIN_SIZE sizeof(DynamicAllocatorBlock)
+
+#define BLOCK_SIZE(block) ((block)->size & ~BLOCK_FREE_FLAG)
+#define BLOCK_IS_FREE(block) ((block)->size & BLOCK_FREE_FLAG)
+
+static u32 bin_index(u64 size) {
+    return 63 - __builtin_clzll(size);
+}
+
+static DynamicAllocatorBlock* next_block(DynamicAllocator* allocator, DynamicAllocatorBlock* block) {
+    u8* next = (u8*)block + BLOCK_SIZE(block);
+    if (next >= (u8*)allocator->memory + allocator->totalSize) {
+        return 0;
+    }
+    return (DynamicAllocatorBlock*)next;
+}
+
+static DynamicAllocatorBlock* prev_block(DynamicAllocatorBlock* block) {
+    if (block->prevSize == 0) {
+        return 0;
+    }
+    return (DynamicAllocatorBlock*)((u8*)block - block->prevSize);
+}
+
+static void insert_free_block(DynamicAllocator* allocator, DynamicAllocatorBlock* block) {
+    u32 bin = bin_index(BLOCK_SIZE(block));
+    block->prevFree = 0;
+    block->nextFree = allocator->bins[bin];
+    if (block->nextFree) {
+        block->nextFree->prevFree = block;
+    }
+    allocator->bins[bin] = block;
+    allocator->binMask |= (1ULL << bin);
+}
+
+static void remove_free_block(DynamicAllocator* allocator, DynamicAllocatorBlock* block) {
+    u32 bin = bin_index(BLOCK_SIZE(block));
+    if (block->prevFree) {
+        block->prevFree->nextFree = block->nextFree;
+    } else {
+        allocator->bins[bin] = block->nextFree;
+    }
+    if (block->nextFree) {
+        block->nextFree->prevFree = block->prevFree;
+    }
+    if (!allocator->bins[bin]) {
+        allocator->binMask &= ~(1ULL << bin);
+    }
+}
+
+b8 dynamic_allocator_create(u64 totalSize, void* memory, DynamicAllocator* allocator) {
+    if (!allocator) {
+        KERROR("dynamic_allocator_create requires a valid pointer to hold the allocator.");
+        return false;
+    }
+    kzero_memory(allocator, sizeof(DynamicAllocator));
+
+    allocator->ownsMemory = memory == 0;
+    if (!memory) {
+        memory = kallocate(totalSize, MEMORY_TAG_DYNAMIC_ALLOCATOR);
+    }
+
+    // Make sure every block, and therefore every payload, starts on an aligned address.
+    u64 padding = (BLOCK_ALIGNMENT - ((u64)memory & (BLOCK_ALIGNMENT - 1))) & (BLOCK_ALIGNMENT - 1);
+    u64 usable = totalSize > padding ? (totalSize - padding) & ~(u64)(BLOCK_ALIGNMENT - 1) : 0;
+    if (usable < BLOCK_MIN_SIZE) {
+        KERROR("dynamic_allocator_create - totalSize of %lluB is too small to be managed.", totalSize);
+        if (allocator->ownsMemory) {
+            kfree(memory, totalSize, MEMORY_TAG_DYNAMIC_ALLOCATOR);
+        }
+        kzero_memory(allocator, sizeof(DynamicAllocator));
+        return false;
+    }
+
+    allocator->memory = (u8*)memory + padding;
+    allocator->totalSize = usable;
+
+    // The whole range starts out as a single free block.
+    DynamicAllocatorBlock* block = allocator->memory;
+    block->prevSize = 0;
+    block->size = usable | BLOCK_FREE_FLAG;
+    insert_free_block(allocator, block);
+    return true;
+}
+
+void dynamic_allocator_destroy(DynamicAllocator* allocator) {
+    if (allocator) {
+        if (allocator->ownsMemory && allocator->memory) {
+            // The original size and address are not retained, so recover them from the alignment padding.
+            u64 padding = (u64)allocator->memory & (BLOCK_ALIGNMENT - 1);
+            kfree((u8*)allocator->memory - padding, allocator->totalSize + padding, MEMORY_TAG_DYNAMIC_ALLOCATOR);
+        }
+        kzero_memory(allocator, sizeof(DynamicAllocator));
+    }
+}
+
+void* dynamic_allocator_allocate(DynamicAllocator* allocator, u64 size) {
+    if (!allocator || !allocator->memory || size == 0) {
+        return 0;
+    }
+
+    u64 needed = (size + BLOCK_HEADER_SIZE + (BLOCK_ALIGNMENT - 1)) & ~(u64)(BLOCK_ALIGNMENT - 1);
+    if (needed < BLOCK_MIN_SIZE) {
+        needed = BLOCK_MIN_SIZE;
+    }
+    if (needed < size) {
+        // Overflowed.
+        return 0;
+    }
+
+    // Look for a fit within the block's own size class first.
+    u32 bin = bin_index(needed);
+    DynamicAllocatorBlock* block = 0;
+    for (DynamicAllocatorBlock* b = allocator->bins[bin]; b; b = b->nextFree) {
+        if (BLOCK_SIZE(b) >= needed) {
+            block = b;
+            break;
+        }
+    }
+
+    // Otherwise any block from a larger class is guaranteed to fit.
+    if (!block) {
+        u64 larger = allocator->binMask & ~((2ULL << bin) - 1);
+        if (bin == 63 || !larger) {
+            return 0;
+        }
+        block = allocator->bins[__builtin_ctzll(larger)];
+    }
+
+    remove_free_block(allocator, block);
+
+    // Split off the remainder if it is big enough to hold a block of its own.
+    u64 blockSize = BLOCK_SIZE(block);
+    if (blockSize - needed >= BLOCK_MIN_SIZE) {
+        DynamicAllocatorBlock* remainder = (DynamicAllocatorBlock*)((u8*)block + needed);
+        remainder->prevSize = needed;
+        remainder->size = (blockSize - needed) | BLOCK_FREE_FLAG;
+        DynamicAllocatorBlock* next = next_block(allocator, remainder);
+        if (next) {
+            next->prevSize = blockSize - needed;
+        }
+        insert_free_block(allocator, remainder);
+        blockSize = needed;
+    }
+
+    block->size = blockSize;
+    allocator->allocated += blockSize;
+    allocator->allocationCount++;
+    return (u8*)block + BLOCK_HEADER_SIZE;
+}
+
+b8 dynamic_allocator_free(DynamicAllocator* allocator, void* block) {
+    if (!dynamic_allocator_owns(allocator, block)) {
+        KERROR("dynamic_allocator_free - block %p does not belong to this allocator.", block);
+        return false;
+    }
+
+    DynamicAllocatorBlock* b = (DynamicAllocatorBlock*)((u8*)block - BLOCK_HEADER_SIZE);
+    if (BLOCK_IS_FREE(b)) {
+        KERROR("dynamic_allocator_free - block %p has already been freed.", block);
+        return false;
+    }
+
+    u64 size = BLOCK_SIZE(b);
+    allocator->allocated -= size;
+    allocator->allocationCount--;
+
+    // Coalesce with the following block.
+    DynamicAllocatorBlock* next = next_block(allocator, b);
+    if (next && BLOCK_IS_FREE(next)) {
+        remove_free_block(allocator, next);
+        size += BLOCK_SIZE(next);
+    }
+
+    // Coalesce with the preceding block.
+    DynamicAllocatorBlock* prev = prev_block(b);
+    if (prev && BLOCK_IS_FREE(prev)) {
+        remove_free_block(allocator, prev);
+        size += BLOCK_SIZE(prev);
+        b = prev;
+    }
+
+    b->size = size | BLOCK_FREE_FLAG;
+    next = next_block(allocator, b);
+    if (next) {
+        next->prevSize = size;
+    }
+    insert_free_block(allocator, b);
+    return true;
+}
+
+b8 dynamic_allocator_owns(DynamicAllocator* allocator, const void* block) {
+    if (!allocator || !allocator->memory) {
+        return false;
+    }
+    const u8* start = (const u8*)allocator->memory;
+    return (const u8*)block >= start + BLOCK_HEADER_SIZE && (const u8*)block < start + allocator->totalSize;
+}
+
+u64 dynamic_allocator_block_size(DynamicAllocator* allocator, const void* block) {
+    if (!dynamic_allocator_owns(allocator, block)) {
+        return 0;
+    }
+    const DynamicAllocatorBlock* b = (const DynamicAllocatorBlock*)((const u8*)block - BLOCK_HEADER_SIZE);
+    return BLOCK_SIZE(b) - BLOCK_HEADER_SIZE;
+}
+
+u64 dynamic_allocator_free_space(DynamicAllocator* allocator) {
+    if (!allocator) {
+        return 0;
+    }
+    return allocator->totalSize - allocator->allocated;
+}
+
+u64 dynamic_allocator_largest_free_block(DynamicAllocator* allocator) {
+    if (!allocator || !allocator->binMask) {
+        return 0;
+    }
+    // Only the highest non-empty bin can contain the largest block.
+    u32 bin = 63 - __builtin_clzll(allocator->binMask);
+    u64 largest = 0;
+    for (DynamicAllocatorBlock* b = allocator->bins[bin]; b; b = b->nextFree) {
+        if (BLOCK_SIZE(b) > largest) {
+            largest = BLOCK_SIZE(b);
+        }
+    }
+    return largest;
+}
@@ -0,0 +1,77 @@
+#define KLOG_CHANNEL LOG_CHANNEL_MEMORY
+
+#include "memory/frame_allocator.h"
+#include "memory/linear_allocator.h"
+#include "memory/kmemory.h"
+#include "core/logger.h"
+
+#define FRAME_ALLOCATOR_ALIGNMENT 16
+
+typedef struct FrameAllocatorState {
+    FrameAllocatorConfig config;
+    u8 currentFrame;
+    // Largest amount used by any single frame, for sizing the arenas.
+    u64 peakUsage;
+    LinearAllocator frames[FRAME_ALLOCATOR_MAX_FRAMES];
+} FrameAllocatorState;
+
+static FrameAllocatorState* statePtr = 0;
+
+b8 frame_allocator_initialize(u64* memoryRequirement, void* state, FrameAllocatorConfig config) {
+    if (config.frameCount == 0 || config.frameCount > FRAME_ALLOCATOR_MAX_FRAMES) {
+        KFATAL("frame_allocator_initialize - frameCount must be between 1 and %u.", FRAME_ALLOCATOR_MAX_FRAMES);
+        return false;
+    }
+    *memoryRequirement = sizeof(FrameAllocatorState);
+    if (!state) {
+        return true;
+    }
+
+    statePtr = state;
+    kzero_memory(statePtr, sizeof(FrameAllocatorState));
+    statePtr->config = config;
+    for (u8 i = 0; i < config.frameCount; ++i) {
+        linear_allocator_create(config.frameSize, 0, &statePtr->frames[i]);
+    }
+    return true;
+}
+
+void frame_allocator_shutdown(void* state) {
+    if (statePtr) {
+        u64 used = statePtr->frames[statePtr->currentFrame].allocated;
+        if (used > statePtr->peakUsage) {
+            statePtr->peakUsage = used;
+        }
+        KDEBUG("Frame allocator peak usage: %lluB of %lluB per frame.", statePtr->peakUsage, statePtr->frames[0].totalSize);
+        for (u8 i = 0; i < statePtr->config.frameCount; ++i) {
+            linear_allocator_destroy(&statePtr->frames[i]);
+        }
+        statePtr = 0;
+    }
+}
+
+void frame_allocator_begin_frame() {
+    if (statePtr) {
+        u64 used = statePtr->frames[statePtr->currentFrame].allocated;
+        if (used > statePtr->peakUsage) {
+            statePtr->peakUsage = used;
+        }
+        statePtr->currentFrame = (statePtr->currentFrame + 1) % statePtr->config.frameCount;
+        linear_allocator_free_all(&statePtr->frames[statePtr->currentFrame]);
+    }
+}
+
+void* frame_allocate(u64 size) {
+    if (!statePtr) {
+        KERROR("frame_allocate called before the frame allocator was initialized.");
+        return 0;
+    }
+    return linear_allocator_allocate_aligned(&statePtr->frames[statePtr->currentFrame], size, FRAME_ALLOCATOR_ALIGNMENT);
+}
+
+u64 frame_allocator_used() {
+    if (!statePtr) {
+        return 0;
+    }
+    return statePtr->frames[statePtr->currentFrame].allocated;
+}
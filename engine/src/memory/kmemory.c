@@ -1,20 +1,43 @@
+#define KLOG_CHANNEL LOG_CHANNEL_MEMORY
+
 #include "memory/kmemory.h"
+#include "memory/dynamic_allocator.h"
+#include "memory/pool_allocator.h"
 
+#include "core/kstring.h"
 #include "core/logger.h"
 #include "platform/platform.h"
+#include "platform/atomic.h"
+#include "platform/thread.h"
 
 #include <string.h>
 #include <stdio.h>
 
+// The functions below are the untracked implementations that the tracking macros wrap.
+#if KMEMORY_TRACKING
+#undef kallocate
+#undef kfree
+#undef kreallocate
+#undef kallocate_aligned
+#undef kfree_aligned
+#undef kallocate_pooled
+#undef kfree_pooled
+#endif
+
 struct MemoryStats {
     u64 totalAllocated;
     u64 taggedAllocations[MEMORY_TAG_MAX_TAGS];
+    // Live blocks from kallocate_aligned, and the bytes reserved beyond their size to align them.
+    u64 alignedAllocations;
+    u64 alignmentOverhead;
 };
 
 static const char* memoryTagStrings[MEMORY_TAG_MAX_TAGS] = {
     "UNKNOWN         ",
     "ARRAY           ",
     "LINEAR_ALLOCATOR",
+    "DYNAMIC_ALLOC   ",
+    "POOL_ALLOCATOR  ",
     "DARRAY          ",
     "DICT            ",
     "RING_QUEUE      ",
@@ -29,16 +52,114 @@ static const char* memoryTagStrings[MEMORY_TAG_MAX_TAGS] = {
     "TRANSFORM       ",
     "ENTITY          ",
     "ENTITY_NODE     ",
-    "SCENE           "};
+    "SCENE           ",
+    "PROFILER        "};
+
+
+// Size classes for pooled allocations: 16, 32, 64 ... 4096 bytes.
+#define MEMORY_POOL_SIZE_CLASS_COUNT 9
+#define MEMORY_POOL_MIN_ELEMENT_SIZE 16
+#define MEMORY_POOL_PAGE_SIZE (64 * 1024)
+
+// Alignment of every block handed out by the heap.
+#define MEMORY_HEAP_ALIGNMENT 16
+
+// Each thread keeps up to this many freed blocks per size class before handing half back to the shared pool.
+#define MEMORY_THREAD_CACHE_LIMIT 64
+// Number of blocks a thread takes from the shared pool at once when its cache is empty.
+#define MEMORY_THREAD_CACHE_REFILL 16
 
+// Stats are shared by every thread, so they are only ever touched atomically.
+#define STAT_ADD(stat, value) __atomic_fetch_add(&(stat), (value), __ATOMIC_RELAXED)
+#define STAT_SUB(stat, value) __atomic_fetch_sub(&(stat), (value), __ATOMIC_RELAXED)
+#define STAT_GET(stat) __atomic_load_n(&(stat), __ATOMIC_RELAXED)
 
 typedef struct MemorySystemState { 
+    MemorySystemConfig config;
     struct MemoryStats stats;
     u64 allocationCount;
+    // Allocations that did not fit in the heap and went to the OS instead.
+    u64 osAllocationCount;
+    // Pooled blocks sitting in thread caches rather than in use.
+    u64 threadCachedBlocks;
+    void* heapMemory;
+    DynamicAllocator heap;
+    PoolAllocator pools[MEMORY_POOL_SIZE_CLASS_COUNT];
+    // The heap and each pool are guarded by their own lock so that threads working with
+    // different size classes do not contend. A thread that finds one taken spins briefly,
+    // then sleeps, so a holder that gets preempted does not leave the others burning CPU.
+    KMutex heapLock;
+    KMutex poolLocks[MEMORY_POOL_SIZE_CLASS_COUNT];
 } MemorySystemState;
 static MemorySystemState* statePtr;
 
-void memory_system_initialize(u64* memoryRequirements, void* state) {
+// Address space held by virtual arenas. Kept outside the state since arenas can be created
+// before the memory system, the systems arena among them.
+static u64 virtualReserved = 0;
+static u64 virtualCommitted = 0;
+
+// Bumped each time the memory system is initialized. Thread caches filled under an earlier
+// epoch point into pools that no longer exist and are discarded.
+static u32 memoryEpoch = 0;
+
+/* Per-thread free lists in front of the shared pools. Blocks freed on a thread are reused by
+   that thread without taking a lock, and are exchanged with the shared pool in batches. */
+typedef struct MemoryThreadCache {
+    u32 epoch;
+    u32 counts[MEMORY_POOL_SIZE_CLASS_COUNT];
+    void* blocks[MEMORY_POOL_SIZE_CLASS_COUNT];
+} MemoryThreadCache;
+static KTHREAD_LOCAL MemoryThreadCache threadCache;
+
+#if KMEMORY_TRACKING
+typedef struct MemoryTrackingRecord {
+    void* block;
+    u64 size;
+    u64 frame;
+    const char* file;
+    u32 line;
+    MemoryTag tag;
+} MemoryTrackingRecord;
+
+// Marks a record whose allocation has been freed, so that probing continues past it.
+#define MEMORY_TRACKING_TOMBSTONE ((void*)1)
+#define MEMORY_TRACKING_INITIAL_CAPACITY 4096
+// Most outstanding allocations listed by a single report.
+#define MEMORY_TRACKING_REPORT_LIMIT 256
+
+/* Open-addressed table of live allocations keyed by address. It is allocated straight from
+   the platform so that tracking never recurses into the allocations it tracks. */
+typedef struct MemoryTracker {
+    KMutex lock;
+    u64 capacity;
+    u64 count;
+    u64 tombstones;
+    MemoryTrackingRecord* records;
+    u64 frame;
+    u64 frameAllocations;
+    u64 frameFrees;
+    u64 lastFrameAllocations;
+    u64 lastFrameFrees;
+    u64 peakAllocations[MEMORY_TAG_MAX_TAGS];
+} MemoryTracker;
+
+static MemoryTracker tracker;
+#endif
+
+static void* heap_allocate(u64 size) {
+    platform_mutex_lock(&statePtr->heapLock);
+    void* block = dynamic_allocator_allocate(&statePtr->heap, size);
+    platform_mutex_unlock(&statePtr->heapLock);
+    return block;
+}
+
+static void heap_free(void* block) {
+    platform_mutex_lock(&statePtr->heapLock);
+    dynamic_allocator_free(&statePtr->heap, block);
+    platform_mutex_unlock(&statePtr->heapLock);
+}
+
+void memory_system_initialize(u64* memoryRequirements, void* state, MemorySystemConfig config) {
     *memoryRequirements = sizeof(MemorySystemState);
     if(state == 0){
         return;
@@ -46,13 +167,50 @@ void memory_system_initialize(u64* memoryRequirements, void* state) {
     }
     platform_zero_memory(state,sizeof(MemorySystemState));
     statePtr = state;
+    memoryEpoch++;
+    statePtr->config = config;
     statePtr->allocationCount = 0;
     platform_zero_memory(&statePtr->stats, sizeof(statePtr->stats));
+
+    // Reserve the heap that all engine allocations are carved out of.
+    if (config.totalAllocSize > 0) {
+        statePtr->heapMemory = platform_allocate(config.totalAllocSize, true);
+        if (!statePtr->heapMemory || !dynamic_allocator_create(config.totalAllocSize, statePtr->heapMemory, &statePtr->heap)) {
+            KERROR("Unable to reserve %llu bytes for the memory system heap. Falling back to OS allocations.", config.totalAllocSize);
+            if (statePtr->heapMemory) {
+                platform_free(statePtr->heapMemory, true);
+                statePtr->heapMemory = 0;
+            }
+        }
+    }
+
+    // Pools do not allocate pages until first used, so all size classes can be set up front.
+    for (u32 i = 0; i < MEMORY_POOL_SIZE_CLASS_COUNT; ++i) {
+        u64 elementSize = MEMORY_POOL_MIN_ELEMENT_SIZE << i;
+        pool_allocator_create(elementSize, MEMORY_POOL_PAGE_SIZE / elementSize, &statePtr->pools[i]);
+    }
     KDEBUG("MEMORY SUBSYSTEM INITIALIZED");
 }
 
 void memory_system_shutdown(void* state) {
-    // platform_free(statePtr,false);
+    if (statePtr) {
+        memory_thread_cache_flush();
+        for (u32 i = 0; i < MEMORY_POOL_SIZE_CLASS_COUNT; ++i) {
+            pool_allocator_destroy(&statePtr->pools[i]);
+        }
+#if KMEMORY_TRACKING
+        memory_tracking_report(false);
+        if (tracker.records) {
+            platform_free(tracker.records, false);
+        }
+        platform_zero_memory(&tracker, sizeof(MemoryTracker));
+#endif
+        if (statePtr->heapMemory) {
+            dynamic_allocator_destroy(&statePtr->heap);
+            platform_free(statePtr->heapMemory, true);
+            statePtr->heapMemory = 0;
+        }
+    }
     statePtr = 0;
 }
 
@@ -62,21 +220,48 @@ void* kallocate(u64 size, MemoryTag tag){
     }
 
     if(statePtr){
-        statePtr->allocationCount++;
-        statePtr->stats.totalAllocated += size;
-        statePtr->stats.taggedAllocations[tag] += size;
+        STAT_ADD(statePtr->allocationCount, 1);
+        STAT_ADD(statePtr->stats.totalAllocated, size);
+        STAT_ADD(statePtr->stats.taggedAllocations[tag], size);
     }
 
-    // TODO: Memory alignment
-    void* block = platform_allocate(size, false);
+    void* block = 0;
+    if (statePtr && statePtr->heapMemory) {
+        block = heap_allocate(size);
+        if (!block) {
+            STAT_ADD(statePtr->osAllocationCount, 1);
+        }
+    }
+    if (!block) {
+        block = platform_allocate(size, false);
+    }
     platform_zero_memory(block, size);
     return block;
 
 }
 
+void memory_system_track_virtual(i64 reservedDelta, i64 committedDelta){
+    STAT_ADD(virtualReserved, (u64)reservedDelta);
+    STAT_ADD(virtualCommitted, (u64)committedDelta);
+}
+
 u64 get_memory_alloc_count(){
     if(statePtr){
-        return statePtr->allocationCount;
+        return STAT_GET(statePtr->allocationCount);
+    }
+    return 0;
+}
+
+u64 get_memory_tag_usage(MemoryTag tag){
+    if(statePtr && tag < MEMORY_TAG_MAX_TAGS){
+        return STAT_GET(statePtr->stats.taggedAllocations[tag]);
+    }
+    return 0;
+}
+
+u64 get_memory_total_usage(){
+    if(statePtr){
+        return STAT_GET(statePtr->stats.totalAllocated);
     }
     return 0;
 }
@@ -86,14 +271,235 @@ void kfree(void* block, u64 size, MemoryTag tag){
         KWARN("kfree called using MEMORY_TAG_UNKNOWN. Re-class this allocation.");
     }
     if(statePtr){
-        statePtr->stats.totalAllocated -= size;
-        statePtr->stats.taggedAllocations[tag] -= size;
+        STAT_SUB(statePtr->stats.totalAllocated, size);
+        STAT_SUB(statePtr->stats.taggedAllocations[tag], size);
     }
     
+    if (statePtr && dynamic_allocator_owns(&statePtr->heap, block)) {
+        heap_free(block);
+    } else {
+        platform_free(block, false);
+    }
+
+}
+
+void* kreallocate(void* block, u64 oldSize, u64 newSize, MemoryTag tag){
+    if (!block) {
+        return kallocate(newSize, tag);
+    }
+    if (tag == MEMORY_TAG_UNKNOWN) {
+        KWARN("kreallocate called using MEMORY_TAG_UNKNOWN. Re-class this allocation.");
+    }
 
-    // TODO: Memory alignment
-    platform_free(block, false);
+    void* result = 0;
+    if (statePtr && dynamic_allocator_owns(&statePtr->heap, block)) {
+        if (dynamic_allocator_block_size(&statePtr->heap, block) >= newSize) {
+            // The block already has room, usually because it was rounded up when allocated.
+            result = block;
+        } else {
+            result = heap_allocate(newSize);
+            if (!result) {
+                STAT_ADD(statePtr->osAllocationCount, 1);
+                result = platform_allocate(newSize, false);
+            }
+            if (result) {
+                platform_copy_memory(result, block, oldSize < newSize ? oldSize : newSize);
+                heap_free(block);
+            }
+        }
+    } else {
+        result = platform_reallocate(block, newSize);
+    }
+    if (!result) {
+        KERROR("kreallocate - unable to resize block from %lluB to %lluB.", oldSize, newSize);
+        return 0;
+    }
 
+    if (newSize > oldSize) {
+        platform_zero_memory((u8*)result + oldSize, newSize - oldSize);
+    }
+    if (statePtr) {
+        STAT_ADD(statePtr->allocationCount, 1);
+        STAT_ADD(statePtr->stats.totalAllocated, newSize - oldSize);
+        STAT_ADD(statePtr->stats.taggedAllocations[tag], newSize - oldSize);
+    }
+    return result;
+}
+
+void* kallocate_aligned(u64 size, u16 alignment, MemoryTag tag){
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        KERROR("kallocate_aligned - alignment of %u is not a power of two.", alignment);
+        return 0;
+    }
+    // Heap blocks already satisfy the smaller alignments.
+    if (alignment <= MEMORY_HEAP_ALIGNMENT) {
+        void* block = kallocate(size, tag);
+        if (statePtr) {
+            STAT_ADD(statePtr->stats.alignedAllocations, 1);
+        }
+        return block;
+    }
+
+    if (tag == MEMORY_TAG_UNKNOWN) {
+        KWARN("kallocate_aligned called using MEMORY_TAG_UNKNOWN. Re-class this allocation.");
+    }
+
+    void* block = 0;
+    if (statePtr && statePtr->heapMemory) {
+        // Over-allocate and step forward to the next aligned address. Heap blocks are aligned to
+        // MEMORY_HEAP_ALIGNMENT, so there is always room just before that address for the original pointer.
+        u8* raw = heap_allocate(size + alignment);
+        if (raw) {
+            block = (void*)(((u64)raw + alignment) & ~(u64)(alignment - 1));
+            ((void**)block)[-1] = raw;
+        } else {
+            STAT_ADD(statePtr->osAllocationCount, 1);
+        }
+    }
+    if (!block) {
+        block = platform_allocate_aligned(size, alignment);
+        if (!block) {
+            KERROR("kallocate_aligned - unable to allocate %lluB aligned to %u.", size, alignment);
+            return 0;
+        }
+    }
+
+    if (statePtr) {
+        STAT_ADD(statePtr->allocationCount, 1);
+        STAT_ADD(statePtr->stats.totalAllocated, size);
+        STAT_ADD(statePtr->stats.taggedAllocations[tag], size);
+        STAT_ADD(statePtr->stats.alignedAllocations, 1);
+        STAT_ADD(statePtr->stats.alignmentOverhead, alignment);
+    }
+    platform_zero_memory(block, size);
+    return block;
+}
+
+void kfree_aligned(void* block, u64 size, u16 alignment, MemoryTag tag){
+    if (!block) {
+        return;
+    }
+    if (alignment <= MEMORY_HEAP_ALIGNMENT) {
+        if (statePtr) {
+            STAT_SUB(statePtr->stats.alignedAllocations, 1);
+        }
+        kfree(block, size, tag);
+        return;
+    }
+
+    if (tag == MEMORY_TAG_UNKNOWN) {
+        KWARN("kfree_aligned called using MEMORY_TAG_UNKNOWN. Re-class this allocation.");
+    }
+    if (statePtr) {
+        STAT_SUB(statePtr->stats.totalAllocated, size);
+        STAT_SUB(statePtr->stats.taggedAllocations[tag], size);
+        STAT_SUB(statePtr->stats.alignedAllocations, 1);
+        STAT_SUB(statePtr->stats.alignmentOverhead, alignment);
+    }
+
+    if (statePtr && dynamic_allocator_owns(&statePtr->heap, block)) {
+        heap_free(((void**)block)[-1]);
+    } else {
+        platform_free(block, true);
+    }
+}
+
+// Returns the size class for the given size, or -1 if it is too large to be pooled.
+static i32 pool_index_for_size(u64 size) {
+    if (!statePtr || size == 0 || size > (MEMORY_POOL_MIN_ELEMENT_SIZE << (MEMORY_POOL_SIZE_CLASS_COUNT - 1))) {
+        return -1;
+    }
+    return size <= MEMORY_POOL_MIN_ELEMENT_SIZE ? 0 : (64 - __builtin_clzll(size - 1)) - 4;
+}
+
+static MemoryThreadCache* get_thread_cache() {
+    if (threadCache.epoch != memoryEpoch) {
+        platform_zero_memory(&threadCache, sizeof(MemoryThreadCache));
+        threadCache.epoch = memoryEpoch;
+    }
+    return &threadCache;
+}
+
+// Moves up to count blocks of the given class from the thread cache back to the shared pool.
+static void thread_cache_release(MemoryThreadCache* cache, i32 index, u32 count) {
+    platform_mutex_lock(&statePtr->poolLocks[index]);
+    for (u32 i = 0; i < count && cache->blocks[index]; ++i) {
+        void* block = cache->blocks[index];
+        cache->blocks[index] = *(void**)block;
+        cache->counts[index]--;
+        pool_allocator_free(&statePtr->pools[index], block);
+        STAT_SUB(statePtr->threadCachedBlocks, 1);
+    }
+    platform_mutex_unlock(&statePtr->poolLocks[index]);
+}
+
+void* kallocate_pooled(u64 size, MemoryTag tag){
+    i32 index = pool_index_for_size(size);
+    if (index < 0) {
+        return kallocate(size, tag);
+    }
+
+    MemoryThreadCache* cache = get_thread_cache();
+    if (!cache->blocks[index]) {
+        // Take a batch from the shared pool so the next few allocations on this thread need no lock.
+        platform_mutex_lock(&statePtr->poolLocks[index]);
+        for (u32 i = 0; i < MEMORY_THREAD_CACHE_REFILL; ++i) {
+            void* block = pool_allocator_allocate(&statePtr->pools[index]);
+            if (!block) {
+                break;
+            }
+            *(void**)block = cache->blocks[index];
+            cache->blocks[index] = block;
+            cache->counts[index]++;
+            STAT_ADD(statePtr->threadCachedBlocks, 1);
+        }
+        platform_mutex_unlock(&statePtr->poolLocks[index]);
+        if (!cache->blocks[index]) {
+            return 0;
+        }
+    }
+
+    void* block = cache->blocks[index];
+    cache->blocks[index] = *(void**)block;
+    cache->counts[index]--;
+    STAT_SUB(statePtr->threadCachedBlocks, 1);
+    STAT_ADD(statePtr->allocationCount, 1);
+    // The bytes are already counted, as part of a pool page. Move them from the pool to the
+    // tag, so that each byte is counted once and the total is unchanged.
+    STAT_SUB(statePtr->stats.taggedAllocations[MEMORY_TAG_POOL_ALLOCATOR], size);
+    STAT_ADD(statePtr->stats.taggedAllocations[tag], size);
+    platform_zero_memory(block, size);
+    return block;
+}
+
+void kfree_pooled(void* block, u64 size, MemoryTag tag){
+    i32 index = pool_index_for_size(size);
+    if (index < 0) {
+        kfree(block, size, tag);
+        return;
+    }
+
+    STAT_SUB(statePtr->stats.taggedAllocations[tag], size);
+    STAT_ADD(statePtr->stats.taggedAllocations[MEMORY_TAG_POOL_ALLOCATOR], size);
+    MemoryThreadCache* cache = get_thread_cache();
+    *(void**)block = cache->blocks[index];
+    cache->blocks[index] = block;
+    cache->counts[index]++;
+    STAT_ADD(statePtr->threadCachedBlocks, 1);
+    if (cache->counts[index] > MEMORY_THREAD_CACHE_LIMIT) {
+        thread_cache_release(cache, index, MEMORY_THREAD_CACHE_LIMIT / 2);
+    }
+}
+
+void memory_thread_cache_flush(){
+    if (!statePtr || threadCache.epoch != memoryEpoch) {
+        return;
+    }
+    for (i32 i = 0; i < MEMORY_POOL_SIZE_CLASS_COUNT; ++i) {
+        if (threadCache.counts[i]) {
+            thread_cache_release(&threadCache, i, threadCache.counts[i]);
+        }
+    }
 }
 
 void* kzero_memory(void* block, u64 size){
@@ -116,30 +522,284 @@ char* get_memory_usage_str(){
     const u64 mib = 1024 * 1024;
     const u64 kib = 1024;
 
-    char buffer[8000] = "System memory use (tagged):\n";
+    // Each byte is counted once. Pooled blocks count under their own tag, and POOL_ALLOCATOR
+    // holds the rest of the pool pages: free blocks, size class rounding and page headers.
+    char buffer[8000] = "System memory use (tagged; pooled blocks under their tag, POOL_ALLOCATOR is unused pool space):\n";
     u64 offset = strlen(buffer);
     for (u32 i = 0; i < MEMORY_TAG_MAX_TAGS; ++i) {
         char unit[4] = "XiB";
         float amount = 1.0f;
-        if (statePtr->stats.taggedAllocations[i] >= gib) {
+        u64 tagged = STAT_GET(statePtr->stats.taggedAllocations[i]);
+        if (tagged >= gib) {
             unit[0] = 'G';
-            amount = statePtr->stats.taggedAllocations[i] / (float)gib;
-        } else if (statePtr->stats.taggedAllocations[i] >= mib) {
+            amount = tagged / (float)gib;
+        } else if (tagged >= mib) {
             unit[0] = 'M';
-            amount = statePtr->stats.taggedAllocations[i] / (float)mib;
-        } else if (statePtr->stats.taggedAllocations[i] >= kib) {
+            amount = tagged / (float)mib;
+        } else if (tagged >= kib) {
             unit[0] = 'K';
-            amount = statePtr->stats.taggedAllocations[i] / (float)kib;
+            amount = tagged / (float)kib;
         } else {
             unit[0] = 'B';
             unit[1] = 0;
-            amount = (float)statePtr->stats.taggedAllocations[i];
+            amount = (float)tagged;
         }
 
-        i32 length = snprintf(buffer + offset, 8000, "  %s: %.2f%s\n", memoryTagStrings[i], amount, unit);
+        i32 length = snprintf(buffer + offset, 8000, "  %s: %.2f%s", memoryTagStrings[i], amount, unit);
         offset += length;
+#if KMEMORY_TRACKING
+        length = snprintf(buffer + offset, 8000 - offset, " (peak %.2fKiB)", tracker.peakAllocations[i] / (f32)kib);
+        offset += length;
+#endif
+        buffer[offset++] = '\n';
+        buffer[offset] = 0;
+    }
+    if (statePtr->heapMemory) {
+        platform_mutex_lock(&statePtr->heapLock);
+        u64 heapAllocated = statePtr->heap.allocated;
+        u64 freeSpace = dynamic_allocator_free_space(&statePtr->heap);
+        u64 largestFree = dynamic_allocator_largest_free_block(&statePtr->heap);
+        platform_mutex_unlock(&statePtr->heapLock);
+        f32 fragmentation = freeSpace ? 1.0f - (largestFree / (f32)freeSpace) : 0.0f;
+        i32 length = snprintf(buffer + offset, 8000 - offset, "Heap: %.2fMiB used of %.2fMiB, largest free block %.2fMiB (%.1f%% fragmented), %llu OS fallback allocations\n",
+                              heapAllocated / (f32)mib, statePtr->heap.totalSize / (f32)mib, largestFree / (f32)mib, fragmentation * 100.0f, STAT_GET(statePtr->osAllocationCount));
+        offset += length;
+    }
+    u64 pooledCount = 0;
+    u64 pageCount = 0;
+    for (u32 i = 0; i < MEMORY_POOL_SIZE_CLASS_COUNT; ++i) {
+        platform_mutex_lock(&statePtr->poolLocks[i]);
+        pooledCount += statePtr->pools[i].allocatedCount;
+        pageCount += statePtr->pools[i].pageCount;
+        platform_mutex_unlock(&statePtr->poolLocks[i]);
+    }
+    // Blocks held in thread caches have left the pools but are not in use.
+    u64 cachedCount = STAT_GET(statePtr->threadCachedBlocks);
+    i32 length = snprintf(buffer + offset, 8000 - offset, "Pools: %llu objects in %llu pages, %llu cached by threads\n", pooledCount - cachedCount, pageCount, cachedCount);
+    offset += length;
+    length = snprintf(buffer + offset, 8000 - offset, "Aligned: %llu allocations, %.2fKiB alignment overhead\n",
+                      STAT_GET(statePtr->stats.alignedAllocations), STAT_GET(statePtr->stats.alignmentOverhead) / (f32)kib);
+    offset += length;
+    length = snprintf(buffer + offset, 8000 - offset, "Virtual arenas: %.2fMiB committed of %.2fMiB reserved\n",
+                      STAT_GET(virtualCommitted) / (f32)mib, STAT_GET(virtualReserved) / (f32)mib);
+    offset += length;
+#if KMEMORY_TRACKING
+    platform_mutex_lock(&tracker.lock);
+    length = snprintf(buffer + offset, 8000 - offset, "Tracking: frame %llu, %llu live allocations, %llu allocations and %llu frees last frame\n",
+                      tracker.frame, tracker.count, tracker.lastFrameAllocations, tracker.lastFrameFrees);
+    platform_mutex_unlock(&tracker.lock);
+    offset += length;
+#endif
+    return string_duplicate(buffer);
+
+}
+
+#if KMEMORY_TRACKING
+static u64 tracking_hash(const void* block) {
+    // Blocks are at least 8-byte aligned, so drop the low bits before mixing.
+    u64 h = (u64)block >> 3;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+static void tracking_insert(MemoryTrackingRecord* records, u64 capacity, const MemoryTrackingRecord* record) {
+    u64 i = tracking_hash(record->block) & (capacity - 1);
+    while (records[i].block && records[i].block != MEMORY_TRACKING_TOMBSTONE) {
+        i = (i + 1) & (capacity - 1);
+    }
+    records[i] = *record;
+}
+
+// Grows the table, or just clears out tombstones, once it is 70% full. Requires the tracker lock.
+static b8 tracking_reserve() {
+    if (tracker.records && (tracker.count + tracker.tombstones + 1) * 10 < tracker.capacity * 7) {
+        return true;
+    }
+    u64 capacity = tracker.capacity ? tracker.capacity : MEMORY_TRACKING_INITIAL_CAPACITY;
+    if ((tracker.count + 1) * 2 > capacity) {
+        capacity *= 2;
+    }
+    MemoryTrackingRecord* records = platform_allocate(sizeof(MemoryTrackingRecord) * capacity, false);
+    if (!records) {
+        return false;
+    }
+    platform_zero_memory(records, sizeof(MemoryTrackingRecord) * capacity);
+    for (u64 i = 0; i < tracker.capacity; ++i) {
+        if (tracker.records[i].block && tracker.records[i].block != MEMORY_TRACKING_TOMBSTONE) {
+            tracking_insert(records, capacity, &tracker.records[i]);
+        }
     }
-    char* out_string = strdup(buffer);
-    return out_string;
+    if (tracker.records) {
+        platform_free(tracker.records, false);
+    }
+    tracker.records = records;
+    tracker.capacity = capacity;
+    tracker.tombstones = 0;
+    return true;
+}
 
+static void track_allocation(void* block, u64 size, MemoryTag tag, const char* file, u32 line) {
+    if (!statePtr || !block) {
+        return;
+    }
+    platform_mutex_lock(&tracker.lock);
+    if (tracking_reserve()) {
+        MemoryTrackingRecord record = {block, size, tracker.frame, file, line, tag};
+        tracking_insert(tracker.records, tracker.capacity, &record);
+        tracker.count++;
+    }
+    tracker.frameAllocations++;
+    u64 current = STAT_GET(statePtr->stats.taggedAllocations[tag]);
+    if (current > tracker.peakAllocations[tag]) {
+        tracker.peakAllocations[tag] = current;
+    }
+    platform_mutex_unlock(&tracker.lock);
+}
+
+static void track_free(void* block, u64 size, MemoryTag tag) {
+    if (!statePtr || !block) {
+        return;
+    }
+    platform_mutex_lock(&tracker.lock);
+    tracker.frameFrees++;
+    if (tracker.records) {
+        u64 i = tracking_hash(block) & (tracker.capacity - 1);
+        while (tracker.records[i].block) {
+            MemoryTrackingRecord* record = &tracker.records[i];
+            if (record->block == block) {
+                if (record->size != size || record->tag != tag) {
+                    KWARN("Block %p allocated at %s:%u as %lluB %s was freed as %lluB %s.", block, record->file, record->line,
+                          record->size, memoryTagStrings[record->tag], size, memoryTagStrings[tag]);
+                }
+                record->block = MEMORY_TRACKING_TOMBSTONE;
+                tracker.count--;
+                tracker.tombstones++;
+                break;
+            }
+            i = (i + 1) & (tracker.capacity - 1);
+        }
+    }
+    platform_mutex_unlock(&tracker.lock);
+}
+
+void* kallocate_tracked(u64 size, MemoryTag tag, const char* file, u32 line) {
+    void* block = kallocate(size, tag);
+    track_allocation(block, size, tag, file, line);
+    return block;
+}
+
+void kfree_tracked(void* block, u64 size, MemoryTag tag) {
+    track_free(block, size, tag);
+    kfree(block, size, tag);
+}
+
+void* kreallocate_tracked(void* block, u64 oldSize, u64 newSize, MemoryTag tag, const char* file, u32 line) {
+    void* result = kreallocate(block, oldSize, newSize, tag);
+    if (result) {
+        if (block) {
+            track_free(block, oldSize, tag);
+        }
+        track_allocation(result, newSize, tag, file, line);
+    }
+    return result;
+}
+
+void* kallocate_aligned_tracked(u64 size, u16 alignment, MemoryTag tag, const char* file, u32 line) {
+    void* block = kallocate_aligned(size, alignment, tag);
+    track_allocation(block, size, tag, file, line);
+    return block;
+}
+
+void kfree_aligned_tracked(void* block, u64 size, u16 alignment, MemoryTag tag) {
+    track_free(block, size, tag);
+    kfree_aligned(block, size, alignment, tag);
+}
+
+void* kallocate_pooled_tracked(u64 size, MemoryTag tag, const char* file, u32 line) {
+    void* block = kallocate_pooled(size, tag);
+    track_allocation(block, size, tag, file, line);
+    return block;
+}
+
+void kfree_pooled_tracked(void* block, u64 size, MemoryTag tag) {
+    track_free(block, size, tag);
+    kfree_pooled(block, size, tag);
+}
+
+void memory_tracking_begin_frame() {
+    platform_mutex_lock(&tracker.lock);
+    tracker.lastFrameAllocations = tracker.frameAllocations;
+    tracker.lastFrameFrees = tracker.frameFrees;
+    tracker.frameAllocations = 0;
+    tracker.frameFrees = 0;
+    tracker.frame++;
+    platform_mutex_unlock(&tracker.lock);
+}
+
+void memory_tracking_get_summary(MemoryTrackingSummary* outSummary) {
+    platform_zero_memory(outSummary, sizeof(MemoryTrackingSummary));
+    platform_mutex_lock(&tracker.lock);
+    for (u64 i = 0; i < tracker.capacity; ++i) {
+        MemoryTrackingRecord* record = &tracker.records[i];
+        if (record->block && record->block != MEMORY_TRACKING_TOMBSTONE) {
+            outSummary->outstanding++;
+            outSummary->outstandingBytes += record->size;
+        }
+    }
+    platform_copy_memory(outSummary->peakAllocations, tracker.peakAllocations, sizeof(tracker.peakAllocations));
+    platform_mutex_unlock(&tracker.lock);
+}
+
+b8 memory_tracking_find(const void* block, const char** outFile, u32* outLine) {
+    b8 found = false;
+    platform_mutex_lock(&tracker.lock);
+    if (tracker.records && block) {
+        u64 i = tracking_hash(block) & (tracker.capacity - 1);
+        while (tracker.records[i].block) {
+            MemoryTrackingRecord* record = &tracker.records[i];
+            if (record->block == block) {
+                *outFile = record->file;
+                *outLine = record->line;
+                found = true;
+                break;
+            }
+            i = (i + 1) & (tracker.capacity - 1);
+        }
+    }
+    platform_mutex_unlock(&tracker.lock);
+    return found;
+}
+
+void memory_tracking_report(b8 currentFrameOnly) {
+    platform_mutex_lock(&tracker.lock);
+    u64 reported = 0;
+    u64 outstanding = 0;
+    u64 outstandingBytes = 0;
+    for (u64 i = 0; i < tracker.capacity; ++i) {
+        MemoryTrackingRecord* record = &tracker.records[i];
+        if (!record->block || record->block == MEMORY_TRACKING_TOMBSTONE) {
+            continue;
+        }
+        if (currentFrameOnly && record->frame != tracker.frame) {
+            continue;
+        }
+        outstanding++;
+        outstandingBytes += record->size;
+        if (reported < MEMORY_TRACKING_REPORT_LIMIT) {
+            KWARN("Outstanding allocation: %lluB %s at %s:%u in frame %llu", record->size, memoryTagStrings[record->tag], record->file, record->line, record->frame);
+            reported++;
+        }
+    }
+    platform_mutex_unlock(&tracker.lock);
+    if (outstanding > reported) {
+        KWARN("... and %llu more.", outstanding - reported);
+    }
+    if (outstanding) {
+        KWARN("%llu outstanding allocations totalling %lluB.", outstanding, outstandingBytes);
+    } else {
+        KINFO("No outstanding allocations.");
+    }
 }
+#endif
@@ -1,3 +1,5 @@
+#define KLOG_CHANNEL LOG_CHANNEL_MEMORY
+
 #include "memory/linear_allocator.h"
 #include "memory/kmemory.h"
 #include "core/logger.h"
@@ -31,16 +33,26 @@ void linear_allocator_destroy(LinearAllocator* allocator){
 }
 
 KAPI void* linear_allocator_allocate(LinearAllocator* allocator, u64 size){
+    return linear_allocator_allocate_aligned(allocator, size, LINEAR_ALLOCATOR_DEFAULT_ALIGNMENT);
+}
+
+KAPI void* linear_allocator_allocate_aligned(LinearAllocator* allocator, u64 size, u64 alignment){
 
     if (allocator && allocator->memory) {
-        if (allocator->allocated + size > allocator->totalSize) {
+        if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+            KERROR("linear_allocator_allocate_aligned - alignment of %llu is not a power of two.", alignment);
+            return 0;
+        }
+        u64 address = (u64)allocator->memory + allocator->allocated;
+        u64 padding = (alignment - (address & (alignment - 1))) & (alignment - 1);
+        if (allocator->allocated + padding + size > allocator->totalSize) {
             u64 remaining = allocator->totalSize - allocator->allocated;
             KERROR("linear_allocator_allocate - Tried to allocate %lluB, only %lluB remaining.", size, remaining);
             return 0;
         }
 
-        void* block = ((u8*)allocator->memory) + allocator->allocated;
-        allocator->allocated += size;
+        void* block = ((u8*)allocator->memory) + allocator->allocated + padding;
+        allocator->allocated += padding + size;
         return block;
     }
 
@@ -50,8 +62,9 @@ KAPI void* linear_allocator_allocate(LinearAllocator* allocator, u64 size){
 }
 KAPI void linear_allocator_free_all(LinearAllocator* allocator){
     if (allocator && allocator->memory) {
+        // Only the allocated range has been handed out, so that is all that needs clearing.
+        kzero_memory(allocator->memory, allocator->allocated);
         allocator->allocated = 0;
-        kzero_memory(allocator->memory, allocator->totalSize);
     }
 
 }
\ No newline at end of file
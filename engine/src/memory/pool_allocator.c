@@ -0,0 +1,83 @@
+#define KLOG_CHANNEL LOG_CHANNEL_MEMORY
+
+#include "memory/pool_allocator.h"
+#include "memory/kmemory.h"
+#include "core/logger.h"
+
+// Keeps elements 16-byte aligned behind the page link.
+#define POOL_PAGE_HEADER_SIZE 16
+
+static u64 page_size(PoolAllocator* pool) {
+    return POOL_PAGE_HEADER_SIZE + pool->elementSize * pool->elementsPerPage;
+}
+
+static b8 add_page(PoolAllocator* pool) {
+    u8* page = kallocate(page_size(pool), MEMORY_TAG_POOL_ALLOCATOR);
+    if (!page) {
+        return false;
+    }
+    *(void**)page = pool->pages;
+    pool->pages = page;
+    pool->pageCount++;
+
+    // Thread the new elements onto the free list back to front so they are handed out in address order.
+    u8* elements = page + POOL_PAGE_HEADER_SIZE;
+    for (u64 i = pool->elementsPerPage; i > 0; --i) {
+        void** element = (void**)(elements + (i - 1) * pool->elementSize);
+        *element = pool->freeList;
+        pool->freeList = element;
+    }
+    return true;
+}
+
+b8 pool_allocator_create(u64 elementSize, u64 elementsPerPage, PoolAllocator* pool) {
+    if (!pool || elementSize == 0 || elementsPerPage == 0) {
+        KERROR("pool_allocator_create requires a pool, and elementSize and elementsPerPage must be non-zero.");
+        return false;
+    }
+    kzero_memory(pool, sizeof(PoolAllocator));
+    // Each free element must be able to hold the free list link.
+    pool->elementSize = (elementSize + 7) & ~7ULL;
+    pool->elementsPerPage = elementsPerPage;
+    return true;
+}
+
+void pool_allocator_destroy(PoolAllocator* pool) {
+    if (pool) {
+        if (pool->allocatedCount > 0) {
+            KWARN("pool_allocator_destroy - %llu elements of %lluB are still allocated.", pool->allocatedCount, pool->elementSize);
+        }
+        void* page = pool->pages;
+        u64 size = page_size(pool);
+        while (page) {
+            void* next = *(void**)page;
+            kfree(page, size, MEMORY_TAG_POOL_ALLOCATOR);
+            page = next;
+        }
+        kzero_memory(pool, sizeof(PoolAllocator));
+    }
+}
+
+void* pool_allocator_allocate(PoolAllocator* pool) {
+    if (!pool || pool->elementSize == 0) {
+        KERROR("pool_allocator_allocate - provided pool not initialized.");
+        return 0;
+    }
+    if (!pool->freeList && !add_page(pool)) {
+        KERROR("pool_allocator_allocate - unable to allocate a new page.");
+        return 0;
+    }
+    void** element = pool->freeList;
+    pool->freeList = *element;
+    pool->allocatedCount++;
+    return element;
+}
+
+void pool_allocator_free(PoolAllocator* pool, void* block) {
+    if (!pool || !block) {
+        return;
+    }
+    *(void**)block = pool->freeList;
+    pool->freeList = block;
+    pool->allocatedCount--;
+}
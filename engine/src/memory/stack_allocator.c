@@ -0,0 +1,73 @@
+#define KLOG_CHANNEL LOG_CHANNEL_MEMORY
+
+#include "memory/stack_allocator.h"
+#include "memory/kmemory.h"
+#include "core/logger.h"
+
+void stack_allocator_create(u64 totalSize, void* memory, StackAllocator* allocator) {
+    if (allocator) {
+        linear_allocator_create(totalSize, memory, &allocator->linear);
+        allocator->peak = 0;
+    }
+}
+
+void stack_allocator_destroy(StackAllocator* allocator) {
+    if (allocator) {
+        linear_allocator_destroy(&allocator->linear);
+        allocator->peak = 0;
+    }
+}
+
+void* stack_allocator_allocate(StackAllocator* allocator, u64 size) {
+    return stack_allocator_allocate_aligned(allocator, size, STACK_ALLOCATOR_DEFAULT_ALIGNMENT);
+}
+
+void* stack_allocator_allocate_aligned(StackAllocator* allocator, u64 size, u64 alignment) {
+    if (!allocator) {
+        KERROR("stack_allocator_allocate - provided allocator not initialized.");
+        return 0;
+    }
+    void* block = linear_allocator_allocate_aligned(&allocator->linear, size, alignment);
+    if (block && allocator->linear.allocated > allocator->peak) {
+        allocator->peak = allocator->linear.allocated;
+    }
+    return block;
+}
+
+u64 stack_allocator_get_marker(StackAllocator* allocator) {
+    return allocator ? allocator->linear.allocated : 0;
+}
+
+void stack_allocator_free_to_marker(StackAllocator* allocator, u64 marker) {
+    if (!allocator) {
+        return;
+    }
+    if (marker > allocator->linear.allocated) {
+        KERROR("stack_allocator_free_to_marker - marker %llu is above the top of the stack (%llu). Markers must be freed in reverse order.", marker, allocator->linear.allocated);
+        return;
+    }
+    // Unlike linear_allocator_free_all, freed memory is not zeroed; callers only ever see it as scratch.
+    allocator->linear.allocated = marker;
+}
+
+b8 stack_allocator_owns(StackAllocator* allocator, const void* block) {
+    if (!allocator || !allocator->linear.memory) {
+        return false;
+    }
+    const u8* start = allocator->linear.memory;
+    return (const u8*)block >= start && (const u8*)block < start + allocator->linear.totalSize;
+}
+
+StackAllocatorScope stack_allocator_scope_begin(StackAllocator* allocator) {
+    StackAllocatorScope scope;
+    scope.allocator = allocator;
+    scope.marker = stack_allocator_get_marker(allocator);
+    return scope;
+}
+
+void stack_allocator_scope_end(StackAllocatorScope* scope) {
+    if (scope && scope->allocator) {
+        stack_allocator_free_to_marker(scope->allocator, scope->marker);
+        scope->allocator = 0;
+    }
+}
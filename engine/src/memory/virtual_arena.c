@@ -0,0 +1,105 @@
+#define KLOG_CHANNEL LOG_CHANNEL_MEMORY
+
+#include "memory/virtual_arena.h"
+#include "memory/kmemory.h"
+#include "core/logger.h"
+#include "platform/platform.h"
+
+#define VIRTUAL_ARENA_DEFAULT_ALIGNMENT 16
+// Commit at least this much at a time so that steady growth is not a system call per allocation.
+#define VIRTUAL_ARENA_MIN_COMMIT (64 * 1024)
+// Size of a transparent huge page.
+#define VIRTUAL_ARENA_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+static u64 round_up(u64 value, u64 granularity) {
+    return (value + granularity - 1) / granularity * granularity;
+}
+
+b8 virtual_arena_create(u64 reserveSize, b8 hugePages, VirtualArena* arena) {
+    if (!arena || reserveSize == 0) {
+        KERROR("virtual_arena_create requires a valid pointer to hold the arena and a non-zero size.");
+        return false;
+    }
+    kzero_memory(arena, sizeof(VirtualArena));
+
+    u64 pageSize = platform_memory_page_size();
+    arena->commitGranularity = hugePages ? VIRTUAL_ARENA_HUGE_PAGE_SIZE : round_up(VIRTUAL_ARENA_MIN_COMMIT, pageSize);
+    arena->reservedSize = round_up(reserveSize, arena->commitGranularity);
+    arena->memory = platform_memory_reserve(arena->reservedSize, hugePages);
+    if (!arena->memory) {
+        KERROR("virtual_arena_create - unable to reserve %llu bytes of address space.", arena->reservedSize);
+        kzero_memory(arena, sizeof(VirtualArena));
+        return false;
+    }
+    memory_system_track_virtual(arena->reservedSize, 0);
+    return true;
+}
+
+void virtual_arena_destroy(VirtualArena* arena) {
+    if (arena && arena->memory) {
+        memory_system_track_virtual(-(i64)arena->reservedSize, -(i64)arena->committedSize);
+        platform_memory_release(arena->memory, arena->reservedSize);
+        kzero_memory(arena, sizeof(VirtualArena));
+    }
+}
+
+void* virtual_arena_allocate(VirtualArena* arena, u64 size) {
+    return virtual_arena_allocate_aligned(arena, size, VIRTUAL_ARENA_DEFAULT_ALIGNMENT);
+}
+
+void* virtual_arena_allocate_aligned(VirtualArena* arena, u64 size, u64 alignment) {
+    if (!arena || !arena->memory) {
+        KERROR("virtual_arena_allocate - provided arena not initialized.");
+        return 0;
+    }
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        KERROR("virtual_arena_allocate - alignment of %llu is not a power of two.", alignment);
+        return 0;
+    }
+
+    u64 offset = round_up(arena->allocated, alignment);
+    u64 end = offset + size;
+    if (end > arena->reservedSize || end < offset) {
+        KERROR("virtual_arena_allocate - Tried to allocate %lluB, only %lluB of the reservation remaining.", size, arena->reservedSize - arena->allocated);
+        return 0;
+    }
+
+    if (end > arena->committedSize) {
+        u64 commitEnd = round_up(end, arena->commitGranularity);
+        if (commitEnd > arena->reservedSize) {
+            commitEnd = arena->reservedSize;
+        }
+        u64 commitSize = commitEnd - arena->committedSize;
+        if (!platform_memory_commit((u8*)arena->memory + arena->committedSize, commitSize)) {
+            KERROR("virtual_arena_allocate - unable to commit %lluB.", commitSize);
+            return 0;
+        }
+        memory_system_track_virtual(0, commitSize);
+        arena->committedSize = commitEnd;
+    }
+
+    arena->allocated = end;
+    void* block = (u8*)arena->memory + offset;
+    // Freshly committed pages are already zero, so only memory reused after free_all needs clearing.
+    // Leaving the rest untouched keeps it from becoming resident before it is used.
+    if (offset < arena->peakAllocated) {
+        kzero_memory(block, (end < arena->peakAllocated ? end : arena->peakAllocated) - offset);
+    }
+    if (end > arena->peakAllocated) {
+        arena->peakAllocated = end;
+    }
+    return block;
+}
+
+void virtual_arena_free_all(VirtualArena* arena, b8 decommit) {
+    if (!arena || !arena->memory) {
+        return;
+    }
+    arena->allocated = 0;
+    if (decommit && arena->committedSize) {
+        platform_memory_decommit(arena->memory, arena->committedSize);
+        memory_system_track_virtual(0, -(i64)arena->committedSize);
+        arena->committedSize = 0;
+        arena->peakAllocated = 0;
+    }
+}
@@ -1,3 +1,5 @@
+#define KLOG_CHANNEL LOG_CHANNEL_PLATFORM
+
 #include "platform/filesystem.h"
 #include "core/logger.h"
 #include "memory/kmemory.h"
@@ -12,6 +14,10 @@ b8 filesystem_exists(const char* path){
     return stat(path, &buffer) == 0;
 }
 
+b8 filesystem_delete(const char* path){
+    return remove(path) == 0;
+}
+
 
 b8 filesystem_open(const char* path, FileModes mode, b8 binary, FileHandle* outHandle){
      outHandle->isValid = false;
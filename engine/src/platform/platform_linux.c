@@ -1,4 +1,12 @@
+#define KLOG_CHANNEL LOG_CHANNEL_PLATFORM
+
+// For pthread_setaffinity_np and CPU_COUNT. Must come before any system header.
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
 #include "platform/platform.h"
+#include "platform/thread.h"
+#include "platform/atomic.h"
 
 
 // Linux platform layer.
@@ -22,6 +30,15 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>  // sysconf
+#include <pthread.h>
+#include <sched.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>  // uintptr_t
 
 static PlatformState* statePtr;
 
@@ -277,11 +294,57 @@ b8 platform_pump_messages(void* platformState) {
 }
 
 void* platform_allocate(u64 size, b8 aligned) {
+    if (aligned) {
+        return platform_allocate_aligned(size, PLATFORM_DEFAULT_ALIGNMENT);
+    }
     return malloc(size);
 }
+void* platform_allocate_aligned(u64 size, u64 alignment) {
+    // posix_memalign requires at least pointer alignment.
+    if (alignment < sizeof(void*)) {
+        alignment = sizeof(void*);
+    }
+    void* block = 0;
+    if (posix_memalign(&block, alignment, size) != 0) {
+        return 0;
+    }
+    return block;
+}
 void platform_free(void* block, b8 aligned) {
+    // Blocks from posix_memalign are released with free as well.
     free(block);
 }
+void* platform_reallocate(void* block, u64 size) {
+    return realloc(block, size);
+}
+u64 platform_memory_page_size() {
+    return (u64)sysconf(_SC_PAGESIZE);
+}
+void* platform_memory_reserve(u64 size, b8 hugePages) {
+    // MAP_NORESERVE keeps large reservations from counting against overcommit limits.
+    void* address = mmap(0, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (address == MAP_FAILED) {
+        return 0;
+    }
+#ifdef MADV_HUGEPAGE
+    if (hugePages) {
+        // Only a hint; the kernel falls back to regular pages if huge pages are unavailable.
+        madvise(address, size, MADV_HUGEPAGE);
+    }
+#endif
+    return address;
+}
+b8 platform_memory_commit(void* address, u64 size) {
+    return mprotect(address, size, PROT_READ | PROT_WRITE) == 0;
+}
+void platform_memory_decommit(void* address, u64 size) {
+    // Drop the pages first so they no longer count towards the resident set, then make the range inaccessible again.
+    madvise(address, size, MADV_DONTNEED);
+    mprotect(address, size, PROT_NONE);
+}
+void platform_memory_release(void* address, u64 size) {
+    munmap(address, size);
+}
 void* platform_zero_memory(void* block, u64 size) {
     return memset(block, 0, size);
 }
@@ -302,6 +365,10 @@ void platform_console_write_error(const char* message, u8 colour) {
     const char* colour_strings[] = {"0;41", "1;31", "1;33", "1;32", "1;34", "1;30"};
     printf("\033[%sm%s\033[0m", colour_strings[colour], message);
 }
+void platform_console_flush() {
+    fflush(stdout);
+    fflush(stderr);
+}
 
 f64 platform_get_absolute_time() {
     struct timespec now;
@@ -309,6 +376,12 @@ f64 platform_get_absolute_time() {
     return now.tv_sec + now.tv_nsec * 0.000000001;
 }
 
+u64 platform_get_timestamp() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &now);
+    return (u64)now.tv_sec * 1000000000ull + (u64)now.tv_nsec;
+}
+
 void platform_sleep(u64 ms) {
 #if _POSIX_C_SOURCE >= 199309L
     struct timespec ts;
@@ -323,6 +396,444 @@ void platform_sleep(u64 ms) {
 #endif
 }
 
+#define WAIT_FOREVER ((u64)-1)
+
+// Sleeps while *address holds expected, for at most timeoutMs unless it is WAIT_FOREVER.
+// Returns false if the time ran out.
+static b8 futex_wait(u32* address, u32 expected, u64 timeoutMs) {
+    struct timespec timeout;
+    struct timespec* timeoutPtr = 0;
+    if (timeoutMs != WAIT_FOREVER) {
+        timeout.tv_sec = timeoutMs / 1000;
+        timeout.tv_nsec = (timeoutMs % 1000) * 1000 * 1000;
+        timeoutPtr = &timeout;
+    }
+    long result = syscall(SYS_futex, address, FUTEX_WAIT_PRIVATE, expected, timeoutPtr, 0, 0);
+    return !(result == -1 && errno == ETIMEDOUT);
+}
+
+static void futex_wake(u32* address, u32 count) {
+    syscall(SYS_futex, address, FUTEX_WAKE_PRIVATE, count > INT_MAX ? INT_MAX : count, 0, 0, 0);
+}
+
+// The milliseconds left until deadline, a time from platform_get_absolute_time. 0 once it has passed.
+static u64 remaining_ms(f64 deadline) {
+    f64 remaining = deadline - platform_get_absolute_time();
+    return remaining > 0 ? (u64)(remaining * 1000.0) + 1 : 0;
+}
+
+// What a new thread runs, handed to it by platform_thread_create.
+typedef struct ThreadStart {
+    PFN_thread_start start;
+    void* params;
+} ThreadStart;
+
+// pthreads calls a void* (*)(void*), so the thread's function is called from here and its
+// exit code returned as the thread's result.
+static void* thread_trampoline(void* arg) {
+    ThreadStart threadStart = *(ThreadStart*)arg;
+    platform_free(arg, false);
+    u32 exitCode = threadStart.start(threadStart.params);
+    return (void*)(uintptr_t)exitCode;
+}
+
+b8 platform_thread_create(PFN_thread_start start, void* params, KThread* outThread) {
+    if (!start || !outThread) {
+        KERROR("platform_thread_create requires a start function and an output thread.");
+        return false;
+    }
+    ThreadStart* threadStart = platform_allocate(sizeof(ThreadStart), false);
+    if (!threadStart) {
+        KERROR("platform_thread_create - unable to allocate the thread's start block.");
+        return false;
+    }
+    threadStart->start = start;
+    threadStart->params = params;
+    pthread_t thread;
+    i32 result = pthread_create(&thread, 0, thread_trampoline, threadStart);
+    if (result != 0) {
+        platform_free(threadStart, false);
+        KERROR("platform_thread_create - pthread_create failed with error %i.", result);
+        return false;
+    }
+    outThread->handle = (u64)thread;
+    return true;
+}
+
+u32 platform_thread_join(KThread* thread) {
+    if (!thread || !thread->handle) {
+        return 0;
+    }
+    void* result = 0;
+    pthread_join((pthread_t)thread->handle, &result);
+    thread->handle = 0;
+    return (u32)(uintptr_t)result;
+}
+
+// Linux limits thread names to 15 characters and fails outright on longer ones.
+static void set_thread_name(pthread_t thread, const char* name) {
+    char truncated[16];
+    strncpy(truncated, name, sizeof(truncated) - 1);
+    truncated[sizeof(truncated) - 1] = 0;
+    pthread_setname_np(thread, truncated);
+}
+
+void platform_thread_set_name(KThread* thread, const char* name) {
+    if (thread && thread->handle && name) {
+        set_thread_name((pthread_t)thread->handle, name);
+    }
+}
+
+void platform_thread_set_current_name(const char* name) {
+    if (name) {
+        set_thread_name(pthread_self(), name);
+    }
+}
+
+u64 platform_thread_current_id() {
+    return (u64)syscall(SYS_gettid);
+}
+
+b8 platform_thread_set_affinity(KThread* thread, u32 processorIndex) {
+    if (!thread || !thread->handle || processorIndex >= CPU_SETSIZE) {
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(processorIndex, &set);
+    return pthread_setaffinity_np((pthread_t)thread->handle, sizeof(set), &set) == 0;
+}
+
+void platform_thread_yield() {
+    sched_yield();
+}
+
+u32 platform_get_processor_count() {
+    // Respects any affinity mask the process was started with, unlike counting every processor online.
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        i32 count = CPU_COUNT(&set);
+        if (count > 0) {
+            return (u32)count;
+        }
+    }
+    long online = sysconf(_SC_NPROCESSORS_ONLN);
+    return online > 0 ? (u32)online : 1;
+}
+
+// Reads a number from a sysfs file, such as "3" or "32K". Returns false if the file is missing.
+static b8 read_sysfs_u32(const char* path, u32* outValue) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+    char line[32] = {0};
+    b8 read = fgets(line, sizeof(line), file) != 0;
+    fclose(file);
+    if (!read) {
+        return false;
+    }
+    char* end;
+    unsigned long value = strtoul(line, &end, 10);
+    if (end == line) {
+        return false;
+    }
+    if (*end == 'K') {
+        value *= 1024;
+    } else if (*end == 'M') {
+        value *= 1024 * 1024;
+    }
+    *outValue = (u32)value;
+    return true;
+}
+
+// Identifies the physical core of a logical processor by its package and core ids.
+static b8 read_processor_core(u32 processor, u32* outPackage, u32* outCore) {
+    char path[128];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/physical_package_id", processor);
+    if (!read_sysfs_u32(path, outPackage)) {
+        return false;
+    }
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%u/topology/core_id", processor);
+    return read_sysfs_u32(path, outCore);
+}
+
+/* Walks the processors available to the process in order, numbering each distinct physical
+   core as it is first seen. Counts the cores and packages, and finds the core number of the
+   given processor when it is not INVALID_ID. Returns false if the topology is unavailable. */
+static b8 walk_topology(u32 processor, u32* outCoreCount, u32* outPackageCount, u32* outCoreIndex) {
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        return false;
+    }
+    // Distinct cores seen so far, as package << 32 | core.
+    u64 cores[CPU_SETSIZE];
+    u32 packages[CPU_SETSIZE];
+    u32 coreCount = 0;
+    u32 packageCount = 0;
+    *outCoreIndex = INVALID_ID;
+    for (u32 cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (!CPU_ISSET(cpu, &set)) {
+            continue;
+        }
+        u32 package, core;
+        if (!read_processor_core(cpu, &package, &core)) {
+            return false;
+        }
+        u64 key = ((u64)package << 32) | core;
+        u32 index = 0;
+        while (index < coreCount && cores[index] != key) {
+            index++;
+        }
+        if (index == coreCount) {
+            cores[coreCount++] = key;
+        }
+        u32 p = 0;
+        while (p < packageCount && packages[p] != package) {
+            p++;
+        }
+        if (p == packageCount) {
+            packages[packageCount++] = package;
+        }
+        if (cpu == processor) {
+            *outCoreIndex = index;
+        }
+    }
+    *outCoreCount = coreCount;
+    *outPackageCount = packageCount;
+    return coreCount > 0;
+}
+
+void platform_get_cpu_info(PlatformCpuInfo* outInfo) {
+    kzero_memory(outInfo, sizeof(PlatformCpuInfo));
+    outInfo->processorCount = platform_get_processor_count();
+    u32 unused;
+    if (!walk_topology(INVALID_ID, &outInfo->coreCount, &outInfo->packageCount, &unused)) {
+        outInfo->coreCount = outInfo->processorCount;
+        outInfo->packageCount = 1;
+    }
+
+    // The caches of the first processor, which on every machine we target match the others.
+    char path[128];
+    for (u32 index = 0; index < 8; ++index) {
+        u32 level, size, lineSize;
+        char type[16] = {0};
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%u/level", index);
+        if (!read_sysfs_u32(path, &level)) {
+            break;
+        }
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%u/type", index);
+        FILE* file = fopen(path, "r");
+        if (file) {
+            if (!fgets(type, sizeof(type), file)) {
+                type[0] = 0;
+            }
+            fclose(file);
+        }
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%u/size", index);
+        if (!read_sysfs_u32(path, &size)) {
+            continue;
+        }
+        if (level == 1 && strncmp(type, "Data", 4) == 0) {
+            outInfo->l1DataCacheSize = size;
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu0/cache/index%u/coherency_line_size", index);
+            if (read_sysfs_u32(path, &lineSize)) {
+                outInfo->cacheLineSize = lineSize;
+            }
+        } else if (level == 2) {
+            outInfo->l2CacheSize = size;
+        } else if (level == 3) {
+            outInfo->l3CacheSize = size;
+        }
+    }
+
+    // Some virtual machines hide the cache directory, but glibc can still ask the CPU.
+#ifdef _SC_LEVEL1_DCACHE_SIZE
+    if (!outInfo->l1DataCacheSize) {
+        long value = sysconf(_SC_LEVEL1_DCACHE_SIZE);
+        outInfo->l1DataCacheSize = value > 0 ? (u32)value : 0;
+    }
+    if (!outInfo->l2CacheSize) {
+        long value = sysconf(_SC_LEVEL2_CACHE_SIZE);
+        outInfo->l2CacheSize = value > 0 ? (u32)value : 0;
+    }
+    if (!outInfo->l3CacheSize) {
+        long value = sysconf(_SC_LEVEL3_CACHE_SIZE);
+        outInfo->l3CacheSize = value > 0 ? (u32)value : 0;
+    }
+    if (!outInfo->cacheLineSize) {
+        long value = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);
+        outInfo->cacheLineSize = value > 0 ? (u32)value : 0;
+    }
+#endif
+    if (!outInfo->cacheLineSize) {
+        outInfo->cacheLineSize = KCACHE_LINE_SIZE;
+    }
+}
+
+u32 platform_get_processor_core(u32 processorIndex) {
+    u32 coreCount, packageCount, coreIndex;
+    if (!walk_topology(processorIndex, &coreCount, &packageCount, &coreIndex)) {
+        return INVALID_ID;
+    }
+    return coreIndex;
+}
+
+u32 platform_get_core_processors(u32* outProcessors, u32 maxCount) {
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        return 0;
+    }
+    // Cores listed so far, as package << 32 | core.
+    u64 cores[CPU_SETSIZE];
+    u32 coreCount = 0;
+    u32 count = 0;
+    for (u32 cpu = 0; cpu < CPU_SETSIZE && count < maxCount; ++cpu) {
+        if (!CPU_ISSET(cpu, &set)) {
+            continue;
+        }
+        u32 package, core;
+        if (read_processor_core(cpu, &package, &core)) {
+            u64 key = ((u64)package << 32) | core;
+            u32 index = 0;
+            while (index < coreCount && cores[index] != key) {
+                index++;
+            }
+            if (index < coreCount) {
+                // A hyperthread of a core already listed.
+                continue;
+            }
+            cores[coreCount++] = key;
+        }
+        outProcessors[count++] = cpu;
+    }
+    return count;
+}
+
+// Spins briefly before sleeping, since most locks are held for less time than a trip to the kernel.
+#define MUTEX_SPIN_COUNT 100
+
+// The mutex from Ulrich Drepper's "Futexes Are Tricky". Unlocking only enters the kernel
+// when the state says another thread may be asleep.
+void platform_mutex_lock(KMutex* mutex) {
+    u32 state = 0;
+    if (__atomic_compare_exchange_n(&mutex->state, &state, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return;
+    }
+    for (u32 i = 0; i < MUTEX_SPIN_COUNT; ++i) {
+        kcpu_pause();
+        state = 0;
+        if (__atomic_load_n(&mutex->state, __ATOMIC_RELAXED) == 0 &&
+            __atomic_compare_exchange_n(&mutex->state, &state, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return;
+        }
+    }
+    // Mark the mutex contended before sleeping, so the holder knows to wake someone.
+    while (__atomic_exchange_n(&mutex->state, 2, __ATOMIC_ACQUIRE) != 0) {
+        futex_wait(&mutex->state, 2, WAIT_FOREVER);
+    }
+}
+
+b8 platform_mutex_try_lock(KMutex* mutex) {
+    u32 state = 0;
+    return __atomic_compare_exchange_n(&mutex->state, &state, 1, false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+void platform_mutex_unlock(KMutex* mutex) {
+    if (__atomic_exchange_n(&mutex->state, 0, __ATOMIC_RELEASE) == 2) {
+        futex_wake(&mutex->state, 1);
+    }
+}
+
+b8 platform_condition_wait_timeout(KConditionVariable* condition, KMutex* mutex, u64 timeoutMs) {
+    // A signal after this read changes the sequence, so the futex will not sleep through it.
+    u32 sequence = __atomic_load_n(&condition->sequence, __ATOMIC_RELAXED);
+    platform_mutex_unlock(mutex);
+    b8 signalled = futex_wait(&condition->sequence, sequence, timeoutMs);
+    // Others may be waiting too, so take the mutex as contended.
+    while (__atomic_exchange_n(&mutex->state, 2, __ATOMIC_ACQUIRE) != 0) {
+        futex_wait(&mutex->state, 2, WAIT_FOREVER);
+    }
+    return signalled;
+}
+
+void platform_condition_wait(KConditionVariable* condition, KMutex* mutex) {
+    platform_condition_wait_timeout(condition, mutex, WAIT_FOREVER);
+}
+
+void platform_condition_signal(KConditionVariable* condition) {
+    __atomic_add_fetch(&condition->sequence, 1, __ATOMIC_SEQ_CST);
+    futex_wake(&condition->sequence, 1);
+}
+
+void platform_condition_broadcast(KConditionVariable* condition) {
+    __atomic_add_fetch(&condition->sequence, 1, __ATOMIC_SEQ_CST);
+    futex_wake(&condition->sequence, INT_MAX);
+}
+
+void platform_semaphore_create(u32 initialCount, KSemaphore* outSemaphore) {
+    outSemaphore->count = initialCount;
+    outSemaphore->waiters = 0;
+}
+
+void platform_semaphore_signal(KSemaphore* semaphore, u32 count) {
+    __atomic_add_fetch(&semaphore->count, count, __ATOMIC_SEQ_CST);
+    // Only enter the kernel when someone may be asleep.
+    if (__atomic_load_n(&semaphore->waiters, __ATOMIC_SEQ_CST) > 0) {
+        futex_wake(&semaphore->count, count);
+    }
+}
+
+b8 platform_semaphore_wait_timeout(KSemaphore* semaphore, u64 timeoutMs) {
+    f64 deadline = timeoutMs == WAIT_FOREVER ? 0 : platform_get_absolute_time() + timeoutMs / 1000.0;
+    while (true) {
+        u32 count = __atomic_load_n(&semaphore->count, __ATOMIC_RELAXED);
+        while (count > 0) {
+            if (__atomic_compare_exchange_n(&semaphore->count, &count, count - 1, true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+                return true;
+            }
+        }
+        u64 waitMs = WAIT_FOREVER;
+        if (timeoutMs != WAIT_FOREVER) {
+            waitMs = remaining_ms(deadline);
+            if (waitMs == 0) {
+                return false;
+            }
+        }
+        // The kernel only puts the thread to sleep if the count is still zero, so a signal
+        // arriving between the check above and the wait is not lost.
+        __atomic_add_fetch(&semaphore->waiters, 1, __ATOMIC_SEQ_CST);
+        futex_wait(&semaphore->count, 0, waitMs);
+        __atomic_sub_fetch(&semaphore->waiters, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+void platform_semaphore_wait(KSemaphore* semaphore) {
+    platform_semaphore_wait_timeout(semaphore, WAIT_FOREVER);
+}
+
+b8 platform_thread_local_create(KThreadLocalKey* outKey) {
+    pthread_key_t key;
+    if (pthread_key_create(&key, 0) != 0) {
+        KERROR("platform_thread_local_create - out of thread-local keys.");
+        return false;
+    }
+    outKey->key = (u32)key;
+    return true;
+}
+
+void platform_thread_local_destroy(KThreadLocalKey* key) {
+    pthread_key_delete((pthread_key_t)key->key);
+}
+
+void* platform_thread_local_get(KThreadLocalKey* key) {
+    return pthread_getspecific((pthread_key_t)key->key);
+}
+
+void platform_thread_local_set(KThreadLocalKey* key, void* value) {
+    pthread_setspecific((pthread_key_t)key->key, value);
+}
+
 
 
 Keys translate_keycode(u32 x_keycode) {
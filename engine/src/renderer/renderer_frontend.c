@@ -1,3 +1,5 @@
+#define KLOG_CHANNEL LOG_CHANNEL_RENDERER
+
 #include "renderer/renderer_frontend.h"
 #include "renderer/renderer_backend.h"
 
@@ -7,6 +9,9 @@
 #include "resources/resource_types.h"
 #include "systems/texture_system.h"
 #include "systems/material_system.h"
+#include "core/profiler.h"
+#include "core/frame_stats.h"
+#include "platform/platform.h"
 
 
 
@@ -30,6 +35,7 @@ b8 renderer_system_initialize(u64* memoryRequiremnt, void* state, void* platform
         return false;
     }
     statePtr = state;
+    KPROFILE_SCOPE("renderer_system_initialize");
 
 
     
@@ -85,15 +91,25 @@ b8 renderer_end_frame(f32 deltaTime){
 }
 
 b8 renderer_draw_frame(RenderPacket* packet){
-
-    if(renderer_begin_frame(packet->deltaTime)){
+    KPROFILE_SCOPE("renderer_draw_frame");
+
+    // Beginning a frame waits for the GPU to finish with it and for the next image, so it
+    // counts as presenting rather than recording.
+    f64 waitStartTime = platform_get_absolute_time();
+    b8 began = renderer_begin_frame(packet->deltaTime);
+    f64 recordStartTime = platform_get_absolute_time();
+    frame_stats_record(FRAME_STAT_PRESENT, recordStartTime - waitStartTime);
+    if(began){
         
         statePtr->backend.update_global_state(&statePtr->backend,statePtr->projection,statePtr->view,vec3_zero(),vec4_one(),0);
         u32 count = packet->geometryCount;
         for(u32 i=0; i < count; i++){
             statePtr->backend.draw_geometry(&statePtr->backend,packet->geometries[i]);
         }
+        f64 presentStartTime = platform_get_absolute_time();
+        frame_stats_record(FRAME_STAT_RENDER, presentStartTime - recordStartTime);
         b8 result = renderer_end_frame(packet->deltaTime);
+        frame_stats_record(FRAME_STAT_PRESENT, platform_get_absolute_time() - presentStartTime);
         if(!result){
             KERROR("renderer_end_frame failed. Application shutting down......");
             return false;
@@ -1,3 +1,5 @@
+#define KLOG_CHANNEL LOG_CHANNEL_RENDERER
+
 #include "renderer/vulkan_backend/shaders/vulkan_material_shader.h"
 #include "renderer/vulkan_backend/vulkan_shader_utils.h"
 #include "renderer/vulkan_backend/vulkan_pipeline.h"
@@ -7,19 +9,19 @@
 #include "math/kmath.h"
 #include "systems/texture_system.h"
 
-#define BUILTIN_SHADER_NAME_MATERIAL "Builtin.MaterialShader"
-
 b8 vulkan_material_shader_create(VulkanContext *context, VulkanMaterialShader *shader, int deviceIndex)
 {
     
-    // Shader module init per state
-    char stageTypeStrings[MATERIAL_SHADER_STAGE_COUNT][5] = {"vert", "frag"};
+    // Shader module init per state. Filenames are joined at compile time.
+    const char* stageFilenames[MATERIAL_SHADER_STAGE_COUNT] = {
+        "shaders/" BUILTIN_SHADER_NAME_MATERIAL ".vert.spv",
+        "shaders/" BUILTIN_SHADER_NAME_MATERIAL ".frag.spv"};
     VkShaderStageFlagBits stageTypes[MATERIAL_SHADER_STAGE_COUNT] = {VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT};
     for (u32 i = 0; i < MATERIAL_SHADER_STAGE_COUNT; i++)
     {
-        if (!create_shader_module(context, BUILTIN_SHADER_NAME_MATERIAL, stageTypeStrings[i], stageTypes[i], i, shader->stages, deviceIndex))
+        if (!create_shader_module(context, stageFilenames[i], stageTypes[i], i, shader->stages, deviceIndex))
         {
-            KERROR("Unable to create %s shader module for '%s'.", stageTypeStrings[i], BUILTIN_SHADER_NAME_MATERIAL);
+            KERROR("Unable to create shader module '%s'.", stageFilenames[i]);
             return false;
         }
     }
@@ -1,6 +1,9 @@
+#define KLOG_CHANNEL LOG_CHANNEL_RENDERER
+
 #include "renderer/vulkan_backend/vulkan_backend.h"
 #include "renderer/vulkan_backend/vulkan_types.inl"
 #include "core/logger.h"
+#include "core/string_intern.h"
 #include "containers/darray.h"
 #include "core/application.h"
 #include "renderer/vulkan_backend/vulkan_platform.h"
@@ -17,11 +20,23 @@
 #include "renderer/vulkan_backend/vulkan_image.h"
 #include "math/math_types.h"
 #include "systems/material_system.h"
+#include "core/profiler.h"
+#include "core/string_id.h"
 
 static VulkanContext context{};
 static u64 cachedFramebufferWidth = 0;
 static u64 cachedFramebufferHeight = 0;
 
+// Finds the shader that draws a material. The case labels are resolved at compile time.
+static VulkanMaterialShader* find_material_shader(u64 shaderId, int deviceIndex) {
+    switch (shaderId) {
+        case KSID(BUILTIN_SHADER_NAME_MATERIAL):
+            return &context.materialShaders[deviceIndex];
+        default:
+            return 0;
+    }
+}
+
 
 
 VKAPI_ATTR VkBool32 VKAPI_CALL vk_debug_callback(
@@ -72,8 +87,8 @@ b8 vulkan_renderer_backend_initialize(RendererBackend *backend, const char *appl
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "Kohi Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    std::vector<const char *> extensions = std::vector<const char *>(0);
-    std::vector<const char *> requiredLayers = std::vector<const char *>(0);
+    kvector<const char *> extensions;
+    kvector<const char *> requiredLayers;
 
 #ifndef NDEBUG
     extensions.emplace_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
@@ -92,7 +107,7 @@ b8 vulkan_renderer_backend_initialize(RendererBackend *backend, const char *appl
     u32 availableLayerCount = 0;
 
     VK_CHECK(vkEnumerateInstanceLayerProperties(&availableLayerCount, VK_NULL_HANDLE));
-    std::vector<VkLayerProperties> availableLayers = std::vector<VkLayerProperties>(availableLayerCount);
+    kvector<VkLayerProperties> availableLayers(availableLayerCount);
     VK_CHECK(vkEnumerateInstanceLayerProperties(&availableLayerCount, availableLayers.data()));
     for (int i = 0; i < requiredLayers.size(); i++)
     {
@@ -153,27 +168,27 @@ b8 vulkan_renderer_backend_initialize(RendererBackend *backend, const char *appl
         KERROR("Failed to create Vulkan device");
         return false;
     }
-    context.framebufferWidth = std::vector<u64>(context.device.deviceCount);
-    context.framebufferHeight = std::vector<u64>(context.device.deviceCount);
-    context.framebufferSizeGeneration = std::vector<u64>(context.device.deviceCount);
-    context.framebufferSizeLastGeneration = std::vector<u64>(context.device.deviceCount);
-    context.currentDeviceIndex = std::vector<int>(context.device.deviceCount);
-    context.lastDeviceIndex = std::vector<int>(context.device.deviceCount);
-    context.imageAvalableSemaphores = std::vector<std::vector<VkSemaphore>>(context.device.deviceCount);
-    context.queueCompleteSemaphores = std::vector<std::vector<VkSemaphore>>(context.device.deviceCount);
-    context.inFlightFences = std::vector<std::vector<VulkanFence>>(context.device.deviceCount);
-    context.imagesInFlight = std::vector<std::vector<VulkanFence *>>(context.device.deviceCount);
-    context.swapchains = std::vector<VulkanSwapchain>(context.device.deviceCount);
-    context.mainRenderPasses = std::vector<VulkanRenderpass>(context.device.deviceCount);
-    context.graphicsCommandBuffers = std::vector<std::vector<VulkanCommandBuffer>>(context.device.deviceCount);
-    context.currentFrame = std::vector<u32>(context.device.deviceCount);
-    context.imageIndex = std::vector<u32>(context.device.deviceCount);
-    context.recreatingSwapchain = std::vector<b8>(context.device.deviceCount);
-    context.materialShaders = std::vector<VulkanMaterialShader>(context.device.deviceCount);
-    context.vertexBuffers = std::vector<VulkanBuffer>(context.device.deviceCount);
-    context.indexBuffers = std::vector<VulkanBuffer>(context.device.deviceCount);
-    context.geometryVertexOffset = std::vector<u32>(context.device.deviceCount);
-    context.geometryIndexOffset = std::vector<u32>(context.device.deviceCount);
+    context.framebufferWidth.resize(context.device.deviceCount);
+    context.framebufferHeight.resize(context.device.deviceCount);
+    context.framebufferSizeGeneration.resize(context.device.deviceCount);
+    context.framebufferSizeLastGeneration.resize(context.device.deviceCount);
+    context.currentDeviceIndex.resize(context.device.deviceCount);
+    context.lastDeviceIndex.resize(context.device.deviceCount);
+    context.imageAvalableSemaphores.resize(context.device.deviceCount);
+    context.queueCompleteSemaphores.resize(context.device.deviceCount);
+    context.inFlightFences.resize(context.device.deviceCount);
+    context.imagesInFlight.resize(context.device.deviceCount);
+    context.swapchains.resize(context.device.deviceCount);
+    context.mainRenderPasses.resize(context.device.deviceCount);
+    context.graphicsCommandBuffers.resize(context.device.deviceCount);
+    context.currentFrame.resize(context.device.deviceCount);
+    context.imageIndex.resize(context.device.deviceCount);
+    context.recreatingSwapchain.resize(context.device.deviceCount);
+    context.materialShaders.resize(context.device.deviceCount);
+    context.vertexBuffers.resize(context.device.deviceCount);
+    context.indexBuffers.resize(context.device.deviceCount);
+    context.geometryVertexOffset.resize(context.device.deviceCount);
+    context.geometryIndexOffset.resize(context.device.deviceCount);
     for (int deviceIndex = 0; deviceIndex < context.device.deviceCount; deviceIndex++)
     {
         context.framebufferWidth[deviceIndex] = cachedFramebufferWidth != 0 ? cachedFramebufferWidth : 640;
@@ -184,7 +199,7 @@ b8 vulkan_renderer_backend_initialize(RendererBackend *backend, const char *appl
         
         vulkan_renderpass_create(&context, &context.mainRenderPasses[deviceIndex], 0, 0, context.framebufferWidth[deviceIndex], context.framebufferHeight[deviceIndex], 0.0f, 0.0f, 0.2f, 1.0f, 1.0f, 0, deviceIndex);
 
-        context.swapchains[deviceIndex].framebuffers = std::vector<VulkanFramebuffer>(context.swapchains[deviceIndex].imageCount);
+        context.swapchains[deviceIndex].framebuffers.resize(context.swapchains[deviceIndex].imageCount);
         regenerate_framebuffers(backend, &context.swapchains[deviceIndex], &context.mainRenderPasses[deviceIndex], deviceIndex);
         create_command_buffers(backend, deviceIndex);
 
@@ -192,9 +207,9 @@ b8 vulkan_renderer_backend_initialize(RendererBackend *backend, const char *appl
         
 
         // Vulkan sync objects
-        context.imageAvalableSemaphores[deviceIndex] = std::vector<VkSemaphore>(context.swapchains[deviceIndex].imageCount);
-        context.queueCompleteSemaphores[deviceIndex] = std::vector<VkSemaphore>(context.swapchains[deviceIndex].imageCount);
-        context.inFlightFences[deviceIndex] = std::vector<VulkanFence>(context.swapchains[deviceIndex].imageCount);
+        context.imageAvalableSemaphores[deviceIndex].resize(context.swapchains[deviceIndex].imageCount);
+        context.queueCompleteSemaphores[deviceIndex].resize(context.swapchains[deviceIndex].imageCount);
+        context.inFlightFences[deviceIndex].resize(context.swapchains[deviceIndex].imageCount);
         for (int i = 0; i < context.swapchains[deviceIndex].imageCount; i++)
         {
             VkSemaphoreCreateInfo semaphoreCreateInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
@@ -209,7 +224,7 @@ b8 vulkan_renderer_backend_initialize(RendererBackend *backend, const char *appl
         // In flight fences should not yet exist at this point, so clear the list. These are stored in pointers
         // because the initial state should be 0, and will be 0 when not in use. Acutal fences are not owned
         // by this list.
-        context.imagesInFlight[deviceIndex] = std::vector<VulkanFence *>(context.swapchains[deviceIndex].imageCount);
+        context.imagesInFlight[deviceIndex].resize(context.swapchains[deviceIndex].imageCount);
         for (u32 i = 0; i < context.swapchains[deviceIndex].imageCount; ++i)
         {
             context.imagesInFlight[deviceIndex][i] = nullptr;
@@ -223,9 +238,7 @@ b8 vulkan_renderer_backend_initialize(RendererBackend *backend, const char *appl
 
     
     }
-    for(u32 i=0; i < VULKAN_MAX_GEOMETRY_COUNT; i++){
-        context.geometries[i].id = INVALID_ID;
-    }
+    slot_map_create(sizeof(VulkanGeometryData), VULKAN_MAX_GEOMETRY_COUNT, 0, &context.geometries);
 
     
 
@@ -289,6 +302,8 @@ void vulkan_renderer_backend_shutdown(RendererBackend *backend)
         
     }
 
+    slot_map_destroy(&context.geometries);
+
     vulkan_device_destory(&context);
 
     KINFO("Destroying Vulkan surface");
@@ -306,6 +321,11 @@ void vulkan_renderer_backend_shutdown(RendererBackend *backend)
 
     KINFO("Destroying Vulkan instance...");
     vkDestroyInstance(context.instance, context.allocator);
+
+    // Release every container now, while the memory system is still running, rather than at
+    // static destruction. This leaves the context as it was before initialization.
+    context.~VulkanContext();
+    new (&context) VulkanContext{};
 }
 
 void vulkan_renderer_backend_on_resized(RendererBackend *backend, u16 width, u16 height)
@@ -321,6 +341,7 @@ void vulkan_renderer_backend_on_resized(RendererBackend *backend, u16 width, u16
 
 b8 vulkan_renderer_backend_begin_frame(RendererBackend *backend, f64 deltaTime)
 {
+    KPROFILE_SCOPE("vulkan_renderer_backend_begin_frame");
     int deviceIndex = backend->frameNumber %  context.device.deviceCount;
     context.frameDeltaTime = deltaTime;
     // Check if recreating swap chain and boot out.
@@ -427,6 +448,7 @@ void vulkan_renderer_backend_update_global_state(RendererBackend* backend,mat4 p
 
 b8 vulkan_renderer_backend_end_frame(RendererBackend *backend, f64 deltaTime)
 {
+    KPROFILE_SCOPE("vulkan_renderer_backend_end_frame");
     int deviceIndex = backend->frameNumber % context.device.deviceCount;
 
     VulkanCommandBuffer* commandBuffer = &context.graphicsCommandBuffers[deviceIndex][context.imageIndex[deviceIndex]];
@@ -531,7 +553,7 @@ i32 find_memory_index(u64 memoryTypeBits, VkMemoryPropertyFlags memoryFlags, int
 
 void create_command_buffers(RendererBackend *backend, int deviceIndex)
 {
-    context.graphicsCommandBuffers[deviceIndex] = std::vector<VulkanCommandBuffer>(context.swapchains[deviceIndex].imageCount);
+    context.graphicsCommandBuffers[deviceIndex].resize(context.swapchains[deviceIndex].imageCount);
     for (int i = 0; i < context.swapchains[deviceIndex].imageCount; i++)
     {
         if (context.graphicsCommandBuffers[deviceIndex][i].handle == VK_NULL_HANDLE)
@@ -554,7 +576,7 @@ void regenerate_framebuffers(RendererBackend *backend, VulkanSwapchain *swapchai
         //     vulkan_framebuffer_destroy(&context,&context.swapchains[deviceIndex].framebuffers[i],deviceIndex);
         // }
         u32 attachmentCount = 2;
-        std::vector<VkImageView> attachments = std::vector<VkImageView>(attachmentCount);
+        VkImageView attachments[2];
         if(swapchain->views[i] != VK_NULL_HANDLE){
             attachments[0] = swapchain->views[i];
         }
@@ -569,7 +591,7 @@ void regenerate_framebuffers(RendererBackend *backend, VulkanSwapchain *swapchai
             KFATAL("Invalid depth attachment");
             return;
         }
-        vulkan_framebuffer_create(&context, renderpass, context.framebufferWidth[deviceIndex], context.framebufferHeight[deviceIndex], attachmentCount, attachments, &context.swapchains[deviceIndex].framebuffers[i], deviceIndex);
+        vulkan_framebuffer_create(&context, renderpass, context.framebufferWidth[deviceIndex], context.framebufferHeight[deviceIndex], kspan<const VkImageView>(attachments, attachmentCount), &context.swapchains[deviceIndex].framebuffers[i], deviceIndex);
     }
 }
 
@@ -672,7 +694,7 @@ b8 create_buffers(VulkanContext* context, int deviceIndex){
 }
 
 void vulkan_renderer_backend_create_texture_for_device(VulkanBuffer* stagingBuffers,const u8* pixels, struct VulkanTexture* texture, int deviceIndex){
-    VulkanTextureData* data = (VulkanTextureData*)kallocate(sizeof(VulkanTextureData),MEMORY_TAG_TEXTURE);
+    VulkanTextureData* data = (VulkanTextureData*)kallocate_pooled(sizeof(VulkanTextureData),MEMORY_TAG_TEXTURE);
     texture->textureData[deviceIndex] = data;
 
 
@@ -775,19 +797,20 @@ void vulkan_renderer_backend_create_texture(const u8* pixels, Texture* texture){
     
 
     // Internal Data creation
-    // TODO: Use an allocator for this
     
-    VulkanTexture* vulkanTexture = (VulkanTexture*)kallocate(sizeof(VulkanTexture),MEMORY_TAG_TEXTURE);
-    vulkanTexture->textureData = std::vector<VulkanTextureData*>(context.device.deviceCount);
+    VulkanTexture* vulkanTexture = (VulkanTexture*)kallocate_pooled(sizeof(VulkanTexture),MEMORY_TAG_TEXTURE);
+    // Held inline for up to VULKAN_INLINE_DEVICE_COUNT devices, so this does not allocate.
+    vulkanTexture->textureData.resize(context.device.deviceCount);
     vulkanTexture->width = texture->width;
     vulkanTexture->height = texture->height;
     vulkanTexture->channelCount = texture->channelCount;
     vulkanTexture->id = texture->id;
+    vulkanTexture->nameId = texture->nameId;
 
     
     
     
-    std::vector<VulkanBuffer> stagingBuffers = std::vector<VulkanBuffer>(context.device.deviceCount);
+    VulkanPerDevice<VulkanBuffer> stagingBuffers(context.device.deviceCount);
     
     for(deviceIndex = 0; deviceIndex < context.device.deviceCount; deviceIndex++){
         
@@ -805,7 +828,7 @@ void vulkan_renderer_backend_create_texture(const u8* pixels, Texture* texture){
 }
 
 void vulkan_renderer_backend_destroy_texture_for_device(VulkanTextureData* data,int deviceIndex){
-    KINFO("Destroying Texture for %s ",context.device.properties[deviceIndex].deviceName);
+    KINFO_LIMITED("Destroying Texture for %s ",context.device.properties[deviceIndex].deviceName);
     
     
     
@@ -815,12 +838,12 @@ void vulkan_renderer_backend_destroy_texture_for_device(VulkanTextureData* data,
     kzero_memory(&data->image, sizeof(VulkanImage));
     vkDestroySampler(context.device.logicalDevices[deviceIndex], data->sampler, context.allocator);
     kzero_memory(&data->sampler,sizeof(VkSampler));
-    KINFO("Destroyed Texture for %s ",context.device.properties[deviceIndex].deviceName);
+    KINFO_LIMITED("Destroyed Texture for %s ",context.device.properties[deviceIndex].deviceName);
 
 }
 
 void vulkan_renderer_backend_destroy_texture(Texture* texture){
-    KINFO("Destroying Texture %d in Vulkan Backend",texture->id);
+    KINFO_LIMITED("Destroying Texture %d in Vulkan Backend",texture->id);
     int deviceIndex = 0;
     VulkanTexture* vulkanTexture = (VulkanTexture*)texture->internalData;
     
@@ -830,10 +853,13 @@ void vulkan_renderer_backend_destroy_texture(Texture* texture){
             if(data){
                 
                 vulkan_renderer_backend_destroy_texture_for_device(data,deviceIndex);
-                kfree(vulkanTexture->textureData[deviceIndex], sizeof(VulkanTextureData), MEMORY_TAG_TEXTURE);
+                kfree_pooled(vulkanTexture->textureData[deviceIndex], sizeof(VulkanTextureData), MEMORY_TAG_TEXTURE);
             }
             
         }
+        // Release any storage beyond the inline devices before handing the memory back to the pool.
+        vulkanTexture->textureData.reset();
+        kfree_pooled(vulkanTexture, sizeof(VulkanTexture), MEMORY_TAG_TEXTURE);
         
     }
     kzero_memory(texture, sizeof(Texture));
@@ -847,8 +873,13 @@ b8 vulkan_renderer_backend_create_material(Material* material){
     if(material){
 
         for(deviceIndex = 0; deviceIndex < context.device.deviceCount; deviceIndex++){
+            VulkanMaterialShader* shader = find_material_shader(material->shaderId, deviceIndex);
+            if(!shader){
+                KERROR("Material '%s' uses an unknown shader.", string_intern_get(material->nameId));
+                return false;
+            }
 
-            if(!vulkan_material_shader_acquire_resources(&context,&context.materialShaders[deviceIndex],material,deviceIndex)){
+            if(!vulkan_material_shader_acquire_resources(&context,shader,material,deviceIndex)){
             KERROR("Could not acquire resource for Material");
             return false;
 
@@ -863,7 +894,11 @@ b8 vulkan_renderer_backend_create_material(Material* material){
 void vulkan_renderer_backend_destroy_material(Material* material){
     
     for(int deviceIndex = 0; deviceIndex < context.device.deviceCount; deviceIndex++){
-        vulkan_material_shader_release_resources(&context,&context.materialShaders[deviceIndex],material,deviceIndex);
+        VulkanMaterialShader* shader = find_material_shader(material->shaderId, deviceIndex);
+        if(!shader){
+            continue;
+        }
+        vulkan_material_shader_release_resources(&context,shader,material,deviceIndex);
         KDEBUG("VULKAN BACKEND MATERIAL STUB DESTROY %s",context.device.properties[deviceIndex].deviceName);
     }
     material->internalId = INVALID_ID;
@@ -882,7 +917,11 @@ b8 vulkan_renderer_backend_create_geometry(Geometry* geometry,u32 vertexCount,co
 
     VulkanGeometryData* internal_data = 0;
     if (is_reupload) {
-        internal_data = &context.geometries[geometry->internalId];
+        internal_data = (VulkanGeometryData*)slot_map_get(&context.geometries, geometry->internalId);
+        if (!internal_data) {
+            KERROR("vulkan_renderer_create_geometry - geometry '%s' has a stale internal id.", string_intern_get(geometry->nameId));
+            return false;
+        }
 
         // Take a copy of the old range.
         old_range.indexBufferOffset = internal_data->indexBufferOffset;
@@ -892,14 +931,12 @@ b8 vulkan_renderer_backend_create_geometry(Geometry* geometry,u32 vertexCount,co
         old_range.vertexCount = internal_data->vertexCount;
         old_range.vertexSize = internal_data->vertexSize;
     } else {
-        for (u32 i = 0; i < VULKAN_MAX_GEOMETRY_COUNT; ++i) {
-            if (context.geometries[i].id == INVALID_ID) {
-                // Found a free index.
-                geometry->internalId = i;
-                context.geometries[i].id = i;
-                internal_data = &context.geometries[i];
-                break;
-            }
+        u32 handle;
+        internal_data = (VulkanGeometryData*)slot_map_insert(&context.geometries, &handle);
+        if (internal_data) {
+            geometry->internalId = handle;
+            internal_data->id = handle;
+            internal_data->generation = INVALID_ID;
         }
     }
     if (!internal_data) {
@@ -954,7 +991,11 @@ b8 vulkan_renderer_backend_create_geometry(Geometry* geometry,u32 vertexCount,co
 }
 void vulkan_renderer_backend_destroy_geometry(Geometry* geometry){
     if(geometry && geometry->internalId != INVALID_ID){
-        VulkanGeometryData* internalData = &context.geometries[geometry->internalId];
+        VulkanGeometryData* internalData = (VulkanGeometryData*)slot_map_get(&context.geometries, geometry->internalId);
+        if (!internalData) {
+            KWARN("vulkan_renderer_backend_destroy_geometry - geometry '%s' has a stale internal id. Nothing was done.", string_intern_get(geometry->nameId));
+            return;
+        }
         for(int deviceIndex = 0; deviceIndex < context.device.deviceCount; deviceIndex++){
             vkDeviceWaitIdle(context.device.logicalDevices[deviceIndex]);
             
@@ -970,9 +1011,8 @@ void vulkan_renderer_backend_destroy_geometry(Geometry* geometry){
             }
         }
         // Clean up data.
-        kzero_memory(internalData, sizeof(VulkanGeometryData));
-        internalData->id = INVALID_ID;
-        internalData->generation = INVALID_ID;
+        slot_map_remove(&context.geometries, geometry->internalId);
+        geometry->internalId = INVALID_ID;
     }
     
     
@@ -987,13 +1027,12 @@ void vulkan_renderer_backend_draw_geometry(RendererBackend* backend, GeometryRen
     }
     
     int deviceIndex = backend->frameNumber % context.device.deviceCount;
-    VulkanGeometryData* bufferData = &context.geometries[data.geometry->internalId];
+    VulkanGeometryData* bufferData = (VulkanGeometryData*)slot_map_get(&context.geometries, data.geometry->internalId);
+    if (!bufferData) {
+        return;
+    }
     vkDeviceWaitIdle(context.device.logicalDevices[deviceIndex]);
     VulkanCommandBuffer* commandBuffer = &context.graphicsCommandBuffers[deviceIndex][context.imageIndex[deviceIndex]];
-    //TODO: check if this is actually needed
-    vulkan_material_shader_use(&context,&context.materialShaders[deviceIndex],deviceIndex);
-
-    vulkan_material_shader_set_model(&context,&context.materialShaders[deviceIndex],data.model,deviceIndex);
     Material* m = 0;
     if(data.geometry->material){
         m = data.geometry->material;
@@ -1001,7 +1040,15 @@ void vulkan_renderer_backend_draw_geometry(RendererBackend* backend, GeometryRen
     else{
         m = material_system_get_default();
     }
-    vulkan_material_shader_apply_material(&context,&context.materialShaders[deviceIndex],m,deviceIndex);
+    VulkanMaterialShader* shader = find_material_shader(m->shaderId, deviceIndex);
+    if(!shader){
+        return;
+    }
+    //TODO: check if this is actually needed
+    vulkan_material_shader_use(&context,shader,deviceIndex);
+
+    vulkan_material_shader_set_model(&context,shader,data.model,deviceIndex);
+    vulkan_material_shader_apply_material(&context,shader,m,deviceIndex);
     
 
     
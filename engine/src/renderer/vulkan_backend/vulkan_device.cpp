@@ -1,3 +1,5 @@
+#define KLOG_CHANNEL LOG_CHANNEL_RENDERER
+
 #include "renderer/vulkan_backend/vulkan_device.h"
 #include "core/logger.h"
 #include "memory/kmemory.h"
@@ -9,7 +11,7 @@ typedef struct VulkanPhysicalDeviceRequirements
     b8 compute;
     b8 transfer;
     b8 present;
-    std::vector<const char *> deviceExtensionNames;
+    kfixed_vector<const char *, 8> deviceExtensionNames;
     b8 anisotropySampler;
     b8 discreteGpu;
 } VulkanPhysicalDeviceRequirements;
@@ -35,11 +37,11 @@ b8 vulkan_device_create(VulkanContext *context)
     }
 
     KINFO("Creating Logical devices");
-    context->device.logicalDevices = std::vector<VkDevice>(context->device.deviceCount);
-    context->device.graphicsQueues = std::vector<VkQueue>(context->device.deviceCount);
-    context->device.presentQueues = std::vector<VkQueue>(context->device.deviceCount);
-    context->device.transferQueues = std::vector<VkQueue>(context->device.deviceCount);
-    context->device.graphicsCommandPools = std::vector<VkCommandPool>(context->device.deviceCount);
+    context->device.logicalDevices.resize(context->device.deviceCount);
+    context->device.graphicsQueues.resize(context->device.deviceCount);
+    context->device.presentQueues.resize(context->device.deviceCount);
+    context->device.transferQueues.resize(context->device.deviceCount);
+    context->device.graphicsCommandPools.resize(context->device.deviceCount);
     for (int deviceIndex = 0; deviceIndex < context->device.deviceCount; deviceIndex++)
     {
 
@@ -157,14 +159,14 @@ void vulkan_device_destory(VulkanContext *context)
         KINFO("Destroying Logical device for %s",context->device.properties[deviceIndex].deviceName);
         vkDestroyDevice(context->device.logicalDevices[deviceIndex],context->allocator);
     }
-    context->device.logicalDevices.clear();
+    context->device.logicalDevices.reset();
 
     KINFO("Releasing Physical devices");
     for (int i = 0; i < context->device.deviceCount; i++)
     {
         context->device.physicalDevices[i] = VK_NULL_HANDLE;
     }
-    context->device.physicalDevices.clear();
+    context->device.physicalDevices.reset();
     context->device.deviceCount = 0;
 
     if (context->device.swapchainSupport.formats)
@@ -191,9 +193,9 @@ void vulkan_device_destory(VulkanContext *context)
         &context->device.swapchainSupport.capabilities,
         sizeof(context->device.swapchainSupport.capabilities));
 
-    context->device.graphicsQueueIndex.clear();
-    context->device.presentQueueIndex.clear();
-    context->device.transferQueueIndex.clear();
+    context->device.graphicsQueueIndex.reset();
+    context->device.presentQueueIndex.reset();
+    context->device.transferQueueIndex.reset();
 }
 
 void vulkan_device_query_swapchain_support(
@@ -280,11 +282,11 @@ b8 vulkan_create_physical_device_array(VulkanContext *context)
         KFATAL("No Vulkan Physical Devices found!");
         return false;
     }
-    context->device.physicalDevices = std::vector<VkPhysicalDevice>(deviceCount);
-    context->device.deviceNames = std::vector<const char*>(deviceCount);
-    context->device.presentQueueIndex = std::vector<u32>(deviceCount);
-    context->device.transferQueueIndex = std::vector<u32>(deviceCount);
-    context->device.graphicsQueueIndex = std::vector<u32>(deviceCount);
+    context->device.physicalDevices.resize(deviceCount);
+    context->device.deviceNames.resize(deviceCount);
+    context->device.presentQueueIndex.resize(deviceCount);
+    context->device.transferQueueIndex.resize(deviceCount);
+    context->device.graphicsQueueIndex.resize(deviceCount);
     
     VK_CHECK(vkEnumeratePhysicalDevices(context->instance, &deviceCount, context->device.physicalDevices.data()));
     for (int i = 0; i < deviceCount; i++)
@@ -411,7 +413,7 @@ b8 physical_device_meets_requirements(VkPhysicalDevice device, VkSurfaceKHR surf
     // }
     u32 queueFamilyCount = 0;
     vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, VK_NULL_HANDLE);
-    std::vector<VkQueueFamilyProperties> queueFamilyProperties = std::vector<VkQueueFamilyProperties>(queueFamilyCount);
+    kvector<VkQueueFamilyProperties> queueFamilyProperties(queueFamilyCount);
     vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilyProperties.data());
 
     // Look at each queue and see what queues it supports
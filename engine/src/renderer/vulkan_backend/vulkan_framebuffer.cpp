@@ -2,15 +2,12 @@
 
 #include "memory/kmemory.h"
 
-void vulkan_framebuffer_create(VulkanContext* context, VulkanRenderpass* renderpass,u32 width,u32 height,u32 attachmentCount,std::vector<VkImageView> attachments,VulkanFramebuffer* framebuffer,int deviceIndex){
-    framebuffer->attachments = std::vector<VkImageView>(attachmentCount);
-    for(int i=0; i < attachmentCount; i++){
-        framebuffer->attachments[i] = attachments[i];
-    }
+void vulkan_framebuffer_create(VulkanContext* context, VulkanRenderpass* renderpass,u32 width,u32 height,kspan<const VkImageView> attachments,VulkanFramebuffer* framebuffer,int deviceIndex){
+    framebuffer->attachments.assign(attachments);
     framebuffer->renderpass = renderpass;
-    framebuffer->attachmentCount = attachmentCount;
+    framebuffer->attachmentCount = attachments.size();
     VkFramebufferCreateInfo framebufferCreateInfo{VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO};
-    framebufferCreateInfo.attachmentCount = attachmentCount;
+    framebufferCreateInfo.attachmentCount = framebuffer->attachmentCount;
     framebufferCreateInfo.renderPass = renderpass->handle;
     framebufferCreateInfo.pAttachments = framebuffer->attachments.data();
     framebufferCreateInfo.width = width;
@@ -1,3 +1,5 @@
+#define KLOG_CHANNEL LOG_CHANNEL_RENDERER
+
 #include "renderer/vulkan_backend/vulkan_image.h"
 #include "renderer/vulkan_backend/vulkan_device.h"
 #include "core/logger.h"
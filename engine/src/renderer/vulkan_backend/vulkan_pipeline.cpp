@@ -1,3 +1,5 @@
+#define KLOG_CHANNEL LOG_CHANNEL_RENDERER
+
 #include "renderer/vulkan_backend/vulkan_pipeline.h"
 #include "memory/kmemory.h"
 #include "math/math_types.h"
@@ -8,7 +8,7 @@
 #include <X11/Xlib-xcb.h>  // sudo apt-get install libxkbcommon-x11-dev
 #include "core/logger.h"
 
-void platform_get_required_extension_names(std::vector<const char*>* extensions){
+void platform_get_required_extension_names(kvector<const char*>* extensions){
     extensions->emplace_back("VK_KHR_xcb_surface");
 
 
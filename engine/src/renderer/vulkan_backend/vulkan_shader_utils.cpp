@@ -1,15 +1,12 @@
+#define KLOG_CHANNEL LOG_CHANNEL_RENDERER
+
 #include "renderer/vulkan_backend/vulkan_shader_utils.h"
 #include "core/logger.h"
-#include "core/kstring.h"
 #include "memory/kmemory.h"
 #include "systems/resource_system.h"
 
-b8 create_shader_module(VulkanContext* context, const char* name,const char* stageTypeString, VkShaderStageFlagBits shaderStageFlag, u32 stageIndex, VulkanShaderStage* shaderStages,int deviceIndex){
-
-    // build filename
+b8 create_shader_module(VulkanContext* context, const char* filename, VkShaderStageFlagBits shaderStageFlag, u32 stageIndex, VulkanShaderStage* shaderStages,int deviceIndex){
 
-    char filename[512];
-    string_format(filename,"shaders/%s.%s.spv",name,stageTypeString);
     kzero_memory(&shaderStages[stageIndex],sizeof(VkShaderModuleCreateInfo));
     shaderStages[stageIndex].createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
     shaderStages[stageIndex].shaderStageCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
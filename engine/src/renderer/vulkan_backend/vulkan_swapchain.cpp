@@ -1,3 +1,5 @@
+#define KLOG_CHANNEL LOG_CHANNEL_RENDERER
+
 #include "renderer/vulkan_backend/vulkan_swapchain.h"
 
 #include "core/logger.h"
@@ -130,8 +132,8 @@ void create( VulkanContext *context, u32 width,u32 height,VulkanSwapchain *swapc
     swapchain->imageCount = 0;
     VK_CHECK(vkGetSwapchainImagesKHR(context->device.logicalDevices[deviceIndex],swapchain->handle,&swapchain->imageCount,VK_NULL_HANDLE));
     swapchain->maxFramesInFlight = swapchain->imageCount - 1;
-    swapchain->images = std::vector<VkImage>(swapchain->imageCount);
-    swapchain->views = std::vector<VkImageView>(swapchain->imageCount);
+    swapchain->images.resize(swapchain->imageCount);
+    swapchain->views.resize(swapchain->imageCount);
     VK_CHECK(vkGetSwapchainImagesKHR(context->device.logicalDevices[deviceIndex],swapchain->handle,&swapchain->imageCount,swapchain->images.data()));
 
      for (u32 i = 0; i < swapchain->imageCount; ++i) {
@@ -1,3 +1,5 @@
+#define KLOG_CHANNEL LOG_CHANNEL_RESOURCES
+
 #include "resources/loaders/binary_loader.h"
 #include "core/logger.h"
 
@@ -41,8 +43,6 @@ b8 binary_loader_load( ResourceLoader* self, const char* name, Resource* resourc
 
 
 
-    // TODO: Should be using an allocator here.
-
     resource->fullPath = string_duplicate(full_file_path);
 
 
@@ -129,13 +129,9 @@ void binary_loader_unload(ResourceLoader* self, Resource* resource) {
 
 
 
-    u32 path_length = string_length(resource->fullPath);
+    string_free(resource->fullPath);
 
-    if (path_length) {
-
-        kfree(resource->fullPath, sizeof(char) * path_length + 1, MEMORY_TAG_STRING);
-
-    }
+    resource->fullPath = 0;
 
 
 
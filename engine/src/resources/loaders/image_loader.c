@@ -1,3 +1,5 @@
+#define KLOG_CHANNEL LOG_CHANNEL_RESOURCES
+
 #include "resources/loaders/image_loader.h"
 
 #include "core/logger.h"
@@ -5,19 +7,102 @@
 #include "memory/kmemory.h"
 #include "resources/resource_types.h"
 #include "systems/resource_system.h"
+#include "memory/stack_allocator.h"
+#include "platform/platform.h"
+
+#define IMAGE_LOADER_PATH_LENGTH 512
 
+// stb_image allocates through these. The decoded image is handed to the texture as it is,
+// so it comes from the heap; the decode temporaries come from the resource system's scratch stack.
+static void* image_loader_malloc(u64 size);
+static void* image_loader_realloc(void* block, u64 oldSize, u64 newSize);
+static void image_loader_free(void* block);
+
+#define STBI_MALLOC(sz) image_loader_malloc(sz)
+#define STBI_REALLOC_SIZED(p, oldsz, newsz) image_loader_realloc(p, oldsz, newsz)
+#define STBI_FREE(p) image_loader_free(p)
 #define STB_IMAGE_IMPLEMENTATION
 #include "vendor/stb_image.h"
 
+// The image being decoded on this thread.
+typedef struct ImageLoaderDecode {
+    // The size of the decoded image, or 0 if it is not known.
+    u64 pixelsSize;
+    // The heap block given to stb_image for the decoded image, if it has asked for it.
+    void* pixels;
+} ImageLoaderDecode;
+
+static KTHREAD_LOCAL ImageLoaderDecode decode;
+
+static void* image_loader_malloc(u64 size) {
+    // stb_image allocates the decoded image at its final size. Nothing before it is that size, except
+    // in rare cases such as an image one pixel wide. Those are caught when the decode finishes.
+    if (decode.pixelsSize && size == decode.pixelsSize && !decode.pixels) {
+        decode.pixels = kallocate(size, MEMORY_TAG_TEXTURE);
+        return decode.pixels;
+    }
+    StackAllocator* scratch = resource_system_scratch_allocator();
+    // Checked first, as the stack reports every allocation that does not fit as an error.
+    b8 fits = scratch && size <= scratch->linear.totalSize - scratch->linear.allocated;
+    void* block = fits ? stack_allocator_allocate(scratch, size) : 0;
+    if (!block) {
+        // Too big for the scratch stack, so fall back to the heap like stb_image would.
+        block = platform_allocate(size, false);
+    }
+    return block;
+}
+
+static void* image_loader_realloc(void* block, u64 oldSize, u64 newSize) {
+    if (!block) {
+        return image_loader_malloc(newSize);
+    }
+    StackAllocator* scratch = resource_system_scratch_allocator();
+    if (stack_allocator_owns(scratch, block)) {
+        // The most recent allocation can simply grow in place.
+        u8* top = (u8*)scratch->linear.memory + scratch->linear.allocated;
+        if ((u8*)block + oldSize == top && newSize >= oldSize && scratch->linear.allocated + (newSize - oldSize) <= scratch->linear.totalSize) {
+            stack_allocator_allocate_aligned(scratch, newSize - oldSize, 1);
+            return block;
+        }
+    }
+    void* newBlock = image_loader_malloc(newSize);
+    if (newBlock) {
+        kcopy_memory(newBlock, block, oldSize < newSize ? oldSize : newSize);
+        image_loader_free(block);
+    }
+    return newBlock;
+}
+
+static void image_loader_free(void* block) {
+    if (block && block == decode.pixels) {
+        kfree(block, decode.pixelsSize, MEMORY_TAG_TEXTURE);
+        decode.pixels = 0;
+        return;
+    }
+    // Scratch memory is released all at once when the load finishes.
+    if (block && !stack_allocator_owns(resource_system_scratch_allocator(), block)) {
+        platform_free(block, false);
+    }
+}
+
 b8 image_loader_load(ResourceLoader* self,const char* name,Resource* resource){
      if (!self || !name || !resource) {
         return false;
     }
 
+    // Everything stb_image allocates from the scratch stack is released when this function returns.
+    StackAllocator* scratch = resource_system_scratch_allocator();
+    STACK_ALLOCATOR_SCOPE(scratchScope, scratch);
+    char* full_file_path = stack_allocator_allocate(scratch, IMAGE_LOADER_PATH_LENGTH);
+    if (!full_file_path) {
+        KERROR("image_loader_load - not enough scratch memory to load '%s'.", name);
+        return false;
+    }
+
     char* format_str = "%s/%s/%s%s";
     const i32 required_channel_count = 4;
-    stbi_set_flip_vertically_on_load(true);
-    char full_file_path[512];
+    // Images may be loaded on several threads at once, so use the per-thread setting.
+    stbi_set_flip_vertically_on_load_thread(true);
 
     // TODO: try different extensions
     string_format(full_file_path, format_str, resource_system_base_path(), self->typePath, name, ".png");
@@ -26,6 +111,15 @@ b8 image_loader_load(ResourceLoader* self,const char* name,Resource* resource){
     i32 height;
     i32 channel_count;
 
+    // Reading the header first tells the allocation hooks which block is the decoded image.
+    decode.pixels = 0;
+    decode.pixelsSize = 0;
+    if (stbi_info(full_file_path, &width, &height, &channel_count)) {
+        decode.pixelsSize = (u64)width * height * required_channel_count;
+    }
+    // Probing the other formats leaves a failure reason behind, even when the header was read.
+    stbi__err(0, 0);
+
     // For now, assume 8 bits per channel, 4 channels.
     // TODO: extend this to make it configurable.
     u8* data = stbi_load(
@@ -45,20 +139,35 @@ b8 image_loader_load(ResourceLoader* self,const char* name,Resource* resource){
         if (data) {
             stbi_image_free(data);
         }
+        image_loader_free(decode.pixels);
+        decode.pixelsSize = 0;
         return false;
     }
 
     if (!data) {
         KERROR("Image resource loader failed to load file '%s'.", full_file_path);
+        image_loader_free(decode.pixels);
+        decode.pixelsSize = 0;
         return false;
     }
 
-    // TODO: Should be using an allocator here.
     resource->fullPath = string_duplicate(full_file_path);
 
-    // TODO: Should be using an allocator here.
-    ImageResourceData* resourceData = kallocate(sizeof(ImageResourceData), MEMORY_TAG_TEXTURE);
-    resourceData->pixels = data;
+    // Normally the decoded image is already the heap block, and is kept as it is. Otherwise
+    // it outlives the scratch memory, so keep a copy of just the pixels.
+    u64 pixelsSize = (u64)width * height * required_channel_count;
+    u8* pixels = data;
+    if (data != decode.pixels || pixelsSize != decode.pixelsSize) {
+        pixels = kallocate(pixelsSize, MEMORY_TAG_TEXTURE);
+        kcopy_memory(pixels, data, pixelsSize);
+        stbi_image_free(data);
+        image_loader_free(decode.pixels);
+    }
+    decode.pixels = 0;
+    decode.pixelsSize = 0;
+
+    ImageResourceData* resourceData = kallocate_pooled(sizeof(ImageResourceData), MEMORY_TAG_TEXTURE);
+    resourceData->pixels = pixels;
     resourceData->width = width;
     resourceData->height = height;
     resourceData->channelCount = required_channel_count;
@@ -76,13 +185,14 @@ void image_loader_unload(ResourceLoader* self, Resource* resource) {
         return;
     }
 
-    u32 path_length = string_length(resource->fullPath);
-    if (path_length) {
-        kfree(resource->fullPath, sizeof(char) * path_length + 1, MEMORY_TAG_STRING);
-    }
+    string_free(resource->fullPath);
+
+    resource->fullPath = 0;
 
     if (resource->data) {
-        kfree(resource->data, resource->dataSize, MEMORY_TAG_TEXTURE);
+        ImageResourceData* resourceData = resource->data;
+        kfree(resourceData->pixels, (u64)resourceData->width * resourceData->height * resourceData->channelCount, MEMORY_TAG_TEXTURE);
+        kfree_pooled(resource->data, resource->dataSize, MEMORY_TAG_TEXTURE);
         resource->data = 0;
         resource->dataSize = 0;
         resource->loaderId = INVALID_ID;
@@ -1,7 +1,10 @@
+#define KLOG_CHANNEL LOG_CHANNEL_RESOURCES
+
 #include "resources/loaders/material_loader.h"
 
 #include "core/logger.h"
 #include "core/kstring.h"
+#include "core/string_id.h"
 #include "memory/kmemory.h"
 #include "resources/resource_types.h"
 #include "systems/resource_system.h"
@@ -21,11 +24,10 @@ b8 material_loader_load(ResourceLoader* self,const char* name,Resource* resource
         KERROR("material_loader_load Could not open file '%s' ",fullFilePath);
         return false;
     }
-    // TODO: Should be using an allocator here.
     resource->fullPath = string_duplicate(fullFilePath);
 
-    // TODO: Should be using an allocator here.
-    MaterialConfig* resourceData = kallocate(sizeof(MaterialConfig), MEMORY_TAG_MATERIAL_INSTANCE);
+    MaterialConfig* resourceData = kallocate_pooled(sizeof(MaterialConfig), MEMORY_TAG_MATERIAL_INSTANCE);
+    resourceData->shaderId = string_id(BUILTIN_SHADER_NAME_MATERIAL);
     resourceData->autoRelease = true;
     resourceData->diffuseColour = vec4_one();
     resourceData->diffuseMapName[0] = 0;
@@ -67,6 +69,8 @@ b8 material_loader_load(ResourceLoader* self,const char* name,Resource* resource
             // TODO: version
         } else if (strings_equali(trimmed_var_name, "name")) {
             string_ncopy(resourceData->name, trimmed_value, MATERIAL_NAME_MAX_LENGTH);
+        } else if (strings_equali(trimmed_var_name, "shader")) {
+            resourceData->shaderId = string_id(trimmed_value);
         } else if (strings_equali(trimmed_var_name, "diffuse_map_name")) {
             string_ncopy(resourceData->diffuseMapName, trimmed_value, TEXTURE_NAME_MAX_LENGTH);
         } else if (strings_equali(trimmed_var_name, "diffuse_colour")) {
@@ -99,13 +103,12 @@ void material_loader_unload(ResourceLoader* self, Resource* resource) {
         return;
     }
 
-    u32 path_length = string_length(resource->fullPath);
-    if (path_length) {
-        kfree(resource->fullPath, sizeof(char) * path_length + 1, MEMORY_TAG_STRING);
-    }
+    string_free(resource->fullPath);
+
+    resource->fullPath = 0;
 
     if (resource->data) {
-        kfree(resource->data, resource->dataSize, MEMORY_TAG_TEXTURE);
+        kfree_pooled(resource->data, resource->dataSize, MEMORY_TAG_MATERIAL_INSTANCE);
         resource->data = 0;
         resource->dataSize = 0;
         resource->loaderId = INVALID_ID;
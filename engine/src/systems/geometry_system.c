@@ -1,10 +1,16 @@
+#define KLOG_CHANNEL LOG_CHANNEL_SYSTEMS
+
 #include "core/logger.h"
 #include "core/kstring.h"
+#include "core/string_intern.h"
+#include "core/parallel_for.h"
 #include "memory/kmemory.h"
+#include "containers/slot_map.h"
 
 #include "systems/geometry_system.h"
 #include "systems/material_system.h"
 #include "renderer/renderer_frontend.h"
+#include "core/profiler.h"
 
 
 typedef struct GeometryReference{
@@ -16,7 +22,8 @@ typedef struct GeometryReference{
 typedef struct GeometrySystemState{
     GeometrySystemConfig config;
     Geometry defaultGeometry;
-    GeometryReference* registeredGeometries;
+    // Registered geometries, addressed by handle.
+    SlotMap registeredGeometries;
 }GeometrySystemState;
 
 static GeometrySystemState* statePtr = 0;
@@ -33,29 +40,22 @@ b8 geometry_system_initialize(u64* memory_requirement, void* state, GeometrySyst
         return false;
     }
 
-    // Block of memory will contain state structure, then block for array, then block for hashtable.
+    // Block of memory will contain state structure, then block for array.
     u64 struct_requirement = sizeof(GeometrySystemState);
-    u64 array_requirement = sizeof(Geometry) * config.maxGeometryCount;
+    u64 array_requirement = slot_map_memory_requirement(sizeof(GeometryReference), config.maxGeometryCount);
     *memory_requirement = struct_requirement + array_requirement;
 
     if (!state) {
         return true;
     }
+    KPROFILE_SCOPE("geometry_system_initialize");
 
     statePtr = state;
     statePtr->config = config;
 
     // The array block is after the state. Already allocated, so just set the pointer.
     void* array_block = state + struct_requirement;
-    statePtr->registeredGeometries = array_block;
-
-    // Invalidate all geometries in the array.
-    u32 count = statePtr->config.maxGeometryCount;
-    for (u32 i = 0; i < count; ++i) {
-        statePtr->registeredGeometries[i].geometry.id = INVALID_ID;
-        statePtr->registeredGeometries[i].geometry.internalId = INVALID_ID;
-        statePtr->registeredGeometries[i].geometry.generation = INVALID_ID;
-    }
+    slot_map_create(sizeof(GeometryReference), config.maxGeometryCount, array_block, &statePtr->registeredGeometries);
 
     if (!create_default_geometry(statePtr)) {
         KFATAL("Failed to create default geometry. Application cannot continue.");
@@ -71,36 +71,34 @@ void geometry_system_shutdown(void* state){
 }
 
 Geometry* geometry_system_acquire_by_id(u32 id){
-        if (id != INVALID_ID && statePtr->registeredGeometries[id].geometry.id != INVALID_ID) {
-        statePtr->registeredGeometries[id].referenceCount++;
-        return &statePtr->registeredGeometries[id].geometry;
+    GeometryReference* ref = slot_map_get(&statePtr->registeredGeometries, id);
+    if (ref) {
+        ref->referenceCount++;
+        return &ref->geometry;
     }
 
     // NOTE: Should return default geometry instead?
-    KERROR("geometry_system_acquire_by_id cannot load invalid geometry id. Returning nullptr.");
+    KERROR("geometry_system_acquire_by_id cannot load invalid or stale geometry id. Returning nullptr.");
     return 0;
 }
 
 Geometry* geometry_system_acquire_from_config(GeometryConfig config, b8 auto_release){
-    Geometry* g = 0;
-    for (u32 i = 0; i < statePtr->config.maxGeometryCount; ++i) {
-        if (statePtr->registeredGeometries[i].geometry.id == INVALID_ID) {
-            // Found empty slot.
-            statePtr->registeredGeometries[i].autoRelease = auto_release;
-            statePtr->registeredGeometries[i].referenceCount = 1;
-            g = &statePtr->registeredGeometries[i].geometry;
-            g->id = i;
-            break;
-        }
-    }
-
-    if (!g) {
+    u32 handle;
+    GeometryReference* ref = slot_map_insert(&statePtr->registeredGeometries, &handle);
+    if (!ref) {
         KERROR("Unable to obtain free slot for geometry. Adjust configuration to allow more space. Returning nullptr.");
         return 0;
     }
+    ref->autoRelease = auto_release;
+    ref->referenceCount = 1;
+    Geometry* g = &ref->geometry;
+    g->id = handle;
+    g->internalId = INVALID_ID;
+    g->generation = INVALID_ID;
 
     if (!create_geometry(statePtr, config, g)) {
         KERROR("Failed to create geometry. Returning nullptr.");
+        slot_map_remove(&statePtr->registeredGeometries, handle);
         return 0;
     }
 
@@ -108,11 +106,10 @@ Geometry* geometry_system_acquire_from_config(GeometryConfig config, b8 auto_rel
 }
 void geometry_system_release(Geometry* geometry){
      if (geometry && geometry->id != INVALID_ID) {
-        GeometryReference* ref = &statePtr->registeredGeometries[geometry->id];
-
-        // Take a copy of the id;
+        // Take a copy of the id, since destroying the geometry blanks it out.
         u32 id = geometry->id;
-        if (ref->geometry.id == geometry->id) {
+        GeometryReference* ref = slot_map_get(&statePtr->registeredGeometries, id);
+        if (ref) {
             if (ref->referenceCount > 0) {
                 ref->referenceCount--;
             }
@@ -122,9 +119,10 @@ void geometry_system_release(Geometry* geometry){
                 destroy_geometry(statePtr, &ref->geometry);
                 ref->referenceCount = 0;
                 ref->autoRelease = false;
+                slot_map_remove(&statePtr->registeredGeometries, id);
             }
         } else {
-            KFATAL("Geometry id mismatch. Check registration logic, as this should never occur.");
+            KWARN("geometry_system_release - geometry id %u is stale, it has already been released.", id);
         }
         return;
     }
@@ -141,46 +139,35 @@ Geometry* geometry_system_get_default(){
     return 0;
 
 }
-GeometryConfig geometry_system_generate_plane_config(f32 width, f32 height, u32 x_segment_count, u32 y_segment_count, f32 tile_x, f32 tile_y, const char* name, const char* material_name){
-
-    if (width == 0) {
-        KWARN("Width must be nonzero. Defaulting to one.");
-        width = 1.0f;
-    }
-    if (height == 0) {
-        KWARN("Height must be nonzero. Defaulting to one.");
-        height = 1.0f;
-    }
-    if (x_segment_count < 1) {
-        KWARN("x_segment_count must be a positive number. Defaulting to one.");
-        x_segment_count = 1;
-    }
-    if (y_segment_count < 1) {
-        KWARN("y_segment_count must be a positive number. Defaulting to one.");
-        y_segment_count = 1;
-    }
-
-    if (tile_x == 0) {
-        KWARN("tile_x must be nonzero. Defaulting to one.");
-        tile_x = 1.0f;
-    }
-    if (tile_y == 0) {
-        KWARN("tile_y must be nonzero. Defaulting to one.");
-        tile_y = 1.0f;
-    }
-
-    GeometryConfig config;
-    config.vertexCount = x_segment_count * y_segment_count * 4;  // 4 verts per segment
-    config.vertices = kallocate(sizeof(Vertex3D) * config.vertexCount, MEMORY_TAG_ARRAY);
-    config.indexCount = x_segment_count * y_segment_count * 6;  // 6 indices per segment
-    config.indices = kallocate(sizeof(u32) * config.indexCount, MEMORY_TAG_ARRAY);
 
-    // TODO: This generates extra vertices, but we can always deduplicate them later.
-    f32 seg_width = width / x_segment_count;
-    f32 seg_height = height / y_segment_count;
-    f32 half_width = width * 0.5f;
-    f32 half_height = height * 0.5f;
-    for (u32 y = 0; y < y_segment_count; ++y) {
+// The fewest plane segments worth generating on another thread.
+#define PLANE_SEGMENTS_PER_GRAIN 4096
+
+typedef struct PlaneGeneration {
+    Vertex3D* vertices;
+    u32* indices;
+    u32 x_segment_count;
+    u32 y_segment_count;
+    f32 seg_width;
+    f32 seg_height;
+    f32 half_width;
+    f32 half_height;
+    f32 tile_x;
+    f32 tile_y;
+} PlaneGeneration;
+
+// Generates the segments of rows [row_begin, row_end). Each segment writes only its own vertices and indices.
+static void generate_plane_rows(u64 row_begin, u64 row_end, void* user) {
+    const PlaneGeneration* plane = user;
+    u32 x_segment_count = plane->x_segment_count;
+    u32 y_segment_count = plane->y_segment_count;
+    f32 seg_width = plane->seg_width;
+    f32 seg_height = plane->seg_height;
+    f32 half_width = plane->half_width;
+    f32 half_height = plane->half_height;
+    f32 tile_x = plane->tile_x;
+    f32 tile_y = plane->tile_y;
+    for (u32 y = (u32)row_begin; y < (u32)row_end; ++y) {
         for (u32 x = 0; x < x_segment_count; ++x) {
             // Generate vertices
             f32 min_x = (x * seg_width) - half_width;
@@ -193,10 +180,10 @@ GeometryConfig geometry_system_generate_plane_config(f32 width, f32 height, u32
             f32 max_uvy = ((y + 1) / (f32)y_segment_count) * tile_y;
 
             u32 v_offset = ((y * x_segment_count) + x) * 4;
-            Vertex3D* v0 = &config.vertices[v_offset + 0];
-            Vertex3D* v1 = &config.vertices[v_offset + 1];
-            Vertex3D* v2 = &config.vertices[v_offset + 2];
-            Vertex3D* v3 = &config.vertices[v_offset + 3];
+            Vertex3D* v0 = &plane->vertices[v_offset + 0];
+            Vertex3D* v1 = &plane->vertices[v_offset + 1];
+            Vertex3D* v2 = &plane->vertices[v_offset + 2];
+            Vertex3D* v3 = &plane->vertices[v_offset + 3];
 
             v0->position.x = min_x;
             v0->position.y = min_y;
@@ -220,14 +207,65 @@ GeometryConfig geometry_system_generate_plane_config(f32 width, f32 height, u32
 
             // Generate indices
             u32 i_offset = ((y * x_segment_count) + x) * 6;
-            config.indices[i_offset + 0] = v_offset + 0;
-            config.indices[i_offset + 1] = v_offset + 1;
-            config.indices[i_offset + 2] = v_offset + 2;
-            config.indices[i_offset + 3] = v_offset + 0;
-            config.indices[i_offset + 4] = v_offset + 3;
-            config.indices[i_offset + 5] = v_offset + 1;
+            plane->indices[i_offset + 0] = v_offset + 0;
+            plane->indices[i_offset + 1] = v_offset + 1;
+            plane->indices[i_offset + 2] = v_offset + 2;
+            plane->indices[i_offset + 3] = v_offset + 0;
+            plane->indices[i_offset + 4] = v_offset + 3;
+            plane->indices[i_offset + 5] = v_offset + 1;
         }
     }
+}
+
+GeometryConfig geometry_system_generate_plane_config(f32 width, f32 height, u32 x_segment_count, u32 y_segment_count, f32 tile_x, f32 tile_y, const char* name, const char* material_name){
+
+    if (width == 0) {
+        KWARN("Width must be nonzero. Defaulting to one.");
+        width = 1.0f;
+    }
+    if (height == 0) {
+        KWARN("Height must be nonzero. Defaulting to one.");
+        height = 1.0f;
+    }
+    if (x_segment_count < 1) {
+        KWARN("x_segment_count must be a positive number. Defaulting to one.");
+        x_segment_count = 1;
+    }
+    if (y_segment_count < 1) {
+        KWARN("y_segment_count must be a positive number. Defaulting to one.");
+        y_segment_count = 1;
+    }
+
+    if (tile_x == 0) {
+        KWARN("tile_x must be nonzero. Defaulting to one.");
+        tile_x = 1.0f;
+    }
+    if (tile_y == 0) {
+        KWARN("tile_y must be nonzero. Defaulting to one.");
+        tile_y = 1.0f;
+    }
+
+    GeometryConfig config;
+    config.vertexCount = x_segment_count * y_segment_count * 4;  // 4 verts per segment
+    config.vertices = kallocate(sizeof(Vertex3D) * config.vertexCount, MEMORY_TAG_ARRAY);
+    config.indexCount = x_segment_count * y_segment_count * 6;  // 6 indices per segment
+    config.indices = kallocate(sizeof(u32) * config.indexCount, MEMORY_TAG_ARRAY);
+
+    // TODO: This generates extra vertices, but we can always deduplicate them later.
+    PlaneGeneration plane;
+    plane.vertices = config.vertices;
+    plane.indices = config.indices;
+    plane.x_segment_count = x_segment_count;
+    plane.y_segment_count = y_segment_count;
+    plane.seg_width = width / x_segment_count;
+    plane.seg_height = height / y_segment_count;
+    plane.half_width = width * 0.5f;
+    plane.half_height = height * 0.5f;
+    plane.tile_x = tile_x;
+    plane.tile_y = tile_y;
+    // Rows are split between threads, enough of them per grain to be worth a job.
+    u64 rows_per_grain = PLANE_SEGMENTS_PER_GRAIN / x_segment_count + 1;
+    parallel_for(0, y_segment_count, rows_per_grain, generate_plane_rows, &plane);
 
     if (name && string_length(name) > 0) {
         string_ncopy(config.name, name, GEOMETRY_NAME_MAX_LENGTH);
@@ -272,6 +310,12 @@ b8 create_default_geometry(GeometrySystemState* state){
 
     u32 indices[6] = {0, 1, 2, 0, 3, 1};
 
+    // The default geometry is not registered, so it has no id, and is not yet known to the renderer.
+    state->defaultGeometry.id = INVALID_ID;
+    state->defaultGeometry.internalId = INVALID_ID;
+    state->defaultGeometry.generation = INVALID_ID;
+    state->defaultGeometry.nameId = string_intern(DEFAULT_GEOMETRY_NAME);
+
     // Send the geometry off to the renderer to be uploaded to the GPU.
     if (!renderer_create_geometry(&state->defaultGeometry, 4, verts, 6, indices)) {
         KFATAL("Failed to create default geometry. Application cannot continue.");
@@ -285,11 +329,10 @@ b8 create_default_geometry(GeometrySystemState* state){
 
 }
 b8 create_geometry(GeometrySystemState* state, GeometryConfig config, Geometry* g){
+    g->nameId = string_intern(config.name);
         // Send the geometry off to the renderer to be uploaded to the GPU.
     if (!renderer_create_geometry(g, config.vertexCount, config.vertices, config.indexCount, config.indices)) {
-        // Invalidate the entry.
-        state->registeredGeometries[g->id].referenceCount = 0;
-        state->registeredGeometries[g->id].autoRelease = false;
+        // Invalidate the entry. The caller frees its slot.
         g->id = INVALID_ID;
         g->generation = INVALID_ID;
         g->internalId = INVALID_ID;
@@ -313,10 +356,10 @@ void destroy_geometry(GeometrySystemState* state, Geometry* g){
     g->internalId = INVALID_ID;
     g->generation = INVALID_ID;
     g->id = INVALID_ID;
-    string_empty(g->name);
+    g->nameId = STRING_ID_EMPTY;
      // Release the material.
-    if (g->material && string_length(g->material->name) > 0) {
-        material_system_release(g->material->name);
+    if (g->material && g->material->nameId != STRING_ID_EMPTY) {
+        material_system_release(string_intern_get(g->material->nameId));
         g->material = 0;
     }
 
@@ -1,11 +1,17 @@
+#define KLOG_CHANNEL LOG_CHANNEL_SYSTEMS
+
 #include "systems/material_system.h"
 #include "core/logger.h"
 #include "core/kstring.h"
 #include "containers/hashtable.h"
+#include "core/string_intern.h"
+#include "core/string_id.h"
+#include "containers/slot_map.h"
 #include "math/kmath.h"
 #include "renderer/renderer_frontend.h"
 #include "systems/texture_system.h"
 #include "systems/resource_system.h"
+#include "core/profiler.h"
 
 
 typedef struct MaterialSystemState {
@@ -13,8 +19,8 @@ typedef struct MaterialSystemState {
 
     Material defaultMaterial;
 
-    // Array of registered materials.
-    Material* registeredMaterials;
+    // Registered materials, addressed by handle.
+    SlotMap registeredMaterials;
 
     // Hashtable for material lookups.
     HashTable registeredMaterialTable;
@@ -30,6 +36,8 @@ static MaterialSystemState* statePtr = 0;
 
 b8 create_defaultMaterial(MaterialSystemState* state);
 b8 load_material(MaterialConfig config, Material* m);
+b8 create_placeholder_material(u32 nameId, Material* m);
+void on_material_loaded(Resource* materialResource, void* user);
 void destroy_material(Material* m);
 
 
@@ -41,20 +49,21 @@ b8 material_system_initialize(u64* memory_requirement, void* state, MaterialSyst
     }
     // Block of memory will contain state structure, then block for array, then block for hashtable.
     u64 struct_requirement = sizeof(MaterialSystemState);
-    u64 array_requirement = sizeof(Material) * config.maxMaterialCount;
-    u64 hashtable_requirement = sizeof(MaterialReference) * config.maxMaterialCount;
+    u64 array_requirement = slot_map_memory_requirement(sizeof(Material), config.maxMaterialCount);
+    u64 hashtable_requirement = hashtable_memory_requirement(sizeof(MaterialReference), config.maxMaterialCount);
     *memory_requirement = struct_requirement + array_requirement + hashtable_requirement;
 
     if (!state) {
         return true;
     }
+    KPROFILE_SCOPE("material_system_initialize");
 
     statePtr = state;
     statePtr->config = config;
 
     // The array block is after the state. Already allocated, so just set the pointer.
     void* array_block = state + struct_requirement;
-    statePtr->registeredMaterials = array_block;
+    slot_map_create(sizeof(Material), config.maxMaterialCount, array_block, &statePtr->registeredMaterials);
 
     // Hashtable block is after array.
     void* hashtable_block = array_block + array_requirement;
@@ -69,14 +78,6 @@ b8 material_system_initialize(u64* memory_requirement, void* state, MaterialSyst
     invalid_ref.referenceCount = 0;
     hashtable_fill(&statePtr->registeredMaterialTable, &invalid_ref);
 
-    // Invalidate all materials in the array.
-    u32 count = statePtr->config.maxMaterialCount;
-    for (u32 i = 0; i < count; ++i) {
-        statePtr->registeredMaterials[i].id = INVALID_ID;
-        statePtr->registeredMaterials[i].generation = INVALID_ID;
-        statePtr->registeredMaterials[i].internalId = INVALID_ID;
-    }
-
     if (!create_defaultMaterial(statePtr)) {
         KFATAL("Failed to create default material. Application cannot continue.");
         return false;
@@ -90,16 +91,14 @@ b8 material_system_initialize(u64* memory_requirement, void* state, MaterialSyst
 void material_system_shutdown(void* state){
     MaterialSystemState* s = (MaterialSystemState*)state;
     if (s) {
-        // Invalidate all materials in the array.
-        u32 count = s->config.maxMaterialCount;
-        for (u32 i = 0; i < count; ++i) {
-            if (s->registeredMaterials[i].id != INVALID_ID) {
-                destroy_material(&s->registeredMaterials[i]);
-            }
+        // Destroy all registered materials.
+        for (u32 i = 0; i < s->registeredMaterials.count; ++i) {
+            destroy_material(slot_map_at(&s->registeredMaterials, i, 0));
         }
 
         // Destroy the default material.
         destroy_material(&s->defaultMaterial);
+        hashtable_destroy(&s->registeredMaterialTable);
     }
 
     statePtr = 0;
@@ -127,33 +126,25 @@ Material* material_system_acquire(const char* name){
 
 Material* material_system_acquire_from_config(MaterialConfig config){
 
+    // Names are looked up by their interned id, which also makes the lookup case-insensitive.
+    u32 nameId = string_intern(config.name);
+
     // Return default material.
-    if (strings_equali(config.name, DEFAULT_MATERIAL_NAME)) {
+    if (statePtr && nameId == statePtr->defaultMaterial.nameId) {
         return &statePtr->defaultMaterial;
     }
 
     MaterialReference ref;
-    if (statePtr && hashtable_get(&statePtr->registeredMaterialTable, config.name, &ref)) {
+    if (statePtr && nameId != INVALID_ID && hashtable_get_id(&statePtr->registeredMaterialTable, nameId, &ref)) {
         // This can only be changed the first time a material is loaded.
         if (ref.referenceCount == 0) {
             ref.autoRelease = config.autoRelease;
         }
         ref.referenceCount++;
         if (ref.handle == INVALID_ID) {
-            // This means no material exists here. Find a free index first.
-            u32 count = statePtr->config.maxMaterialCount;
-            Material* m = 0;
-            for (u32 i = 0; i < count; ++i) {
-                if (statePtr->registeredMaterials[i].id == INVALID_ID) {
-                    // A free slot has been found. Use its index as the handle.
-                    ref.handle = i;
-                    m = &statePtr->registeredMaterials[i];
-                    break;
-                }
-            }
-
-            // Make sure an empty slot was actually found.
-            if (!m || ref.handle == INVALID_ID) {
+            // This means no material exists here. Take a free slot first.
+            Material* m = slot_map_insert(&statePtr->registeredMaterials, &ref.handle);
+            if (!m) {
                 KFATAL("material_system_acquire - Material system cannot hold anymore materials. Adjust configuration to allow more.");
                 return 0;
             }
@@ -161,6 +152,7 @@ Material* material_system_acquire_from_config(MaterialConfig config){
             // Create new material.
             if (!load_material(config, m)) {
                 KERROR("Failed to load material '%s'.", config.name);
+                slot_map_remove(&statePtr->registeredMaterials, ref.handle);
                 return 0;
             }
 
@@ -178,8 +170,8 @@ Material* material_system_acquire_from_config(MaterialConfig config){
         }
 
         // Update the entry.
-        hashtable_set(&statePtr->registeredMaterialTable, config.name, &ref);
-        return &statePtr->registeredMaterials[ref.handle];
+        hashtable_set_id(&statePtr->registeredMaterialTable, nameId, &ref);
+        return slot_map_get(&statePtr->registeredMaterials, ref.handle);
     }
 
     // NOTE: This would only happen in the event something went wrong with the state.
@@ -187,34 +179,89 @@ Material* material_system_acquire_from_config(MaterialConfig config){
     return 0;
 
 }
+Material* material_system_acquire_async(const char* name, b8 autoRelease){
+    u32 nameId = string_intern(name);
+
+    // Return default material.
+    if (statePtr && nameId == statePtr->defaultMaterial.nameId) {
+        return &statePtr->defaultMaterial;
+    }
+
+    MaterialReference ref;
+    if (statePtr && nameId != INVALID_ID && hashtable_get_id(&statePtr->registeredMaterialTable, nameId, &ref)) {
+        // This can only be changed the first time a material is loaded. Set with the reference,
+        // so a release before the configuration arrives already honours it.
+        if (ref.referenceCount == 0) {
+            ref.autoRelease = autoRelease;
+        }
+        ref.referenceCount++;
+        if (ref.handle == INVALID_ID) {
+            // This means no material exists here. Take a free slot first.
+            Material* m = slot_map_insert(&statePtr->registeredMaterials, &ref.handle);
+            if (!m) {
+                KFATAL("material_system_acquire_async - Material system cannot hold anymore materials. Adjust configuration to allow more.");
+                return 0;
+            }
+            if (!create_placeholder_material(nameId, m)) {
+                KERROR("Failed to create material '%s'.", name);
+                slot_map_remove(&statePtr->registeredMaterials, ref.handle);
+                return 0;
+            }
+            m->id = ref.handle;
+
+            // The handle tells the callback whether the material still exists when the configuration arrives.
+            if (!resource_system_load_async(name, RESOURCE_TYPE_MATERIAL, on_material_loaded, (void*)(u64)ref.handle)) {
+                KERROR("Failed to start loading material '%s'.", name);
+                destroy_material(m);
+                slot_map_remove(&statePtr->registeredMaterials, ref.handle);
+                return 0;
+            }
+            KTRACE("Material '%s' does not yet exist. Loading, and ref_count is now %i.", name, ref.referenceCount);
+        } else {
+            KTRACE("Material '%s' already exists, ref_count increased to %i.", name, ref.referenceCount);
+        }
+
+        // Update the entry.
+        hashtable_set_id(&statePtr->registeredMaterialTable, nameId, &ref);
+        return slot_map_get(&statePtr->registeredMaterials, ref.handle);
+    }
+
+    // NOTE: This would only happen in the event something went wrong with the state.
+    KERROR("material_system_acquire_async failed to acquire material '%s'. Null pointer will be returned.", name);
+    return 0;
+}
+
 void material_system_release(const char* name){
+    u32 nameId = string_intern_find(name);
+
     // Ignore release requests for the default material.
-    if (strings_equali(name, DEFAULT_MATERIAL_NAME)) {
+    if (statePtr && nameId == statePtr->defaultMaterial.nameId) {
         return;
     }
     MaterialReference ref;
-    if (statePtr && hashtable_get(&statePtr->registeredMaterialTable, name, &ref)) {
+    if (statePtr && nameId != INVALID_ID && hashtable_get_id(&statePtr->registeredMaterialTable, nameId, &ref)) {
         if (ref.referenceCount == 0) {
             KWARN("Tried to release non-existent material: '%s'", name);
             return;
         }
+        // Interned, so it remains valid after the material is destroyed.
+        const char* internedName = string_intern_get(nameId);
         ref.referenceCount--;
         if (ref.referenceCount == 0 && ref.autoRelease) {
-            Material* m = &statePtr->registeredMaterials[ref.handle];
+            Material* m = slot_map_get(&statePtr->registeredMaterials, ref.handle);
 
             // Destroy/reset material.
             destroy_material(m);
+            slot_map_remove(&statePtr->registeredMaterials, ref.handle);
 
-            // Reset the reference.
-            ref.handle = INVALID_ID;
-            ref.autoRelease = false;
-            KTRACE("Released material '%s'., Material unloaded because reference count=0 and auto_release=true.", name);
+            // Drop the reference, so the next acquire starts over from the default.
+            hashtable_remove_id(&statePtr->registeredMaterialTable, nameId);
+            KTRACE_LIMITED("Released material '%s'., Material unloaded because reference count=0 and auto_release=true.", internedName);
         } else {
-            KTRACE("Released material '%s', now has a reference count of '%i' (auto_release=%s).", name, ref.referenceCount, ref.autoRelease ? "true" : "false");
+            KTRACE_LIMITED("Released material '%s', now has a reference count of '%i' (auto_release=%s).", internedName, ref.referenceCount, ref.autoRelease ? "true" : "false");
+            // Update the entry.
+            hashtable_set_id(&statePtr->registeredMaterialTable, nameId, &ref);
         }
-
-        // Update the entry.
-        hashtable_set(&statePtr->registeredMaterialTable, name, &ref);
     } else {
         KERROR("material_system_release failed to release material '%s'.", name);
     }
@@ -225,7 +272,8 @@ b8 load_material(MaterialConfig config, Material* m){
     kzero_memory(m, sizeof(Material));
 
     // name
-    string_ncopy(m->name, config.name, MATERIAL_NAME_MAX_LENGTH);
+    m->nameId = string_intern(config.name);
+    m->shaderId = config.shaderId;
 
     // Diffuse colour
     m->diffuseColour = config.diffuseColour;
@@ -236,7 +284,7 @@ b8 load_material(MaterialConfig config, Material* m){
         m->diffuseMap.texture = texture_system_acquire(config.diffuseMapName, true);
         
         if (!m->diffuseMap.texture) {
-            KWARN("Unable to load texture '%s' for material '%s', using default.", config.diffuseMapName, m->name);
+            KWARN("Unable to load texture '%s' for material '%s', using default.", config.diffuseMapName, config.name);
             m->diffuseMap.texture = texture_system_get_default_texture();
             KTRACE("%d",m->diffuseMap.texture->internalData);
             if(!m->diffuseMap.texture->internalData){
@@ -253,18 +301,69 @@ b8 load_material(MaterialConfig config, Material* m){
 
     // Send it off to the renderer to acquire resources.
     if (!renderer_create_material(m)) {
-        KERROR("Failed to acquire renderer resources for material '%s'.", m->name);
+        KERROR("Failed to acquire renderer resources for material '%s'.", config.name);
         return false;
     }
 
     return true;
 }
+// Sets up a material that looks like the default, to stand in until its configuration is loaded.
+b8 create_placeholder_material(u32 nameId, Material* m){
+    kzero_memory(m, sizeof(Material));
+    m->nameId = nameId;
+    m->shaderId = string_id(BUILTIN_SHADER_NAME_MATERIAL);
+    m->diffuseColour = vec4_one();  // white
+    m->diffuseMap.textureUse = TEXTURE_USE_MAP_DIFFUSE;
+    m->diffuseMap.texture = texture_system_get_default_texture();
+
+    if (!renderer_create_material(m)) {
+        return false;
+    }
+    m->generation = 0;
+    return true;
+}
+
+void on_material_loaded(Resource* materialResource, void* user){
+    u32 handle = (u32)(u64)user;
+    Material* m = statePtr ? slot_map_get(&statePtr->registeredMaterials, handle) : 0;
+    if (!m) {
+        // Released while it was loading.
+        if (materialResource) {
+            resource_system_unload(materialResource);
+        }
+        return;
+    }
+    if (!materialResource) {
+        KERROR("Failed to load material '%s', it will look like the default.", string_intern_get(m->nameId));
+        return;
+    }
+    MaterialConfig* config = materialResource->data;
+
+    // The renderer resources were acquired for the placeholder's shader, which cannot change now.
+    if (config->shaderId != m->shaderId) {
+        KWARN("Material '%s' names a shader other than the built-in one, which is ignored when loading asynchronously.", config->name);
+    }
+    m->diffuseColour = config->diffuseColour;
+    if (string_length(config->diffuseMapName) > 0) {
+        Texture* t = texture_system_acquire_async(config->diffuseMapName, true);
+        if (t) {
+            m->diffuseMap.texture = t;
+        } else {
+            KWARN("Unable to load texture '%s' for material '%s', using default.", config->diffuseMapName, config->name);
+        }
+    }
+
+    // The renderer sees the new generation and picks up the changes.
+    m->generation++;
+    resource_system_unload(materialResource);
+}
+
 void destroy_material(Material* m){
-    KTRACE("Destroying material '%s'...", m->name);
+    KTRACE_LIMITED("Destroying material '%s'...", string_intern_get(m->nameId));
 
     // Release texture references.
     if (m->diffuseMap.texture) {
-        texture_system_release(m->diffuseMap.texture->name);
+        texture_system_release(string_intern_get(m->diffuseMap.texture->nameId));
     }
 
     // Release renderer resources.
@@ -282,7 +381,8 @@ b8 create_defaultMaterial(MaterialSystemState* state){
     kzero_memory(&state->defaultMaterial, sizeof(Material));
     state->defaultMaterial.id = INVALID_ID;
     state->defaultMaterial.generation = INVALID_ID;
-    string_ncopy(state->defaultMaterial.name, DEFAULT_MATERIAL_NAME, MATERIAL_NAME_MAX_LENGTH);
+    state->defaultMaterial.nameId = string_intern(DEFAULT_MATERIAL_NAME);
+    state->defaultMaterial.shaderId = string_id(BUILTIN_SHADER_NAME_MATERIAL);
     state->defaultMaterial.diffuseColour = vec4_one();  // white
     state->defaultMaterial.diffuseMap.textureUse = TEXTURE_USE_MAP_DIFFUSE;
     state->defaultMaterial.diffuseMap.texture = texture_system_get_default_texture();
@@ -292,7 +392,6 @@ b8 create_defaultMaterial(MaterialSystemState* state){
         KFATAL("Failed to acquire renderer resources for default texture. Application cannot continue.");
         return false;
     }
-    hashtable_set(&state->registeredMaterialTable,DEFAULT_MATERIAL_NAME,&state->defaultMaterial);
 
     return true;
 
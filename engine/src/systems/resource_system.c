@@ -1,21 +1,51 @@
+#define KLOG_CHANNEL LOG_CHANNEL_SYSTEMS
+
 #include "systems/resource_system.h"
 
 #include "core/logger.h"
 #include "core/kstring.h"
+#include "core/job_system.h"
+#include "memory/kmemory.h"
+#include "platform/atomic.h"
 
 #include "resources/loaders/binary_loader.h"
 #include "resources/loaders/image_loader.h"
 #include "resources/loaders/material_loader.h"
+#include "core/profiler.h"
+
 
+// An asynchronous load, from submission until its callback has been invoked.
+typedef struct AsyncLoad{
+    char* name;
+    ResourceLoader* loader;
+    PFN_resource_loaded callback;
+    void* user;
+    b8 success;
+    Resource resource;
+    // The next finished load, while on the completed list.
+    struct AsyncLoad* next;
+}AsyncLoad;
 
 typedef struct ResourceSystemState{
     ResourceSystemConfig config;
     ResourceLoader* registeredLoaders;
+    // One per job system thread, indexed by job_system_thread_index. Created on first use,
+    // except for the main thread's.
+    StackAllocator* scratch;
+    u32 scratchCount;
+    // Loads that have been submitted but not yet finished.
+    JobCounter asyncLoads;
+    // Finished loads awaiting delivery, most recent first. Pushed by workers, taken whole by the main thread.
+    AsyncLoad* completedLoads;
 }ResourceSystemState;
 
 static ResourceSystemState* statePtr = 0;
 
 b8 load_resource(const char* name, ResourceLoader* loader,Resource* resource);
+static ResourceLoader* find_loader(ResourceType type);
+static void async_load_job(void* param);
+static AsyncLoad* take_completed_loads();
+static void async_load_free(AsyncLoad* load);
 b8 resource_system_initialize(u64* memory_requirement, void* state, ResourceSystemConfig config){
     KDEBUG("Initializing Resource Subsystem");
     if(config.maxLoaderCount == 0){
@@ -23,18 +53,28 @@ b8 resource_system_initialize(u64* memory_requirement, void* state, ResourceSyst
         return false;
 
     }
-    *memory_requirement = sizeof(ResourceSystemState) + (sizeof(ResourceLoader) * config.maxLoaderCount);
+    // Loads may run on any thread of the job system, so it must be initialized first.
+    u32 scratchCount = job_system_thread_count();
+    u64 loaderRequirement = sizeof(ResourceLoader) * config.maxLoaderCount;
+    *memory_requirement = sizeof(ResourceSystemState) + loaderRequirement + sizeof(StackAllocator) * scratchCount;
 
     if (!state) {
         return true;
     }
+    KPROFILE_SCOPE("resource_system_initialize");
 
     statePtr = state;
+    kzero_memory(statePtr, sizeof(ResourceSystemState));
     statePtr->config = config;
 
-    void* array_block = state + sizeof(ResourceSystemState) * config.maxLoaderCount;
+    void* array_block = state + sizeof(ResourceSystemState);
     statePtr->registeredLoaders = array_block;
 
+    statePtr->scratch = array_block + loaderRequirement;
+    statePtr->scratchCount = scratchCount;
+    kzero_memory(statePtr->scratch, sizeof(StackAllocator) * scratchCount);
+    stack_allocator_create(config.scratchSize, 0, &statePtr->scratch[0]);
+
     // Invalidate all loaders
     u32 count = config.maxLoaderCount;
     for (u32 i = 0; i < count; ++i) {
@@ -47,10 +87,35 @@ b8 resource_system_initialize(u64* memory_requirement, void* state, ResourceSyst
     resource_system_register_loader(material_resource_loader_create());
 
     KINFO("Resource system initialized with base path %s",config.assetBasePath);
+    return true;
 
 }
 void resource_system_shutdown(void* state){
     if(statePtr){
+        // Let outstanding loads finish, then discard the results; the systems that asked for them are gone.
+        job_system_wait(&statePtr->asyncLoads);
+        AsyncLoad* load = take_completed_loads();
+        while (load) {
+            AsyncLoad* next = load->next;
+            KDEBUG("Discarding undelivered load of resource '%s'.", load->name);
+            if (load->success) {
+                resource_system_unload(&load->resource);
+            }
+            async_load_free(load);
+            load = next;
+        }
+
+        u64 peak = 0;
+        for (u32 i = 0; i < statePtr->scratchCount; ++i) {
+            StackAllocator* scratch = &statePtr->scratch[i];
+            if (scratch->linear.memory) {
+                if (scratch->peak > peak) {
+                    peak = scratch->peak;
+                }
+                stack_allocator_destroy(scratch);
+            }
+        }
+        KDEBUG("Resource system scratch peak usage: %lluB of %lluB per thread.", peak, statePtr->config.scratchSize);
         statePtr = 0;
     }
 
@@ -92,16 +157,12 @@ b8 resource_system_load(const char* name, ResourceType type, Resource* resource)
     KDEBUG("Loading Resource %s",name);
     if(statePtr && type != RESOURCE_TYPE_CUSTOM){
         resource->name = name;
-        // select loader
-        u32 count = statePtr->config.maxLoaderCount;
-        for(u32 i = 0; i< count; i++){
-            ResourceLoader* l = &statePtr->registeredLoaders[i];
-            if(l->id != INVALID_ID && l->type == type){
-                if(type == RESOURCE_TYPE_BINARY){
-                    KDEBUG("Loading Binary Resource %s",name);
-                }
-                return load_resource(name,l,resource);
+        ResourceLoader* l = find_loader(type);
+        if(l){
+            if(type == RESOURCE_TYPE_BINARY){
+                KDEBUG("Loading Binary Resource %s",name);
             }
+            return load_resource(name,l,resource);
         }
     }
     resource->loaderId = INVALID_ID;
@@ -126,6 +187,56 @@ b8 resource_system_load_custom(const char* name, const char* custom_type, Resour
 
 }
 
+b8 resource_system_load_async(const char* name, ResourceType type, PFN_resource_loaded callback, void* user){
+    if(!statePtr || !name || !callback){
+        KERROR("resource_system_load_async requires an initialized system, a name and a callback.");
+        return false;
+    }
+    ResourceLoader* l = type != RESOURCE_TYPE_CUSTOM ? find_loader(type) : 0;
+    if(!l){
+        KERROR("resource_system_load_async No loader for type %d was found",type);
+        return false;
+    }
+
+    AsyncLoad* load = kallocate_pooled(sizeof(AsyncLoad), MEMORY_TAG_JOB);
+    load->name = string_duplicate(name);
+    load->loader = l;
+    load->callback = callback;
+    load->user = user;
+
+    JobInfo job = {0};
+    job.entry = async_load_job;
+    job.param = load;
+    job.priority = JOB_PRIORITY_LOW;
+    // File reads and decoding would otherwise run inline whenever the main thread helps out in job_system_wait.
+    job.workerOnly = true;
+    job.counter = &statePtr->asyncLoads;
+    job_system_submit(job);
+    return true;
+}
+
+void resource_system_process_completed_loads(){
+    if(!statePtr){
+        return;
+    }
+    // Taken most recent first, so reverse the list to deliver in the order loads finished.
+    AsyncLoad* load = take_completed_loads();
+    AsyncLoad* ordered = 0;
+    while (load) {
+        AsyncLoad* next = load->next;
+        load->next = ordered;
+        ordered = load;
+        load = next;
+    }
+
+    while (ordered) {
+        AsyncLoad* next = ordered->next;
+        ordered->callback(ordered->success ? &ordered->resource : 0, ordered->user);
+        async_load_free(ordered);
+        ordered = next;
+    }
+}
+
 void resource_system_unload(Resource* resource){
     if(statePtr && resource){
         if(resource->loaderId != INVALID_ID){
@@ -145,8 +256,36 @@ const char* resource_system_base_path(){
     KERROR("resource_system_base_path called before initialization, returning empty string");
     return "";
 
+}
+StackAllocator* resource_system_scratch_allocator(){
+    if(!statePtr){
+        KERROR("resource_system_scratch_allocator called before initialization.");
+        return 0;
+    }
+    u32 index = job_system_thread_index();
+    if(index == INVALID_ID){
+        // Without a running job system, the only loads are on the caller's thread.
+        if(job_system_thread_count() > 1){
+            KERROR("resource_system_scratch_allocator called from a thread outside the job system.");
+            return 0;
+        }
+        index = 0;
+    }
+    if(index >= statePtr->scratchCount){
+        KERROR("resource_system_scratch_allocator - thread %u has no scratch stack. Initialize the job system before the resource system.", index);
+        return 0;
+    }
+
+    // Only this thread uses its stack, so it can be created here without synchronization.
+    StackAllocator* scratch = &statePtr->scratch[index];
+    if(!scratch->linear.memory){
+        stack_allocator_create(statePtr->config.scratchSize, 0, scratch);
+    }
+    return scratch;
+
 }
 b8 load_resource(const char* name, ResourceLoader* loader,Resource* resource){
+    KPROFILE_SCOPE("load_resource");
     if(!name || !loader || !loader->load || !resource){
         resource->loaderId = INVALID_ID;
         return false;
@@ -155,4 +294,40 @@ b8 load_resource(const char* name, ResourceLoader* loader,Resource* resource){
     return loader->load(loader,name,resource);
     
 
-}
\ No newline at end of file
+}
+
+static ResourceLoader* find_loader(ResourceType type){
+    u32 count = statePtr->config.maxLoaderCount;
+    for(u32 i = 0; i< count; i++){
+        ResourceLoader* l = &statePtr->registeredLoaders[i];
+        if(l->id != INVALID_ID && l->type == type){
+            return l;
+        }
+    }
+    return 0;
+}
+
+static void async_load_job(void* param){
+    AsyncLoad* load = param;
+    load->resource.name = load->name;
+    load->success = load_resource(load->name, load->loader, &load->resource);
+    if(!load->success){
+        KERROR("Failed to load resource '%s' asynchronously.", load->name);
+    }
+
+    // Push onto the completed list. The release publishes the load to the main thread.
+    AsyncLoad* head = __atomic_load_n(&statePtr->completedLoads, __ATOMIC_RELAXED);
+    do {
+        load->next = head;
+    } while (!__atomic_compare_exchange_n(&statePtr->completedLoads, &head, load, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static AsyncLoad* take_completed_loads(){
+    // Nothing is ever popped singly, so swapping out the whole list cannot suffer ABA.
+    return katomic_exchange_ptr((void**)&statePtr->completedLoads, 0);
+}
+
+static void async_load_free(AsyncLoad* load){
+    string_free(load->name);
+    kfree_pooled(load, sizeof(AsyncLoad), MEMORY_TAG_JOB);
+}
@@ -1,10 +1,17 @@
+#define KLOG_CHANNEL LOG_CHANNEL_SYSTEMS
+
 #include "systems/texture_system.h"
 #include "core/logger.h"
 #include "core/kstring.h"
 #include "memory/kmemory.h"
 #include "containers/hashtable.h"
+#include "core/string_intern.h"
+#include "core/parallel_for.h"
+#include "platform/atomic.h"
+#include "containers/slot_map.h"
 #include "renderer/renderer_frontend.h"
 #include "systems/resource_system.h"
+#include "core/profiler.h"
 
 
 
@@ -12,8 +19,8 @@
 typedef struct TextureSystemState{
     TextureSystemConfig config;
     Texture defaultTexture;
-    // Array of registered textures
-    Texture* registeredTextures;
+    // Registered textures, addressed by handle.
+    SlotMap registeredTextures;
     // Hash table for easy texture lookup
     HashTable registeredTextureTable;
 
@@ -36,7 +43,10 @@ void create_texture(Texture* texture){
 b8 create_default_textures(TextureSystemState* state);
 void destroy_default_textures(TextureSystemState* state);
 b8 load_texture(const char* textureName,Texture* texture);
+void upload_texture(ImageResourceData* imageResourceData, Texture* texture);
+void on_texture_loaded(Resource* imageResource, void* user);
 void destroy_texture(Texture* texture);
+static Texture* acquire_texture(const char* name, b8 autoRelease, b8 async);
 b8 texture_system_initialize(u64* memoryRequirement, void* state, TextureSystemConfig config){
     if(config.maxTextureCount == 0){
         KFATAL("Texture System Initialize config.maxxTextureCount must be > 0");
@@ -44,20 +54,21 @@ b8 texture_system_initialize(u64* memoryRequirement, void* state, TextureSystemC
     }
     // Block of memory will contain state structure, then block for array, then block for hashtable.
     u64 struct_requirement = sizeof(TextureSystemState);
-    u64 array_requirement = sizeof(Texture) * config.maxTextureCount;
-    u64 hashtable_requirement = sizeof(TextureReference) * config.maxTextureCount;
+    u64 array_requirement = slot_map_memory_requirement(sizeof(Texture), config.maxTextureCount);
+    u64 hashtable_requirement = hashtable_memory_requirement(sizeof(TextureReference), config.maxTextureCount);
     *memoryRequirement = struct_requirement + array_requirement + hashtable_requirement;
 
         if (!state) {
         return true;
     }
+    KPROFILE_SCOPE("texture_system_initialize");
 
     statePtr = state;
     statePtr->config = config;
 
     // The array block is after the state. Already allocated, so just set the pointer.
     void* array_block = state + struct_requirement;
-    statePtr->registeredTextures = array_block;
+    slot_map_create(sizeof(Texture), config.maxTextureCount, array_block, &statePtr->registeredTextures);
 
     // Hashtable block is after array.
     void* hashtable_block = array_block + array_requirement;
@@ -72,13 +83,6 @@ b8 texture_system_initialize(u64* memoryRequirement, void* state, TextureSystemC
     invalid_ref.referenceCount = 0;
     hashtable_fill(&statePtr->registeredTextureTable, &invalid_ref);
 
-    // Invalidate all textures in the array.
-    u32 count = statePtr->config.maxTextureCount;
-    for (u32 i = 0; i < count; ++i) {
-        statePtr->registeredTextures[i].id = INVALID_ID;
-        statePtr->registeredTextures[i].generation = INVALID_ID;
-    }
-
     // Create default textures for use in the system.
     create_default_textures(statePtr);
     KINFO("Texture System Initialized");
@@ -95,14 +99,15 @@ b8 texture_system_initialize(u64* memoryRequirement, void* state, TextureSystemC
 void texture_system_shutdown(void* state){
     if (statePtr) {
         // Destroy all loaded textures.
-        for (u32 i = 0; i < statePtr->config.maxTextureCount; ++i) {
-            Texture* t = &statePtr->registeredTextures[i];
+        for (u32 i = 0; i < statePtr->registeredTextures.count; ++i) {
+            Texture* t = slot_map_at(&statePtr->registeredTextures, i, 0);
             if (t->generation != INVALID_ID) {
                 renderer_destroy_texture(t);
             }
         }
 
         destroy_default_textures(statePtr);
+        hashtable_destroy(&statePtr->registeredTextureTable);
 
         statePtr = 0;
     }
@@ -110,54 +115,60 @@ void texture_system_shutdown(void* state){
 }
 
 Texture* texture_system_acquire(const char* name, b8 autoRelease){
+    return acquire_texture(name, autoRelease, false);
+}
+
+Texture* texture_system_acquire_async(const char* name, b8 autoRelease){
+    return acquire_texture(name, autoRelease, true);
+}
+
+static Texture* acquire_texture(const char* name, b8 autoRelease, b8 async){
+    // Names are looked up by their interned id, which also makes the lookup case-insensitive.
+    u32 nameId = string_intern(name);
+
     // Return default texture, but warn about it since this should be returned via get_default_texture();
-    if (strings_equali(name, DEFAULT_TEXTURE_NAME)) {
+    if (statePtr && nameId == statePtr->defaultTexture.nameId) {
         KWARN("texture_system_acquire called for default texture. Use texture_system_get_default_texture for texture 'default'.");
         return &statePtr->defaultTexture;
     }
 
     TextureReference ref;
-    if (statePtr && hashtable_get(&statePtr->registeredTextureTable, name, &ref)) {
+    if (statePtr && nameId != INVALID_ID && hashtable_get_id(&statePtr->registeredTextureTable, nameId, &ref)) {
         // This can only be changed the first time a texture is loaded.
         if (ref.referenceCount == 0) {
             ref.autoRelease = autoRelease;
         }
         ref.referenceCount++;
         if (ref.handle == INVALID_ID) {
-            // This means no texture exists here. Find a free index first.
-            u32 count = statePtr->config.maxTextureCount;
-            Texture* t = 0;
-            for (u32 i = 0; i < count; ++i) {
-                if (statePtr->registeredTextures[i].id == INVALID_ID) {
-                    // A free slot has been found. Use its index as the handle.
-                    ref.handle = i;
-                    t = &statePtr->registeredTextures[i];
-                    break;
-                }
-            }
-
-            // Make sure an empty slot was actually found.
-            if (!t || ref.handle == INVALID_ID) {
+            // This means no texture exists here. Take a free slot first.
+            Texture* t = slot_map_insert(&statePtr->registeredTextures, &ref.handle);
+            if (!t) {
                 KFATAL("texture_system_acquire - Texture system cannot hold anymore textures. Adjust configuration to allow more.");
                 return 0;
             }
+            create_texture(t);
 
-            // Create new texture.
-            if (!load_texture(name, t)) {
+            // Also use the handle as the texture id.
+            t->id = ref.handle;
+            t->nameId = nameId;
+
+            // Create new texture. One loaded asynchronously draws as the default until on_texture_loaded
+            // uploads it; the handle tells the callback whether the texture still exists by then.
+            b8 loaded = async ? resource_system_load_async(name, RESOURCE_TYPE_IMAGE, on_texture_loaded, (void*)(u64)ref.handle)
+                              : load_texture(name, t);
+            if (!loaded) {
                 KERROR("Failed to load texture '%s'.", name);
+                slot_map_remove(&statePtr->registeredTextures, ref.handle);
                 return 0;
             }
-
-            // Also use the handle as the texture id.
-            t->id = ref.handle;
             KTRACE("Texture '%s' does not yet exist. Created, and ref_count is now %i.", name, ref.referenceCount);
         } else {
             KTRACE("Texture '%s' already exists, ref_count increased to %i.", name, ref.referenceCount);
         }
 
         // Update the entry.
-        hashtable_set(&statePtr->registeredTextureTable, name, &ref);
-        return &statePtr->registeredTextures[ref.handle];
+        hashtable_set_id(&statePtr->registeredTextureTable, nameId, &ref);
+        return slot_map_get(&statePtr->registeredTextures, ref.handle);
     }
 
     // NOTE: This would only happen in the event something went wrong with the state.
@@ -165,35 +176,34 @@ Texture* texture_system_acquire(const char* name, b8 autoRelease){
     return 0;
 }
 void texture_system_release(const char* name){
-        // Ignore release requests for the default texture.
-    if (strings_equali(name, DEFAULT_TEXTURE_NAME)) {
+    u32 nameId = string_intern_find(name);
+
+    // Ignore release requests for the default texture.
+    if (statePtr && nameId == statePtr->defaultTexture.nameId) {
         return;
     }
     TextureReference ref;
-    if (statePtr && hashtable_get(&statePtr->registeredTextureTable, name, &ref)) {
+    if (statePtr && nameId != INVALID_ID && hashtable_get_id(&statePtr->registeredTextureTable, nameId, &ref)) {
         if (ref.referenceCount == 0) {
             KWARN("Tried to release non-existent texture: '%s'", name);
             return;
         }
-        // Take a copy of the name since it will be wiped out by destroy,
-        // (as passed in name is generally a pointer to the actual texture's name).
-        char name_copy[TEXTURE_NAME_MAX_LENGTH];
-        string_ncopy(name_copy, name, TEXTURE_NAME_MAX_LENGTH);
+        // Interned, so it remains valid after the texture is destroyed.
+        const char* internedName = string_intern_get(nameId);
         ref.referenceCount--;
         if (ref.referenceCount == 0 && ref.autoRelease) {
-            Texture* t = &statePtr->registeredTextures[ref.handle];
+            Texture* t = slot_map_get(&statePtr->registeredTextures, ref.handle);
 
             destroy_texture(t);
-            // Reset the reference.
-            ref.handle = INVALID_ID;
-            ref.autoRelease = false;
-            KTRACE("Released texture '%s'., Texture unloaded because reference count=0 and autoRelease=true.", name_copy);
+            slot_map_remove(&statePtr->registeredTextures, ref.handle);
+            // Drop the reference, so the next acquire starts over from the default.
+            hashtable_remove_id(&statePtr->registeredTextureTable, nameId);
+            KTRACE_LIMITED("Released texture '%s'., Texture unloaded because reference count=0 and autoRelease=true.", internedName);
         } else {
-            KTRACE("Released texture '%s', now has a reference count of '%i' (autoRelease=%s).", name_copy, ref.referenceCount, ref.autoRelease ? "true" : "false");
+            KTRACE_LIMITED("Released texture '%s', now has a reference count of '%i' (autoRelease=%s).", internedName, ref.referenceCount, ref.autoRelease ? "true" : "false");
+            // Update the entry.
+            hashtable_set_id(&statePtr->registeredTextureTable, nameId, &ref);
         }
-
-        // Update the entry.
-        hashtable_set(&statePtr->registeredTextureTable, name_copy, &ref);
     } else {
         KERROR("texture_system_release failed to release texture '%s'.", name);
     }
@@ -242,7 +252,7 @@ b8 create_default_textures(TextureSystemState* state){
             }
         }
     }
-    string_ncopy(state->defaultTexture.name, DEFAULT_TEXTURE_NAME, TEXTURE_NAME_MAX_LENGTH);
+    state->defaultTexture.nameId = string_intern(DEFAULT_TEXTURE_NAME);
     state->defaultTexture.width = tex_dimension;
     state->defaultTexture.height = tex_dimension;
     state->defaultTexture.channelCount = 4;
@@ -265,33 +275,80 @@ void destroy_default_textures(TextureSystemState* state){
 
 
 
+// The fewest pixels worth scanning on another thread.
+#define ALPHA_SCAN_PIXELS_PER_GRAIN (64 * 1024)
+
+typedef struct AlphaScan {
+    const u8* pixels;
+    u32 channelCount;
+    u32 found;
+} AlphaScan;
+
+// Looks for a pixel in [begin, end) that is not fully opaque.
+static void scan_alpha(u64 begin, u64 end, void* user) {
+    AlphaScan* scan = user;
+    // Another chunk already found one.
+    if (katomic_load_u32(&scan->found)) {
+        return;
+    }
+    for (u64 i = begin; i < end; ++i) {
+        if (scan->pixels[i * scan->channelCount + 3] < 255) {
+            katomic_store_u32(&scan->found, true);
+            return;
+        }
+    }
+}
+
 b8 load_texture(const char* textureName,Texture* texture){
     Resource imageResource;
     if(!resource_system_load(textureName,RESOURCE_TYPE_IMAGE,&imageResource)){
         KERROR("Failed to load image resource for texture %s",textureName);
         return false;
     }
-    ImageResourceData* imageResourceData = imageResource.data;
+    upload_texture(imageResource.data, texture);
+
+    // clean up data
+    resource_system_unload(&imageResource);
+    return true;
+}
+
+void on_texture_loaded(Resource* imageResource, void* user){
+    u32 handle = (u32)(u64)user;
+    Texture* texture = statePtr ? slot_map_get(&statePtr->registeredTextures, handle) : 0;
+    if (!texture) {
+        // Released while it was loading.
+        if (imageResource) {
+            resource_system_unload(imageResource);
+        }
+        return;
+    }
+    if (!imageResource) {
+        KERROR("Failed to load texture '%s', it will be drawn as the default.", string_intern_get(texture->nameId));
+        return;
+    }
+    upload_texture(imageResource->data, texture);
+    resource_system_unload(imageResource);
+}
+
+// Creates the renderer's copy of the image, replacing any the texture had, and bumps the generation.
+void upload_texture(ImageResourceData* imageResourceData, Texture* texture){
     Texture tempTexture;
     tempTexture.width = imageResourceData->width;
     tempTexture.height = imageResourceData->height;
     tempTexture.channelCount = imageResourceData->channelCount;
     u32 currentGeneration = texture->generation;
     texture->generation = INVALID_ID;
-    u64 totalSize = tempTexture.width * tempTexture.height * tempTexture.channelCount;
     // check for transparency
     b32 hasTransparency = false;
-    for(u64 i=0; i < totalSize; i+=tempTexture.channelCount ){
-            u8 a = imageResourceData->pixels[i + 3];
-            if(a < 255){
-                hasTransparency = true;
-                break;
-            }
-        }
+    if (tempTexture.channelCount == 4) {
+        AlphaScan scan = {imageResourceData->pixels, tempTexture.channelCount, false};
+        parallel_for(0, (u64)tempTexture.width * tempTexture.height, ALPHA_SCAN_PIXELS_PER_GRAIN, scan_alpha, &scan);
+        hasTransparency = scan.found;
+    }
         
 
-        // Take a copy of the name.
-        string_ncopy(tempTexture.name, textureName, TEXTURE_NAME_MAX_LENGTH);
+        tempTexture.nameId = texture->nameId;
+        tempTexture.id = texture->id;
         tempTexture.generation = INVALID_ID;
         tempTexture.hasTransparency = hasTransparency;
 
@@ -311,16 +368,11 @@ b8 load_texture(const char* textureName,Texture* texture){
         else{
             texture->generation = currentGeneration + 1;
         }
-
-        // clean up data
-        resource_system_unload(&imageResource);
-        return true;
 }
 
 void destroy_texture(Texture* texture){
 
     renderer_destroy_texture(texture);
-    kzero_memory(texture->name,sizeof(char) * TEXTURE_NAME_MAX_LENGTH);
     kzero_memory(texture,sizeof(Texture));
     texture->id = INVALID_ID;
     texture->generation = INVALID_ID;
@@ -10,6 +10,9 @@ b8 create_game(Game* outGame){
     outGame->applicationConfig.name = (char*)"Kohi Testbed";
     outGame->applicationConfig.startWidth = 640;
     outGame->applicationConfig.startHeight = 480;
+    outGame->applicationConfig.jobWorkerCount = 0;
+    outGame->applicationConfig.logLevels = "*=trace,renderer=info";
+    outGame->applicationConfig.profileStartupFrames = 0;
     outGame->initialize = game_initialize;
     outGame->update = game_update;
     outGame->render = game_render;
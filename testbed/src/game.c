@@ -1,3 +1,5 @@
+#define KLOG_CHANNEL LOG_CHANNEL_GAME
+
 #include "game.h"
 #include <core/logger.h>
 #include <memory/kmemory.h>
@@ -67,6 +69,8 @@ b8 game_update(Game* gameInstance,f32 deltaTime){
     alloc_count = get_memory_alloc_count();
     if (input_is_key_up('M') && input_was_key_down('M')) {
         KDEBUG("Allocations: %llu (%llu this frame)", alloc_count, alloc_count - prev_alloc_count);
+        // Only does anything in builds with KMEMORY_TRACKING enabled.
+        memory_tracking_report(true);
     }
         // TODO: temp
     if (input_is_key_up(KEY_T) && input_was_key_down(KEY_T)) {
@@ -0,0 +1,12 @@
+#pragma once
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+void kvector_register_tests();
+
+#ifdef __cplusplus
+}
+#endif
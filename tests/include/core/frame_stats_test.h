@@ -0,0 +1,3 @@
+#pragma once
+
+void frame_stats_register_tests();
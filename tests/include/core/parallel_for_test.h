@@ -0,0 +1,3 @@
+#pragma once
+
+void parallel_for_register_tests();
@@ -0,0 +1,3 @@
+#pragma once
+
+void string_intern_register_tests();
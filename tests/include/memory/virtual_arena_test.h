@@ -0,0 +1,3 @@
+#pragma once
+
+void virtual_arena_register_tests();
\ No newline at end of file
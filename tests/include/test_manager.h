@@ -1,13 +1,50 @@
 #pragma once
 
 #include <defines.h>
+#include <memory/kmemory.h>
 
 #define BYPASS 2
 
 typedef u8 (*PFN_test)();
 
+typedef void (*PFN_test_system_shutdown)(void* state);
+
+// An engine system started by a test, its state allocated with the two-call initialize pattern.
+typedef struct TestSystem {
+    void* state;
+    u64 memoryRequirement;
+    MemoryTag tag;
+    PFN_test_system_shutdown shutdown;
+} TestSystem;
+
+/**
+ * @brief Starts a system for a test. Calls initialize once to obtain the memory requirement,
+ * allocates the state with the given tag and calls initialize again with it. Works with any
+ * b8 initialize(u64* memoryRequirement, void* state, Config config). Evaluates to the result
+ * of the second call. Stop the system with test_system_end.
+ */
+#define test_system_begin(system, initialize, shutdownFunction, config, memoryTag) \
+    (initialize(&(system)->memoryRequirement, 0, config),                          \
+     test_system_allocate(system, shutdownFunction, memoryTag),                    \
+     initialize(&(system)->memoryRequirement, (system)->state, config))
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
 void test_manager_init();
 
-void test_manager_register_test(PFN_test, char* desc);
+void test_manager_register_test(PFN_test, const char* desc);
+
+void test_manager_run_tests();
+
+/** @brief Allocates the state of a system whose memory requirement has been obtained. Used by test_system_begin. */
+void test_system_allocate(TestSystem* system, PFN_test_system_shutdown shutdown, MemoryTag tag);
+
+/** @brief Shuts down a system started by test_system_begin and frees its state. */
+void test_system_end(TestSystem* system);
 
-void test_manager_run_tests(); 
\ No newline at end of file
+#ifdef __cplusplus
+}
+#endif 
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "containers/darray_test.h"
+#include "expect.h"
+#include <defines.h>
+#include "test_manager.h"
+#include <containers/darray.h>
+
+u8 darray_should_grow_reserve_and_shrink() {
+    u32* array = darray_create(u32);
+    expect_should_be(0, darray_length(array));
+    expect_should_be(sizeof(u32), darray_stride(array));
+
+    for (u32 i = 0; i < 100; ++i) {
+        darray_push(array, i);
+    }
+    expect_should_be(100, darray_length(array));
+    expect_to_be_true(darray_capacity(array) >= 100);
+    for (u32 i = 0; i < 100; ++i) {
+        expect_should_be(i, array[i]);
+    }
+
+    darray_reserve(array, 1000);
+    expect_should_be(1000, darray_capacity(array));
+    expect_should_be(100, darray_length(array));
+    expect_should_be(99, array[99]);
+
+    // Reserving less than the capacity does nothing.
+    darray_reserve(array, 10);
+    expect_should_be(1000, darray_capacity(array));
+
+    darray_shrink_to_fit(array);
+    expect_should_be(100, darray_capacity(array));
+    expect_should_be(99, array[99]);
+
+    darray_clear(array);
+    expect_should_be(0, darray_length(array));
+    darray_destroy(array);
+    return true;
+}
+
+u8 darray_should_push_n_and_append_array() {
+    u64* array = darray_create_with_capacity(u64, 4);
+    u64 value = 7;
+    darray_push_n(array, value, 3);
+    expect_should_be(3, darray_length(array));
+
+    u64 values[10];
+    for (u32 i = 0; i < 10; ++i) {
+        values[i] = 100 + i;
+    }
+    darray_append_array(array, values, 10);
+    expect_should_be(13, darray_length(array));
+    expect_should_be(7, array[0]);
+    expect_should_be(7, array[2]);
+    expect_should_be(100, array[3]);
+    expect_should_be(109, array[12]);
+
+    u64 popped = 0;
+    darray_pop(array, &popped);
+    expect_should_be(109, popped);
+    expect_should_be(12, darray_length(array));
+    darray_destroy(array);
+    return true;
+}
+
+u8 darray_should_insert_and_pop_at() {
+    u32* array = darray_create(u32);
+    for (u32 i = 0; i < 5; ++i) {
+        darray_push(array, i);
+    }
+
+    u32 value = 50;
+    darray_insert_at(array, 2, value);
+    // Inserting at the length appends.
+    value = 60;
+    darray_insert_at(array, 6, value);
+    u32 expected[7] = {0, 1, 50, 2, 3, 4, 60};
+    expect_should_be(7, darray_length(array));
+    for (u32 i = 0; i < 7; ++i) {
+        expect_should_be(expected[i], array[i]);
+    }
+
+    u32 popped = 0;
+    darray_pop_at(array, 0, &popped);
+    expect_should_be(0, popped);
+    darray_pop_at(array, 5, &popped);
+    expect_should_be(60, popped);
+    u32 remaining[5] = {1, 50, 2, 3, 4};
+    expect_should_be(5, darray_length(array));
+    for (u32 i = 0; i < 5; ++i) {
+        expect_should_be(remaining[i], array[i]);
+    }
+    darray_destroy(array);
+    return true;
+}
+
+void darray_register_tests() {
+    test_manager_register_test(darray_should_grow_reserve_and_shrink, "Darray should grow, reserve and shrink to fit");
+    test_manager_register_test(darray_should_push_n_and_append_array, "Darray should push copies and append arrays");
+    test_manager_register_test(darray_should_insert_and_pop_at, "Darray should insert and pop at an index");
+}
@@ -0,0 +1,84 @@
+#include "containers/hash_test.h"
+#include "expect.h"
+#include <defines.h>
+#include "test_manager.h"
+#include <containers/hash.h>
+#include <core/kstring.h>
+#include <core/logger.h>
+#include <platform/platform.h>
+
+u8 hash_should_depend_on_every_byte() {
+    u8 data[64];
+    for (u32 i = 0; i < 64; ++i) {
+        data[i] = (u8)i;
+    }
+
+    // Every length hashes differently, and flipping any one bit changes the hash.
+    for (u64 length = 1; length <= 64; ++length) {
+        u64 hash = hash_bytes(data, length, 0);
+        expect_should_not_be(hash_bytes(data, length - 1, 0), hash);
+        expect_should_be(hash, hash_bytes(data, length, 0));
+        for (u64 i = 0; i < length; ++i) {
+            data[i] ^= 0x10;
+            expect_should_not_be(hash, hash_bytes(data, length, 0));
+            data[i] ^= 0x10;
+        }
+    }
+    return true;
+}
+
+u8 hash_should_match_for_strings_and_bytes() {
+    const char* name = "textures/cobblestone";
+    expect_should_be(hash_bytes(name, string_length(name), 0), hash_string(name));
+    expect_should_not_be(hash_string("Cobblestone"), hash_string("cobblestone"));
+    expect_should_not_be(hash_bytes(name, 8, 0), hash_bytes(name, 8, 1));
+    expect_should_not_be(hash_u64(1), hash_u64(2));
+    return true;
+}
+
+// The byte-at-a-time hash the hashtable used before, for comparison.
+static u64 legacy_hash_name(const char* name, u32 elementCount) {
+    static const u64 multiplier = 97;
+    u64 hash = 0;
+    for (unsigned const char* us = (unsigned const char*)name; *us; us++) {
+        hash = hash * multiplier + *us;
+    }
+    hash %= elementCount;
+    return hash;
+}
+
+u8 hash_benchmark_against_legacy_hash() {
+    // Typical resource names, from short to long.
+    const char* names[] = {
+        "default",
+        "cobblestone",
+        "paving_stone_diffuse",
+        "materials/test_material_with_a_longer_name",
+        "textures/environment/sky/a_rather_long_path_to_a_cubemap_face_texture_positive_x"};
+    const u32 nameCount = sizeof(names) / sizeof(names[0]);
+    const u32 iterations = 200000;
+
+    u64 sink = 0;
+    f64 start = platform_get_absolute_time();
+    for (u32 i = 0; i < iterations; ++i) {
+        sink += legacy_hash_name(names[i % nameCount], 65536);
+    }
+    f64 legacyTime = platform_get_absolute_time() - start;
+
+    start = platform_get_absolute_time();
+    for (u32 i = 0; i < iterations; ++i) {
+        // The table masks the hash instead of taking the modulo.
+        sink += hash_string(names[i % nameCount]) & (65536 - 1);
+    }
+    f64 newTime = platform_get_absolute_time() - start;
+
+    KINFO("Hashed %u names: byte-at-a-time %.3fms, wyhash %.3fms (%.1fx). (%llu)",
+          iterations, legacyTime * 1000.0, newTime * 1000.0, newTime > 0 ? legacyTime / newTime : 0.0, sink & 1);
+    return true;
+}
+
+void hash_register_tests() {
+    test_manager_register_test(hash_should_depend_on_every_byte, "Hash should depend on every byte");
+    test_manager_register_test(hash_should_match_for_strings_and_bytes, "Hash of a string should match its bytes");
+    test_manager_register_test(hash_benchmark_against_legacy_hash, "Hash benchmark against the previous hash");
+}
@@ -0,0 +1,149 @@
+#include "containers/hashtable_test.h"
+#include "expect.h"
+#include <defines.h>
+#include "test_manager.h"
+#include <containers/hashtable.h>
+#include <memory/kmemory.h>
+#include <core/kstring.h>
+#include <core/logger.h>
+
+u8 hashtable_should_keep_every_entry_of_a_full_table() {
+    const u32 count = 200;
+    u64 requirement = hashtable_memory_requirement(sizeof(u32), count);
+    void* memory = kallocate(requirement, MEMORY_TAG_DICT);
+    HashTable table;
+    hashtable_create(sizeof(u32), count, memory, false, &table);
+
+    char name[32];
+    for (u32 i = 0; i < count; ++i) {
+        string_format(name, "texture_%u", i);
+        expect_to_be_true(hashtable_set(&table, name, &i));
+    }
+    expect_should_be(count, table.count);
+
+    // No entry may be overwritten by another whose hash lands on the same slot.
+    for (u32 i = 0; i < count; ++i) {
+        string_format(name, "texture_%u", i);
+        u32 value = INVALID_ID;
+        expect_to_be_true(hashtable_get(&table, name, &value));
+        expect_should_be(i, value);
+    }
+
+    u32 missing;
+    expect_to_be_false(hashtable_get(&table, "not_there", &missing));
+
+    // With a default, missing entries give that instead.
+    u32 fallback = 1234;
+    hashtable_fill(&table, &fallback);
+    expect_to_be_true(hashtable_get(&table, "not_there", &missing));
+    expect_should_be(1234, missing);
+
+    hashtable_destroy(&table);
+    kfree(memory, requirement, MEMORY_TAG_DICT);
+    return true;
+}
+
+u8 hashtable_should_reuse_removed_entries() {
+    const u32 count = 16;
+    u64 requirement = hashtable_memory_requirement(sizeof(u64), count);
+    void* memory = kallocate(requirement, MEMORY_TAG_DICT);
+    HashTable table;
+    hashtable_create(sizeof(u64), count, memory, false, &table);
+
+    // Churn many more names through the table than it can hold at once.
+    char name[32];
+    for (u64 i = 0; i < 1000; ++i) {
+        string_format(name, "material_%llu", i);
+        expect_to_be_true(hashtable_set(&table, name, &i));
+        if (i >= count - 1) {
+            string_format(name, "material_%llu", i - (count - 1));
+            expect_to_be_true(hashtable_remove(&table, name));
+            expect_to_be_false(hashtable_remove(&table, name));
+        }
+    }
+    expect_should_be(count - 1, table.count);
+
+    for (u64 i = 1000 - (count - 1); i < 1000; ++i) {
+        string_format(name, "material_%llu", i);
+        u64 value = 0;
+        expect_to_be_true(hashtable_get(&table, name, &value));
+        expect_should_be(i, value);
+    }
+
+    hashtable_destroy(&table);
+    kfree(memory, requirement, MEMORY_TAG_DICT);
+    return true;
+}
+
+u8 hashtable_should_clear_tombstones_in_fixed_memory_without_allocating() {
+    TestSystem memory;
+    MemorySystemConfig config;
+    config.totalAllocSize = 1024 * 1024;
+    test_system_begin(&memory, memory_system_initialize, memory_system_shutdown, config, MEMORY_TAG_APPLICATION);
+
+    // u32 values, so the keys after them would not be aligned if they were not placed first.
+    const u32 count = 100;
+    u64 requirement = hashtable_memory_requirement(sizeof(u32), count);
+    void* block = kallocate(requirement, MEMORY_TAG_DICT);
+    HashTable table;
+    hashtable_create(sizeof(u32), count, block, false, &table);
+    u64 allocations = get_memory_alloc_count();
+
+    // Churn ids through the table so that tombstones build up and are cleared many times.
+    for (u32 i = 0; i < 5000; ++i) {
+        expect_to_be_true(hashtable_set_id(&table, i * 7919ull, &i));
+        if (i >= count - 1) {
+            expect_to_be_true(hashtable_remove_id(&table, (i - (count - 1)) * 7919ull));
+        }
+    }
+    expect_should_be(allocations, get_memory_alloc_count());
+    expect_should_be(count - 1, table.count);
+    for (u32 i = 5000 - (count - 1); i < 5000; ++i) {
+        u32 value = 0;
+        expect_to_be_true(hashtable_get_id(&table, i * 7919ull, &value));
+        expect_should_be(i, value);
+    }
+    u32 value;
+    expect_to_be_false(hashtable_get_id(&table, 0, &value));
+
+    hashtable_destroy(&table);
+    kfree(block, requirement, MEMORY_TAG_DICT);
+    test_system_end(&memory);
+    return true;
+}
+
+u8 hashtable_should_grow_with_id_keys() {
+    HashTable table;
+    hashtable_create(sizeof(u64), 4, 0, false, &table);
+    u32 initialCapacity = table.capacity;
+
+    for (u64 i = 0; i < 5000; ++i) {
+        u64 value = i * 3;
+        expect_to_be_true(hashtable_set_id(&table, i << 20, &value));
+    }
+    expect_should_be(5000, table.count);
+    expect_to_be_true(table.capacity > initialCapacity);
+
+    for (u64 i = 0; i < 5000; ++i) {
+        u64 value = 0;
+        expect_to_be_true(hashtable_get_id(&table, i << 20, &value));
+        expect_should_be(i * 3, value);
+    }
+    expect_to_be_true(hashtable_remove_id(&table, 0));
+    u64 value;
+    expect_to_be_false(hashtable_get_id(&table, 0, &value));
+
+    // Keys of a table cannot be mixed.
+    KDEBUG("Note: The following error is intentionally caused by this test.");
+    expect_to_be_false(hashtable_set(&table, "name", &value));
+
+    hashtable_destroy(&table);
+    return true;
+}
+
+void hashtable_register_tests() {
+    test_manager_register_test(hashtable_should_keep_every_entry_of_a_full_table, "Hashtable should keep every entry of a full table");
+    test_manager_register_test(hashtable_should_reuse_removed_entries, "Hashtable should reuse removed entries");
+    test_manager_register_test(hashtable_should_clear_tombstones_in_fixed_memory_without_allocating, "Hashtable should clear tombstones in fixed memory without allocating");
+    test_manager_register_test(hashtable_should_grow_with_id_keys, "Hashtable should grow with id keys");
+}
@@ -0,0 +1,137 @@
+#include "containers/kvector_test.h"
+#include "expect.h"
+#include <defines.h>
+#include "test_manager.h"
+#include <containers/kvector.h>
+#include <memory/kmemory.h>
+
+// Counts live instances, to check that elements are constructed and destroyed exactly once.
+static i32 liveCount = 0;
+
+struct Tracked {
+    u32 value;
+    kvector<u32> owned;
+
+    Tracked() : value(0) { liveCount++; }
+    explicit Tracked(u32 value) : value(value) {
+        liveCount++;
+        owned.push_back(value);
+    }
+    Tracked(Tracked&& other) : value(other.value), owned(static_cast<kvector<u32>&&>(other.owned)) { liveCount++; }
+    ~Tracked() { liveCount--; }
+};
+
+static u64 sum(kspan<const u32> values) {
+    u64 total = 0;
+    for (u32 value : values) {
+        total += value;
+    }
+    return total;
+}
+
+u8 kvector_should_keep_small_arrays_inline() {
+    MemorySystemConfig config;
+    config.totalAllocSize = 1024 * 1024;
+    u64 memoryRequirement = 0;
+    memory_system_initialize(&memoryRequirement, 0, config);
+    void* state = kallocate(memoryRequirement, MEMORY_TAG_APPLICATION);
+    memory_system_initialize(&memoryRequirement, state, config);
+    u64 allocations = get_memory_alloc_count();
+
+    kvector<u32, 2> perDevice(2);
+    expect_to_be_true(perDevice.is_inline());
+    expect_should_be(allocations, get_memory_alloc_count());
+    perDevice[0] = 3;
+    perDevice[1] = 4;
+    expect_should_be(7, sum(perDevice));
+
+    // A third element spills to the heap, keeping the first two.
+    perDevice.push_back(5);
+    expect_to_be_false(perDevice.is_inline());
+    expect_should_be(allocations + 1, get_memory_alloc_count());
+    expect_should_be(12, sum(perDevice));
+
+    kfixed_vector<u32, 4> fixed;
+    fixed.push_back(1);
+    fixed.push_back(2);
+    expect_should_be(2, fixed.size());
+    expect_should_be(3, sum(fixed));
+    u32 array[3] = {1, 1, 1};
+    expect_should_be(3, sum(array));
+
+    perDevice.reset();
+    memory_system_shutdown(state);
+    kfree(state, memoryRequirement, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+u8 kvector_should_grow_and_preserve_elements() {
+    kvector<u64> values;
+    for (u64 i = 0; i < 1000; ++i) {
+        values.push_back(i * 3);
+    }
+    expect_should_be(1000, values.size());
+    expect_to_be_true(values.capacity() >= 1000);
+    for (u64 i = 0; i < 1000; ++i) {
+        expect_should_be(i * 3, values[i]);
+    }
+
+    values.resize(10);
+    expect_should_be(27, values.back());
+    values.resize(12);
+    // New elements are value-initialized.
+    expect_should_be(0, values[11]);
+
+    kvector<u64> copy;
+    copy.assign(values);
+    expect_should_be(12, copy.size());
+    expect_should_be(27, copy[9]);
+
+    // A zeroed vector is a valid empty one, so vectors can live in kallocate'd structures.
+    kvector<u32, 2>* zeroed = static_cast<kvector<u32, 2>*>(kallocate(sizeof(kvector<u32, 2>), MEMORY_TAG_ARRAY));
+    expect_should_be(0, zeroed->size());
+    expect_should_be(2, zeroed->capacity());
+    zeroed->resize(2);
+    zeroed->reset();
+    kfree(zeroed, sizeof(kvector<u32, 2>), MEMORY_TAG_ARRAY);
+    return true;
+}
+
+u8 kvector_should_move_non_trivial_elements() {
+    liveCount = 0;
+    {
+        kvector<Tracked, 2> outer;
+        for (u32 i = 0; i < 10; ++i) {
+            outer.emplace_back(i);
+        }
+        expect_should_be(10, liveCount);
+
+        // Moving takes the storage, leaving the source empty.
+        kvector<Tracked, 2> moved(static_cast<kvector<Tracked, 2>&&>(outer));
+        expect_should_be(0, outer.size());
+        expect_should_be(10, moved.size());
+        for (u32 i = 0; i < 10; ++i) {
+            expect_should_be(i, moved[i].value);
+            expect_should_be(i, moved[i].owned[0]);
+        }
+
+        // Moving an inline vector moves the elements one by one.
+        kvector<Tracked, 2> small;
+        small.emplace_back(7u);
+        kvector<Tracked, 2> smallMoved;
+        smallMoved = static_cast<kvector<Tracked, 2>&&>(small);
+        expect_should_be(7, smallMoved[0].owned[0]);
+        expect_should_be(11, liveCount);
+
+        moved.pop_back();
+        expect_should_be(10, liveCount);
+    }
+    expect_should_be(0, liveCount);
+    return true;
+}
+
+void kvector_register_tests() {
+    test_manager_register_test(kvector_should_keep_small_arrays_inline, "kvector should keep small arrays inline");
+    test_manager_register_test(kvector_should_grow_and_preserve_elements, "kvector should grow and preserve elements");
+    test_manager_register_test(kvector_should_move_non_trivial_elements, "kvector should move non-trivial elements");
+}
@@ -0,0 +1,182 @@
+#include "containers/ring_queue_test.h"
+#include "expect.h"
+#include <defines.h>
+#include "test_manager.h"
+#include <containers/ring_queue.h>
+#include <core/logger.h>
+#include <platform/platform.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+u8 spsc_queue_should_be_fifo_and_bounded() {
+    SpscQueue queue;
+    // Rounded up to 8.
+    expect_to_be_true(spsc_queue_create(sizeof(u32), 5, 0, &queue));
+    expect_should_be(8, queue.capacity);
+
+    u32 value = 0;
+    expect_to_be_false(spsc_queue_pop(&queue, &value));
+    for (u32 lap = 0; lap < 3; ++lap) {
+        for (u32 i = 0; i < 8; ++i) {
+            u32 pushed = lap * 100 + i;
+            expect_to_be_true(spsc_queue_push(&queue, &pushed));
+        }
+        u32 extra = 999;
+        expect_to_be_false(spsc_queue_push(&queue, &extra));
+        expect_should_be(8, spsc_queue_count(&queue));
+        for (u32 i = 0; i < 8; ++i) {
+            expect_to_be_true(spsc_queue_pop(&queue, &value));
+            expect_should_be(lap * 100 + i, value);
+        }
+        expect_to_be_false(spsc_queue_pop(&queue, &value));
+    }
+
+    spsc_queue_destroy(&queue);
+    return true;
+}
+
+typedef struct Message {
+    u64 sender;
+    u64 sequence;
+    u8 payload[16];
+} Message;
+
+u8 mpmc_queue_should_be_fifo_and_bounded() {
+    MpmcQueue queue;
+    expect_to_be_true(mpmc_queue_create(sizeof(Message), 16, 0, &queue));
+    expect_should_be(16, queue.capacity);
+
+    Message message = {0};
+    expect_to_be_false(mpmc_queue_pop(&queue, &message));
+    for (u32 lap = 0; lap < 3; ++lap) {
+        for (u64 i = 0; i < 16; ++i) {
+            message.sender = lap;
+            message.sequence = i;
+            message.payload[15] = (u8)i;
+            expect_to_be_true(mpmc_queue_push(&queue, &message));
+        }
+        expect_to_be_false(mpmc_queue_push(&queue, &message));
+        expect_should_be(16, mpmc_queue_count(&queue));
+        for (u64 i = 0; i < 16; ++i) {
+            expect_to_be_true(mpmc_queue_pop(&queue, &message));
+            expect_should_be(lap, message.sender);
+            expect_should_be(i, message.sequence);
+            expect_should_be(i, message.payload[15]);
+        }
+        expect_to_be_false(mpmc_queue_pop(&queue, &message));
+    }
+
+    mpmc_queue_destroy(&queue);
+    return true;
+}
+
+#define BENCHMARK_MAX_THREADS 16
+
+typedef struct BenchmarkState {
+    SpscQueue spsc;
+    MpmcQueue mpmc;
+    u64 itemsPerProducer;
+    u64 totalItems;
+    // Claimed by consumers as they pop, so they know when to stop.
+    u64 consumed;
+    // The sum of everything consumed, to check nothing was lost or duplicated.
+    u64 sum;
+} BenchmarkState;
+
+static void* spsc_producer(void* arg) {
+    BenchmarkState* state = arg;
+    for (u64 i = 1; i <= state->totalItems; ++i) {
+        while (!spsc_queue_push(&state->spsc, &i)) {
+            sched_yield();
+        }
+    }
+    return 0;
+}
+
+static void* spsc_consumer(void* arg) {
+    BenchmarkState* state = arg;
+    u64 sum = 0;
+    for (u64 i = 0; i < state->totalItems; ++i) {
+        u64 value;
+        while (!spsc_queue_pop(&state->spsc, &value)) {
+            sched_yield();
+        }
+        sum += value;
+    }
+    state->sum = sum;
+    return 0;
+}
+
+static void* mpmc_producer(void* arg) {
+    BenchmarkState* state = arg;
+    for (u64 i = 1; i <= state->itemsPerProducer; ++i) {
+        while (!mpmc_queue_push(&state->mpmc, &i)) {
+            sched_yield();
+        }
+    }
+    return 0;
+}
+
+static void* mpmc_consumer(void* arg) {
+    BenchmarkState* state = arg;
+    u64 sum = 0;
+    while (__atomic_fetch_add(&state->consumed, 1, __ATOMIC_RELAXED) < state->totalItems) {
+        u64 value;
+        while (!mpmc_queue_pop(&state->mpmc, &value)) {
+            sched_yield();
+        }
+        sum += value;
+    }
+    __atomic_fetch_add(&state->sum, sum, __ATOMIC_RELAXED);
+    return 0;
+}
+
+u8 ring_queue_benchmark_throughput() {
+    static BenchmarkState state;
+    long processorCount = sysconf(_SC_NPROCESSORS_ONLN);
+    u32 maxThreads = processorCount > BENCHMARK_MAX_THREADS ? BENCHMARK_MAX_THREADS : (processorCount < 2 ? 2 : (u32)processorCount);
+    pthread_t threads[BENCHMARK_MAX_THREADS * 2];
+
+    // One producer and one consumer thread.
+    kzero_memory(&state, sizeof(BenchmarkState));
+    state.totalItems = 1000000;
+    spsc_queue_create(sizeof(u64), 1024, 0, &state.spsc);
+    f64 start = platform_get_absolute_time();
+    pthread_create(&threads[0], 0, spsc_producer, &state);
+    pthread_create(&threads[1], 0, spsc_consumer, &state);
+    pthread_join(threads[0], 0);
+    pthread_join(threads[1], 0);
+    f64 elapsed = platform_get_absolute_time() - start;
+    spsc_queue_destroy(&state.spsc);
+    expect_should_be(state.totalItems * (state.totalItems + 1) / 2, state.sum);
+    KINFO("SPSC queue: %.2f million ops/sec with 1 producer and 1 consumer.", state.totalItems / elapsed / 1000000.0);
+
+    // Equal numbers of producers and consumers, 1 to maxThreads of each.
+    for (u32 threadCount = 1; threadCount <= maxThreads; threadCount *= 2) {
+        kzero_memory(&state, sizeof(BenchmarkState));
+        state.itemsPerProducer = 400000 / threadCount;
+        state.totalItems = state.itemsPerProducer * threadCount;
+        mpmc_queue_create(sizeof(u64), 1024, 0, &state.mpmc);
+        start = platform_get_absolute_time();
+        for (u32 i = 0; i < threadCount; ++i) {
+            pthread_create(&threads[i * 2], 0, mpmc_producer, &state);
+            pthread_create(&threads[i * 2 + 1], 0, mpmc_consumer, &state);
+        }
+        for (u32 i = 0; i < threadCount * 2; ++i) {
+            pthread_join(threads[i], 0);
+        }
+        elapsed = platform_get_absolute_time() - start;
+        mpmc_queue_destroy(&state.mpmc);
+        expect_should_be(threadCount * (state.itemsPerProducer * (state.itemsPerProducer + 1) / 2), state.sum);
+        KINFO("MPMC queue: %.2f million ops/sec with %u producer/consumer thread pairs.", state.totalItems / elapsed / 1000000.0, threadCount);
+    }
+    return true;
+}
+
+void ring_queue_register_tests() {
+    test_manager_register_test(spsc_queue_should_be_fifo_and_bounded, "SPSC queue should be FIFO and bounded");
+    test_manager_register_test(mpmc_queue_should_be_fifo_and_bounded, "MPMC queue should be FIFO and bounded");
+    test_manager_register_test(ring_queue_benchmark_throughput, "Ring queue throughput benchmark across threads");
+}
@@ -0,0 +1,89 @@
+#include "containers/slot_map_test.h"
+#include "expect.h"
+#include <defines.h>
+#include "test_manager.h"
+#include <containers/slot_map.h>
+
+u8 slot_map_should_insert_and_get() {
+    SlotMap map;
+    expect_to_be_true(slot_map_create(sizeof(u64), 4, 0, &map));
+
+    u32 handles[4];
+    for (u64 i = 0; i < 4; ++i) {
+        u64* element = slot_map_insert(&map, &handles[i]);
+        expect_should_not_be(0, element);
+        *element = i * 10;
+    }
+    expect_should_be(4, map.count);
+
+    // Full, so no more slots can be taken.
+    u32 extra;
+    expect_should_be(0, slot_map_insert(&map, &extra));
+
+    for (u64 i = 0; i < 4; ++i) {
+        u64* element = slot_map_get(&map, handles[i]);
+        expect_should_not_be(0, element);
+        expect_should_be(i * 10, *element);
+    }
+
+    slot_map_destroy(&map);
+    expect_should_be(0, map.elements);
+    return true;
+}
+
+u8 slot_map_should_detect_stale_handles() {
+    SlotMap map;
+    slot_map_create(sizeof(u32), 2, 0, &map);
+
+    u32 first;
+    slot_map_insert(&map, &first);
+    expect_to_be_true(slot_map_remove(&map, first));
+    expect_should_be(0, slot_map_get(&map, first));
+    expect_to_be_false(slot_map_remove(&map, first));
+
+    // The freed slot is reused, but with a new generation.
+    u32 second;
+    slot_map_insert(&map, &second);
+    expect_should_be(SLOT_MAP_HANDLE_INDEX(first), SLOT_MAP_HANDLE_INDEX(second));
+    expect_should_not_be(first, second);
+    expect_should_be(0, slot_map_get(&map, first));
+    expect_should_not_be(0, slot_map_get(&map, second));
+    expect_should_be(0, slot_map_get(&map, INVALID_ID));
+
+    slot_map_destroy(&map);
+    return true;
+}
+
+u8 slot_map_should_iterate_live_elements() {
+    SlotMap map;
+    slot_map_create(sizeof(u32), 8, 0, &map);
+
+    u32 handles[5];
+    for (u32 i = 0; i < 5; ++i) {
+        u32* element = slot_map_insert(&map, &handles[i]);
+        *element = i;
+    }
+    slot_map_remove(&map, handles[1]);
+    slot_map_remove(&map, handles[3]);
+    expect_should_be(3, map.count);
+
+    // Only elements 0, 2 and 4 remain, each visited once with its own handle.
+    u32 sum = 0;
+    for (u32 i = 0; i < map.count; ++i) {
+        u32 handle;
+        u32* element = slot_map_at(&map, i, &handle);
+        expect_should_be(element, slot_map_get(&map, handle));
+        sum += *element;
+    }
+    expect_should_be(6, sum);
+    expect_should_be(0, slot_map_at(&map, map.count, 0));
+
+    slot_map_destroy(&map);
+    return true;
+}
+
+void slot_map_register_tests() {
+    test_manager_register_test(slot_map_should_insert_and_get, "Slot map should insert and get elements");
+    test_manager_register_test(slot_map_should_detect_stale_handles, "Slot map should detect stale handles");
+    test_manager_register_test(slot_map_should_iterate_live_elements, "Slot map should iterate live elements");
+}
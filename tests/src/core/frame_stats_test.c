@@ -0,0 +1,155 @@
+#include "core/frame_stats_test.h"
+#include "expect.h"
+#include <defines.h>
+#include "test_manager.h"
+#include <core/frame_stats.h>
+#include <core/kstring.h>
+#include <core/logger.h>
+#include <memory/kmemory.h>
+#include <platform/filesystem.h>
+
+static void begin_frame_stats(u32 windowSize, const char* csvPath, TestSystem* outSystem) {
+    FrameStatsConfig config;
+    config.windowSize = windowSize;
+    config.hitchThresholdMs = 50.0f;
+    config.reportInterval = 0;
+    config.csvPath = csvPath;
+    test_system_begin(outSystem, frame_stats_initialize, frame_stats_shutdown, config, MEMORY_TAG_APPLICATION);
+}
+
+u8 frame_stats_should_work_out_percentiles() {
+    TestSystem frameStats;
+    begin_frame_stats(128, 0, &frameStats);
+
+    FrameStats stats;
+    expect_to_be_false(frame_stats_get(&stats));
+    expect_should_be(0, stats.sampleCount);
+
+    // Frames of 100 down to 1 milliseconds, with an update taking half of each.
+    for (u32 i = 100; i > 0; --i) {
+        frame_stats_record(FRAME_STAT_UPDATE, i * 0.0005);
+        frame_stats_end_frame(i * 0.001);
+    }
+    expect_to_be_true(frame_stats_get(&stats));
+    expect_should_be(100, stats.sampleCount);
+    const FrameStatSummary* frame = &stats.sections[FRAME_STAT_FRAME];
+    expect_float_to_be(1.0f, frame->min);
+    expect_float_to_be(50.5f, frame->mean);
+    expect_float_to_be(50.0f, frame->p50);
+    expect_float_to_be(95.0f, frame->p95);
+    expect_float_to_be(99.0f, frame->p99);
+    expect_float_to_be(100.0f, frame->max);
+    expect_float_to_be(25.0f, stats.sections[FRAME_STAT_UPDATE].p50);
+    expect_float_to_be(0.0f, stats.sections[FRAME_STAT_PRESENT].max);
+
+    test_system_end(&frameStats);
+    return true;
+}
+
+u8 frame_stats_should_roll_the_window_and_count_hitches() {
+    TestSystem frameStats;
+    begin_frame_stats(4, 0, &frameStats);
+
+    // Two hitches, then enough short frames to push them out of the window.
+    frame_stats_end_frame(0.1);
+    frame_stats_end_frame(0.06);
+    for (u32 i = 0; i < 4; ++i) {
+        frame_stats_end_frame(0.01);
+    }
+    FrameStats stats;
+    expect_to_be_true(frame_stats_get(&stats));
+    expect_should_be(4, stats.sampleCount);
+    expect_should_be(0, stats.hitchCount);
+    expect_should_be(6, stats.totalFrames);
+    expect_should_be(2, stats.totalHitches);
+    expect_float_to_be(10.0f, stats.sections[FRAME_STAT_FRAME].max);
+
+    frame_stats_end_frame(0.2);
+    expect_to_be_true(frame_stats_get(&stats));
+    expect_should_be(1, stats.hitchCount);
+    expect_float_to_be(200.0f, stats.sections[FRAME_STAT_FRAME].max);
+
+    // A reset empties the window but keeps the totals.
+    frame_stats_reset();
+    expect_to_be_false(frame_stats_get(&stats));
+    expect_should_be(0, stats.sampleCount);
+    expect_should_be(7, stats.totalFrames);
+    expect_should_be(3, stats.totalHitches);
+
+    test_system_end(&frameStats);
+    return true;
+}
+
+u8 frame_stats_should_write_reports_to_csv() {
+    TestSystem frameStats;
+    begin_frame_stats(16, "frame_stats_test.csv", &frameStats);
+    for (u32 i = 0; i < 8; ++i) {
+        frame_stats_record(FRAME_STAT_RENDER, 0.002);
+        frame_stats_record(FRAME_STAT_PRESENT, 0.001);
+        frame_stats_end_frame(0.016);
+    }
+    frame_stats_report();
+    // Nothing has happened since the report, so shutting down adds no row.
+    test_system_end(&frameStats);
+
+    // Read the header and the row, then delete the file before looking at them.
+    FileHandle file;
+    expect_to_be_true(filesystem_open("frame_stats_test.csv", FILE_MODE_READ, false, &file));
+    char header[1024];
+    char line[1024];
+    char rest[1024];
+    char* p = header;
+    u64 length = 0;
+    b8 readHeader = filesystem_read_line(&file, sizeof(header), &p, &length);
+    p = line;
+    b8 readRow = filesystem_read_line(&file, sizeof(line), &p, &length);
+    p = rest;
+    b8 readMore = filesystem_read_line(&file, sizeof(rest), &p, &length);
+    filesystem_close(&file);
+    expect_to_be_true(filesystem_delete("frame_stats_test.csv"));
+
+    expect_to_be_true(readHeader);
+    expect_to_be_true(strings_equal("time_s,frames,hitches,frame_min_ms,frame_mean_ms,frame_p50_ms,frame_p95_ms,frame_p99_ms,frame_max_ms,"
+                                   "update_min_ms,update_mean_ms,update_p50_ms,update_p95_ms,update_p99_ms,update_max_ms,"
+                                   "render_min_ms,render_mean_ms,render_p50_ms,render_p95_ms,render_p99_ms,render_max_ms,"
+                                   "present_min_ms,present_mean_ms,present_p50_ms,present_p95_ms,present_p99_ms,present_max_ms\n",
+                                   header));
+    expect_to_be_true(readRow);
+    // Skip the time the row was written at.
+    u64 start = 0;
+    while (line[start] && line[start] != ',') {
+        start++;
+    }
+    expect_to_be_true(strings_equal(",8,0,16.000,16.000,16.000,16.000,16.000,16.000,"
+                                   "0.000,0.000,0.000,0.000,0.000,0.000,"
+                                   "2.000,2.000,2.000,2.000,2.000,2.000,"
+                                   "1.000,1.000,1.000,1.000,1.000,1.000\n",
+                                   line + start));
+    expect_to_be_false(readMore);
+    return true;
+}
+
+u8 frame_stats_should_keep_collecting_without_a_csv_file() {
+    TestSystem frameStats;
+    KDEBUG("Note: The following errors are intentionally caused by this test.");
+    begin_frame_stats(16, "no_such_directory/frame_stats_test.csv", &frameStats);
+    expect_to_be_false(filesystem_exists("no_such_directory/frame_stats_test.csv"));
+
+    frame_stats_record(FRAME_STAT_RENDER, 0.002);
+    frame_stats_end_frame(0.016);
+    FrameStats stats;
+    expect_to_be_true(frame_stats_get(&stats));
+    expect_should_be(1, stats.sampleCount);
+    expect_float_to_be(2.0f, stats.sections[FRAME_STAT_RENDER].max);
+    frame_stats_report();
+
+    test_system_end(&frameStats);
+    return true;
+}
+
+void frame_stats_register_tests() {
+    test_manager_register_test(frame_stats_should_work_out_percentiles, "Frame stats should work out percentiles over the window");
+    test_manager_register_test(frame_stats_should_roll_the_window_and_count_hitches, "Frame stats should roll the window and count hitches");
+    test_manager_register_test(frame_stats_should_write_reports_to_csv, "Frame stats should write reports to a CSV file");
+    test_manager_register_test(frame_stats_should_keep_collecting_without_a_csv_file, "Frame stats should keep collecting without a CSV file");
+}
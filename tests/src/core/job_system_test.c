@@ -0,0 +1,183 @@
+#include "core/job_system_test.h"
+#include "expect.h"
+#include <defines.h>
+#include "test_manager.h"
+#include <core/job_system.h>
+#include <core/logger.h>
+#include <memory/kmemory.h>
+#include <platform/platform.h>
+#include <platform/thread.h>
+
+static void begin_jobs(u32 workerCount, u32 maxQueuedJobs, TestSystem* outSystem) {
+    JobSystemConfig config;
+    config.workerCount = workerCount;
+    config.maxQueuedJobs = maxQueuedJobs;
+    test_system_begin(outSystem, job_system_initialize, job_system_shutdown, config, MEMORY_TAG_JOB);
+}
+
+static void increment_job(void* param) {
+    __atomic_add_fetch((u32*)param, 1, __ATOMIC_RELAXED);
+}
+
+#define FAN_OUT 16
+#define LEAVES_PER_FAN 256
+
+typedef struct FanJob {
+    u32 leaves[LEAVES_PER_FAN];
+} FanJob;
+
+// Forks more jobs and waits on them from inside a job.
+static void fan_job(void* param) {
+    FanJob* fan = param;
+    JobCounter counter = {0};
+    JobInfo job = {increment_job, fan->leaves, JOB_PRIORITY_HIGH, &counter, 0};
+    job_system_submit_many(job, LEAVES_PER_FAN, sizeof(u32));
+    job_system_wait(&counter);
+}
+
+u8 job_system_should_fork_and_join() {
+    TestSystem jobs;
+    // Fewer slots than jobs, so some submissions run inline.
+    begin_jobs(3, 64, &jobs);
+    expect_should_be(4, job_system_thread_count());
+    expect_should_be(0, job_system_thread_index());
+
+    FanJob* fans = kallocate(sizeof(FanJob) * FAN_OUT, MEMORY_TAG_JOB);
+    JobCounter counter = {0};
+    JobInfo job = {fan_job, fans, JOB_PRIORITY_NORMAL, &counter, 0};
+    job_system_submit_many(job, FAN_OUT, sizeof(FanJob));
+    job_system_wait(&counter);
+    expect_to_be_true(job_system_is_done(&counter));
+
+    // Each leaf ran exactly once.
+    for (u32 i = 0; i < FAN_OUT; ++i) {
+        for (u32 j = 0; j < LEAVES_PER_FAN; ++j) {
+            expect_should_be(1, fans[i].leaves[j]);
+        }
+    }
+
+    kfree(fans, sizeof(FanJob) * FAN_OUT, MEMORY_TAG_JOB);
+    test_system_end(&jobs);
+    expect_should_be(INVALID_ID, job_system_thread_index());
+    return true;
+}
+
+typedef struct Stage {
+    u32 produced[64];
+    u32 sum;
+} Stage;
+
+static void produce_job(void* param) {
+    *(u32*)param = 1;
+}
+
+static void sum_job(void* param) {
+    Stage* stage = param;
+    u32 sum = 0;
+    for (u32 i = 0; i < 64; ++i) {
+        sum += stage->produced[i];
+    }
+    stage->sum = sum;
+}
+
+u8 job_system_should_respect_dependencies() {
+    TestSystem jobs;
+    begin_jobs(2, 256, &jobs);
+
+    for (u32 round = 0; round < 50; ++round) {
+        Stage stage = {0};
+        JobCounter produced = {0};
+        JobCounter summed = {0};
+        // Submitted first, so it is the first job some thread picks up.
+        JobInfo sum = {sum_job, &stage, JOB_PRIORITY_HIGH, &summed, &produced};
+        JobInfo produce = {produce_job, stage.produced, JOB_PRIORITY_LOW, &produced, 0};
+        // Count the producers before the sum can be picked up.
+        __atomic_add_fetch(&produced.pending, 1, __ATOMIC_RELAXED);
+        job_system_submit(sum);
+        job_system_submit_many(produce, 64, sizeof(u32));
+        __atomic_sub_fetch(&produced.pending, 1, __ATOMIC_RELEASE);
+        job_system_wait(&summed);
+        expect_should_be(64, stage.sum);
+    }
+
+    test_system_end(&jobs);
+    return true;
+}
+
+// Stands in for a long job, so the jobs depending on it are set aside and the workers go idle.
+static void long_job(void* param) {
+    platform_sleep(20);
+}
+
+u8 job_system_should_wake_workers_when_a_dependency_finishes() {
+    TestSystem jobs;
+    begin_jobs(2, 256, &jobs);
+
+    u32 counts[128] = {0};
+    JobCounter gate = {0};
+    JobCounter counter = {0};
+    JobInfo wait = {long_job, 0, JOB_PRIORITY_NORMAL, &gate, 0};
+    JobInfo job = {increment_job, counts, JOB_PRIORITY_NORMAL, &counter, &gate};
+    job_system_submit(wait);
+    job_system_submit_many(job, 128, sizeof(u32));
+
+    // The main thread does not help, so the workers must pick the jobs up again themselves.
+    for (u32 i = 0; i < 2000 && !job_system_is_done(&counter); ++i) {
+        platform_sleep(1);
+    }
+    expect_to_be_true(job_system_is_done(&counter));
+    for (u32 i = 0; i < 128; ++i) {
+        expect_should_be(1, counts[i]);
+    }
+
+    test_system_end(&jobs);
+    return true;
+}
+
+typedef struct Producer {
+    u32* counts;
+    JobCounter* counter;
+} Producer;
+
+// A thread outside the job system, such as a loader or network thread.
+static u32 submitting_thread(void* params) {
+    Producer* producer = params;
+    JobInfo job = {increment_job, producer->counts, JOB_PRIORITY_LOW, producer->counter, 0};
+    for (u32 round = 0; round < 8; ++round) {
+        job_system_submit_many(job, 128, sizeof(u32));
+    }
+    return 0;
+}
+
+u8 job_system_should_take_jobs_from_other_threads() {
+    // Without the system, jobs run as they are submitted.
+    u32 count = 0;
+    JobCounter counter = {0};
+    JobInfo job = {increment_job, &count, JOB_PRIORITY_NORMAL, &counter, 0};
+    job_system_submit(job);
+    expect_should_be(1, count);
+    expect_to_be_true(job_system_is_done(&counter));
+    expect_to_be_false(job_system_run_pending());
+
+    TestSystem jobs;
+    begin_jobs(2, 32, &jobs);
+    u32 counts[128] = {0};
+    Producer producer = {counts, &counter};
+    KThread thread;
+    expect_to_be_true(platform_thread_create(submitting_thread, &producer, &thread));
+    platform_thread_join(&thread);
+    job_system_wait(&counter);
+    for (u32 i = 0; i < 128; ++i) {
+        expect_should_be(8, counts[i]);
+    }
+
+    test_system_end(&jobs);
+    return true;
+}
+
+void job_system_register_tests() {
+    test_manager_register_test(job_system_should_fork_and_join, "Job system should fork and join, including from inside jobs");
+    test_manager_register_test(job_system_should_respect_dependencies, "Job system should not start a job before its dependency");
+    test_manager_register_test(job_system_should_wake_workers_when_a_dependency_finishes, "Job system should wake workers when a dependency finishes");
+    test_manager_register_test(job_system_should_take_jobs_from_other_threads, "Job system should take jobs from threads outside it");
+}
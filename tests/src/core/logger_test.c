@@ -0,0 +1,243 @@
+#include "core/logger_test.h"
+#include "expect.h"
+#include <defines.h>
+#include "test_manager.h"
+#include <core/kstring.h>
+#include <core/logger.h>
+#include <memory/kmemory.h>
+#include <platform/filesystem.h>
+#include <platform/thread.h>
+
+#define LOGGING_THREADS 4
+#define MESSAGES_PER_THREAD 50
+
+// shutdown_logging also takes the memory requirement, which it does not use.
+static void stop_logging(void* state) {
+    shutdown_logging(0, state);
+}
+
+static void begin_logging(u32 queueCapacity, const char* logFilePath, TestSystem* outSystem) {
+    LoggingConfig config;
+    config.queueCapacity = queueCapacity;
+    config.logFilePath = logFilePath;
+    config.channelLevels = 0;
+    test_system_begin(outSystem, initialize_logging, stop_logging, config, MEMORY_TAG_APPLICATION);
+}
+
+static u32 log_messages(void* params) {
+    u32 thread = (u32)(u64)params;
+    for (u32 i = 0; i < MESSAGES_PER_THREAD; ++i) {
+        KTRACE("Logger test thread %u, message %u.", thread, i);
+    }
+    return 0;
+}
+
+u8 logger_should_write_messages_from_many_threads() {
+    TestSystem logging;
+    begin_logging(1024, 0, &logging);
+
+    KThread threads[LOGGING_THREADS];
+    for (u32 i = 0; i < LOGGING_THREADS; ++i) {
+        expect_to_be_true(platform_thread_create(log_messages, (void*)(u64)i, &threads[i]));
+    }
+    for (u32 i = 0; i < LOGGING_THREADS; ++i) {
+        platform_thread_join(&threads[i]);
+    }
+
+    // The queue holds everything, so nothing is dropped, and the flush waits for all of it.
+    logger_flush();
+    LoggerStats stats;
+    logger_get_stats(&stats);
+    expect_should_be(LOGGING_THREADS * MESSAGES_PER_THREAD, stats.written);
+    expect_should_be(0, stats.dropped);
+
+    test_system_end(&logging);
+    return true;
+}
+
+u8 logger_should_drop_only_low_severity_messages_when_full() {
+    TestSystem logging;
+    begin_logging(4, 0, &logging);
+
+    // Far more than the queue holds, faster than the writer can print them.
+    const u32 traceCount = 200;
+    const u32 warnCount = 20;
+    for (u32 i = 0; i < traceCount; ++i) {
+        KTRACE("Logger test flood message %u.", i);
+        if (i % (traceCount / warnCount) == 0) {
+            KWARN("Logger test warning %u, which must not be dropped.", i);
+        }
+    }
+    logger_flush();
+
+    LoggerStats stats;
+    logger_get_stats(&stats);
+    // Every message was either written or counted as dropped, and only trace messages were dropped.
+    expect_should_be(traceCount + warnCount, stats.written + stats.dropped);
+    expect_to_be_true(stats.dropped <= traceCount);
+    expect_to_be_true(stats.written >= warnCount);
+
+    test_system_end(&logging);
+    return true;
+}
+
+u8 logger_should_flush_on_fatal_and_write_directly_after_shutdown() {
+    TestSystem logging;
+    begin_logging(64, 0, &logging);
+
+    // A fatal message is written before log_output returns.
+    KDEBUG("Note: The following fatal message is intentionally caused by this test.");
+    KFATAL("Logger test fatal message.");
+    LoggerStats stats;
+    logger_get_stats(&stats);
+    expect_should_be(2, stats.written);
+
+    test_system_end(&logging);
+
+    // Without the system, messages are written on the calling thread and nothing is counted.
+    KTRACE("Logger test message after shutdown.");
+    logger_flush();
+    logger_get_stats(&stats);
+    expect_should_be(0, stats.written);
+    expect_should_be(0, stats.dropped);
+    return true;
+}
+
+u8 logger_should_format_captured_arguments_as_printf_does() {
+    char expected[256];
+    char actual[256];
+    i32 value = -42;
+    void* pointer = &value;
+
+    // Captured arguments give the same text as formatting them at once.
+    const char* format = "%d %u %llu %5.2f %s %-8s| %x %p %c %% %hhd";
+    LogArg args[] = {KLOG_ARG(value), KLOG_ARG(7u), KLOG_ARG(123456789012ull), KLOG_ARG(3.14159f), KLOG_ARG("text"),
+                     KLOG_ARG("left"), KLOG_ARG(255), KLOG_ARG(pointer), KLOG_ARG('k'), KLOG_ARG(300)};
+    string_nformat(expected, sizeof(expected), format, value, 7u, 123456789012ull, 3.14159, "text", "left", 255, pointer, 'k', 300);
+    log_format_args(actual, sizeof(actual), format, 10, args);
+    expect_to_be_true(strings_equal(expected, actual));
+
+    // Star widths and precisions consume arguments, and a null string prints as printf prints it.
+    LogArg starArgs[] = {KLOG_ARG(6), KLOG_ARG(3), KLOG_ARG("truncated"), KLOG_ARG(-4), KLOG_ARG(12), log_arg_string(0)};
+    string_nformat(expected, sizeof(expected), "[%*.*s][%*d][%s]", 6, 3, "truncated", -4, 12, "(null)");
+    log_format_args(actual, sizeof(actual), "[%*.*s][%*d][%s]", 6, starArgs);
+    expect_to_be_true(strings_equal(expected, actual));
+
+    // Missing arguments leave the specification as it is, and the result is cut short to fit.
+    log_format_args(actual, sizeof(actual), "%d and %s", 1, args);
+    expect_to_be_true(strings_equal("-42 and %s", actual));
+    expect_should_be(3, log_format_args(actual, 4, "%s", 1, &args[4]));
+    expect_to_be_true(strings_equal("tex", actual));
+
+    // A deferred string is copied, so the caller may change it before the writer gets to it.
+    TestSystem logging;
+    begin_logging(64, "logger_test.log", &logging);
+    char name[32];
+    string_format(name, "%s", "original");
+    KTRACE("Logger test deferred string '%s'.", name);
+    string_format(name, "%s", "changed");
+    test_system_end(&logging);
+
+    FileHandle file;
+    expect_to_be_true(filesystem_open("logger_test.log", FILE_MODE_READ, false, &file));
+    u64 size = 0;
+    kzero_memory(actual, sizeof(actual));
+    expect_to_be_true(filesystem_size(&file, &size));
+    expect_to_be_true(size < sizeof(actual));
+    expect_to_be_true(filesystem_read_all_text(&file, actual, &size));
+    filesystem_close(&file);
+    expect_to_be_true(filesystem_delete("logger_test.log"));
+    expect_to_be_true(strings_equal("[TRACE]: Logger test deferred string 'original'.\n", actual));
+    return true;
+}
+
+u8 logger_should_write_long_messages_whole() {
+    // Longer than a queue record holds, whether formatted at once or captured for the writer.
+    char text[1200];
+    for (u32 i = 0; i < sizeof(text) - 1; ++i) {
+        text[i] = 'a' + (i % 26);
+    }
+    text[sizeof(text) - 1] = 0;
+
+    TestSystem logging;
+    begin_logging(64, "logger_test.log", &logging);
+    KWARN("Logger test long warning %s.", text);
+    KTRACE("Logger test long trace %s.", text);
+    test_system_end(&logging);
+
+    u64 expectedSize = sizeof(text) * 4;
+    char* expected = kallocate(expectedSize, MEMORY_TAG_STRING);
+    char* actual = kallocate(expectedSize, MEMORY_TAG_STRING);
+    string_nformat(expected, expectedSize, "[WARN]:  Logger test long warning %s.\n[TRACE]: Logger test long trace %s.\n", text, text);
+
+    FileHandle file;
+    expect_to_be_true(filesystem_open("logger_test.log", FILE_MODE_READ, false, &file));
+    u64 size = 0;
+    expect_to_be_true(filesystem_size(&file, &size));
+    expect_to_be_true((size < expectedSize));
+    expect_to_be_true(filesystem_read_all_text(&file, actual, &size));
+    filesystem_close(&file);
+    expect_to_be_true(filesystem_delete("logger_test.log"));
+    expect_should_be(string_length(expected), size);
+    expect_to_be_true(strings_equal(expected, actual));
+
+    kfree(expected, expectedSize, MEMORY_TAG_STRING);
+    kfree(actual, expectedSize, MEMORY_TAG_STRING);
+    return true;
+}
+
+u8 logger_should_filter_by_channel_level_and_rate_limit() {
+    TestSystem logging;
+    begin_logging(64, 0, &logging);
+
+    expect_to_be_true(logger_configure_levels("*=warn, core = debug"));
+    expect_should_be(LOG_LEVEL_DEBUG, logger_get_channel_level(LOG_CHANNEL_CORE));
+    expect_should_be(LOG_LEVEL_WARN, logger_get_channel_level(LOG_CHANNEL_RENDERER));
+    // Unknown names, and levels that would hide errors, are ignored.
+    expect_to_be_false(logger_configure_levels("renderer=loud,bogus=info,*=fatal,memory"));
+    expect_should_be(LOG_LEVEL_WARN, logger_get_channel_level(LOG_CHANNEL_RENDERER));
+    expect_should_be(LOG_LEVEL_DEBUG, logger_get_channel_level(LOG_CHANNEL_CORE));
+
+    // Skipped messages do not evaluate their arguments.
+    u32 evaluated = 0;
+    KTRACE("Logger test skipped message %u.", ++evaluated);
+    expect_should_be(0, evaluated);
+    KDEBUG("Logger test written message %u.", ++evaluated);
+    expect_should_be(1, evaluated);
+
+    // A rate limited call site writes a few messages from a burst.
+    for (u32 i = 0; i < 20; ++i) {
+        KDEBUG_LIMITED("Logger test rate limited message %u.", i);
+    }
+    logger_flush();
+    LoggerStats stats;
+    logger_get_stats(&stats);
+    expect_should_be(1 + LOG_RATE_LIMIT_COUNT, stats.written);
+
+    // Once its window has passed, the skipped messages are reported.
+    LogRateLimit limit = {0};
+    for (u32 i = 0; i < LOG_RATE_LIMIT_COUNT; ++i) {
+        expect_to_be_true(log_rate_limit_allow(&limit, LOG_LEVEL_DEBUG, "Logger test %u."));
+    }
+    expect_to_be_false(log_rate_limit_allow(&limit, LOG_LEVEL_DEBUG, "Logger test %u."));
+    expect_should_be(1, limit.skipped);
+    limit.windowStart = 1;
+    expect_to_be_true(log_rate_limit_allow(&limit, LOG_LEVEL_DEBUG, "Logger test %u."));
+    expect_should_be(0, limit.skipped);
+    logger_flush();
+    logger_get_stats(&stats);
+    expect_should_be(2 + LOG_RATE_LIMIT_COUNT, stats.written);
+
+    logger_set_channel_level(LOG_CHANNEL_COUNT, LOG_LEVEL_TRACE);
+    test_system_end(&logging);
+    return true;
+}
+
+void logger_register_tests() {
+    test_manager_register_test(logger_should_write_messages_from_many_threads, "Logger should write messages from many threads");
+    test_manager_register_test(logger_should_drop_only_low_severity_messages_when_full, "Logger should drop only low severity messages when full");
+    test_manager_register_test(logger_should_flush_on_fatal_and_write_directly_after_shutdown, "Logger should flush on fatal and write directly after shutdown");
+    test_manager_register_test(logger_should_format_captured_arguments_as_printf_does, "Logger should format captured arguments as printf does");
+    test_manager_register_test(logger_should_write_long_messages_whole, "Logger should write long messages whole");
+    test_manager_register_test(logger_should_filter_by_channel_level_and_rate_limit, "Logger should filter by channel level and rate limit");
+}
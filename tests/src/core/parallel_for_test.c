@@ -0,0 +1,218 @@
+#include "core/parallel_for_test.h"
+#include "expect.h"
+#include <defines.h>
+#include "test_manager.h"
+#include <core/job_system.h>
+#include <core/parallel_for.h>
+#include <core/logger.h>
+#include <math/math_types.h>
+#include <memory/kmemory.h>
+#include <platform/atomic.h>
+#include <platform/platform.h>
+#include <platform/thread.h>
+
+static void begin_jobs(u32 threadCount, TestSystem* outSystem) {
+    JobSystemConfig config;
+    config.workerCount = threadCount - 1;
+    config.maxQueuedJobs = 256;
+    test_system_begin(outSystem, job_system_initialize, job_system_shutdown, config, MEMORY_TAG_JOB);
+}
+
+typedef struct Visits {
+    u64 origin;
+    u64 grain;
+    u32* counts;
+    u32 misalignedChunks;
+    u32 chunks;
+} Visits;
+
+static void count_visits(u64 begin, u64 end, void* user) {
+    Visits* visits = user;
+    katomic_fetch_add_u32(&visits->chunks, 1);
+    if ((begin - visits->origin) % visits->grain != 0) {
+        katomic_fetch_add_u32(&visits->misalignedChunks, 1);
+    }
+    for (u64 i = begin; i < end; ++i) {
+        visits->counts[i - visits->origin]++;
+    }
+}
+
+static u8 check_visits(u64 begin, u64 end, u64 grain, u32 expectedChunks) {
+    u32 counts[10000] = {0};
+    Visits visits = {begin, grain ? grain : PARALLEL_FOR_DEFAULT_GRAIN, counts, 0, 0};
+    parallel_for(begin, end, grain, count_visits, &visits);
+    for (u64 i = 0; i < end - begin; ++i) {
+        expect_should_be(1, counts[i]);
+    }
+    expect_should_be(0, visits.misalignedChunks);
+    if (expectedChunks) {
+        expect_should_be(expectedChunks, visits.chunks);
+    }
+    return true;
+}
+
+u8 parallel_for_should_visit_each_index_once() {
+    // Without the job system the whole range is a single serial call.
+    if (!check_visits(100, 10000, 7, 1)) {
+        return false;
+    }
+
+    TestSystem jobs;
+    begin_jobs(4, &jobs);
+    // One grain or less runs serially.
+    if (!check_visits(0, 64, 64, 1) || !check_visits(5, 6, 0, 1)) {
+        return false;
+    }
+    // Four chunks per thread.
+    if (!check_visits(0, 1600, 100, 16) || !check_visits(100, 10000, 7, 16)) {
+        return false;
+    }
+    // Fewer grains than threads' worth of chunks.
+    if (!check_visits(0, 300, 100, 3) || !check_visits(0, 301, 100, 4)) {
+        return false;
+    }
+    test_system_end(&jobs);
+    return true;
+}
+
+// The layout geometry_system_generate_plane_config writes: 4 vertices and 6 indices per segment.
+typedef struct PlaneBuild {
+    Vertex3D* vertices;
+    u32* indices;
+    u32 segments;
+} PlaneBuild;
+
+static void build_plane_rows(u64 rowBegin, u64 rowEnd, void* user) {
+    PlaneBuild* plane = user;
+    f32 size = 1.0f / plane->segments;
+    for (u32 y = (u32)rowBegin; y < (u32)rowEnd; ++y) {
+        for (u32 x = 0; x < plane->segments; ++x) {
+            u32 segment = y * plane->segments + x;
+            Vertex3D* v = &plane->vertices[segment * 4];
+            f32 minX = x * size, minY = y * size, maxX = minX + size, maxY = minY + size;
+            v[0].position = (vec3){minX, minY, 0};
+            v[0].texcoord = (vec2){minX, minY};
+            v[1].position = (vec3){maxX, maxY, 0};
+            v[1].texcoord = (vec2){maxX, maxY};
+            v[2].position = (vec3){minX, maxY, 0};
+            v[2].texcoord = (vec2){minX, maxY};
+            v[3].position = (vec3){maxX, minY, 0};
+            v[3].texcoord = (vec2){maxX, minY};
+            u32* i = &plane->indices[segment * 6];
+            u32 base = segment * 4;
+            i[0] = base;
+            i[1] = base + 1;
+            i[2] = base + 2;
+            i[3] = base;
+            i[4] = base + 3;
+            i[5] = base + 1;
+        }
+    }
+}
+
+typedef struct AlphaScan {
+    const u8* pixels;
+    u32 found;
+} AlphaScan;
+
+// The scan load_texture runs over RGBA pixels.
+static void scan_alpha(u64 begin, u64 end, void* user) {
+    AlphaScan* scan = user;
+    if (katomic_load_u32(&scan->found)) {
+        return;
+    }
+    for (u64 i = begin; i < end; ++i) {
+        if (scan->pixels[i * 4 + 3] < 255) {
+            katomic_store_u32(&scan->found, true);
+            return;
+        }
+    }
+}
+
+#define PLANE_SEGMENTS 512
+#define IMAGE_SIZE 4096
+#define BENCHMARK_REPEATS 3
+
+u8 parallel_for_should_match_serial_output() {
+    u32 segmentCount = 64 * 64;
+    PlaneBuild serial = {kallocate(sizeof(Vertex3D) * segmentCount * 4, MEMORY_TAG_ARRAY), kallocate(sizeof(u32) * segmentCount * 6, MEMORY_TAG_ARRAY), 64};
+    PlaneBuild parallel = {kallocate(sizeof(Vertex3D) * segmentCount * 4, MEMORY_TAG_ARRAY), kallocate(sizeof(u32) * segmentCount * 6, MEMORY_TAG_ARRAY), 64};
+    build_plane_rows(0, 64, &serial);
+
+    TestSystem jobs;
+    begin_jobs(4, &jobs);
+    parallel_for(0, 64, 1, build_plane_rows, &parallel);
+    test_system_end(&jobs);
+
+    for (u32 i = 0; i < segmentCount * 4; ++i) {
+        expect_float_to_be(serial.vertices[i].position.x, parallel.vertices[i].position.x);
+        expect_float_to_be(serial.vertices[i].position.y, parallel.vertices[i].position.y);
+        expect_float_to_be(serial.vertices[i].texcoord.x, parallel.vertices[i].texcoord.x);
+        expect_float_to_be(serial.vertices[i].texcoord.y, parallel.vertices[i].texcoord.y);
+    }
+    for (u32 i = 0; i < segmentCount * 6; ++i) {
+        expect_should_be(serial.indices[i], parallel.indices[i]);
+    }
+    kfree(serial.vertices, sizeof(Vertex3D) * segmentCount * 4, MEMORY_TAG_ARRAY);
+    kfree(serial.indices, sizeof(u32) * segmentCount * 6, MEMORY_TAG_ARRAY);
+    kfree(parallel.vertices, sizeof(Vertex3D) * segmentCount * 4, MEMORY_TAG_ARRAY);
+    kfree(parallel.indices, sizeof(u32) * segmentCount * 6, MEMORY_TAG_ARRAY);
+    return true;
+}
+
+u8 parallel_for_benchmark_speedup() {
+    u32 segmentCount = PLANE_SEGMENTS * PLANE_SEGMENTS;
+    PlaneBuild plane = {kallocate(sizeof(Vertex3D) * segmentCount * 4, MEMORY_TAG_ARRAY), kallocate(sizeof(u32) * segmentCount * 6, MEMORY_TAG_ARRAY), PLANE_SEGMENTS};
+    u64 pixelCount = (u64)IMAGE_SIZE * IMAGE_SIZE;
+    // Fully opaque, so the scan reads every pixel.
+    u8* pixels = kallocate(pixelCount * 4, MEMORY_TAG_TEXTURE);
+    kset_memory(pixels, 255, pixelCount * 4);
+
+    KINFO("parallel_for on %u processors: %ux%u segment plane, %ux%u RGBA alpha scan.", platform_get_processor_count(), PLANE_SEGMENTS, PLANE_SEGMENTS, IMAGE_SIZE, IMAGE_SIZE);
+    f64 serialPlane = 0, serialScan = 0;
+    u32 threadCounts[] = {1, 2, 4, 8, 16};
+    for (u32 t = 0; t < 5; ++t) {
+        // A single thread is the serial fallback, with no job system at all.
+        TestSystem jobs = {0};
+        if (threadCounts[t] > 1) {
+            begin_jobs(threadCounts[t], &jobs);
+        }
+        f64 bestPlane = 1e9, bestScan = 1e9;
+        for (u32 r = 0; r < BENCHMARK_REPEATS; ++r) {
+            f64 start = platform_get_absolute_time();
+            parallel_for(0, PLANE_SEGMENTS, 4096 / PLANE_SEGMENTS + 1, build_plane_rows, &plane);
+            f64 middle = platform_get_absolute_time();
+            AlphaScan scan = {pixels, false};
+            parallel_for(0, pixelCount, 64 * 1024, scan_alpha, &scan);
+            f64 end = platform_get_absolute_time();
+            expect_to_be_false(scan.found);
+            if (middle - start < bestPlane) {
+                bestPlane = middle - start;
+            }
+            if (end - middle < bestScan) {
+                bestScan = end - middle;
+            }
+        }
+        if (jobs.state) {
+            test_system_end(&jobs);
+        } else {
+            serialPlane = bestPlane;
+            serialScan = bestScan;
+        }
+        KINFO("%2u threads: plane %.2f ms (%.2fx), alpha scan %.2f ms (%.2fx).", threadCounts[t],
+              bestPlane * 1000.0, serialPlane / bestPlane, bestScan * 1000.0, serialScan / bestScan);
+    }
+
+    // Spot check the last build.
+    expect_should_be(segmentCount * 4 - 1, plane.indices[segmentCount * 6 - 1] + 2);
+    kfree(pixels, pixelCount * 4, MEMORY_TAG_TEXTURE);
+    kfree(plane.vertices, sizeof(Vertex3D) * segmentCount * 4, MEMORY_TAG_ARRAY);
+    kfree(plane.indices, sizeof(u32) * segmentCount * 6, MEMORY_TAG_ARRAY);
+    return true;
+}
+
+void parallel_for_register_tests() {
+    test_manager_register_test(parallel_for_should_visit_each_index_once, "parallel_for should visit each index once, in chunks of whole grains");
+    test_manager_register_test(parallel_for_should_match_serial_output, "parallel_for should produce the same output as the serial loop");
+    test_manager_register_test(parallel_for_benchmark_speedup, "parallel_for speedup benchmark on plane and texture sized loops");
+}
@@ -0,0 +1,153 @@
+#include "core/profiler_test.h"
+#include "expect.h"
+#include <defines.h>
+#include "test_manager.h"
+#include <core/kstring.h>
+#include <core/profiler.h>
+#include <memory/kmemory.h>
+#include <platform/filesystem.h>
+#include <platform/thread.h>
+
+#define PROFILING_THREADS 4
+#define ZONES_PER_THREAD 20
+#define EVENTS_PER_THREAD 16
+
+static void begin_profiler(const char* tracePath, TestSystem* outSystem) {
+    ProfilerConfig config;
+    config.eventsPerThread = EVENTS_PER_THREAD;
+    config.maxThreads = 8;
+    config.tracePath = tracePath;
+    config.startupCaptureFrames = 0;
+    test_system_begin(outSystem, profiler_initialize, profiler_shutdown, config, MEMORY_TAG_APPLICATION);
+}
+
+static b8 text_contains(const char* text, const char* pattern) {
+    u64 patternLength = string_length(pattern);
+    for (const char* c = text; *c; ++c) {
+        u64 i = 0;
+        while (i < patternLength && c[i] == pattern[i]) {
+            i++;
+        }
+        if (i == patternLength) {
+            return true;
+        }
+    }
+    return false;
+}
+
+u8 profiler_should_export_nested_zones_as_chrome_trace() {
+    TestSystem profiler;
+    begin_profiler("profiler_test.json", &profiler);
+
+    expect_to_be_true(profiler_begin_capture(0));
+    ProfileZone outer = profiler_zone_begin("Outer \"zone\"");
+    ProfileZone inner = profiler_zone_begin("Inner");
+    profiler_zone_end(&inner);
+    profiler_zone_end(&outer);
+    ProfilerStats stats;
+    profiler_get_stats(&stats);
+    expect_to_be_true(stats.capturing);
+    expect_should_be(2, stats.eventCount);
+    expect_to_be_true(profiler_end_capture());
+    test_system_end(&profiler);
+
+    FileHandle file;
+    expect_to_be_true(filesystem_open("profiler_test.json", FILE_MODE_READ, false, &file));
+    u64 size = 0;
+    expect_to_be_true(filesystem_size(&file, &size));
+    char* text = kallocate(size + 1, MEMORY_TAG_APPLICATION);
+    expect_to_be_true(filesystem_read_all_text(&file, text, &size));
+    filesystem_close(&file);
+    expect_to_be_true(filesystem_delete("profiler_test.json"));
+
+    // Names are escaped, and the inner zone is one deeper than the outer one.
+    expect_to_be_true(text_contains(text, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":["));
+    expect_to_be_true(text_contains(text, "\"name\":\"thread_name\""));
+    expect_to_be_true(text_contains(text, "{\"name\":\"Outer \\\"zone\\\"\",\"ph\":\"X\""));
+    expect_to_be_true(text_contains(text, "\"args\":{\"depth\":0}}"));
+    expect_to_be_true(text_contains(text, "{\"name\":\"Inner\",\"ph\":\"X\""));
+    expect_to_be_true(text_contains(text, "\"args\":{\"depth\":1}}"));
+    expect_to_be_true(text_contains(text, "\n]}\n"));
+    kfree(text, size + 1, MEMORY_TAG_APPLICATION);
+    return true;
+}
+
+static u32 record_zones(void* params) {
+    char name[32];
+    string_format(name, "Profiler test %u", (u32)(u64)params);
+    profiler_set_thread_name(name);
+    for (u32 i = 0; i < ZONES_PER_THREAD; ++i) {
+        ProfileZone zone = profiler_zone_begin("Test zone");
+        profiler_zone_end(&zone);
+    }
+    return 0;
+}
+
+u8 profiler_should_record_each_thread_separately() {
+    TestSystem profiler;
+    begin_profiler(0, &profiler);
+    expect_to_be_true(profiler_begin_capture(0));
+
+    KThread threads[PROFILING_THREADS];
+    for (u32 i = 0; i < PROFILING_THREADS; ++i) {
+        expect_to_be_true(platform_thread_create(record_zones, (void*)(u64)i, &threads[i]));
+    }
+    for (u32 i = 0; i < PROFILING_THREADS; ++i) {
+        platform_thread_join(&threads[i]);
+    }
+
+    // Each thread filled its own buffer, and the zones that did not fit were counted.
+    ProfilerStats stats;
+    profiler_get_stats(&stats);
+    expect_should_be(PROFILING_THREADS, stats.threadCount);
+    expect_should_be(PROFILING_THREADS * EVENTS_PER_THREAD, stats.eventCount);
+    expect_should_be(PROFILING_THREADS * (ZONES_PER_THREAD - EVENTS_PER_THREAD), stats.droppedCount);
+
+    expect_to_be_true(profiler_end_capture());
+    test_system_end(&profiler);
+    return true;
+}
+
+u8 profiler_should_only_record_during_a_capture() {
+    TestSystem profiler;
+    begin_profiler(0, &profiler);
+
+    ProfileZone zone = profiler_zone_begin("Before capture");
+    profiler_zone_end(&zone);
+    profiler_frame_mark();
+    ProfilerStats stats;
+    profiler_get_stats(&stats);
+    expect_to_be_false(stats.capturing);
+    expect_should_be(0, stats.eventCount);
+
+    // A capture of two frames ends at the marker after the second one.
+    expect_to_be_true(profiler_begin_capture(2));
+    KDEBUG("Note: The following warning is intentionally caused by this test.");
+    expect_to_be_false(profiler_begin_capture(2));
+    profiler_frame_mark();
+    profiler_frame_mark();
+    profiler_get_stats(&stats);
+    expect_to_be_true(stats.capturing);
+    profiler_frame_mark();
+    profiler_get_stats(&stats);
+    expect_to_be_false(stats.capturing);
+    expect_should_be(3, stats.eventCount);
+
+    // The next capture starts from nothing.
+    expect_to_be_true(profiler_begin_capture(0));
+    zone = profiler_zone_begin("Second capture");
+    profiler_zone_end(&zone);
+    profiler_get_stats(&stats);
+    expect_should_be(1, stats.eventCount);
+
+    test_system_end(&profiler);
+    profiler_get_stats(&stats);
+    expect_should_be(0, stats.threadCount);
+    return true;
+}
+
+void profiler_register_tests() {
+    test_manager_register_test(profiler_should_export_nested_zones_as_chrome_trace, "Profiler should export nested zones as a Chrome trace");
+    test_manager_register_test(profiler_should_record_each_thread_separately, "Profiler should record each thread separately");
+    test_manager_register_test(profiler_should_only_record_during_a_capture, "Profiler should only record during a capture");
+}
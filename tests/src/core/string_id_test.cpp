@@ -0,0 +1,32 @@
+#include "core/string_id_test.h"
+#include "expect.h"
+#include <defines.h>
+#include "test_manager.h"
+#include <core/string_id.h>
+#include <resources/resource_types.h>
+
+// Built as C++, so the static_asserts in core/string_id.h are compiled with the tests.
+
+u8 string_id_should_match_compile_time_ids() {
+    expect_should_be(STRING_ID_OFFSET_BASIS, string_id(""));
+    expect_should_be(0xaf63dc4c8601ec8cULL, string_id("a"));
+    // Published 64-bit FNV-1a test vector.
+    expect_should_be(0x85944171f73967e8ULL, string_id("foobar"));
+    expect_should_be(KSID("foobar"), string_id("foobar"));
+
+    // Materials store the runtime id of their shader's name, and the renderer matches it against KSID.
+    expect_should_be(KSID(BUILTIN_SHADER_NAME_MATERIAL), string_id(BUILTIN_SHADER_NAME_MATERIAL));
+    return true;
+}
+
+u8 string_id_should_ignore_case() {
+    expect_should_be(string_id("builtin.materialshader"), string_id("Builtin.MaterialShader"));
+    expect_should_be(KSID("builtin.materialshader"), string_id("Builtin.MaterialShader"));
+    expect_should_not_be(string_id("Builtin.MaterialShader"), string_id("Builtin.MaterialShader2"));
+    return true;
+}
+
+void string_id_register_tests() {
+    test_manager_register_test(string_id_should_match_compile_time_ids, "String id should match compile-time ids");
+    test_manager_register_test(string_id_should_ignore_case, "String id should ignore case");
+}
@@ -0,0 +1,79 @@
+#include "core/string_intern_test.h"
+#include "expect.h"
+#include <defines.h>
+#include "test_manager.h"
+#include <core/string_intern.h>
+#include <core/kstring.h>
+#include <core/logger.h>
+#include <memory/kmemory.h>
+
+static void begin_intern(u32 maxStringCount, TestSystem* outSystem) {
+    StringInternConfig config;
+    config.maxStringCount = maxStringCount;
+    config.maxStringBytes = 1024 * 1024;
+    test_system_begin(outSystem, string_intern_initialize, string_intern_shutdown, config, MEMORY_TAG_STRING);
+}
+
+u8 string_intern_should_ignore_case() {
+    TestSystem intern;
+    begin_intern(64, &intern);
+
+    expect_should_be(STRING_ID_EMPTY, string_intern(""));
+
+    u32 id = string_intern("Cobblestone");
+    expect_should_not_be(INVALID_ID, id);
+    expect_should_be(id, string_intern("cobblestone"));
+    expect_should_be(id, string_intern_find("COBBLESTONE"));
+
+    // The spelling it was first interned with is kept.
+    expect_to_be_true(strings_equal("Cobblestone", string_intern_get(id)));
+
+    test_system_end(&intern);
+    return true;
+}
+
+u8 string_intern_should_give_distinct_ids() {
+    TestSystem intern;
+    begin_intern(256, &intern);
+
+    char name[32];
+    u32 ids[200];
+    for (u32 i = 0; i < 200; ++i) {
+        string_format(name, "texture_%u", i);
+        expect_should_be(INVALID_ID, string_intern_find(name));
+        ids[i] = string_intern(name);
+        expect_should_not_be(INVALID_ID, ids[i]);
+    }
+    for (u32 i = 0; i < 200; ++i) {
+        string_format(name, "texture_%u", i);
+        expect_should_be(ids[i], string_intern_find(name));
+        expect_to_be_true(strings_equal(name, string_intern_get(ids[i])));
+        if (i > 0) {
+            expect_should_not_be(ids[i - 1], ids[i]);
+        }
+    }
+
+    test_system_end(&intern);
+    return true;
+}
+
+u8 string_intern_should_stop_when_full() {
+    TestSystem intern;
+    // The empty string takes one of the two.
+    begin_intern(2, &intern);
+
+    expect_should_not_be(INVALID_ID, string_intern("one"));
+    KDEBUG("Note: The following error is intentionally caused by this test.");
+    expect_should_be(INVALID_ID, string_intern("two"));
+    expect_should_be(INVALID_ID, string_intern_find("two"));
+    expect_to_be_true(strings_equal("", string_intern_get(INVALID_ID)));
+
+    test_system_end(&intern);
+    return true;
+}
+
+void string_intern_register_tests() {
+    test_manager_register_test(string_intern_should_ignore_case, "String interning should ignore case");
+    test_manager_register_test(string_intern_should_give_distinct_ids, "String interning should give distinct ids");
+    test_manager_register_test(string_intern_should_stop_when_full, "String interning should stop when full");
+}
@@ -1,12 +1,54 @@
 #include "expect.h"
 #include "test_manager.h"
 #include "memory/linear_allocator_test.h"
+#include "memory/dynamic_allocator_test.h"
+#include "memory/pool_allocator_test.h"
+#include "memory/stack_allocator_test.h"
+#include "memory/frame_allocator_test.h"
+#include "memory/virtual_arena_test.h"
+#include "memory/kmemory_test.h"
+#include "containers/darray_test.h"
+#include "containers/kvector_test.h"
+#include "containers/slot_map_test.h"
+#include "containers/hash_test.h"
+#include "containers/hashtable_test.h"
+#include "containers/ring_queue_test.h"
+#include "core/logger_test.h"
+#include "core/string_intern_test.h"
+#include "core/string_id_test.h"
+#include "core/job_system_test.h"
+#include "core/parallel_for_test.h"
+#include "core/profiler_test.h"
+#include "core/frame_stats_test.h"
+#include "platform/thread_test.h"
+#include "systems/resource_system_test.h"
 int main() {
     // Always initalize the test manager first.
     test_manager_init();
 
     // TODO: add test registrations here.
     linear_allocator_register_tests();
+    dynamic_allocator_register_tests();
+    pool_allocator_register_tests();
+    stack_allocator_register_tests();
+    frame_allocator_register_tests();
+    virtual_arena_register_tests();
+    kmemory_register_tests();
+    darray_register_tests();
+    kvector_register_tests();
+    slot_map_register_tests();
+    hash_register_tests();
+    hashtable_register_tests();
+    ring_queue_register_tests();
+    logger_register_tests();
+    string_intern_register_tests();
+    string_id_register_tests();
+    job_system_register_tests();
+    parallel_for_register_tests();
+    profiler_register_tests();
+    frame_stats_register_tests();
+    thread_register_tests();
+    resource_system_register_tests();
 
 
     KDEBUG("Starting tests...");
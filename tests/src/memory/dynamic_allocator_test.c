@@ -0,0 +1,114 @@
+#include "memory/dynamic_allocator_test.h"
+#include "expect.h"
+#include <defines.h>
+#include "test_manager.h"
+#include <memory/dynamic_allocator.h>
+
+u8 dynamic_allocator_should_create_and_destroy() {
+    DynamicAllocator alloc;
+    expect_to_be_true(dynamic_allocator_create(1024, 0, &alloc));
+
+    expect_should_not_be(0, alloc.memory);
+    expect_should_be(1024, alloc.totalSize);
+    expect_should_be(0, alloc.allocated);
+    expect_should_be(1024, dynamic_allocator_free_space(&alloc));
+
+    dynamic_allocator_destroy(&alloc);
+
+    expect_should_be(0, alloc.memory);
+    expect_should_be(0, alloc.totalSize);
+
+    return true;
+}
+
+u8 dynamic_allocator_single_allocation_and_free() {
+    DynamicAllocator alloc;
+    dynamic_allocator_create(1024, 0, &alloc);
+
+    void* block = dynamic_allocator_allocate(&alloc, 64);
+    expect_should_not_be(0, block);
+    expect_should_be(0, (u64)block % 16);
+    expect_to_be_true(dynamic_allocator_owns(&alloc, block));
+    expect_to_be_true(dynamic_allocator_block_size(&alloc, block) >= 64);
+    expect_should_be(1, alloc.allocationCount);
+
+    expect_to_be_true(dynamic_allocator_free(&alloc, block));
+    expect_should_be(0, alloc.allocated);
+    expect_should_be(1024, dynamic_allocator_largest_free_block(&alloc));
+
+    dynamic_allocator_destroy(&alloc);
+    return true;
+}
+
+u8 dynamic_allocator_over_allocate() {
+    DynamicAllocator alloc;
+    dynamic_allocator_create(1024, 0, &alloc);
+
+    void* block = dynamic_allocator_allocate(&alloc, 2048);
+    expect_should_be(0, block);
+    expect_should_be(0, alloc.allocated);
+
+    dynamic_allocator_destroy(&alloc);
+    return true;
+}
+
+u8 dynamic_allocator_free_should_coalesce() {
+    u64 max_allocs = 16;
+    DynamicAllocator alloc;
+    dynamic_allocator_create(4096, 0, &alloc);
+
+    void* blocks[16];
+    for (u64 i = 0; i < max_allocs; ++i) {
+        blocks[i] = dynamic_allocator_allocate(&alloc, 100);
+        expect_should_not_be(0, blocks[i]);
+    }
+
+    // Free every other block, leaving holes that cannot be merged.
+    for (u64 i = 0; i < max_allocs; i += 2) {
+        expect_to_be_true(dynamic_allocator_free(&alloc, blocks[i]));
+    }
+    expect_to_be_true(dynamic_allocator_largest_free_block(&alloc) < 4096);
+
+    // Freeing the rest should merge everything back into a single block.
+    for (u64 i = 1; i < max_allocs; i += 2) {
+        expect_to_be_true(dynamic_allocator_free(&alloc, blocks[i]));
+    }
+    expect_should_be(0, alloc.allocated);
+    expect_should_be(4096, dynamic_allocator_largest_free_block(&alloc));
+
+    // The whole range should be usable again.
+    void* big = dynamic_allocator_allocate(&alloc, 4000);
+    expect_should_not_be(0, big);
+    dynamic_allocator_free(&alloc, big);
+
+    dynamic_allocator_destroy(&alloc);
+    return true;
+}
+
+u8 dynamic_allocator_reuses_freed_block() {
+    DynamicAllocator alloc;
+    dynamic_allocator_create(1024, 0, &alloc);
+
+    void* a = dynamic_allocator_allocate(&alloc, 128);
+    void* b = dynamic_allocator_allocate(&alloc, 128);
+    expect_should_not_be(0, b);
+    dynamic_allocator_free(&alloc, a);
+
+    void* c = dynamic_allocator_allocate(&alloc, 96);
+    expect_should_be(a, c);
+
+    KDEBUG("Note: The following error is intentionally caused by this test.");
+    dynamic_allocator_free(&alloc, c);
+    expect_to_be_false(dynamic_allocator_free(&alloc, c));
+
+    dynamic_allocator_destroy(&alloc);
+    return true;
+}
+
+void dynamic_allocator_register_tests() {
+    test_manager_register_test(dynamic_allocator_should_create_and_destroy, "Dynamic allocator should create and destroy");
+    test_manager_register_test(dynamic_allocator_single_allocation_and_free, "Dynamic allocator single alloc and free");
+    test_manager_register_test(dynamic_allocator_over_allocate, "Dynamic allocator try over allocate");
+    test_manager_register_test(dynamic_allocator_free_should_coalesce, "Dynamic allocator should coalesce free blocks");
+    test_manager_register_test(dynamic_allocator_reuses_freed_block, "Dynamic allocator reuses freed blocks and rejects double free");
+}
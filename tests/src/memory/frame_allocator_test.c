@@ -0,0 +1,74 @@
+#include "memory/frame_allocator_test.h"
+#include "expect.h"
+#include <defines.h>
+#include "test_manager.h"
+#include <memory/frame_allocator.h>
+#include <memory/kmemory.h>
+
+u8 frame_allocator_allocations_are_aligned() {
+    FrameAllocatorConfig config;
+    config.frameSize = 1024;
+    config.frameCount = 2;
+    TestSystem frames;
+    expect_to_be_true(test_system_begin(&frames, frame_allocator_initialize, frame_allocator_shutdown, config, MEMORY_TAG_APPLICATION));
+
+    u8* a = frame_allocate(3);
+    u8* b = frame_allocate(20);
+    expect_should_not_be(0, a);
+    expect_should_not_be(0, b);
+    expect_should_be(0, (u64)b % 16);
+    expect_should_be(16, b - a);
+    expect_should_be(36, frame_allocator_used());
+
+    test_system_end(&frames);
+    return true;
+}
+
+u8 frame_allocator_reuses_arena_after_frame_count() {
+    FrameAllocatorConfig config;
+    config.frameSize = 1024;
+    config.frameCount = 3;
+    TestSystem frames;
+    test_system_begin(&frames, frame_allocator_initialize, frame_allocator_shutdown, config, MEMORY_TAG_APPLICATION);
+
+    u64* first = frame_allocate(sizeof(u64));
+    *first = 42;
+
+    // Data from a frame must survive while the following frames are in flight.
+    frame_allocator_begin_frame();
+    expect_should_be(0, frame_allocator_used());
+    u64* second = frame_allocate(sizeof(u64));
+    expect_should_not_be(first, second);
+    frame_allocator_begin_frame();
+    expect_should_be(42, *first);
+
+    // Once frameCount frames have passed, the first arena is reset and reused.
+    frame_allocator_begin_frame();
+    expect_should_be(0, *first);
+    u64* reused = frame_allocate(sizeof(u64));
+    expect_should_be(first, reused);
+
+    test_system_end(&frames);
+    return true;
+}
+
+u8 frame_allocator_over_allocate() {
+    FrameAllocatorConfig config;
+    config.frameSize = 64;
+    config.frameCount = 1;
+    TestSystem frames;
+    test_system_begin(&frames, frame_allocator_initialize, frame_allocator_shutdown, config, MEMORY_TAG_APPLICATION);
+
+    expect_should_not_be(0, frame_allocate(64));
+    KDEBUG("Note: The following error is intentionally caused by this test.");
+    expect_should_be(0, frame_allocate(1));
+
+    test_system_end(&frames);
+    return true;
+}
+
+void frame_allocator_register_tests() {
+    test_manager_register_test(frame_allocator_allocations_are_aligned, "Frame allocator allocations are aligned");
+    test_manager_register_test(frame_allocator_reuses_arena_after_frame_count, "Frame allocator reuses an arena after frameCount frames");
+    test_manager_register_test(frame_allocator_over_allocate, "Frame allocator try over allocate");
+}
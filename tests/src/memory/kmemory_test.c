@@ -0,0 +1,257 @@
+#include "memory/kmemory_test.h"
+#include "expect.h"
+#include <defines.h>
+#include "test_manager.h"
+#include <core/kstring.h>
+#include <core/logger.h>
+#include <memory/kmemory.h>
+#include <platform/thread.h>
+
+// Starts the memory system with a 1MiB heap.
+static void begin_memory(TestSystem* outSystem) {
+    MemorySystemConfig config;
+    config.totalAllocSize = 1024 * 1024;
+    test_system_begin(outSystem, memory_system_initialize, memory_system_shutdown, config, MEMORY_TAG_APPLICATION);
+}
+
+u8 kmemory_aligned_allocation_and_free() {
+    TestSystem memory;
+    begin_memory(&memory);
+
+    u16 alignments[4] = {8, 16, 32, 64};
+    void* blocks[4];
+    for (u32 i = 0; i < 4; ++i) {
+        blocks[i] = kallocate_aligned(100, alignments[i], MEMORY_TAG_ARRAY);
+        expect_should_not_be(0, blocks[i]);
+        expect_should_be(0, (u64)blocks[i] % alignments[i]);
+        expect_should_be(0, ((u8*)blocks[i])[99]);
+    }
+    expect_should_be(4, get_memory_alloc_count());
+
+    for (u32 i = 0; i < 4; ++i) {
+        kfree_aligned(blocks[i], 100, alignments[i], MEMORY_TAG_ARRAY);
+    }
+
+    // Larger than the heap, so this comes from the OS instead.
+    void* large = kallocate_aligned(2 * 1024 * 1024, 256, MEMORY_TAG_ARRAY);
+    expect_should_not_be(0, large);
+    expect_should_be(0, (u64)large % 256);
+    kfree_aligned(large, 2 * 1024 * 1024, 256, MEMORY_TAG_ARRAY);
+
+    test_system_end(&memory);
+    return true;
+}
+
+u8 kmemory_pooled_blocks_are_reused_through_thread_cache() {
+    TestSystem memory;
+    begin_memory(&memory);
+
+    // Freed blocks go to this thread's cache and are handed straight back out.
+    void* first = kallocate_pooled(48, MEMORY_TAG_STRING);
+    expect_should_not_be(0, first);
+    kfree_pooled(first, 48, MEMORY_TAG_STRING);
+    void* second = kallocate_pooled(48, MEMORY_TAG_STRING);
+    expect_should_be(first, second);
+    expect_should_be(0, ((u8*)second)[47]);
+
+    // Churn well past the cache limit so blocks have to move back to the shared pool.
+    void* blocks[200];
+    for (u32 i = 0; i < 200; ++i) {
+        blocks[i] = kallocate_pooled(48, MEMORY_TAG_STRING);
+        expect_should_not_be(0, blocks[i]);
+    }
+    for (u32 i = 0; i < 200; ++i) {
+        kfree_pooled(blocks[i], 48, MEMORY_TAG_STRING);
+    }
+    kfree_pooled(second, 48, MEMORY_TAG_STRING);
+    memory_thread_cache_flush();
+
+    test_system_end(&memory);
+    return true;
+}
+
+u8 kmemory_reallocate_preserves_contents() {
+    TestSystem memory;
+    begin_memory(&memory);
+
+    u8* block = kreallocate(0, 0, 64, MEMORY_TAG_ARRAY);
+    expect_should_not_be(0, block);
+    for (u32 i = 0; i < 64; ++i) {
+        block[i] = (u8)i;
+    }
+
+    // Grows past the heap, so the block moves to the OS, and then grows again there.
+    u64 sizes[3] = {4096, 2 * 1024 * 1024, 3 * 1024 * 1024};
+    u64 size = 64;
+    for (u32 s = 0; s < 3; ++s) {
+        block = kreallocate(block, size, sizes[s], MEMORY_TAG_ARRAY);
+        expect_should_not_be(0, block);
+        for (u32 i = 0; i < 64; ++i) {
+            expect_should_be(i, block[i]);
+        }
+        // Bytes beyond the old size are zeroed.
+        expect_should_be(0, block[size]);
+        expect_should_be(0, block[sizes[s] - 1]);
+        size = sizes[s];
+    }
+
+    block = kreallocate(block, size, 32, MEMORY_TAG_ARRAY);
+    expect_should_be(31, block[31]);
+    kfree(block, 32, MEMORY_TAG_ARRAY);
+
+    test_system_end(&memory);
+    return true;
+}
+
+// Sums the usage of every tag.
+static u64 tagged_usage() {
+    u64 sum = 0;
+    for (u32 i = 0; i < MEMORY_TAG_MAX_TAGS; ++i) {
+        sum += get_memory_tag_usage(i);
+    }
+    return sum;
+}
+
+u8 kmemory_pooled_bytes_are_counted_once() {
+    TestSystem memory;
+    begin_memory(&memory);
+
+    // The first block also adds a pool page, counted as pool space.
+    void* first = kallocate_pooled(48, MEMORY_TAG_STRING);
+    expect_should_be(48, get_memory_tag_usage(MEMORY_TAG_STRING));
+    expect_should_be(get_memory_total_usage(), tagged_usage());
+
+    // Later blocks move bytes from the pool to their tag, leaving the total as it was.
+    u64 total = get_memory_total_usage();
+    u64 pool = get_memory_tag_usage(MEMORY_TAG_POOL_ALLOCATOR);
+    void* second = kallocate_pooled(48, MEMORY_TAG_STRING);
+    expect_should_be(96, get_memory_tag_usage(MEMORY_TAG_STRING));
+    expect_should_be(pool - 48, get_memory_tag_usage(MEMORY_TAG_POOL_ALLOCATOR));
+    expect_should_be(total, get_memory_total_usage());
+    expect_should_be(get_memory_total_usage(), tagged_usage());
+
+    kfree_pooled(second, 48, MEMORY_TAG_STRING);
+    kfree_pooled(first, 48, MEMORY_TAG_STRING);
+    expect_should_be(0, get_memory_tag_usage(MEMORY_TAG_STRING));
+    expect_should_be(pool + 48, get_memory_tag_usage(MEMORY_TAG_POOL_ALLOCATOR));
+    expect_should_be(total, get_memory_total_usage());
+
+    memory_thread_cache_flush();
+    test_system_end(&memory);
+    return true;
+}
+
+#define ALLOCATING_THREADS 4
+#define ALLOCATIONS_PER_THREAD 2000
+#define LIVE_BLOCKS 16
+
+// Allocates and frees blocks of varied sizes from the heap and the pools, keeping a few alive
+// at a time, and checks that no other thread wrote over them. Returns the number of bad blocks.
+static u32 allocate_and_free(void* params) {
+    u8 pattern = (u8)(u64)params;
+    u8* blocks[LIVE_BLOCKS] = {0};
+    u64 sizes[LIVE_BLOCKS] = {0};
+    u32 bad = 0;
+    for (u32 i = 0; i < ALLOCATIONS_PER_THREAD; ++i) {
+        u32 slot = i % LIVE_BLOCKS;
+        if (blocks[slot]) {
+            for (u64 j = 0; j < sizes[slot]; ++j) {
+                bad += blocks[slot][j] != pattern;
+            }
+            if (slot % 2) {
+                kfree_pooled(blocks[slot], sizes[slot], MEMORY_TAG_ARRAY);
+            } else {
+                kfree(blocks[slot], sizes[slot], MEMORY_TAG_ARRAY);
+            }
+        }
+        // Odd slots take small pooled blocks; even ones go to the heap.
+        sizes[slot] = slot % 2 ? 16 + (i * 7) % 200 : 300 + (i * 37) % 4000;
+        blocks[slot] = slot % 2 ? kallocate_pooled(sizes[slot], MEMORY_TAG_ARRAY) : kallocate(sizes[slot], MEMORY_TAG_ARRAY);
+        kset_memory(blocks[slot], pattern, sizes[slot]);
+    }
+    for (u32 slot = 0; slot < LIVE_BLOCKS; ++slot) {
+        if (slot % 2) {
+            kfree_pooled(blocks[slot], sizes[slot], MEMORY_TAG_ARRAY);
+        } else {
+            kfree(blocks[slot], sizes[slot], MEMORY_TAG_ARRAY);
+        }
+    }
+    memory_thread_cache_flush();
+    return bad;
+}
+
+u8 kmemory_should_allocate_and_free_from_many_threads() {
+    TestSystem memory;
+    begin_memory(&memory);
+    u64 allocations = get_memory_alloc_count();
+
+    KThread threads[ALLOCATING_THREADS];
+    for (u32 i = 0; i < ALLOCATING_THREADS; ++i) {
+        expect_to_be_true(platform_thread_create(allocate_and_free, (void*)(u64)(i + 1), &threads[i]));
+    }
+    for (u32 i = 0; i < ALLOCATING_THREADS; ++i) {
+        expect_should_be(0, platform_thread_join(&threads[i]));
+    }
+    // Every allocation was counted; growing the pools may have added a few of their own.
+    expect_to_be_true((get_memory_alloc_count() >= allocations + ALLOCATING_THREADS * ALLOCATIONS_PER_THREAD));
+
+    test_system_end(&memory);
+    return true;
+}
+
+#if KMEMORY_TRACKING
+u8 kmemory_tracking_should_report_a_leak_with_its_call_site() {
+    TestSystem memory;
+    begin_memory(&memory);
+
+    // Raise the peak, then come back down.
+    void* large = kallocate(4096, MEMORY_TAG_TEXTURE);
+    kfree(large, 4096, MEMORY_TAG_TEXTURE);
+    // A freed block is forgotten. Check before the heap can hand its address out again.
+    const char* file = 0;
+    u32 line = 0;
+    expect_to_be_false(memory_tracking_find(large, &file, &line));
+    void* freed = kallocate_pooled(32, MEMORY_TAG_STRING);
+    kfree_pooled(freed, 32, MEMORY_TAG_STRING);
+    // The pool page holding the pooled block is outstanding until shutdown.
+    MemoryTrackingSummary before;
+    memory_tracking_get_summary(&before);
+    u32 leakLine = __LINE__ + 1;
+    void* leaked = kallocate(100, MEMORY_TAG_TEXTURE);
+
+    MemoryTrackingSummary summary;
+    memory_tracking_get_summary(&summary);
+    expect_should_be(before.outstanding + 1, summary.outstanding);
+    expect_should_be(before.outstandingBytes + 100, summary.outstandingBytes);
+    expect_should_be(4096, summary.peakAllocations[MEMORY_TAG_TEXTURE]);
+    expect_should_be(32, summary.peakAllocations[MEMORY_TAG_STRING]);
+
+    expect_to_be_true(memory_tracking_find(leaked, &file, &line));
+    expect_to_be_true(strings_equal(__FILE__, file));
+    expect_should_be(leakLine, line);
+
+    // The leak is only in this frame's report while this frame lasts.
+    KDEBUG("Note: The following warnings are intentionally caused by this test.");
+    memory_tracking_report(true);
+    memory_tracking_begin_frame();
+    memory_tracking_report(true);
+    memory_tracking_report(false);
+
+    kfree(leaked, 100, MEMORY_TAG_TEXTURE);
+    memory_tracking_get_summary(&summary);
+    expect_should_be(before.outstanding, summary.outstanding);
+    test_system_end(&memory);
+    return true;
+}
+#endif
+
+void kmemory_register_tests() {
+    test_manager_register_test(kmemory_aligned_allocation_and_free, "kallocate_aligned returns aligned, zeroed blocks");
+    test_manager_register_test(kmemory_pooled_blocks_are_reused_through_thread_cache, "kallocate_pooled reuses blocks through the thread cache");
+    test_manager_register_test(kmemory_pooled_bytes_are_counted_once, "Pooled bytes are counted once, under their own tag");
+    test_manager_register_test(kmemory_should_allocate_and_free_from_many_threads, "kallocate and kfree should work from many threads at once");
+#if KMEMORY_TRACKING
+    test_manager_register_test(kmemory_tracking_should_report_a_leak_with_its_call_site, "Allocation tracking should report a leak with its call site");
+#endif
+    test_manager_register_test(kmemory_reallocate_preserves_contents, "kreallocate preserves contents and zeroes new bytes");
+}
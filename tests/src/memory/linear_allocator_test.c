@@ -106,10 +106,34 @@ u8 linear_allocator_multi_allocation_all_space_then_free() {
     return true;
 }
 
+u8 linear_allocator_aligned_allocation() {
+    LinearAllocator alloc;
+    linear_allocator_create(256, 0, &alloc);
+
+    void* unaligned = linear_allocator_allocate_aligned(&alloc, 1, 1);
+    expect_should_not_be(0, unaligned);
+
+    // Padding up to the next 64-byte boundary counts towards the allocated size.
+    void* block = linear_allocator_allocate_aligned(&alloc, 16, 64);
+    expect_should_not_be(0, block);
+    expect_should_be(0, (u64)block % 64);
+    expect_should_be((u64)block - (u64)alloc.memory + 16, alloc.allocated);
+
+    // Regular allocations stay pointer aligned.
+    linear_allocator_allocate_aligned(&alloc, 3, 1);
+    void* next = linear_allocator_allocate(&alloc, sizeof(u64));
+    expect_should_be(0, (u64)next % LINEAR_ALLOCATOR_DEFAULT_ALIGNMENT);
+
+    linear_allocator_destroy(&alloc);
+
+    return true;
+}
+
 void linear_allocator_register_tests() {
     test_manager_register_test(linear_allocator_should_create_and_destroy, "Linear allocator should create and destroy");
     test_manager_register_test(linear_allocator_single_allocation_all_space, "Linear allocator single alloc for all space");
     test_manager_register_test(linear_allocator_multi_allocation_all_space, "Linear allocator multi alloc for all space");
     test_manager_register_test(linear_allocator_multi_allocation_over_allocate, "Linear allocator try over allocate");
     test_manager_register_test(linear_allocator_multi_allocation_all_space_then_free, "Linear allocator allocated should be 0 after free_all");
+    test_manager_register_test(linear_allocator_aligned_allocation, "Linear allocator aligned allocation");
 } 
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "memory/pool_allocator_test.h"
+#include "expect.h"
+#include <defines.h>
+#include "test_manager.h"
+#include <memory/pool_allocator.h>
+
+u8 pool_allocator_should_create_and_destroy() {
+    PoolAllocator pool;
+    expect_to_be_true(pool_allocator_create(12, 8, &pool));
+
+    // Element size is rounded up so every element can hold the free list link.
+    expect_should_be(16, pool.elementSize);
+    expect_should_be(8, pool.elementsPerPage);
+    expect_should_be(0, pool.pageCount);
+
+    pool_allocator_destroy(&pool);
+
+    expect_should_be(0, pool.elementSize);
+    expect_should_be(0, pool.pages);
+
+    return true;
+}
+
+u8 pool_allocator_reuses_freed_element() {
+    PoolAllocator pool;
+    pool_allocator_create(32, 4, &pool);
+
+    void* a = pool_allocator_allocate(&pool);
+    void* b = pool_allocator_allocate(&pool);
+    expect_should_not_be(0, a);
+    expect_should_not_be(0, b);
+    expect_should_be(32, (u8*)b - (u8*)a);
+    expect_should_be(2, pool.allocatedCount);
+
+    pool_allocator_free(&pool, a);
+    expect_should_be(1, pool.allocatedCount);
+
+    // The most recently freed element is handed out first.
+    void* c = pool_allocator_allocate(&pool);
+    expect_should_be(a, c);
+
+    pool_allocator_free(&pool, b);
+    pool_allocator_free(&pool, c);
+    expect_should_be(0, pool.allocatedCount);
+
+    pool_allocator_destroy(&pool);
+    return true;
+}
+
+u8 pool_allocator_grows_by_page() {
+    PoolAllocator pool;
+    pool_allocator_create(16, 4, &pool);
+
+    void* blocks[9];
+    for (u64 i = 0; i < 9; ++i) {
+        blocks[i] = pool_allocator_allocate(&pool);
+        expect_should_not_be(0, blocks[i]);
+    }
+    expect_should_be(3, pool.pageCount);
+    expect_should_be(9, pool.allocatedCount);
+
+    for (u64 i = 0; i < 9; ++i) {
+        pool_allocator_free(&pool, blocks[i]);
+    }
+
+    // Freed elements are reused rather than adding more pages.
+    for (u64 i = 0; i < 9; ++i) {
+        blocks[i] = pool_allocator_allocate(&pool);
+    }
+    expect_should_be(3, pool.pageCount);
+
+    for (u64 i = 0; i < 9; ++i) {
+        pool_allocator_free(&pool, blocks[i]);
+    }
+    pool_allocator_destroy(&pool);
+    return true;
+}
+
+void pool_allocator_register_tests() {
+    test_manager_register_test(pool_allocator_should_create_and_destroy, "Pool allocator should create and destroy");
+    test_manager_register_test(pool_allocator_reuses_freed_element, "Pool allocator reuses freed elements");
+    test_manager_register_test(pool_allocator_grows_by_page, "Pool allocator grows one page at a time");
+}
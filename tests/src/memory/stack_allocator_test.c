@@ -0,0 +1,73 @@
+#include "memory/stack_allocator_test.h"
+#include "expect.h"
+#include <defines.h>
+#include "test_manager.h"
+#include <memory/stack_allocator.h>
+
+u8 stack_allocator_free_to_marker_releases_later_allocations() {
+    StackAllocator alloc;
+    stack_allocator_create(1024, 0, &alloc);
+
+    void* first = stack_allocator_allocate(&alloc, 40);
+    expect_should_not_be(0, first);
+    u64 marker = stack_allocator_get_marker(&alloc);
+
+    void* second = stack_allocator_allocate(&alloc, 100);
+    expect_should_not_be(0, second);
+    expect_should_be(0, (u64)second % STACK_ALLOCATOR_DEFAULT_ALIGNMENT);
+    stack_allocator_allocate(&alloc, 200);
+
+    // Only what was allocated after the marker is released.
+    stack_allocator_free_to_marker(&alloc, marker);
+    expect_should_be(marker, stack_allocator_get_marker(&alloc));
+    void* reused = stack_allocator_allocate(&alloc, 100);
+    expect_should_be(second, reused);
+    expect_to_be_true(alloc.peak >= 300);
+
+    stack_allocator_free_to_marker(&alloc, 0);
+    expect_should_be(0, alloc.linear.allocated);
+
+    stack_allocator_destroy(&alloc);
+    return true;
+}
+
+u8 stack_allocator_rejects_stale_marker() {
+    StackAllocator alloc;
+    stack_allocator_create(1024, 0, &alloc);
+
+    stack_allocator_allocate(&alloc, 64);
+    u64 marker = stack_allocator_get_marker(&alloc);
+    stack_allocator_free_to_marker(&alloc, 0);
+
+    // The marker is now above the top of the stack.
+    KDEBUG("Note: The following error is intentionally caused by this test.");
+    stack_allocator_free_to_marker(&alloc, marker);
+    expect_should_be(0, alloc.linear.allocated);
+
+    stack_allocator_destroy(&alloc);
+    return true;
+}
+
+static void allocate_in_scope(StackAllocator* alloc) {
+    STACK_ALLOCATOR_SCOPE(scope, alloc);
+    stack_allocator_allocate(alloc, 128);
+    stack_allocator_allocate(alloc, 256);
+}
+
+u8 stack_allocator_scope_frees_on_exit() {
+    StackAllocator alloc;
+    stack_allocator_create(1024, 0, &alloc);
+
+    stack_allocator_allocate(&alloc, 16);
+    allocate_in_scope(&alloc);
+    expect_should_be(16, alloc.linear.allocated);
+
+    stack_allocator_destroy(&alloc);
+    return true;
+}
+
+void stack_allocator_register_tests() {
+    test_manager_register_test(stack_allocator_free_to_marker_releases_later_allocations, "Stack allocator frees back to a marker");
+    test_manager_register_test(stack_allocator_rejects_stale_marker, "Stack allocator rejects a marker above the top");
+    test_manager_register_test(stack_allocator_scope_frees_on_exit, "Stack allocator scope frees on exit");
+}
@@ -0,0 +1,71 @@
+#include "memory/virtual_arena_test.h"
+#include "expect.h"
+#include <defines.h>
+#include "test_manager.h"
+#include <memory/virtual_arena.h>
+
+u8 virtual_arena_should_create_and_destroy() {
+    VirtualArena arena;
+    expect_to_be_true(virtual_arena_create(64 * 1024 * 1024, false, &arena));
+
+    expect_should_not_be(0, arena.memory);
+    expect_to_be_true(arena.reservedSize >= 64 * 1024 * 1024);
+    // Nothing is committed until it is allocated.
+    expect_should_be(0, arena.committedSize);
+
+    virtual_arena_destroy(&arena);
+
+    expect_should_be(0, arena.memory);
+    expect_should_be(0, arena.reservedSize);
+
+    return true;
+}
+
+u8 virtual_arena_commits_on_demand() {
+    VirtualArena arena;
+    virtual_arena_create(64 * 1024 * 1024, false, &arena);
+
+    u8* first = virtual_arena_allocate(&arena, 100);
+    expect_should_not_be(0, first);
+    expect_should_be(arena.commitGranularity, arena.committedSize);
+    first[99] = 1;
+
+    // Growing past the committed range commits more without moving earlier blocks.
+    u8* big = virtual_arena_allocate(&arena, arena.commitGranularity * 3);
+    expect_should_not_be(0, big);
+    expect_should_be(0, (u64)big % 16);
+    expect_to_be_true(arena.committedSize >= arena.allocated);
+    expect_should_be(1, first[99]);
+    big[arena.commitGranularity * 3 - 1] = 1;
+
+    // Reused memory comes back zeroed.
+    virtual_arena_free_all(&arena, false);
+    u8* reused = virtual_arena_allocate(&arena, 100);
+    expect_should_be(first, reused);
+    expect_should_be(0, reused[99]);
+
+    virtual_arena_free_all(&arena, true);
+    expect_should_be(0, arena.committedSize);
+
+    virtual_arena_destroy(&arena);
+    return true;
+}
+
+u8 virtual_arena_over_allocate() {
+    VirtualArena arena;
+    virtual_arena_create(1024, false, &arena);
+
+    KDEBUG("Note: The following error is intentionally caused by this test.");
+    void* block = virtual_arena_allocate(&arena, arena.reservedSize + 1);
+    expect_should_be(0, block);
+    expect_should_be(0, arena.allocated);
+
+    virtual_arena_destroy(&arena);
+    return true;
+}
+
+void virtual_arena_register_tests() {
+    test_manager_register_test(virtual_arena_should_create_and_destroy, "Virtual arena should create and destroy");
+    test_manager_register_test(virtual_arena_commits_on_demand, "Virtual arena commits pages on demand");
+    test_manager_register_test(virtual_arena_over_allocate, "Virtual arena try over allocate");
+}
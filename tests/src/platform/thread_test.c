@@ -0,0 +1,182 @@
+#include "platform/thread_test.h"
+#include "expect.h"
+#include <defines.h>
+#include "test_manager.h"
+#include <core/logger.h>
+#include <platform/atomic.h>
+#include <platform/thread.h>
+
+#define LOCK_THREAD_COUNT 4
+#define LOCK_INCREMENTS 20000
+
+typedef struct LockedCounter {
+    KMutex mutex;
+    // Deliberately not atomic; the mutex alone must keep it exact.
+    u64 value;
+} LockedCounter;
+
+static u32 increment_locked(void* params) {
+    LockedCounter* counter = params;
+    for (u32 i = 0; i < LOCK_INCREMENTS; ++i) {
+        platform_mutex_lock(&counter->mutex);
+        counter->value++;
+        platform_mutex_unlock(&counter->mutex);
+    }
+    return 0;
+}
+
+u8 mutex_should_serialize_threads() {
+    LockedCounter counter = {0};
+    expect_to_be_true(platform_mutex_try_lock(&counter.mutex));
+    expect_to_be_false(platform_mutex_try_lock(&counter.mutex));
+    platform_mutex_unlock(&counter.mutex);
+
+    KThread threads[LOCK_THREAD_COUNT];
+    for (u32 i = 0; i < LOCK_THREAD_COUNT; ++i) {
+        expect_to_be_true(platform_thread_create(increment_locked, &counter, &threads[i]));
+        platform_thread_set_name(&threads[i], "kohi-test-mutex-with-a-long-name");
+    }
+    for (u32 i = 0; i < LOCK_THREAD_COUNT; ++i) {
+        platform_thread_join(&threads[i]);
+    }
+    expect_should_be(LOCK_THREAD_COUNT * LOCK_INCREMENTS, counter.value);
+    expect_should_be(0, counter.mutex.state);
+    return true;
+}
+
+typedef struct Mailbox {
+    KMutex mutex;
+    KConditionVariable changed;
+    u32 message;
+    b8 full;
+    KSemaphore done;
+} Mailbox;
+
+// Echoes each message back incremented, until it receives 0.
+// Returns the number of messages echoed.
+static u32 echo_thread(void* params) {
+    Mailbox* mailbox = params;
+    u32 echoed = 0;
+    platform_mutex_lock(&mailbox->mutex);
+    while (true) {
+        while (!mailbox->full) {
+            platform_condition_wait(&mailbox->changed, &mailbox->mutex);
+        }
+        u32 message = mailbox->message;
+        if (message == 0) {
+            break;
+        }
+        mailbox->message = message + 1;
+        mailbox->full = false;
+        echoed++;
+        platform_condition_broadcast(&mailbox->changed);
+        platform_semaphore_signal(&mailbox->done, 1);
+    }
+    platform_mutex_unlock(&mailbox->mutex);
+    return echoed;
+}
+
+u8 condition_and_semaphore_should_hand_off() {
+    Mailbox mailbox = {0};
+
+    // Nothing has signalled it yet.
+    f64 start = platform_get_absolute_time();
+    expect_to_be_false(platform_semaphore_wait_timeout(&mailbox.done, 20));
+    expect_to_be_true((platform_get_absolute_time() - start >= 0.015));
+    platform_mutex_lock(&mailbox.mutex);
+    expect_to_be_false(platform_condition_wait_timeout(&mailbox.changed, &mailbox.mutex, 5));
+    // The mutex is held again after the wait.
+    expect_to_be_false(platform_mutex_try_lock(&mailbox.mutex));
+    platform_mutex_unlock(&mailbox.mutex);
+
+    KThread thread;
+    expect_to_be_true(platform_thread_create(echo_thread, &mailbox, &thread));
+    for (u32 i = 1; i <= 100; ++i) {
+        platform_mutex_lock(&mailbox.mutex);
+        mailbox.message = i * 10;
+        mailbox.full = true;
+        platform_condition_signal(&mailbox.changed);
+        platform_mutex_unlock(&mailbox.mutex);
+
+        platform_semaphore_wait(&mailbox.done);
+        platform_mutex_lock(&mailbox.mutex);
+        expect_should_be(i * 10 + 1, mailbox.message);
+        platform_mutex_unlock(&mailbox.mutex);
+    }
+    platform_mutex_lock(&mailbox.mutex);
+    mailbox.message = 0;
+    mailbox.full = true;
+    platform_condition_broadcast(&mailbox.changed);
+    platform_mutex_unlock(&mailbox.mutex);
+    // The thread's exit code comes back from the join.
+    expect_should_be(100, platform_thread_join(&thread));
+    return true;
+}
+
+typedef struct LocalCheck {
+    KThreadLocalKey* key;
+    void* seenBeforeSet;
+    void* seenAfterSet;
+    u64 threadId;
+} LocalCheck;
+
+static u32 check_thread_local(void* params) {
+    LocalCheck* check = params;
+    check->seenBeforeSet = platform_thread_local_get(check->key);
+    platform_thread_local_set(check->key, check);
+    check->seenAfterSet = platform_thread_local_get(check->key);
+    check->threadId = platform_thread_current_id();
+    return 0;
+}
+
+u8 thread_local_and_cpu_info_should_be_sane() {
+    KThreadLocalKey key;
+    expect_to_be_true(platform_thread_local_create(&key));
+    u32 mainValue = 7;
+    platform_thread_local_set(&key, &mainValue);
+
+    LocalCheck check = {&key, 0, 0, 0};
+    KThread thread;
+    expect_to_be_true(platform_thread_create(check_thread_local, &check, &thread));
+    platform_thread_join(&thread);
+    // Each thread sees only its own value.
+    expect_should_be(0, check.seenBeforeSet);
+    expect_should_be(&check, check.seenAfterSet);
+    expect_should_be(&mainValue, platform_thread_local_get(&key));
+    expect_should_not_be(0, check.threadId);
+    expect_should_not_be(platform_thread_current_id(), check.threadId);
+    platform_thread_local_destroy(&key);
+
+    PlatformCpuInfo info;
+    platform_get_cpu_info(&info);
+    KDEBUG("CPU: %u processors, %u cores, %u packages. L1d %u, L2 %u, L3 %u bytes, %u byte lines.",
+           info.processorCount, info.coreCount, info.packageCount, info.l1DataCacheSize, info.l2CacheSize, info.l3CacheSize, info.cacheLineSize);
+    expect_should_be(platform_get_processor_count(), info.processorCount);
+    expect_to_be_true((info.coreCount >= 1 && info.coreCount <= info.processorCount));
+    expect_to_be_true((info.packageCount >= 1 && info.packageCount <= info.coreCount));
+    expect_should_not_be(0, info.cacheLineSize);
+    // One processor per core, each on a different core.
+    u32 coreProcessors[256];
+    u32 listed = platform_get_core_processors(coreProcessors, 256);
+    expect_to_be_true((listed >= 1 && listed <= info.processorCount));
+    for (u32 i = 1; i < listed; ++i) {
+        expect_to_be_true(coreProcessors[i] > coreProcessors[i - 1]);
+        u32 core = platform_get_processor_core(coreProcessors[i]);
+        expect_to_be_true((core == INVALID_ID || core != platform_get_processor_core(coreProcessors[0])));
+    }
+
+    u32 value = 5;
+    expect_should_be(5, katomic_fetch_add_u32(&value, 3));
+    u32 expected = 7;
+    expect_to_be_false(katomic_compare_exchange_u32(&value, &expected, 1));
+    expect_should_be(8, expected);
+    expect_to_be_true(katomic_compare_exchange_u32(&value, &expected, 1));
+    expect_should_be(1, katomic_load_u32(&value));
+    return true;
+}
+
+void thread_register_tests() {
+    test_manager_register_test(mutex_should_serialize_threads, "Mutex should serialize threads");
+    test_manager_register_test(condition_and_semaphore_should_hand_off, "Condition variable and semaphore should hand off between threads");
+    test_manager_register_test(thread_local_and_cpu_info_should_be_sane, "Thread locals, thread ids and CPU info should be sane");
+}
@@ -0,0 +1,249 @@
+#include "systems/resource_system_test.h"
+#include "expect.h"
+#include <defines.h>
+#include "test_manager.h"
+#include <core/job_system.h>
+#include <core/kstring.h>
+#include <core/logger.h>
+#include <memory/kmemory.h>
+#include <platform/thread.h>
+#include <systems/resource_system.h>
+
+#define LOAD_COUNT 32
+#define SCRATCH_BYTES 4096
+
+typedef struct TestSystems {
+    TestSystem jobs;
+    TestSystem resources;
+} TestSystems;
+
+typedef struct TestLoads {
+    u32 loaded;
+    u32 unloaded;
+    // Set if a load found its scratch memory changed by another load.
+    u32 scratchCorrupted;
+} TestLoads;
+
+static TestLoads loads;
+
+// A loader for text resources, which the resource system does not provide itself.
+// "missing_item" fails to load.
+static b8 test_loader_load(ResourceLoader* self, const char* name, Resource* resource) {
+    // Fill some scratch memory, give other loads the chance to run, then check it is intact.
+    StackAllocator* scratch = resource_system_scratch_allocator();
+    if (!scratch) {
+        return false;
+    }
+    STACK_ALLOCATOR_SCOPE(scratchScope, scratch);
+    u8* block = stack_allocator_allocate(scratch, SCRATCH_BYTES);
+    u8 pattern = (u8)string_length(name) ^ (u8)name[string_length(name) - 1];
+    kset_memory(block, pattern, SCRATCH_BYTES);
+    platform_thread_yield();
+    for (u32 i = 0; i < SCRATCH_BYTES; ++i) {
+        if (block[i] != pattern) {
+            __atomic_store_n(&loads.scratchCorrupted, 1, __ATOMIC_RELAXED);
+            break;
+        }
+    }
+
+    if (strings_equal(name, "missing_item")) {
+        return false;
+    }
+    u32* threadIndex = kallocate_pooled(sizeof(u32), MEMORY_TAG_APPLICATION);
+    *threadIndex = job_system_thread_index();
+    resource->data = threadIndex;
+    resource->dataSize = sizeof(u32);
+    __atomic_add_fetch(&loads.loaded, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+static void test_loader_unload(ResourceLoader* self, Resource* resource) {
+    kfree_pooled(resource->data, resource->dataSize, MEMORY_TAG_APPLICATION);
+    resource->data = 0;
+    __atomic_add_fetch(&loads.unloaded, 1, __ATOMIC_RELAXED);
+}
+
+static void begin_systems(TestSystems* systems) {
+    kzero_memory(&loads, sizeof(TestLoads));
+
+    JobSystemConfig jobConfig;
+    jobConfig.workerCount = 3;
+    jobConfig.maxQueuedJobs = 64;
+    test_system_begin(&systems->jobs, job_system_initialize, job_system_shutdown, jobConfig, MEMORY_TAG_JOB);
+
+    ResourceSystemConfig resourceConfig;
+    resourceConfig.assetBasePath = "../assets";
+    resourceConfig.maxLoaderCount = 8;
+    resourceConfig.scratchSize = 64 * 1024;
+    test_system_begin(&systems->resources, resource_system_initialize, resource_system_shutdown, resourceConfig, MEMORY_TAG_APPLICATION);
+
+    ResourceLoader loader = {0};
+    loader.type = RESOURCE_TYPE_TEXT;
+    loader.typePath = "";
+    loader.load = test_loader_load;
+    loader.unload = test_loader_unload;
+    resource_system_register_loader(loader);
+}
+
+static void end_systems(TestSystems* systems) {
+    test_system_end(&systems->resources);
+    test_system_end(&systems->jobs);
+}
+
+typedef struct Delivery {
+    u32 count;
+    b8 hadResource;
+    u32 callbackThread;
+    u32 loadThread;
+} Delivery;
+
+static void on_loaded(Resource* resource, void* user) {
+    Delivery* delivery = user;
+    delivery->count++;
+    delivery->hadResource = resource != 0;
+    delivery->callbackThread = job_system_thread_index();
+    if (resource) {
+        delivery->loadThread = *(u32*)resource->data;
+        resource_system_unload(resource);
+    }
+}
+
+// Runs jobs and delivers loads on the main thread until the given number of callbacks have been made.
+static void deliver_loads(Delivery* deliveries, u32 count) {
+    for (;;) {
+        resource_system_process_completed_loads();
+        u32 delivered = 0;
+        for (u32 i = 0; i < count; ++i) {
+            delivered += deliveries[i].count;
+        }
+        if (delivered >= count) {
+            return;
+        }
+        if (!job_system_run_pending()) {
+            platform_thread_yield();
+        }
+    }
+}
+
+u8 resource_system_should_deliver_async_loads_on_main_thread() {
+    TestSystems systems;
+    begin_systems(&systems);
+
+    Delivery deliveries[LOAD_COUNT] = {0};
+    char name[32];
+    for (u32 i = 0; i < LOAD_COUNT; ++i) {
+        string_format(name, "item_%u", i);
+        expect_to_be_true(resource_system_load_async(name, RESOURCE_TYPE_TEXT, on_loaded, &deliveries[i]));
+    }
+    // Callbacks only ever come from the sync point.
+    for (u32 i = 0; i < LOAD_COUNT; ++i) {
+        expect_should_be(0, deliveries[i].count);
+    }
+
+    deliver_loads(deliveries, LOAD_COUNT);
+    for (u32 i = 0; i < LOAD_COUNT; ++i) {
+        expect_should_be(1, deliveries[i].count);
+        expect_to_be_true(deliveries[i].hadResource);
+        expect_should_be(0, deliveries[i].callbackThread);
+        // Loads run on the workers, even though the main thread ran jobs while it waited.
+        expect_should_not_be(0, deliveries[i].loadThread);
+        expect_should_not_be(INVALID_ID, deliveries[i].loadThread);
+    }
+    expect_should_be(LOAD_COUNT, loads.loaded);
+    expect_should_be(LOAD_COUNT, loads.unloaded);
+    // Each thread had a scratch stack to itself.
+    expect_should_be(0, loads.scratchCorrupted);
+
+    // Nothing is delivered twice.
+    resource_system_process_completed_loads();
+    expect_should_be(1, deliveries[0].count);
+
+    end_systems(&systems);
+    return true;
+}
+
+u8 resource_system_should_report_failed_async_loads() {
+    TestSystems systems;
+    begin_systems(&systems);
+
+    Delivery delivery = {0};
+    expect_to_be_true(resource_system_load_async("missing_item", RESOURCE_TYPE_TEXT, on_loaded, &delivery));
+    KDEBUG("Note: The following error is intentionally caused by this test.");
+    deliver_loads(&delivery, 1);
+    expect_should_be(1, delivery.count);
+    expect_to_be_false(delivery.hadResource);
+    expect_should_be(0, loads.unloaded);
+
+    // Nothing is started for a type without a loader.
+    KDEBUG("Note: The following errors are intentionally caused by this test.");
+    expect_to_be_false(resource_system_load_async("item", RESOURCE_TYPE_STATIC_MESH, on_loaded, &delivery));
+    expect_to_be_false(resource_system_load_async("item", RESOURCE_TYPE_CUSTOM, on_loaded, &delivery));
+    resource_system_process_completed_loads();
+    expect_should_be(1, delivery.count);
+
+    end_systems(&systems);
+    return true;
+}
+
+u8 resource_system_should_discard_undelivered_loads_on_shutdown() {
+    TestSystems systems;
+    begin_systems(&systems);
+
+    Delivery deliveries[8] = {0};
+    char name[32];
+    for (u32 i = 0; i < 8; ++i) {
+        string_format(name, "item_%u", i);
+        expect_to_be_true(resource_system_load_async(name, RESOURCE_TYPE_TEXT, on_loaded, &deliveries[i]));
+    }
+
+    // Shutdown waits for the loads, then unloads them without calling back.
+    end_systems(&systems);
+    expect_should_be(8, loads.loaded);
+    expect_should_be(8, loads.unloaded);
+    for (u32 i = 0; i < 8; ++i) {
+        expect_should_be(0, deliveries[i].count);
+    }
+    return true;
+}
+
+u8 image_loader_should_keep_the_decoded_image_without_copying_it() {
+    // Started first, so that it counts what the loader allocates.
+    TestSystem memory;
+    MemorySystemConfig memoryConfig;
+    memoryConfig.totalAllocSize = 8 * 1024 * 1024;
+    test_system_begin(&memory, memory_system_initialize, memory_system_shutdown, memoryConfig, MEMORY_TAG_APPLICATION);
+    TestSystems systems;
+    begin_systems(&systems);
+
+    // The first load also gives the pools their pages, which are not counted again.
+    Resource image;
+    expect_to_be_true(resource_system_load("girl1", RESOURCE_TYPE_IMAGE, &image));
+    resource_system_unload(&image);
+
+    u64 textureBytes = get_memory_tag_usage(MEMORY_TAG_TEXTURE);
+    u64 allocations = get_memory_alloc_count();
+    expect_to_be_true(resource_system_load("girl1", RESOURCE_TYPE_IMAGE, &image));
+    ImageResourceData* data = image.data;
+    expect_to_be_true((data->width > 0 && data->height > 0));
+    expect_should_be(4, data->channelCount);
+
+    // The pixels and their description are all that is left, in one heap block and one pooled block.
+    u64 pixelsSize = (u64)data->width * data->height * data->channelCount;
+    expect_should_be(textureBytes + pixelsSize + sizeof(ImageResourceData), get_memory_tag_usage(MEMORY_TAG_TEXTURE));
+    // The full path, the pixels and their description. A copy of the pixels would be one more.
+    expect_should_be(allocations + 3, get_memory_alloc_count());
+
+    resource_system_unload(&image);
+    expect_should_be(textureBytes, get_memory_tag_usage(MEMORY_TAG_TEXTURE));
+
+    end_systems(&systems);
+    test_system_end(&memory);
+    return true;
+}
+
+void resource_system_register_tests() {
+    test_manager_register_test(resource_system_should_deliver_async_loads_on_main_thread, "Resource system should deliver asynchronous loads on the main thread");
+    test_manager_register_test(resource_system_should_report_failed_async_loads, "Resource system should report failed asynchronous loads");
+    test_manager_register_test(resource_system_should_discard_undelivered_loads_on_shutdown, "Resource system should discard undelivered loads on shutdown");
+    test_manager_register_test(image_loader_should_keep_the_decoded_image_without_copying_it, "Image loader should keep the decoded image without copying it");
+}
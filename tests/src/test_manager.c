@@ -4,10 +4,11 @@
 #include <core/logger.h>
 #include <core/clock.h>
 #include <core/kstring.h>
+#include <memory/kmemory.h>
 
 typedef struct test_entry {
     PFN_test func;
-    char* desc;
+    const char* desc;
 } test_entry;
 
 static test_entry* tests;
@@ -16,7 +17,7 @@ void test_manager_init() {
     tests = darray_create(test_entry);
 }
 
-void test_manager_register_test(u8 (*PFN_test)(), char* desc) {
+void test_manager_register_test(u8 (*PFN_test)(), const char* desc) {
     test_entry e;
     e.func = PFN_test;
     e.desc = desc;
@@ -57,4 +58,19 @@ void test_manager_run_tests() {
     clock_stop(&total_time);
 
     KINFO("Results: %d passed, %d failed, %d skipped.", passed, failed, skipped);
-} 
\ No newline at end of file
+}
+
+void test_system_allocate(TestSystem* system, PFN_test_system_shutdown shutdown, MemoryTag tag) {
+    system->tag = tag;
+    system->shutdown = shutdown;
+    system->state = kallocate(system->memoryRequirement, tag);
+}
+
+void test_system_end(TestSystem* system) {
+    if (!system->state) {
+        return;
+    }
+    system->shutdown(system->state);
+    kfree(system->state, system->memoryRequirement, system->tag);
+    system->state = 0;
+}